@@ -1,5 +1,6 @@
 #include "graph.h"
 #include "program.h"
+#include "field_output.h"
 #include "mesh.h"
 #include <cmath>
 
@@ -51,10 +52,9 @@ int main(int argc, char **argv)
 
   timestep.init();
 
-
-  // Create a graph and initialize it with mesh data
-  Set points;
-  Set springs(points, points);
+  FieldOutput output("fem-", OutputFormat::VTK);
+  output.setMesh(&verts, "x", &tets);
+  output.addField(&verts, "v");
 
   // Take 100 time steps
   for (int i = 1; i <= 100; ++i) {
@@ -64,15 +64,15 @@ int main(int argc, char **argv)
     timestep.run();       // Run the timestep function
     timestep.mapArgs();   // Move data back to this memory space
 
-    // Copy the x field to the mesh and save it to an obj file
-    int vi = 0;
-    for (auto &vert : points) {
-      for(int ii = 0; ii < 3; ii++){
-        mesh.v[vi][ii] = x.get(vert)(ii);
-      }
-      vi++;
+    // Queue the step's fields to be written to a VTK file in the background
+    output.write(i);
+
+    // Checkpoint the simulation state every 10 steps. The state is written in
+    // the background while the next steps run.
+    if (i % 10 == 0) {
+      timestep.checkpoint("fem-"+std::to_string(i)+".smsh");
     }
-    mesh.updateSurfVert();
-    mesh.saveTetObj(std::to_string(i)+".obj");
   }
+  int status = output.flush();
+  return (timestep.waitForCheckpoints() != 0) ? -1 : status;
 }
@@ -1,7 +1,6 @@
 #include "graph.h"
 #include "program.h"
 #include "mesh.h"
-#include "timers.h"
 #include <cmath>
 #include <time.h>
 #include <sys/time.h>
@@ -90,7 +89,7 @@ int main(int argc, char **argv)
 //  for (auto quad = Pan.quads_MG[1]->begin(); quad != Pan.quads_MG[1]->end(); ++quad) {
 //    std::cout << float(T.get(*quad)) << std::endl;
 //  }
-//  simit::ir::printTimes();
+//  std::cout << Pan.solve_thermal.getProfile();
   if (PM.get(TPM::dumpVisit)) {
     DumpToVisit("Pan_L1",iter, time, Pan.Xsize[1], Pan.Ysize[1],
                 Pan.quads_MG[1], Pan.points_MG[1]);
@@ -1,5 +1,6 @@
 #include "graph.h"
 #include "program.h"
+#include "field_output.h"
 #include "mesh.h"
 #include <cmath>
 
@@ -100,6 +101,10 @@ int main(int argc, char **argv)
 
   timestep.init();
 
+  FieldOutput output("springs-", OutputFormat::VTK);
+  output.setMesh(&points, "x", &springs);
+  output.addField(&points, "v");
+
   // Take 100 time steps
   for (int i = 1; i <= 100; ++i) {
     std::cout << "timestep " << i << std::endl;
@@ -108,15 +113,8 @@ int main(int argc, char **argv)
     timestep.run();       // Run the timestep function
     timestep.mapArgs();   // Move data back to this memory space
 
-    // Copy the x field to the mesh and save it to an obj file
-    int vi = 0;
-    for (auto &vert : points) {
-      for(int ii = 0; ii < 3; ii++){
-        mesh.v[vi][ii] = x.get(vert)(ii);
-      }
-      vi++;
-    }
-    mesh.updateSurfVert();
-    mesh.saveTetObj(std::to_string(i)+".obj");
+    // Queue the step's fields to be written to a VTK file in the background
+    output.write(i);
   }
+  return output.flush();
 }
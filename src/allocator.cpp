@@ -0,0 +1,190 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+/// Allocations of at least this many bytes are mapped directly.
+const size_t kMapThreshold = 128 << 10;
+
+DefaultAllocator defaultAllocator;
+std::atomic<Allocator*> allocator(&defaultAllocator);
+
+size_t pageSize() {
+  static const size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+size_t roundUp(size_t bytes, size_t multiple) {
+  return (bytes + multiple-1) / multiple * multiple;
+}
+
+void* mapPages(size_t bytes) {
+  void* data = mmap(nullptr, bytes, PROT_READ|PROT_WRITE,
+                    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  return (data == MAP_FAILED) ? nullptr : data;
+}
+
+/// Map `bytes` bytes aligned to huge pages, by mapping an extra huge page and
+/// unmapping the unaligned ends, and advise the kernel to use huge pages.
+void* mapHugePages(size_t bytes) {
+  const size_t hugePage = getHugePageSize();
+  char* mapped = (char*)mapPages(bytes + hugePage);
+  if (mapped == nullptr) {
+    return nullptr;
+  }
+  char* data = (char*)roundUp((uintptr_t)mapped, hugePage);
+  if (data > mapped) {
+    munmap(mapped, data - mapped);
+  }
+  if (data + bytes < mapped + bytes + hugePage) {
+    munmap(data + bytes, (mapped + bytes + hugePage) - (data + bytes));
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+  return data;
+}
+
+}
+
+// class Allocator
+void* Allocator::reallocate(void* data, size_t oldBytes, size_t newBytes) {
+  void* newData = allocate(newBytes);
+  if (data != nullptr && newData != nullptr) {
+    memcpy(newData, data, std::min(oldBytes, newBytes));
+  }
+  deallocate(data, oldBytes);
+  return newData;
+}
+
+
+// class DefaultAllocator
+void* DefaultAllocator::allocate(size_t bytes) {
+  if (bytes == 0) {
+    return nullptr;
+  }
+
+  void* data = nullptr;
+  if (bytes < kMapThreshold) {
+    if (posix_memalign(&data, kAllocationAlignment, bytes) == 0) {
+      memset(data, 0, bytes);
+    }
+    else {
+      data = nullptr;
+    }
+  }
+  else {
+    const size_t mappedBytes = getMappedBytes(bytes);
+    if (hugePages == HugePages::None || bytes < getHugePageSize()) {
+      data = mapPages(mappedBytes);
+    }
+    else {
+#ifdef MAP_HUGETLB
+      if (hugePages == HugePages::Explicit) {
+        data = mmap(nullptr, mappedBytes, PROT_READ|PROT_WRITE,
+                    MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+          data = nullptr;
+        }
+      }
+#endif
+      if (data == nullptr) {
+        data = mapHugePages(mappedBytes);
+      }
+    }
+  }
+  simit_uassert(data != nullptr) << "could not allocate " << bytes << " bytes";
+  return data;
+}
+
+void DefaultAllocator::deallocate(void* data, size_t bytes) {
+  if (data == nullptr) {
+    return;
+  }
+  if (bytes < kMapThreshold) {
+    free(data);
+  }
+  else {
+    munmap(data, getMappedBytes(bytes));
+  }
+}
+
+void* DefaultAllocator::reallocate(void* data, size_t oldBytes,
+                                   size_t newBytes) {
+  if (data == nullptr || oldBytes < kMapThreshold || newBytes < kMapThreshold) {
+    return Allocator::reallocate(data, oldBytes, newBytes);
+  }
+
+  // Both sizes are mapped, so the mapping can be reused or remapped instead of
+  // copied. Mapped bytes beyond an allocation are always zero.
+  const size_t oldMappedBytes = getMappedBytes(oldBytes);
+  const size_t newMappedBytes = getMappedBytes(newBytes);
+  if (newMappedBytes == oldMappedBytes) {
+    if (newBytes < oldBytes) {
+      memset((char*)data + newBytes, 0, oldBytes - newBytes);
+    }
+    return data;
+  }
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+  // Pages from the huge page pool cannot be remapped
+  if (hugePages != HugePages::Explicit) {
+    void* newData = mremap(data, oldMappedBytes, newMappedBytes,
+                           MREMAP_MAYMOVE);
+    if (newData != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+      if (hugePages == HugePages::Transparent &&
+          newBytes >= getHugePageSize()) {
+        madvise(newData, newMappedBytes, MADV_HUGEPAGE);
+      }
+#endif
+      if (newBytes < oldBytes) {
+        memset((char*)newData + newBytes, 0, newMappedBytes - newBytes);
+      }
+      return newData;
+    }
+  }
+#endif
+  return Allocator::reallocate(data, oldBytes, newBytes);
+}
+
+size_t DefaultAllocator::getMappedBytes(size_t bytes) const {
+  if (hugePages != HugePages::None && bytes >= getHugePageSize()) {
+    return roundUp(bytes, getHugePageSize());
+  }
+  return roundUp(bytes, pageSize());
+}
+
+void setAllocator(Allocator* newAllocator) {
+  simit_uassert(newAllocator != nullptr) << "the allocator cannot be null";
+  allocator = newAllocator;
+}
+
+Allocator* getAllocator() {
+  return allocator.load();
+}
+
+size_t getHugePageSize() {
+  static const size_t size = []() {
+    size_t size = 0;
+    ifstream file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+    file >> size;
+    return (size > 0) ? size : (size_t)(2 << 20);
+  }();
+  return size;
+}
+
+}
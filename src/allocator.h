@@ -0,0 +1,88 @@
+#ifndef SIMIT_ALLOCATOR_H
+#define SIMIT_ALLOCATOR_H
+
+#include <cstddef>
+
+/// \file
+/// The allocator of runtime memory: set fields and endpoints, path indices and
+/// the temporaries of compiled functions. Every allocation is aligned to
+/// kAllocationAlignment bytes, which generated code assumes of the arrays it
+/// loads, so custom allocators must keep that guarantee.
+
+namespace simit {
+
+/// The alignment of all runtime allocations (a cache line, and the width of
+/// the widest vector registers).
+const size_t kAllocationAlignment = 64;
+
+/// Interface of runtime memory allocators. Objects that allocate remember the
+/// allocator they allocated from and free their memory with it, so an
+/// allocator must outlive the sets and functions created while it was set.
+class Allocator {
+public:
+  virtual ~Allocator() {}
+
+  /// Allocate `bytes` zeroed bytes aligned to kAllocationAlignment. Returns
+  /// nullptr if `bytes` is zero.
+  virtual void* allocate(size_t bytes) = 0;
+
+  /// Free `bytes` bytes at `data`, which were returned by allocate or
+  /// reallocate with the same size. Freeing nullptr does nothing.
+  virtual void deallocate(void* data, size_t bytes) = 0;
+
+  /// Resize the `oldBytes` bytes at `data` to `newBytes` bytes, keeping their
+  /// contents and zeroing any new bytes. The default allocates, copies and
+  /// deallocates.
+  virtual void* reallocate(void* data, size_t oldBytes, size_t newBytes);
+};
+
+/// Whether large allocations are backed by huge pages, which cut the TLB
+/// misses of loops over large sets.
+enum class HugePages {
+  /// Use the pages the kernel gives by default.
+  None,
+
+  /// Align allocations of at least one huge page to huge pages and advise the
+  /// kernel to back them with transparent huge pages.
+  Transparent,
+
+  /// Back allocations of at least one huge page with pages from the
+  /// reserved huge page pool (`vm.nr_hugepages`), and fall back to
+  /// transparent huge pages when the pool is empty.
+  Explicit
+};
+
+/// The default allocator. Small allocations come from the C heap and large
+/// ones are mapped directly, so their pages are not touched until used and
+/// stay free to be placed on NUMA nodes (see numa.h).
+class DefaultAllocator : public Allocator {
+public:
+  DefaultAllocator(HugePages hugePages=HugePages::None)
+      : hugePages(hugePages) {}
+
+  HugePages getHugePages() const {return hugePages;}
+
+  void* allocate(size_t bytes);
+  void deallocate(void* data, size_t bytes);
+  void* reallocate(void* data, size_t oldBytes, size_t newBytes);
+
+private:
+  HugePages hugePages;
+
+  /// The number of bytes mapped for an allocation of `bytes` bytes.
+  size_t getMappedBytes(size_t bytes) const;
+};
+
+/// Set the allocator of runtime memory allocated from now on. The allocator
+/// is not owned and must outlive everything allocated from it.
+void setAllocator(Allocator* allocator);
+
+/// The allocator of runtime memory, by default a DefaultAllocator without
+/// huge pages.
+Allocator* getAllocator();
+
+/// The size of the transparent huge pages of the machine.
+size_t getHugePageSize();
+
+}
+#endif
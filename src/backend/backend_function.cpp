@@ -15,7 +15,8 @@ namespace backend {
 
 // class Function
 Function::Function(const ir::Func& func)
-    : environment(new ir::Environment(func.getEnvironment())) {
+    : environment(new ir::Environment(func.getEnvironment())),
+      settings(internal::getThreadSettings()) {
   for (const ir::Var& arg : func.getArguments()) {
     string argName = arg.getName();
     arguments.push_back(argName);
@@ -108,4 +109,24 @@ const ir::Environment& Function::getEnvironment() const {
   return *environment;
 }
 
+const Settings& Function::getSettings() const {
+  return settings;
+}
+
+void Function::setProfiler(std::shared_ptr<internal::Profiler> profiler) {
+  this->profiler = profiler;
+}
+
+const std::shared_ptr<internal::Profiler>& Function::getProfiler() const {
+  return profiler;
+}
+
+void Function::setHaloHazard(const std::string& hazard) {
+  this->haloHazard = hazard;
+}
+
+const std::string& Function::getHaloHazard() const {
+  return haloHazard;
+}
+
 }}
@@ -6,14 +6,20 @@
 #include <map>
 #include <functional>
 #include <set>
+#include <memory>
 
 #include "interfaces/printable.h"
 #include "interfaces/uncopyable.h"
+#include "settings.h"
 
 namespace simit {
 class Set;
 class TensorData;
 
+namespace internal {
+class Profiler;
+}
+
 namespace ir {
 class Func;
 class Environment;
@@ -74,8 +80,26 @@ public:
 
   const ir::Environment& getEnvironment() const;
 
+  /// The settings the function was compiled with. They must be in effect on
+  /// the calling thread when the function is bound and initialized.
+  const Settings& getSettings() const;
+
+  /// The profiler that collects the function's counters, if it was compiled
+  /// with profiling (see Program::compileWithProfiler).
+  void setProfiler(std::shared_ptr<internal::Profiler> profiler);
+  const std::shared_ptr<internal::Profiler>& getProfiler() const;
+
+  /// Why the function can not run on distributed sets that only update their
+  /// halos before each run, or an empty string if it can (see
+  /// ir::findHaloHazard).
+  void setHaloHazard(const std::string& hazard);
+  const std::string& getHaloHazard() const;
+
 private:
   ir::Environment* environment;
+  Settings settings;
+  std::shared_ptr<internal::Profiler> profiler;
+  std::string haloHazard;
 
   std::vector<std::string> arguments;
   std::map<std::string, ir::Type> argumentTypes;
@@ -57,10 +57,18 @@ GPUBackend::GPUBackend() : LLVMBackend() {
 }
 
 Function* GPUBackend::compile(ir::Func irFunc, const ir::Storage& storage) {
+  simit_uassert(!ir::ScalarType::longIndices())
+      << "The GPU backend does not support 8-byte indices";
+
   std::ofstream irFile("simit.sim", std::ofstream::trunc);
   irFile << irFunc;
   irFile.close();
 
+  // See LLVMBackend::compile
+  this->context = std::make_shared<llvm::LLVMContext>();
+  LLVMContextScope contextScope(this->context.get());
+  this->builder.reset(new LLVMIRBuilder(*this->context));
+
   this->irFunc = irFunc;
   this->module = createNVVMModule("kernels-module");
   this->dataLayout.reset(new llvm::DataLayout(module));
@@ -171,7 +179,8 @@ Function* GPUBackend::compile(ir::Func irFunc, const ir::Storage& storage) {
   // Fake an EngineBuilder to allow interfacing with the LLVMFunction
   // superclass.
   std::shared_ptr<llvm::EngineBuilder> engineBuilder = createEngineBuilder(module);
-  return new GPUFunction(this->irFunc, func, module, engineBuilder, storage);
+  return new GPUFunction(context, this->irFunc, func, module, engineBuilder,
+                         storage);
 }
 
 void GPUBackend::compile(const ir::Literal& op) {
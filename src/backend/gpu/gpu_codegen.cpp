@@ -3,6 +3,7 @@
 #include "nvvm.h"
 
 #include <fstream>
+#include <mutex>
 #include "llvm/ADT/SmallString.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IRReader/IRReader.h"
@@ -23,6 +24,7 @@
 
 std::string libdevicePtxCache;
 std::string intrinsicsPtxCache;
+static std::mutex libraryPtxCacheMutex;
 
 /// Declare method in the NVPTX LLVM library
 namespace llvm {
@@ -141,6 +143,7 @@ extern "C" unsigned char simit_gpu_intrinsics[];
 extern "C" int simit_gpu_intrinsics_length;
 
 std::vector<std::string> generateLibraryPtx(int devMajor, int devMinor) {
+  std::lock_guard<std::mutex> lock(libraryPtxCacheMutex);
   if (libdevicePtxCache.size() > 0 &&
       intrinsicsPtxCache.size() > 0) {
     return {libdevicePtxCache, intrinsicsPtxCache};
@@ -53,11 +53,13 @@ static CUdeviceptr getGlobalDevPtr(CUmodule& cudaModule, std::string name,
 }
 
 GPUFunction::GPUFunction(
+    std::shared_ptr<llvm::LLVMContext> context,
     ir::Func simitFunc, llvm::Function *llvmFunc,
     llvm::Module *module,
     std::shared_ptr<llvm::EngineBuilder> engineBuilder,
     const ir::Storage& storage)
-    : LLVMFunction(simitFunc, storage, llvmFunc, module, engineBuilder, true),
+    : LLVMFunction(context, simitFunc, storage, llvmFunc, module, engineBuilder,
+                   true),
       cudaModule(nullptr) {
 
   // Subset of LLVMFunction init:
@@ -90,9 +92,9 @@ GPUFunction::GPUFunction(
     if (tensorIndex.getKind() == ir::TensorIndex::PExpr) {
       const ir::Var& rowptr = tensorIndex.getRowptrArray();
       const pe::PathExpression& pexpr = tensorIndex.getPathExpression();
-      const uint32_t **rowptrPtr = (const uint32_t**)new uint32_t*;
+      const void **rowptrPtr = (const void**)new uint32_t*;
       *rowptrPtr = nullptr;
-      const uint32_t **colidxPtr = (const uint32_t**)new uint32_t*;
+      const void **colidxPtr = (const void**)new uint32_t*;
       *colidxPtr = nullptr;
       tensorIndexPtrs.insert({pexpr, {rowptrPtr, colidxPtr}});
     }
@@ -295,7 +297,10 @@ GPUFunction::SetData GPUFunction::pushSetData(Set* set, const ir::SetType* setTy
     simit_iassert(ftype.isTensor()) << "Element field must be tensor type";
     const ir::TensorType *ttype = ftype.toTensor();
     void *fieldData = set->getFieldData(field.name);
-    size_t size = set->getSize() * ttype->size() * ttype->getComponentType().bytes();
+    size_t componentSize = (field.floatBytes != 0)
+                           ? field.floatBytes
+                           : ttype->getComponentType().bytes();
+    size_t size = set->getSize() * ttype->size() * componentSize;
     simit_iassert(size != 0)
         << "Cannot allocate set field of size 0: " << field.name;
     checkCudaErrors(cuMemAlloc(devBuffer, size));
@@ -620,6 +625,7 @@ llvm::Function *GPUFunction::createHarness(
 
 backend::Function::FuncType
 GPUFunction::init() {
+  LLVMContextScope contextScope(context.get());
   CUlinkState linker;
   CUfunction cudaFunction;
 
@@ -880,8 +886,8 @@ GPUFunction::init() {
       continue;
     }
     const pe::PathExpression& pexpr = tensorIndex.getPathExpression();
-    const uint32_t** rowptrDataPtr = tensorIndexPtrs[pexpr].first;
-    const uint32_t** colidxDataPtr = tensorIndexPtrs[pexpr].second;
+    const void** rowptrDataPtr = tensorIndexPtrs[pexpr].first;
+    const void** colidxDataPtr = tensorIndexPtrs[pexpr].second;
     CUdeviceptr *devRowptrBuffer = new CUdeviceptr();
     CUdeviceptr *devColidxBuffer = new CUdeviceptr();
 
@@ -21,7 +21,8 @@ class Actual;
 
 class GPUFunction : public LLVMFunction {
  public:
-  GPUFunction(ir::Func simitFunc, llvm::Function *llvmFunc,
+  GPUFunction(std::shared_ptr<llvm::LLVMContext> context,
+              ir::Func simitFunc, llvm::Function *llvmFunc,
               llvm::Module *module,
               std::shared_ptr<llvm::EngineBuilder> engineBuilder,
               const ir::Storage& storage);
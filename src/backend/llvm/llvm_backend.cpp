@@ -4,9 +4,11 @@
 #include <iostream>
 #include <stack>
 #include <algorithm>
+#include <mutex>
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Value.h"
@@ -26,6 +28,7 @@
 #include "llvm_codegen.h"
 #include "llvm_util.h"
 #include "llvm_data_layouts.h"
+#include "llvm_vectorization_report.h"
 
 #include "macros.h"
 #include "types.h"
@@ -37,6 +40,7 @@
 #include "ir_transforms.h"
 #include "ir_rewriter.h" // TODO: Remove this header
 #include "environment.h"
+#include "allocator.h"
 #include "tensor_index.h"
 #include "llvm_function.h"
 #include "macros.h"
@@ -47,6 +51,8 @@ using namespace std;
 using namespace simit::ir;
 
 namespace simit {
+extern thread_local bool kVectorizationReport;
+
 namespace backend {
 
 const std::string VAL_SUFFIX(".val");
@@ -54,21 +60,19 @@ const std::string PTR_SUFFIX(".ptr");
 const std::string LEN_SUFFIX(".len");
 
 // class LLVMBackend
-bool LLVMBackend::llvmInitialized = false;
-
 shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
   shared_ptr<llvm::EngineBuilder> engineBuilder(
       new llvm::EngineBuilder(std::unique_ptr<llvm::Module>(module)));
   return engineBuilder;
 }
 
-LLVMBackend::LLVMBackend() : builder(new LLVMIRBuilder(LLVM_CTX)) {
-  if (!llvmInitialized) {
+LLVMBackend::LLVMBackend() {
+  static std::once_flag llvmInitialized;
+  std::call_once(llvmInitialized, []() {
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
     llvm::InitializeNativeTargetAsmParser();
-    llvmInitialized = true;
-  }
+  });
 }
 
 LLVMBackend::~LLVMBackend() {}
@@ -110,7 +114,12 @@ Func LLVMBackend::makeSystemTensorsGlobal(Func func) {
 }
 
 Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
-  this->module = new llvm::Module("simit", LLVM_CTX);
+  // Generate code in a fresh context that the compiled function takes
+  // ownership of, so that functions can be compiled on different threads.
+  this->context = std::make_shared<llvm::LLVMContext>();
+  LLVMContextScope contextScope(this->context.get());
+  this->builder.reset(new LLVMIRBuilder(*this->context));
+  this->module = new llvm::Module("simit", *this->context);
 
   simit_iassert(func.getBody().defined())
       << "cannot compile an undefined function";
@@ -120,6 +129,8 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   this->symtable.clear();
   this->buffers.clear();
   this->globals.clear();
+  this->allocatedGlobals.clear();
+  this->bufferAccesses.clear();
   this->storage = storage;
 
   // This backend stores dense tensors and sparse tensors with path expressions
@@ -168,7 +179,7 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
 
   // Declare malloc and free if necessary
   llvm::FunctionType *m =
-      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT}, false);
+      llvm::FunctionType::get(LLVM_INT8_PTR, {llvmIndexType()}, false);
   llvm::Function *malloc =
       llvm::cast<llvm::Function>(module->getOrInsertFunction("malloc", m));
   llvm::FunctionType *f =
@@ -190,7 +201,7 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     const TensorType *ttype = type.toTensor();
     llvm::Value *len= emitComputeLen(ttype,this->storage.getStorage(bufferVar));
     unsigned compSize = ttype->getComponentType().bytes();
-    llvm::Value *size = builder->CreateMul(len, llvmInt(compSize));
+    llvm::Value *size = builder->CreateNSWMul(len, llvmIndex(compSize));
     llvm::Value *mem = builder->CreateCall(malloc, size);
 
     mem = builder->CreateCast(llvm::Instruction::CastOps::BitCast, mem, ltype);
@@ -215,6 +226,8 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   builder->CreateRetVoid();
   symtable.clear();
 
+  emitAliasMetadata();
+
   simit_iassert(!llvm::verifyModule(*module))
       << "LLVM module does not pass verification";
 
@@ -241,14 +254,24 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   pmBuilder.populateFunctionPassManager(fpm);
   pmBuilder.populateModulePassManager(mpm);
 
+  std::unique_ptr<VectorizationReport> report;
+  if (kVectorizationReport) {
+    report.reset(new VectorizationReport(context.get()));
+  }
+
   fpm.doInitialization();
   fpm.run(*llvmFunc);
   fpm.doFinalization();
   
   mpm.run(*module);
+
+  if (report) {
+    report->print(std::cerr);
+  }
 #endif
 
-  return new LLVMFunction(func, storage, llvmFunc, module, engineBuilder);
+  return new LLVMFunction(context, func, storage, llvmFunc, module,
+                          engineBuilder);
 }
 
 void LLVMBackend::compile(const ir::Literal& literal) {
@@ -262,7 +285,7 @@ void LLVMBackend::compile(const ir::Literal& literal) {
       case ScalarType::Int: {
         simit_iassert(ctype.bytes() == 4)
             << "Only 4-byte ints currently supported";
-        val = llvmInt(((int*)literal.data)[0]);
+        val = llvmIndex(((int*)literal.data)[0]);
         break;
       }
       case ScalarType::Float: {
@@ -320,6 +343,10 @@ void LLVMBackend::compile(const ir::VarExpr& varExpr) {
       llvm::Type* eltTy = val->getType()->getPointerElementType();
       val = builder->CreateAddrSpaceCast(val, eltTy->getPointerTo(0));
     }
+    if (util::contains(allocatedGlobals, varExpr.var) &&
+        val->getType()->isPointerTy()) {
+      emitAssumeAligned(val);
+    }
   }
 
   // Special case: check if the symbol is a scalar and the llvm value is a ptr,
@@ -332,6 +359,11 @@ void LLVMBackend::compile(const ir::VarExpr& varExpr) {
     if (val->getType()->isPointerTy() && (!isString(varExpr.type) || 
         val->getType()->getContainedType(0)->isPointerTy())) {
       val = builder->CreateLoad(val, valName);
+
+      // Int arguments are stored in 4 bytes, but may be computed on in 8 bytes
+      if (isInt(varExpr.type) && val->getType() != llvmIndexType()) {
+        val = builder->CreateSExt(val, llvmIndexType(), valName);
+      }
     }
   }
 }
@@ -341,11 +373,22 @@ void LLVMBackend::compile(const ir::Load& load) {
   llvm::Value *index = compile(load.index);
 
   string locName = string(buffer->getName()) + PTR_SUFFIX;
-  llvm::Value *bufferLoc = llvmCreateInBoundsGEP(
-      builder.get(), buffer, index, locName);
+  llvm::Value *bufferLoc = emitElementPtr(buffer, index, locName);
 
   string valName = string(buffer->getName()) + VAL_SUFFIX;
-  val = builder->CreateLoad(bufferLoc, valName);
+  llvm::LoadInst *bufferVal = builder->CreateLoad(bufferLoc, valName);
+  addBufferAccess(load.buffer, bufferVal);
+  val = bufferVal;
+
+  // Int data is stored in 4 bytes, but may be computed on in 8 bytes
+  if (isInt(load.type) && val->getType() != llvmIndexType()) {
+    val = builder->CreateSExt(val, llvmIndexType(), valName);
+  }
+  // Float fields may be stored at a different width than they are computed on
+  else if (val->getType()->isFloatingPointTy() &&
+           val->getType() != llvmFloatType()) {
+    val = builder->CreateFPCast(val, llvmFloatType(), valName);
+  }
 }
 
 void LLVMBackend::compile(const ir::FieldRead& fieldRead) {
@@ -364,6 +407,7 @@ void LLVMBackend::compile(const ir::IndexRead& indexRead) {
   switch (indexRead.kind) {
     case ir::IndexRead::Endpoints:
       val = layout->getEpsArray();
+      emitAssumeAligned(val);
       break;
     case ir::IndexRead::GridDim:
       simit_iassert(indexRead.edgeSet.type().isGridSet());
@@ -652,10 +696,10 @@ void LLVMBackend::compile(const ir::VarDecl& varDecl) {
       else {
         auto index = tensorStorage.getTensorIndex();
         auto rowptr = index.getRowptrArray();
-        auto rowptrPtr = builder->CreateAlloca(LLVM_INT_PTR, llvmInt(1),
+        auto rowptrPtr = builder->CreateAlloca(llvmIndexPtrType(), llvmInt(1),
                                                rowptr.getName()+PTR_SUFFIX);
         auto colidx = index.getColidxArray();
-        auto colidxPtr = builder->CreateAlloca(LLVM_INT_PTR, llvmInt(1),
+        auto colidxPtr = builder->CreateAlloca(llvmIndexPtrType(), llvmInt(1),
                                                colidx.getName()+PTR_SUFFIX);
         symtable.insert(rowptr, rowptrPtr);
         symtable.insert(colidx, colidxPtr);
@@ -705,6 +749,9 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
 
       auto tensorStorage = storage.getStorage(to<VarExpr>(argument)->var);
       auto tensorIndex = tensorStorage.getTensorIndex();
+      simit_uassert(tensorStorage.getKind() != TensorStorage::Symmetric)
+          << "symmetric matrices (Settings::symmetricMatrices) only store "
+          << "their upper triangle and can not be passed to " << argument;
 
       llvm::Value *rowptr = compile(tensorIndex.getRowptrArray());
       llvm::Value *colidx = compile(tensorIndex.getColidxArray());
@@ -717,8 +764,8 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
       llvm::Value* mm;
       Type blockType = type->getBlockType();
       if (isScalar(blockType)) {
-        nn = llvmInt(1);
-        mm = llvmInt(1);
+        nn = llvmIndex(1);
+        mm = llvmIndex(1);
       }
       else {
         auto blockDimensions = blockType.toTensor()->getDimensions();
@@ -798,8 +845,8 @@ LLVMBackend::emitResult(ir::Var result, bool excludeStaticTypes,
       llvm::Value* mm;
       Type blockType = tensorType->getBlockType();
       if (isScalar(blockType)) {
-        nn = llvmInt(1);
-        mm = llvmInt(1);
+        nn = llvmIndex(1);
+        mm = llvmIndex(1);
       }
       else {
         auto blockDimensions = blockType.toTensor()->getDimensions();
@@ -870,6 +917,10 @@ void LLVMBackend::emitInternalCall(const ir::CallStmt& callStmt) {
 }
 
 void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
+  simit_uassert(!ScalarType::longIndices())
+      << "External function '" << callStmt.callee.getName() << "' can not be "
+      << "called when using 8-byte indices";
+
   // ensure it is called with the correct number of arguments.
   simit_uassert(callStmt.actuals.size()== callStmt.callee.getArguments().size())
       << "External function '" << callStmt.callee.getName() << "' called with "
@@ -878,6 +929,14 @@ void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
 
   // Arguments
   auto args = emitArguments(callStmt.actuals, false);
+  for (llvm::Value* arg : args) {
+    llvm::Type* argType = arg->getType();
+    simit_uassert(!argType->isPointerTy() ||
+                  !argType->getPointerElementType()->isFloatingPointTy() ||
+                  argType->getPointerElementType() == llvmFloatType())
+        << "External function '" << callStmt.callee.getName() << "' can not "
+        << "be passed a field stored at a different float precision";
+  }
 
   // Results
   vector<std::pair<ir::Var, llvm::Value*>> resultVals;
@@ -955,7 +1014,8 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
                                compile(callStmt.actuals[1]));
   }
   else if (callStmt.callee == ir::intrinsics::loc()) {
-    call = emitCall("loc", args, LLVM_INT);
+    std::string fname = ScalarType::longIndices() ? "loc_i64" : "loc";
+    call = emitCall(fname, args, llvmIndexType());
   }
   else if (callStmt.callee == ir::intrinsics::free()) {
     auto arg = args[args.size()-1];
@@ -970,7 +1030,7 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
     call = emitCall("strcmp", args, LLVM_INT);
   }
   else if (callStmt.callee == ir::intrinsics::strlen()) {
-    call = emitCall("strlen", args, LLVM_INT);
+    call = emitCall("strlen", args, LLVM_INT64);
   }
   else if (callStmt.callee == ir::intrinsics::strcpy()) {
     call = emitCall("strcpy", args, LLVM_INT8_PTR);
@@ -984,6 +1044,13 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
   else if (callStmt.callee == ir::intrinsics::storeTime()) {
     call = emitCall("storeTime", args);
   }
+  else if (callStmt.callee == ir::intrinsics::profileBegin() ||
+           callStmt.callee == ir::intrinsics::profileEnd()) {
+    simit_iassert(args.size() == 1);
+    std::string fname = (callStmt.callee == ir::intrinsics::profileBegin())
+                        ? "simit_profile_begin" : "simit_profile_end";
+    call = emitCall(fname, {builder->CreateSExtOrTrunc(args[0], LLVM_INT32)});
+  }
   else if (callee == ir::intrinsics::det()) {
     simit_iassert(args.size() == 1);
     std::string fname = callStmt.callee.getName() + "3" + floatTypeName;
@@ -1061,6 +1128,13 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
     simit_iassert(callStmt.results.size() == 1);
     Var var = callStmt.results[0];
     llvm::Value *llvmVar = symtable.get(var);
+
+    // Integer results from C functions may be narrower or wider than Int
+    llvm::Type *varType = llvmVar->getType()->getPointerElementType();
+    if (call->getType()->isIntegerTy() && varType->isIntegerTy() &&
+        call->getType() != varType) {
+      call = builder->CreateSExtOrTrunc(call, varType);
+    }
     builder->CreateStore(call, llvmVar);
   }
 }
@@ -1102,9 +1176,19 @@ void LLVMBackend::compile(const ir::Store& store) {
   simit_iassert(value != nullptr);
 
   string locName = string(buffer->getName()) + PTR_SUFFIX;
-  llvm::Value *bufferLoc = llvmCreateInBoundsGEP(builder.get(),
-                                                 buffer, index, locName);
-  builder->CreateStore(value, bufferLoc);
+  llvm::Value *bufferLoc = emitElementPtr(buffer, index, locName);
+
+  // Int data is stored in 4 bytes, but may be computed on in 8 bytes
+  llvm::Type *elemType = bufferLoc->getType()->getPointerElementType();
+  if (value->getType()->isIntegerTy() && value->getType() != elemType) {
+    value = builder->CreateTrunc(value, elemType);
+  }
+  // Float fields may be stored at a different width than they are computed on
+  else if (value->getType()->isFloatingPointTy() &&
+           value->getType() != elemType) {
+    value = builder->CreateFPCast(value, elemType);
+  }
+  addBufferAccess(store.buffer, builder->CreateStore(value, bufferLoc));
 }
 
 void LLVMBackend::compile(const ir::FieldWrite& fieldWrite) {
@@ -1133,7 +1217,14 @@ void LLVMBackend::compile(const ir::FieldWrite& fieldWrite) {
       llvm::Value *fieldLen =
           emitComputeLen(tensorFieldType, TensorStorage::Dense);
       unsigned compSize = tensorFieldType->getComponentType().bytes();
-      llvm::Value *fieldSize = builder->CreateMul(fieldLen,llvmInt(compSize));
+
+      // Float fields may be stored at a different width than floatBytes
+      llvm::Type *fieldElemType = fieldPtr->getType()->getPointerElementType();
+      if (fieldElemType->isFloatingPointTy()) {
+        compSize = fieldElemType->getPrimitiveSizeInBits() / 8;
+      }
+      llvm::Value *fieldSize = builder->CreateNSWMul(fieldLen,
+                                                     llvmIndex(compSize));
 
       emitMemSet(fieldPtr, llvmInt(0,8), fieldSize, compSize);
     }
@@ -1172,9 +1263,8 @@ void LLVMBackend::compile(const ir::FieldWrite& fieldWrite) {
     llvm::Value *fieldLen =
         emitComputeLen(tensorFieldType, TensorStorage::Dense);
     unsigned elemSize = tensorFieldType->getComponentType().bytes();
-    llvm::Value *fieldSize = builder->CreateMul(fieldLen, llvmInt(elemSize));
 
-    emitMemCpy(fieldPtr, valuePtr, fieldSize, elemSize);
+    emitCopy(fieldPtr, valuePtr, fieldLen, elemSize);
   }
 }
 
@@ -1237,7 +1327,7 @@ void LLVMBackend::compile(const ir::ForRange& forLoop) {
   builder->CreateCondBr(firstCmp, loopBodyStart, loopEnd);
   builder->SetInsertPoint(loopBodyStart);
 
-  llvm::PHINode *i = llvmCreatePHI(builder.get(), LLVM_INT32, 2, iName);
+  llvm::PHINode *i = llvmCreatePHI(builder.get(), llvmIndexType(), 2, iName);
   i->addIncoming(rangeStart, entryBlock);
 
   // Loop Body
@@ -1246,7 +1336,7 @@ void LLVMBackend::compile(const ir::ForRange& forLoop) {
 
   // Loop Footer
   llvm::BasicBlock *loopBodyEnd = builder->GetInsertBlock();
-  llvm::Value *i_nxt = builder->CreateAdd(i, builder->getInt32(1),
+  llvm::Value *i_nxt = builder->CreateAdd(i, llvmIndex(1),
                                           iName+"_nxt", false, true);
   i->addIncoming(i_nxt, loopBodyEnd);
 
@@ -1296,12 +1386,12 @@ void LLVMBackend::compile(const ir::For& forLoop) {
   llvm::BasicBlock *loopEnd = llvm::BasicBlock::Create(LLVM_CTX,
                                                        iName+"_loop_end",
                                                        llvmFunc);
-  llvm::Value *firstCmp = llvmCreateICmpSLT(builder.get(), llvmInt(0), iNum);
+  llvm::Value *firstCmp = llvmCreateICmpSLT(builder.get(), llvmIndex(0), iNum);
   builder->CreateCondBr(firstCmp, loopBodyStart, loopEnd);
   builder->SetInsertPoint(loopBodyStart);
 
-  llvm::PHINode *i = llvmCreatePHI(builder.get(), LLVM_INT32, 2, iName);
-  i->addIncoming(builder->getInt32(0), entryBlock);
+  llvm::PHINode *i = llvmCreatePHI(builder.get(), llvmIndexType(), 2, iName);
+  i->addIncoming(llvmIndex(0), entryBlock);
 
   // Loop Body
   symtable.insert(forLoop.var, i);
@@ -1309,7 +1399,7 @@ void LLVMBackend::compile(const ir::For& forLoop) {
 
   // Loop Footer
   llvm::BasicBlock *loopBodyEnd = builder->GetInsertBlock();
-  llvm::Value *i_nxt = builder->CreateAdd(i, builder->getInt32(1),
+  llvm::Value *i_nxt = builder->CreateAdd(i, llvmIndex(1),
                                           iName+"_nxt", false, true);
   i->addIncoming(i_nxt, loopBodyEnd);
 
@@ -1378,9 +1468,12 @@ void LLVMBackend::compile(const ir::Print& print) {
         specifier = std::string("%") + print.format + "<%g,%g>";
         break;
       case ScalarType::Boolean:
-      case ScalarType::Int:
         specifier = std::string("%") + print.format + "d";
         break;
+      case ScalarType::Int:
+        specifier = std::string("%") + print.format +
+                    (ScalarType::longIndices() ? "lld" : "d");
+        break;
       case ScalarType::String:
         simit_unreachable;
         break;
@@ -1428,14 +1521,26 @@ llvm::Value *LLVMBackend::emitFieldRead(const Expr &elemOrSet,
   
   assert(elemType->hasField(fieldName));
   unsigned fieldLoc = fieldsOffset + elemType->fieldNames.at(fieldName);
-  return llvmCreateExtractValue(builder.get(), setOrElemValue, {fieldLoc},
-                                setOrElemValue->getName()+"."+fieldName);
+  llvm::Value *field =
+      llvmCreateExtractValue(builder.get(), setOrElemValue, {fieldLoc},
+                             setOrElemValue->getName()+"."+fieldName);
+
+  // Set fields are allocated by the runtime allocator
+  if (elemOrSet.type().isSet()) {
+    emitAssumeAligned(field);
+  }
+  return field;
+}
+
+void LLVMBackend::emitAssumeAligned(llvm::Value *ptr) {
+  simit_iassert(ptr->getType()->isPointerTy());
+  builder->CreateAlignmentAssumption(*dataLayout, ptr, kAllocationAlignment);
 }
 
 llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
                                          const TensorStorage &tensorStorage) {
   if (tensorType->order() == 0) {
-    return llvmInt(1);
+    return llvmIndex(1);
   }
 
   vector<IndexDomain> dimensions = tensorType->getDimensions();
@@ -1446,7 +1551,7 @@ llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
       auto it = dimensions.begin();
       len = emitComputeLen(*it++);
       for (; it != dimensions.end(); ++it) {
-        len = builder->CreateMul(len, emitComputeLen(*it));
+        len = builder->CreateNSWMul(len, emitComputeLen(*it));
       }
       break;
     }
@@ -1459,10 +1564,11 @@ llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
       Type blockType = tensorType->getBlockType();
       llvm::Value *blockLen = emitComputeLen(blockType.toTensor(),
                                              TensorStorage::Dense);
-      len = builder->CreateMul(len, blockLen);
+      len = builder->CreateNSWMul(len, blockLen);
       break;
     }
-    case TensorStorage::Indexed: {
+    case TensorStorage::Indexed:
+    case TensorStorage::Symmetric: {
       // We retrieve the number of non-zero blocks in the index, which is stored
       // in the last (sentinel) entry of the coords/rowptr index array.
 
@@ -1489,7 +1595,7 @@ llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
         //       represented by a TensorStorage
         llvm::Value *blockSize = emitComputeLen(blockType.toTensor(),
                                                 TensorStorage::Dense);
-        len = builder->CreateMul(len, blockSize);
+        len = builder->CreateNSWMul(len, blockSize);
       }
       break;
     }
@@ -1510,7 +1616,7 @@ llvm::Value *LLVMBackend::emitComputeLen(const IndexDomain &dom) {
   auto it = dom.getIndexSets().begin();
   llvm::Value *result = emitComputeLen(*it++);
   for (; it != dom.getIndexSets().end(); ++it) {
-    result = builder->CreateMul(result, emitComputeLen(*it));
+    result = builder->CreateNSWMul(result, emitComputeLen(*it));
   }
   return result;
 }
@@ -1518,7 +1624,7 @@ llvm::Value *LLVMBackend::emitComputeLen(const IndexDomain &dom) {
 llvm::Value *LLVMBackend::emitComputeLen(const IndexSet &is) {
   switch (is.getKind()) {
     case IndexSet::Range:
-      return llvmInt(is.getSize());
+      return llvmIndex(is.getSize());
       break;
     case IndexSet::Set: {
       llvm::Value *setValue = compile(is.getSet());
@@ -1536,10 +1642,126 @@ llvm::Value *LLVMBackend::emitComputeLen(const IndexSet &is) {
 }
 
 llvm::Value *LLVMBackend::loadFromArray(llvm::Value *array, llvm::Value *index) {
-  llvm::Value *loc = llvmCreateInBoundsGEP(builder.get(), array, index);
+  llvm::Value *loc = emitElementPtr(array, index, "");
   return builder->CreateLoad(loc);
 }
 
+llvm::Value *LLVMBackend::emitElementPtr(llvm::Value *array,
+                                         llvm::Value *index,
+                                         const llvm::Twine &name) {
+  if (index->getType()->isIntegerTy() &&
+      index->getType()->getIntegerBitWidth() < 64) {
+    index = builder->CreateSExt(index, LLVM_INT64);
+  }
+  return llvmCreateInBoundsGEP(builder.get(), array, index, name);
+}
+
+void LLVMBackend::addBufferAccess(const ir::Expr &buffer,
+                                  llvm::Instruction *access) {
+  string key;
+  if (isa<FieldRead>(buffer)) {
+    const FieldRead *fieldRead = to<FieldRead>(buffer);
+    const Type& type = fieldRead->elementOrSet.type();
+    if (type.isSet()) {
+      key = "field " + type.toSet()->elementType.toElement()->name + "." +
+            fieldRead->fieldName;
+    }
+  }
+  else if (isa<IndexRead>(buffer)) {
+    const IndexRead *indexRead = to<IndexRead>(buffer);
+    if (indexRead->kind == IndexRead::Endpoints) {
+      key = "endpoints " +
+            indexRead->edgeSet.type().toSet()->elementType.toElement()->name;
+    }
+  }
+  else if (isa<VarExpr>(buffer)) {
+    const Var& var = to<VarExpr>(buffer)->var;
+    if (util::contains(allocatedGlobals, var) ||
+        util::contains(buffers, var)) {
+      key = "buffer " + var.getName();
+    }
+  }
+
+  // Fields and buffers that share a key share a scope, which is conservative
+  if (key != "") {
+    bufferAccesses[key].push_back(access);
+  }
+}
+
+void LLVMBackend::emitAliasMetadata() {
+  llvm::MDBuilder mdBuilder(LLVM_CTX);
+
+  // Scoped noalias metadata for the accesses through fields and buffers
+  if (bufferAccesses.size() > 1) {
+    llvm::MDNode *domain = mdBuilder.createAnonymousAliasScopeDomain("simit");
+    vector<llvm::Metadata*> scopes;
+    for (auto &accesses : bufferAccesses) {
+      scopes.push_back(mdBuilder.createAnonymousAliasScope(domain,
+                                                           accesses.first));
+    }
+
+    size_t i = 0;
+    for (auto &accesses : bufferAccesses) {
+      vector<llvm::Metadata*> otherScopes = scopes;
+      otherScopes.erase(otherScopes.begin() + i);
+      llvm::MDNode *scope = llvm::MDNode::get(LLVM_CTX, {scopes[i]});
+      llvm::MDNode *noalias = llvm::MDNode::get(LLVM_CTX, otherScopes);
+      for (llvm::Instruction *access : accesses.second) {
+        access->setMetadata(llvm::LLVMContext::MD_alias_scope, scope);
+        access->setMetadata(llvm::LLVMContext::MD_noalias, noalias);
+      }
+      ++i;
+    }
+  }
+
+  // TBAA metadata for scalar loads and stores. Bytes and booleans are left
+  // untagged, since like chars they may alias anything, and so are aggregates
+  // such as complex values.
+  llvm::MDNode *root = mdBuilder.createTBAARoot("Simit TBAA");
+  map<string, llvm::MDNode*> tags;
+  auto getTag = [&](llvm::Type *type) -> llvm::MDNode* {
+    string name;
+    if (type->isFloatTy()) {
+      name = "float";
+    }
+    else if (type->isDoubleTy()) {
+      name = "double";
+    }
+    else if (type->isIntegerTy() && type->getIntegerBitWidth() > 8) {
+      name = "int" + to_string(type->getIntegerBitWidth());
+    }
+    else if (type->isPointerTy()) {
+      name = "any pointer";
+    }
+    else {
+      return nullptr;
+    }
+    if (!util::contains(tags, name)) {
+      llvm::MDNode *typeNode = mdBuilder.createTBAAScalarTypeNode(name, root);
+      tags[name] = mdBuilder.createTBAAStructTagNode(typeNode, typeNode, 0);
+    }
+    return tags.at(name);
+  };
+  for (llvm::Function &function : *module) {
+    for (llvm::BasicBlock &block : function) {
+      for (llvm::Instruction &inst : block) {
+        llvm::Type *type = nullptr;
+        if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst)) {
+          type = load->getType();
+        }
+        else if (llvm::StoreInst *store =
+                     llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+          type = store->getValueOperand()->getType();
+        }
+        llvm::MDNode *tag = (type != nullptr) ? getTag(type) : nullptr;
+        if (tag != nullptr) {
+          inst.setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+        }
+      }
+    }
+  }
+}
+
 llvm::Value *LLVMBackend::emitCall(string name, vector<llvm::Value*> args) {
   return emitCall(name, args, LLVM_VOID);
 }
@@ -1670,6 +1892,7 @@ void LLVMBackend::emitGlobals(const ir::Environment& env, bool packed) {
                                              globalAddrspace(), packed);
     this->symtable.insert(tmp, ptr);
     this->globals.insert(tmp);
+    this->allocatedGlobals.insert(tmp);
   }
 
   // Emit global tensor indices
@@ -1681,6 +1904,7 @@ void LLVMBackend::emitGlobals(const ir::Environment& env, bool packed) {
                        globalAddrspace(), packed);
       this->symtable.insert(rowptr, rowptrPtr);
       this->globals.insert(rowptr);
+      this->allocatedGlobals.insert(rowptr);
 
       const Var& colidx  = tensorIndex.getColidxArray();
       llvm::GlobalVariable* colidxPtr =
@@ -1688,6 +1912,22 @@ void LLVMBackend::emitGlobals(const ir::Environment& env, bool packed) {
                        globalAddrspace(), packed);
       this->symtable.insert(colidx, colidxPtr);
       this->globals.insert(colidx);
+      this->allocatedGlobals.insert(colidx);
+
+      if (tensorIndex.isSliced()) {
+        for (const Var& array : {tensorIndex.getSliceptrArray(),
+                                 tensorIndex.getPermutationArray(),
+                                 tensorIndex.getLengthArray(),
+                                 tensorIndex.getSlicedColidxArray(),
+                                 tensorIndex.getSlicedLocArray()}) {
+          llvm::GlobalVariable* arrayPtr =
+              createGlobal(module, array, llvm::GlobalValue::ExternalLinkage,
+                           globalAddrspace(), packed);
+          this->symtable.insert(array, arrayPtr);
+          this->globals.insert(array);
+          this->allocatedGlobals.insert(array);
+        }
+      }
     }
   }
 }
@@ -1711,6 +1951,10 @@ void LLVMBackend::emitAssign(Var var, const Expr& value) {
   // Globals are stored as pointer-pointers so we must load them
   if (util::contains(globals, var)) {
     varPtr = builder->CreateLoad(varPtr, var.getName());
+    if (util::contains(allocatedGlobals, var) &&
+        varPtr->getType()->isPointerTy()) {
+      emitAssumeAligned(varPtr);
+    }
   }
 
   const TensorType *varType = var.getType().toTensor();
@@ -1718,15 +1962,19 @@ void LLVMBackend::emitAssign(Var var, const Expr& value) {
 
   // Assigning a scalar to a scalar
   if (varType->order() == 0 && valType->order() == 0) {
-    builder->CreateStore(valuePtr, varPtr);
     valuePtr->setName(varName + VAL_SUFFIX);
+    llvm::Type *varElemType = varPtr->getType()->getPointerElementType();
+    if (isInt(var.getType()) && valuePtr->getType() != varElemType) {
+      valuePtr = builder->CreateTrunc(valuePtr, varElemType);
+    }
+    builder->CreateStore(valuePtr, varPtr);
   }
   // Assign to n-order tensors
   else {
     simit_iassert(storage.hasStorage(var)) << var << " has no storage";
     llvm::Value *len = emitComputeLen(varType, storage.getStorage(var));
     unsigned componentSize = varType->getComponentType().bytes();
-    llvm::Value *size = builder->CreateMul(len, llvmInt(componentSize));
+    llvm::Value *size = builder->CreateNSWMul(len, llvmIndex(componentSize));
 
     // Assigning a scalar to an n-order tensor
     if (varType->order() > 0 && valType->order() == 0) {
@@ -1758,7 +2006,7 @@ void LLVMBackend::emitAssign(Var var, const Expr& value) {
     else {
       simit_iassert(var.getType() == value.type())
           << "variable and value types don't match";
-      emitMemCpy(varPtr, valuePtr, size, componentSize);
+      emitCopy(varPtr, valuePtr, len, componentSize);
     }
   }
 }
@@ -1773,13 +2021,48 @@ void LLVMBackend::emitMemSet(llvm::Value *dst, llvm::Value *val,
   builder->CreateMemSet(dst, val, size, align);
 }
 
+void LLVMBackend::emitCopy(llvm::Value *dst, llvm::Value *src,
+                           llvm::Value *len, unsigned componentSize) {
+  llvm::Type *dstType = dst->getType()->getPointerElementType();
+  llvm::Type *srcType = src->getType()->getPointerElementType();
+  if (dstType == srcType) {
+    llvm::Value *size = builder->CreateNSWMul(len, llvmIndex(componentSize));
+    emitMemCpy(dst, src, size, componentSize);
+    return;
+  }
+  simit_iassert(dstType->isFloatingPointTy() && srcType->isFloatingPointTy());
+
+  llvm::Function *llvmFunc = builder->GetInsertBlock()->getParent();
+  llvm::BasicBlock *entryBlock = builder->GetInsertBlock();
+  llvm::BasicBlock *loopBody =
+      llvm::BasicBlock::Create(LLVM_CTX, "convert_loop_body", llvmFunc);
+  llvm::BasicBlock *loopEnd =
+      llvm::BasicBlock::Create(LLVM_CTX, "convert_loop_end", llvmFunc);
+  builder->CreateCondBr(llvmCreateICmpSLT(builder.get(), llvmIndex(0), len),
+                        loopBody, loopEnd);
+  builder->SetInsertPoint(loopBody);
+
+  llvm::PHINode *i = llvmCreatePHI(builder.get(), llvmIndexType(), 2, "i");
+  i->addIncoming(llvmIndex(0), entryBlock);
+  llvm::Value *srcLoc = llvmCreateInBoundsGEP(builder.get(), src, i);
+  llvm::Value *dstLoc = llvmCreateInBoundsGEP(builder.get(), dst, i);
+  llvm::Value *component = builder->CreateLoad(srcLoc);
+  builder->CreateStore(builder->CreateFPCast(component, dstType), dstLoc);
+
+  llvm::Value *i_nxt = builder->CreateAdd(i, llvmIndex(1), "i_nxt", false, true);
+  i->addIncoming(i_nxt, builder->GetInsertBlock());
+  builder->CreateCondBr(llvmCreateICmpSLT(builder.get(), i_nxt, len),
+                        loopBody, loopEnd);
+  builder->SetInsertPoint(loopEnd);
+}
+
 llvm::Value *LLVMBackend::makeGlobalTensor(ir::Var var) {
   // Allocate buffer for local variable in global storage.
   // TODO: We should allocate small local dense tensors on the stack
   simit_iassert(var.getType().isTensor());
-  llvm::Type *ctype = llvmType(var.getType().toTensor()->getComponentType());
-  llvm::PointerType *globalType = llvm::PointerType::get(ctype,
-                                                         globalAddrspace());
+  llvm::PointerType *globalType =
+      llvmPtrType(var.getType().toTensor()->getComponentType(),
+                  globalAddrspace());
 
   llvm::GlobalVariable* buffer =
       new llvm::GlobalVariable(*module, globalType,
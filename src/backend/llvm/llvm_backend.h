@@ -26,6 +26,7 @@ class Value;
 class Instruction;
 class Function;
 class DataLayout;
+class Twine;
 }
 
 namespace simit {
@@ -57,9 +58,20 @@ protected:
   std::map<ir::Var, llvm::Value*> buffers;
 
   std::set<ir::Var> globals;
+
+  /// Globals that point to memory from the runtime allocator (temporaries and
+  /// tensor index arrays), as opposed to externs bound by the user
+  std::set<ir::Var> allocatedGlobals;
+
+  /// The loads and stores through set fields and allocated buffers, by a key
+  /// that names the field or buffer (see addBufferAccess).
+  std::map<std::string, std::vector<llvm::Instruction*>> bufferAccesses;
   ir::Storage storage;
   const ir::Environment* environment;
 
+  /// The context of the function being compiled (see llvm_context.h)
+  std::shared_ptr<llvm::LLVMContext> context;
+
   llvm::Module *module;
   std::unique_ptr<llvm::DataLayout> dataLayout;
 
@@ -109,6 +121,11 @@ protected:
   /// Get a pointer to the given field
   llvm::Value *emitFieldRead(const ir::Expr &elemOrSet, std::string fieldName);
 
+  /// Let LLVM assume that `ptr` was allocated by the runtime allocator and is
+  /// therefore aligned to kAllocationAlignment, so that vector loads and
+  /// stores through it can be aligned.
+  void emitAssumeAligned(llvm::Value *ptr);
+
   /// Get the number of components in the tensor
   llvm::Value *emitComputeLen(const ir::TensorType*, const ir::TensorStorage &);
 
@@ -120,6 +137,23 @@ protected:
 
   llvm::Value *loadFromArray(llvm::Value *array, llvm::Value *index);
 
+  /// Get a pointer to element `index` of `array`. 32-bit indices are
+  /// sign-extended to 64 bits first, so that the address is an inbounds GEP on
+  /// a 64-bit index that LLVM can strength-reduce across loop iterations.
+  llvm::Value *emitElementPtr(llvm::Value *array, llvm::Value *index,
+                              const llvm::Twine &name);
+
+  /// Record that `access` loads from or stores to `buffer`, if `buffer` is a
+  /// set field, the endpoints of an edge set or a buffer allocated by the
+  /// runtime. These never overlap each other.
+  void addBufferAccess(const ir::Expr &buffer, llvm::Instruction *access);
+
+  /// Give the accesses through each recorded field and buffer an alias scope
+  /// that does not alias the others, so that LLVM can vectorize loops that
+  /// read some fields and write others, and tag scalar loads and stores with
+  /// TBAA types so that e.g. float stores do not alias index loads.
+  void emitAliasMetadata();
+
   llvm::Value *emitCall(std::string name, std::vector<llvm::Value*> args);
 
   llvm::Value *emitCall(std::string name, std::vector<llvm::Value*> args,
@@ -161,6 +195,12 @@ protected:
   virtual void emitMemSet(llvm::Value *dst, llvm::Value *val,
                           llvm::Value *size, unsigned align);
 
+  /// Emit a copy of `len` components from `src` to `dst`. Uses a memcpy if
+  /// both store their components at the same width, and otherwise a loop that
+  /// converts each float component (see ir::Field::floatBytes).
+  void emitCopy(llvm::Value *dst, llvm::Value *src, llvm::Value *len,
+                unsigned componentSize);
+
   /// Allocate a global pointer for a tensor, and add to the symtable
   /// and list of global buffers
   virtual llvm::Value *makeGlobalTensor(ir::Var var);
@@ -194,9 +234,6 @@ protected:
 
   // TODO: Remove this function, once the old init system has been removed
   ir::Func makeSystemTensorsGlobal(ir::Func func);
-
-private:
-  static bool llvmInitialized;
 };
 
 }}
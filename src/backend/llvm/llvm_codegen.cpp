@@ -32,7 +32,7 @@ llvm::Constant* llvmVal(const TensorType& type, const void *data) {
   ScalarType componentType = type.getComponentType();
   switch (componentType.kind) {
     case ScalarType::Int:
-      return llvmInt(static_cast<const int*>(data)[0]);
+      return llvmIndex(static_cast<const int*>(data)[0]);
     case ScalarType::Float:
       if (ir::ScalarType::singleFloat()) {
         return llvmFP(static_cast<const float*>(data)[0],
@@ -92,7 +92,7 @@ llvm::Function *createPrototypeLLVM(const std::string& name,
 llvm::Constant* defaultInitializer(llvm::Type* type) {
   llvm::Constant* initializer = nullptr;
   if (type->isIntegerTy()) {
-    return llvmInt(0);
+    return llvm::ConstantInt::get(type, 0);
   }
   else if (type->isFloatingPointTy()) {
     return llvmFP(0.0);
@@ -68,6 +68,8 @@ llvm::PHINode *llvmCreatePHI(LLVMIRBuilder *builder, llvm::Type *, unsigned,
 
 llvm::ConstantInt* llvmInt(long long int val, unsigned bits=32);
 llvm::ConstantInt* llvmUInt(long long unsigned int val, unsigned bits=32);
+/// An Int constant of the configured index width (see llvmIndexType).
+llvm::ConstantInt* llvmIndex(long long int val);
 llvm::Constant*    llvmFP(double val, unsigned bits=64);
 llvm::Constant*    llvmBool(bool val);
 llvm::Constant*    llvmComplex(double real, double imag);
@@ -40,6 +40,10 @@ ConstantInt *llvmUInt(long long unsigned int val, unsigned bits) {
   return ConstantInt::get(LLVM_CTX, APInt(bits, val, false));
 }
 
+ConstantInt *llvmIndex(long long int val) {
+  return ConstantInt::get(llvmIndexType(), val, true);
+}
+
 Constant *llvmFP(double val, unsigned bits) {
   return ConstantFP::get(llvmFloatType(), val);
 }
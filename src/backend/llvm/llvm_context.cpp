@@ -5,9 +5,24 @@
 namespace simit {
 namespace backend {
 
-llvm::LLVMContext& getGlobalContext() {
-  static llvm::LLVMContext ctx;
-  return ctx;
+static thread_local llvm::LLVMContext* currentContext = nullptr;
+
+llvm::LLVMContext& getCurrentContext() {
+  if (currentContext == nullptr) {
+    static thread_local llvm::LLVMContext threadContext;
+    return threadContext;
+  }
+  return *currentContext;
+}
+
+// class LLVMContextScope
+LLVMContextScope::LLVMContextScope(llvm::LLVMContext* context)
+    : previous(currentContext) {
+  currentContext = context;
+}
+
+LLVMContextScope::~LLVMContextScope() {
+  currentContext = previous;
 }
 
 }}
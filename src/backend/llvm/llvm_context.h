@@ -7,8 +7,28 @@ class LLVMContext;
 
 namespace simit {
 namespace backend {
-llvm::LLVMContext& getGlobalContext();
+
+/// Returns the LLVM context code is generated in on the calling thread. LLVM
+/// contexts are not thread-safe, so every compiled function owns a context and
+/// makes it current with an LLVMContextScope while it generates code. Outside
+/// such a scope each thread falls back to a context of its own.
+llvm::LLVMContext& getCurrentContext();
+
+/// Makes an LLVM context current on the calling thread for the lifetime of the
+/// scope, and restores the previously current context afterwards.
+class LLVMContextScope {
+public:
+  LLVMContextScope(llvm::LLVMContext* context);
+  ~LLVMContextScope();
+
+private:
+  llvm::LLVMContext* previous;
+
+  LLVMContextScope(const LLVMContextScope&) = delete;
+  LLVMContextScope& operator=(const LLVMContextScope&) = delete;
+};
+
 }}
 
-#define LLVM_CTX simit::backend::getGlobalContext()
+#define LLVM_CTX simit::backend::getCurrentContext()
 #endif
@@ -7,12 +7,43 @@
 #include "types.h"
 #include "graph.h"
 
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Value.h"
 #include "llvm/IR/IRBuilder.h"
 
 namespace simit {
 namespace backend {
 
+/// Write `value` to member `i` of the set struct at `setPtr`.
+template <typename T>
+static void writeMember(void *setPtr, const llvm::StructLayout *layout,
+                        unsigned i, T value) {
+  *(T*)((char*)setPtr + layout->getElementOffset(i)) = value;
+}
+
+/// Write the size of `actual` to the first member of the set struct, using the
+/// index width.
+static void writeSetSize(Set *actual, void *setPtr,
+                         const llvm::StructLayout *layout) {
+  if (ir::ScalarType::longIndices()) {
+    writeMember<int64_t>(setPtr, layout, 0, actual->getSize());
+  }
+  else {
+    writeMember<int32_t>(setPtr, layout, 0, actual->getSize());
+  }
+}
+
+/// Write the field pointers of `actual`, starting at member `offset`.
+static void writeSetFields(Set *actual, ir::Type type, void *setPtr,
+                           const llvm::StructLayout *layout, unsigned offset) {
+  for (auto &field : type.toSet()->elementType.toElement()->fields) {
+    simit_iassert(field.type.isTensor());
+    writeMember<void*>(setPtr, layout, offset++,
+                       actual->getFieldData(field.name));
+  }
+}
+
 llvm::Value* UnstructuredSetLayout::getSize(unsigned i) {
   simit_iassert(i == 0) << "Only 1 explicit dimension for unstructured sets";
   return llvmCreateExtractValue(builder, value, {0},
@@ -29,41 +60,15 @@ int UnstructuredSetLayout::getFieldsOffset() {
   return 1;
 }
 
-llvm::Value* UnstructuredSetLayout::makeSet(Set *actual, ir::Type type) {
+void UnstructuredSetLayout::writeSet(Set *actual, ir::Type type, void *setPtr,
+                                     const llvm::StructLayout *layout) {
   simit_iassert(actual->getKind() == Set::Unstructured);
   simit_iassert(actual->getCardinality() == 0);
 
-  const ir::UnstructuredSetType *setType = type.toUnstructuredSet();
-  llvm::StructType *llvmSetType = llvmType(*setType);
-  vector<llvm::Constant*> setData;
-
   // Set size
-  setData.push_back(llvmInt(actual->getSize()));
+  writeSetSize(actual, setPtr, layout);
   // Fields
-  for (auto &field : setType->elementType.toElement()->fields) {
-    assert(field.type.isTensor());
-    setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
-  }
-  return llvm::ConstantStruct::get(llvmSetType, setData);
-}
-
-void UnstructuredSetLayout::writeSet(
-    Set *actual, ir::Type type, void *externPtr) {
-  simit_iassert(actual->getKind() == Set::Unstructured);
-  simit_iassert(actual->getCardinality() == 0);
-
-  const ir::SetType *setType = type.toSet();
-
-  // Set size
-  ((int*)externPtr)[0] = actual->getSize();
-  void **externPtrCast = (void**)(((int*)externPtr)+1);
-  // Fields
-  for (auto &field : setType->elementType.toElement()->fields) {
-    assert(field.type.isTensor());
-    *externPtrCast = actual->getFieldData(field.name);
-    externPtrCast++;
-  }
+  writeSetFields(actual, type, setPtr, layout, 1);
 }
 
 llvm::Value* UnstructuredEdgeSetLayout::getEpsArray() {
@@ -76,48 +81,17 @@ int UnstructuredEdgeSetLayout::getFieldsOffset() {
   return 2;
 }
 
-llvm::Value* UnstructuredEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
-  simit_iassert(actual->getKind() == Set::Unstructured);
-
-  const ir::UnstructuredSetType *setType = type.toUnstructuredSet();
-  llvm::StructType *llvmSetType = llvmType(*setType);
-  vector<llvm::Constant*> setData;
-
-  // Set size
-  setData.push_back(llvmInt(actual->getSize()));
-
-  // Endpoints index
-  setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getEndpointsData()));
-
-  // Fields
-  for (auto &field : setType->elementType.toElement()->fields) {
-    simit_iassert(field.type.isTensor());
-    setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
-  }
-  return llvm::ConstantStruct::get(llvmSetType, setData);
-}
-
 void UnstructuredEdgeSetLayout::writeSet(Set *actual, ir::Type type,
-                                         void *externPtr) {
+                                         void *setPtr,
+                                         const llvm::StructLayout *layout) {
   simit_iassert(actual->getKind() == Set::Unstructured);
 
-  const ir::SetType *setType = type.toSet();
-
   // Set size
-  ((int*)externPtr)[0] = actual->getSize();
-  int **externPtrCast = (int**)(((int*)externPtr)+1);
-
+  writeSetSize(actual, setPtr, layout);
   // Endpoints index
-  externPtrCast[0] = actual->getEndpointsData();
-
+  writeMember<int*>(setPtr, layout, 1, actual->getEndpointsData());
   // Fields
-  void **externPtrFieldCast = (void**)(externPtrCast+3);
-  for (auto &field : setType->elementType.toElement()->fields) {
-    simit_iassert(field.type.isTensor());
-    *externPtrFieldCast = actual->getFieldData(field.name);
-    externPtrFieldCast++;
-  }
+  writeSetFields(actual, type, setPtr, layout, 2);
 }
 
 llvm::Value* GridSetLayout::getSize(unsigned i) {
@@ -126,13 +100,17 @@ llvm::Value* GridSetLayout::getSize(unsigned i) {
                                       util::toString(set)+".sizes()");
   std::string name = string(sizes->getName()) + "[" + std::to_string(i) + "]";
   auto out = llvmCreateInBoundsGEP(builder, sizes, llvmInt(i), name);
-  return builder->CreateLoad(out);
+  llvm::Value *size = builder->CreateLoad(out);
+  if (size->getType() != llvmIndexType()) {
+    size = builder->CreateSExt(size, llvmIndexType());
+  }
+  return size;
 }
 
 llvm::Value* GridSetLayout::getTotalSize() {
   unsigned dims = set.type().toGridSet()->dimensions;
   // directional dimension
-  llvm::Value *total = llvmInt(set.type().toGridSet()->dimensions);
+  llvm::Value *total = llvmIndex(set.type().toGridSet()->dimensions);
   // grid sites dimensions
   for (unsigned i = 0; i < dims; ++i) {
     total = builder->CreateMul(total, getSize(i),
@@ -153,73 +131,30 @@ int GridSetLayout::getFieldsOffset() {
   return 2;
 }
 
-llvm::Value* GridSetLayout::makeSet(Set *actual, ir::Type type) {
+void GridSetLayout::writeSet(Set *actual, ir::Type type, void *setPtr,
+                             const llvm::StructLayout *layout) {
   simit_iassert(actual->getKind() == Set::Grid);
 
-  const ir::GridSetType *setType = type.toGridSet();
-  llvm::StructType *llvmSetType = llvmType(*setType);
-  vector<llvm::Constant*> setData;
-
   // Set sizes
-  unsigned ndims = setType->dimensions;
   const vector<int> &dimensions = actual->getDimensions();
-  simit_uassert(dimensions.size() == ndims)
+  simit_uassert(dimensions.size() == type.toGridSet()->dimensions)
       << "Grid edge set with wrong number of dimensions: "
-      << dimensions.size() << " passed, but " << ndims
+      << dimensions.size() << " passed, but " << type.toGridSet()->dimensions
       << " required";
-  setData.push_back(llvmPtr(LLVM_INT_PTR, dimensions.data()));
-    
-  // CSR data: only set if kIndexlessStencils is false, otherwise
-  // we set these to NULL.
-  if (kIndexlessStencils) {
-    // NULL pointers for endpoints
-    setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
-  }
-  else {
-    // Endpoints index
-    setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getEndpointsData()));
-  }
-    
-  // Fields
-  for (auto &field : setType->elementType.toElement()->fields) {
-    assert(field.type.isTensor());
-    setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
-  }
-  return llvm::ConstantStruct::get(llvmSetType, setData);
-}
+  writeMember<const int*>(setPtr, layout, 0, dimensions.data());
 
-void GridSetLayout::writeSet(Set *actual, ir::Type type, void *externPtr) {
-  simit_iassert(actual->getKind() == Set::Grid);
-
-  const ir::SetType *setType = type.toSet();
-  int** externPtrCast = (int**)externPtr;
-
-  // Set sizes
-  const vector<int> &dimensions = actual->getDimensions();
-  ((const int**)externPtrCast)[0] = dimensions.data();
-    
   // CSR data: only set if kIndexlessStencils is false, otherwise
   // we set these to NULL.
   if (kIndexlessStencils) {
-    // Three NULL pointers for endpoints, nbrs_start, and nbrs
-    externPtrCast[1] = NULL;
-    externPtrCast[2] = NULL;
-    externPtrCast[3] = NULL;
+    writeMember<int*>(setPtr, layout, 1, nullptr);
   }
   else {
     // Endpoints index
-    externPtrCast[1] = actual->getEndpointsData();
+    writeMember<int*>(setPtr, layout, 1, actual->getEndpointsData());
   }
 
-  void **externPtrFieldCast = (void**)(externPtrCast+4);
   // Fields
-  for (auto &field : setType->elementType.toElement()->fields) {
-    assert(field.type.isTensor());
-
-    *externPtrFieldCast = actual->getFieldData(field.name);
-    externPtrFieldCast++;
-  }
+  writeSetFields(actual, type, setPtr, layout, 2);
 }
 
 std::shared_ptr<SetLayout> getSetLayout(
@@ -245,39 +180,20 @@ std::shared_ptr<SetLayout> getSetLayout(
   }
 }
 
-/// Build llvm set struct from runtime Set object
-llvm::Value* makeSet(Set *actual, ir::Type type) {
-  simit_iassert(type.isSet());
-  if (type.isUnstructuredSet()) {
-    if (type.toUnstructuredSet()->getCardinality() == 0) {
-      return UnstructuredSetLayout::makeSet(actual, type);
-    }
-    else {
-      return UnstructuredEdgeSetLayout::makeSet(actual, type);
-    }
-  }
-  else if (type.isGridSet()) {
-    return GridSetLayout::makeSet(actual, type);
-  }
-  else {
-    simit_unreachable;
-    return nullptr;
-  }
-}
-
-/// Write set pointers to extern pointer structure
-void writeSet(Set *actual, ir::Type type, void *externPtr) {
+void writeSet(Set *actual, ir::Type type, void *setPtr,
+              llvm::StructType *llvmSetType, const llvm::DataLayout &layout) {
   simit_iassert(type.isSet());
+  const llvm::StructLayout *structLayout = layout.getStructLayout(llvmSetType);
   if (type.isUnstructuredSet()) {
     if (type.toUnstructuredSet()->getCardinality() == 0) {
-      return UnstructuredSetLayout::writeSet(actual, type, externPtr);
+      UnstructuredSetLayout::writeSet(actual, type, setPtr, structLayout);
     }
     else {
-      return UnstructuredEdgeSetLayout::writeSet(actual, type, externPtr);
+      UnstructuredEdgeSetLayout::writeSet(actual, type, setPtr, structLayout);
     }
   }
   else if (type.isGridSet()) {
-    return GridSetLayout::writeSet(actual, type, externPtr);
+    GridSetLayout::writeSet(actual, type, setPtr, structLayout);
   }
   else {
     simit_unreachable;
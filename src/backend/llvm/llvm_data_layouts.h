@@ -10,6 +10,9 @@
 
 namespace llvm {
 class Value;
+class StructType;
+class StructLayout;
+class DataLayout;
 }
 
 namespace simit {
@@ -44,8 +47,8 @@ public:
 
   virtual int getFieldsOffset();
 
-  static llvm::Value* makeSet(Set *actual, ir::Type type);
-  static void writeSet(Set *actual, ir::Type type, void *externPtr);
+  static void writeSet(Set *actual, ir::Type type, void *setPtr,
+                       const llvm::StructLayout *layout);
 
   UnstructuredSetLayout(ir::Expr set, llvm::Value *value, LLVMIRBuilder *builder)
       : set(set), value(value), builder(builder) {
@@ -59,15 +62,15 @@ private:
 
 
 /// Unstructured edge set layout:
-/// <size> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <f1> <f2> ...
+/// <size> <eps_ptr> <f1> <f2> ...
 class UnstructuredEdgeSetLayout : public UnstructuredSetLayout {
 public:
   virtual llvm::Value* getEpsArray();
 
   virtual int getFieldsOffset();
 
-  static llvm::Value* makeSet(Set *actual, ir::Type type);
-  static void writeSet(Set *actual, ir::Type type, void *externPtr);
+  static void writeSet(Set *actual, ir::Type type, void *setPtr,
+                       const llvm::StructLayout *layout);
 
   UnstructuredEdgeSetLayout(ir::Expr set, llvm::Value *value,
                             LLVMIRBuilder *builder)
@@ -82,7 +85,7 @@ private:
 };
 
 /// Grid edge set layout:
-/// <sizes_ptr> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <f1> <f2> ...
+/// <sizes_ptr> <eps_ptr> <f1> <f2> ...
 class GridSetLayout : public SetLayout {
 public:
   virtual llvm::Value* getSize(unsigned i);
@@ -90,9 +93,9 @@ public:
   virtual llvm::Value* getEpsArray();
   virtual int getFieldsOffset();
 
-  static llvm::Value* makeSet(Set *actual, ir::Type type);
-  static void writeSet(Set *actual, ir::Type type, void *externPtr);
-  
+  static void writeSet(Set *actual, ir::Type type, void *setPtr,
+                       const llvm::StructLayout *layout);
+
   GridSetLayout(ir::Expr set, llvm::Value *value, LLVMIRBuilder *builder)
       : set(set), value(value), builder(builder) {}
 
@@ -105,11 +108,12 @@ private:
 std::shared_ptr<SetLayout> getSetLayout(
     ir::Expr set, llvm::Value *value, LLVMIRBuilder *builder);
 
-/// Build llvm set struct from runtime Set object
-llvm::Value* makeSet(Set *actual, ir::Type type);
-
-/// Write set pointers to extern pointer structure
-void writeSet(Set *actual, ir::Type type, void *externPtr);
+/// Write the size, endpoints and field pointers of a runtime Set object to a
+/// set struct of type `llvmSetType` (an argument descriptor or an extern).
+/// Compiled functions read set structs when they are called, so a set can be
+/// resized and rewritten without recompiling.
+void writeSet(Set *actual, ir::Type type, void *setPtr,
+              llvm::StructType *llvmSetType, const llvm::DataLayout &layout);
 
 }} // namespace simit::backend
 
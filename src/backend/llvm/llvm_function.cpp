@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/IR/LLVMContext.h"
@@ -32,17 +33,19 @@ namespace backend {
 
 typedef void (*FuncPtrType)();
 
-LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
+LLVMFunction::LLVMFunction(std::shared_ptr<llvm::LLVMContext> context,
+                           ir::Func func, const ir::Storage &storage,
                            llvm::Function* llvmFunc, llvm::Module* module,
                            std::shared_ptr<llvm::EngineBuilder> engineBuilder,
                            bool skipEEInit)
-    : Function(func), initialized(false), llvmFunc(llvmFunc), module(module),
-      harnessModule(new llvm::Module("simit_harness", LLVM_CTX)),
+    : Function(func), context(context), initialized(false), llvmFunc(llvmFunc),
+      module(module),
+      harnessModule(new llvm::Module("simit_harness", *context)),
       storage(storage),
       engineBuilder(engineBuilder),
       harnessEngineBuilder(new llvm::EngineBuilder(
           std::unique_ptr<llvm::Module>(harnessModule))),
-      deinit(nullptr) {
+      deinit(nullptr), allocator(getAllocator()) {
 
   // Not all derivative backends can use execution engines to finalize code
   // (see GPU for example). As a result, this provides a shortcut to skip any
@@ -80,6 +83,16 @@ LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
     }
     simit_iassert(!util::contains(this->externPtrs, bindable.getName()));
     this->externPtrs.insert({bindable.getName(), extPtrs});
+
+    // Set externs are set structs
+    if (bindable.getType().isSet()) {
+      simit_iassert(externMapping.getMappings().size() == 1);
+      llvm::GlobalVariable* global =
+          module->getNamedGlobal(externMapping.getMappings()[0].getName());
+      simit_iassert(global != nullptr);
+      externSetTypes.insert({bindable.getName(),
+          llvm::cast<llvm::StructType>(global->getType()->getElementType())});
+    }
   }
 
   // Initialize temporary pointers
@@ -99,16 +112,30 @@ LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
     if (tensorIndex.getKind() == TensorIndex::PExpr) {
       const Var& rowptr = tensorIndex.getRowptrArray();
       addr = executionEngine->getGlobalValueAddress(rowptr.getName());
-      const uint32_t** rowptrPtr = (const uint32_t**)addr;
+      const void** rowptrPtr = (const void**)addr;
       *rowptrPtr = nullptr;
 
       const Var& colidx = tensorIndex.getColidxArray();
       addr = executionEngine->getGlobalValueAddress(colidx.getName());
-      const uint32_t** colidxPtr = (const uint32_t**)addr;
+      const void** colidxPtr = (const void**)addr;
       *colidxPtr = nullptr;
 
       const pe::PathExpression& pexpr = tensorIndex.getPathExpression();
       tensorIndexPtrs.insert({pexpr, {rowptrPtr, colidxPtr}});
+
+      if (tensorIndex.isSliced()) {
+        SlicedIndex& sliced = slicedIndices[pexpr];
+        for (const Var& array : {tensorIndex.getSliceptrArray(),
+                                 tensorIndex.getPermutationArray(),
+                                 tensorIndex.getLengthArray(),
+                                 tensorIndex.getSlicedColidxArray(),
+                                 tensorIndex.getSlicedLocArray()}) {
+          addr = executionEngine->getGlobalValueAddress(array.getName());
+          const void** arrayPtr = (const void**)addr;
+          *arrayPtr = nullptr;
+          sliced.ptrs.push_back(arrayPtr);
+        }
+      }
     }
     else if (tensorIndex.getKind() == TensorIndex::Sten) {
       // No need to build in-memory structures
@@ -124,7 +151,7 @@ LLVMFunction::~LLVMFunction() {
     deinit();
   }
   for (auto& tmpPtr : temporaryPtrs) {
-    free(*tmpPtr.second);
+    allocator->deallocate(*tmpPtr.second, temporaryBytes[tmpPtr.first]);
     *tmpPtr.second = nullptr;
   }
 }
@@ -175,8 +202,17 @@ void LLVMFunction::bind(const std::string& name, simit::Set* set) {
     // Write set values and pointers to the relevant extern
     simit_iassert(util::contains(externPtrs, name)
                   && externPtrs.at(name).size()==1);
-    void *externPtr = externPtrs.at(name)[0];
-    writeSet(set, globalType, externPtr);
+    BoundSet& boundSet = boundSets[name];
+    boundSet.set = set;
+    boundSet.type = globalType;
+    boundSet.llvmType = externSetTypes.at(name);
+    boundSet.setStruct = externPtrs.at(name)[0];
+    boundSet.storage.reset();
+    writeSetStruct(&boundSet);
+
+    // The indices and temporaries of an initialized function are refreshed
+    // before the next call
+    boundSet.topologyVersion = UINT64_MAX;
   }
 }
 
@@ -246,89 +282,65 @@ size_t LLVMFunction::size(const ir::IndexDomain& dimension) {
 }
 
 Function::FuncType LLVMFunction::init() {
-  pe::PathIndexBuilder piBuilder;
+  LLVMContextScope contextScope(context.get());
+  if (piBuilder == nullptr) {
+    piBuilder.reset(new pe::PathIndexBuilder(ScalarType::indexBytes));
+  }
 
-  for (auto& pair : arguments) {
-    string name = pair.first;
-    Actual* actual = pair.second.get();
+  // Write the set structs of set arguments
+  vector<string> formals = getArgs();
+  simit_iassert(formals.size() == llvmFunc->getArgumentList().size());
+  auto llvmArgIt = llvmFunc->getArgumentList().begin();
+  for (const std::string& formal : formals) {
+    simit_uassert(util::contains(arguments, formal))
+        << "Could not find formal argument " << formal <<  " in "
+        << llvmFunc->getName().str();
+    llvm::Argument* llvmFormal = &(*llvmArgIt);
+    ++llvmArgIt;
+
+    Actual* actual = arguments.at(formal).get();
     if (isa<SetActual>(actual)) {
-      Set* set = to<SetActual>(actual)->getSet();
-      piBuilder.bind(name,set);
+      llvm::StructType* llvmSetType =
+          llvm::cast<llvm::StructType>(llvmFormal->getType());
+      size_t structSize = llvm::DataLayout(module).getTypeAllocSize(llvmSetType);
+
+      BoundSet& boundSet = boundSets[formal];
+      boundSet.set = to<SetActual>(actual)->getSet();
+      boundSet.type = getArgType(formal);
+      boundSet.llvmType = llvmSetType;
+      boundSet.storage.reset(new char[structSize]);
+      boundSet.setStruct = boundSet.storage.get();
+      writeSetStruct(&boundSet);
+    }
+  }
+
+  // Set externs bound since the last init may be stale
+  for (auto& boundSet : boundSets) {
+    if (boundSet.second.topologyVersion !=
+        boundSet.second.set->getTopologyVersion()) {
+      writeSetStruct(&boundSet.second);
     }
+    piBuilder->bind(boundSet.first, boundSet.second.set);
   }
 
   const Environment& environment = getEnvironment();
 
   // Initialize indices
-  initIndices(piBuilder, environment);
+  initIndices(*piBuilder, environment);
 
   // Allocate memory for temporaries
-  for (const Var& tmp : environment.getTemporaries()) {
-    simit_iassert(util::contains(temporaryPtrs, tmp.getName()));
-    const Type& type = tmp.getType();
-
-    if (type.isTensor()) {
-      const ir::TensorType* tensorType = type.toTensor();
-      unsigned order = tensorType->order();
-      simit_iassert(order <= 2) << "Higher-order tensors not supported";
-
-      if (order == 1) {
-        // Vectors are currently always dense
-        IndexDomain vecDimension = tensorType->getDimensions()[0];
-        Type blockType = tensorType->getBlockType();
-        size_t blockSize = blockType.toTensor()->size();
-        size_t componentSize = tensorType->getComponentType().bytes();
-        *temporaryPtrs.at(tmp.getName()) =
-            calloc(size(vecDimension) *blockSize, componentSize);
-      }
-      else if (order == 2) {
-        Type blockType = tensorType->getBlockType();
-        size_t blockSize = blockType.toTensor()->size();
-        size_t componentSize = tensorType->getComponentType().bytes();
-        simit_iassert(environment.hasTensorIndex(tmp))
-            << "No tensor index for: " << tmp;
-        const TensorIndex& ti = environment.getTensorIndex(tmp);
-
-        if (ti.getKind() == TensorIndex::PExpr) {
-          const pe::PathExpression& pexpr = ti.getPathExpression();
-          simit_iassert(util::contains(pathIndices, pexpr));
-          size_t matSize = pathIndices.at(pexpr).numNeighbors() *
-              blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
-        }
-        else if (ti.getKind() == TensorIndex::Sten) {
-          auto iss = tensorType->getOuterDimensions();
-          simit_iassert(iss.size() == 2);
-          simit_iassert(iss[0] == iss[1])
-              << "Stencil tensor index must be for a homogeneous matrix";
-          size_t gridSize = size(iss[0]);
-          const StencilLayout& stencil = ti.getStencilLayout();
-          size_t stensize = stencil.getLayout().size();
-          size_t matSize = stensize * gridSize * blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
-        }
-        else {
-          not_supported_yet;
-        }
-      }
-    }
-    else {
-      simit_unreachable << "don't know how to initialize temporary "
-                  << util::quote(tmp);
-    }
-  }
+  initTemporaries(environment);
 
   // Compile a harness void function without arguments that calls the simit
   // llvm function with pointers to the arguments.
   Function::FuncType func;
   initialized = true;
-  vector<string> formals = getArgs();
-  simit_iassert(formals.size() == llvmFunc->getArgumentList().size());
   if (llvmFunc->getArgumentList().size() == 0) {
     llvm::Function *initFunc = getInitFunc();
     llvm::Function *deinitFunc = getDeinitFunc();
-    // Call init()
-    getGlobalFunc(initFunc, executionEngine.get())();
+    // Store and call init()
+    initialize = getGlobalFunc(initFunc, executionEngine.get());
+    initialize();
     // Store deinit(), func()
     deinit = getGlobalFunc(deinitFunc, executionEngine.get());
     func = getGlobalFunc(llvmFunc, executionEngine.get());
@@ -337,10 +349,6 @@ Function::FuncType LLVMFunction::init() {
     llvm::SmallVector<llvm::Value*, 8> args;
     auto llvmArgIt = llvmFunc->getArgumentList().begin();
     for (const std::string& formal : formals) {
-      simit_uassert(util::contains(arguments, formal))
-          << "Could not find formal argument " << formal <<  " in "
-          << llvmFunc->getName().str();
-
       llvm::Argument* llvmFormal = &(*llvmArgIt);
       ++llvmArgIt;
       Actual* actual = arguments.at(formal).get();
@@ -353,15 +361,20 @@ Function::FuncType LLVMFunction::init() {
         llvm::Value* result;
         Type type;
         llvm::Argument* llvmFormal;
-        llvm::Value* init(Actual* a, const Type& t, llvm::Argument* f) {
+        void* setStruct;
+        llvm::Value* init(Actual* a, const Type& t, llvm::Argument* f,
+                          void* setStruct) {
           this->type = t;
           this->llvmFormal = f;
+          this->setStruct = setStruct;
           a->accept(this);
           return result;
         }
 
+        /// Sets are passed as pointers to their set structs, which the harness
+        /// loads when it is called.
         void visit(SetActual* actual) {
-          result = makeSet(actual->getSet(), type);
+          result = llvmPtr(llvmFormal->getType()->getPointerTo(), setStruct);
         }
 
         void visit(TensorActual* actual) {
@@ -372,7 +385,10 @@ Function::FuncType LLVMFunction::init() {
                    : llvmVal(*tensorType, tensorData);
         }
       };
-      llvm::Value* llvmActual = InitActual().init(actual, type, llvmFormal);
+      void* setStruct = util::contains(boundSets, formal)
+                        ? boundSets.at(formal).setStruct : nullptr;
+      llvm::Value* llvmActual =
+          InitActual().init(actual, type, llvmFormal, setStruct);
       args.push_back(llvmActual);
     }
 
@@ -390,23 +406,31 @@ Function::FuncType LLVMFunction::init() {
         createHarness(funcName, args, &funcProto);
 
     // Calling main module functions from the harness requires the
-    // symbols to be loaded into the memory manager ahead of finalization
-    llvm::sys::DynamicLibrary::AddSymbol(
-        initFuncName,
-        (void*) executionEngine->getFunctionAddress(initFuncName));
-    llvm::sys::DynamicLibrary::AddSymbol(
-        deinitFuncName,
-        (void*) executionEngine->getFunctionAddress(deinitFuncName));
-    llvm::sys::DynamicLibrary::AddSymbol(
-        funcName,
-        (void*) executionEngine->getFunctionAddress(funcName));
-    
-    // Finalize harness module
-    harnessExecEngine->finalizeObject();
+    // symbols to be loaded into the memory manager ahead of finalization. The
+    // symbol table is process-wide and keyed by name, and functions compiled
+    // from the same Simit function share names, so no other thread may
+    // redefine the symbols before the harness is linked.
+    {
+      static std::mutex harnessSymbolsMutex;
+      std::lock_guard<std::mutex> lock(harnessSymbolsMutex);
+      llvm::sys::DynamicLibrary::AddSymbol(
+          initFuncName,
+          (void*) executionEngine->getFunctionAddress(initFuncName));
+      llvm::sys::DynamicLibrary::AddSymbol(
+          deinitFuncName,
+          (void*) executionEngine->getFunctionAddress(deinitFuncName));
+      llvm::sys::DynamicLibrary::AddSymbol(
+          funcName,
+          (void*) executionEngine->getFunctionAddress(funcName));
+
+      // Finalize harness module
+      harnessExecEngine->finalizeObject();
+    }
 
     // Fetch hard addresses from ExecutionEngine
-    // call init()
-    getGlobalFunc(initHarness, harnessExecEngine.get())();
+    // store and call init()
+    initialize = getGlobalFunc(initHarness, harnessExecEngine.get());
+    initialize();
     // store deinit(), func()
     deinit = getGlobalFunc(deinitHarness, harnessExecEngine.get());
     func = getGlobalFunc(funcHarness, harnessExecEngine.get());
@@ -416,7 +440,117 @@ Function::FuncType LLVMFunction::init() {
     simit_iassert(!llvm::verifyModule(*harnessModule))
         << "LLVM harness module does not pass verification";
   }
-  return func;
+
+  // Refresh the set structs, indices and temporaries before each call, in case
+  // the bound sets were resized
+  return [this, func]() {
+    refresh();
+    func();
+  };
+}
+
+void LLVMFunction::initTemporaries(const Environment& environment) {
+  for (const Var& tmp : environment.getTemporaries()) {
+    simit_iassert(util::contains(temporaryPtrs, tmp.getName()));
+    const Type& type = tmp.getType();
+
+    // Free the temporary's previous allocation
+    void** tmpPtr = temporaryPtrs.at(tmp.getName());
+    size_t& tmpBytes = temporaryBytes[tmp.getName()];
+    allocator->deallocate(*tmpPtr, tmpBytes);
+    *tmpPtr = nullptr;
+    tmpBytes = 0;
+
+    if (type.isTensor()) {
+      const ir::TensorType* tensorType = type.toTensor();
+      unsigned order = tensorType->order();
+      simit_iassert(order <= 2) << "Higher-order tensors not supported";
+
+      if (order == 1) {
+        // Vectors are currently always dense
+        IndexDomain vecDimension = tensorType->getDimensions()[0];
+        Type blockType = tensorType->getBlockType();
+        size_t blockSize = blockType.toTensor()->size();
+        size_t componentSize = tensorType->getComponentType().bytes();
+        tmpBytes = size(vecDimension) * blockSize * componentSize;
+      }
+      else if (order == 2) {
+        Type blockType = tensorType->getBlockType();
+        size_t blockSize = blockType.toTensor()->size();
+        size_t componentSize = tensorType->getComponentType().bytes();
+        simit_iassert(environment.hasTensorIndex(tmp))
+            << "No tensor index for: " << tmp;
+        const TensorIndex& ti = environment.getTensorIndex(tmp);
+
+        if (ti.getKind() == TensorIndex::PExpr) {
+          const pe::PathExpression& pexpr = ti.getPathExpression();
+          simit_iassert(util::contains(pathIndices, pexpr));
+          size_t matSize = pathIndices.at(pexpr).numNeighbors() *
+              blockSize * componentSize;
+          tmpBytes = matSize;
+        }
+        else if (ti.getKind() == TensorIndex::Sten) {
+          auto iss = tensorType->getOuterDimensions();
+          simit_iassert(iss.size() == 2);
+          simit_iassert(iss[0] == iss[1])
+              << "Stencil tensor index must be for a homogeneous matrix";
+          size_t gridSize = size(iss[0]);
+          const StencilLayout& stencil = ti.getStencilLayout();
+          size_t stensize = stencil.getLayout().size();
+          size_t matSize = stensize * gridSize * blockSize * componentSize;
+          tmpBytes = matSize;
+        }
+        else {
+          not_supported_yet;
+        }
+      }
+    }
+    else {
+      simit_unreachable << "don't know how to initialize temporary "
+                  << util::quote(tmp);
+    }
+    *tmpPtr = allocator->allocate(tmpBytes);
+  }
+}
+
+void LLVMFunction::writeSetStruct(BoundSet* boundSet) {
+  writeSet(boundSet->set, boundSet->type, boundSet->setStruct,
+           boundSet->llvmType, llvm::DataLayout(module));
+  boundSet->topologyVersion = boundSet->set->getTopologyVersion();
+}
+
+void LLVMFunction::refresh() {
+  bool changed = false;
+  for (auto& boundSet : boundSets) {
+    if (boundSet.second.topologyVersion !=
+        boundSet.second.set->getTopologyVersion()) {
+      changed = true;
+      break;
+    }
+  }
+  if (!changed) {
+    return;
+  }
+
+  // Functions are called without their settings in effect
+  internal::SettingsScope settingsScope(getSettings());
+  LLVMContextScope contextScope(context.get());
+
+  // Free the buffers allocated from the old set sizes
+  deinit();
+
+  for (auto& boundSet : boundSets) {
+    if (boundSet.second.topologyVersion !=
+        boundSet.second.set->getTopologyVersion()) {
+      writeSetStruct(&boundSet.second);
+    }
+  }
+
+  // Only the indices over sets whose topology changed are rebuilt
+  const Environment& environment = getEnvironment();
+  initIndices(*piBuilder, environment);
+  initTemporaries(environment);
+  initialize();
 }
 
 void LLVMFunction::print(std::ostream &os) const {
@@ -441,15 +575,34 @@ void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
   for (const TensorIndex& tensorIndex : environment.getTensorIndices()) {
     if (tensorIndex.getKind() == TensorIndex::PExpr) {
       pe::PathExpression pexpr = tensorIndex.getPathExpression();
-      pe::PathIndex pidx = piBuilder.buildSegmented(pexpr, 0);
-      pathIndices.insert({pexpr, pidx});
+      pe::PathIndex pidx = tensorIndex.isUpperTriangular()
+                           ? piBuilder.buildUpperTriangular(pexpr, 0)
+                           : piBuilder.buildSegmented(pexpr, 0);
+      bool rebuilt = !util::contains(pathIndices, pexpr) ||
+                     pathIndices.at(pexpr) != pidx;
+      pathIndices[pexpr] = pidx;
 
-      pair<const uint32_t**,const uint32_t**> ptrPair=tensorIndexPtrs.at(pexpr);
+      pair<const void**,const void**> ptrPair = tensorIndexPtrs.at(pexpr);
 
       if (isa<pe::SegmentedPathIndex>(pidx)) {
         const pe::SegmentedPathIndex* spidx = to<pe::SegmentedPathIndex>(pidx);
         *ptrPair.first = spidx->getCoordData();
         *ptrPair.second = spidx->getSinkData();
+
+        // Sliced views are rebuilt when their path index is
+        if (tensorIndex.isSliced()) {
+          SlicedIndex& sliced = slicedIndices.at(pexpr);
+          if (sliced.index == nullptr || rebuilt) {
+            sliced.index.reset(new pe::SlicedPathIndex(
+                spidx, tensorIndex.getSliceHeight(),
+                tensorIndex.getSortWindow()));
+          }
+          *sliced.ptrs[0] = sliced.index->getSliceptrData();
+          *sliced.ptrs[1] = sliced.index->getPermutationData();
+          *sliced.ptrs[2] = sliced.index->getLengthData();
+          *sliced.ptrs[3] = sliced.index->getSinkData();
+          *sliced.ptrs[4] = sliced.index->getLocData();
+        }
       }
       else {
         not_supported_yet<<"Doesn't know how to initialize this pathindex type";
@@ -485,7 +638,19 @@ llvm::Function* LLVMFunction::createHarness(
   llvm::Function *harness = createPrototype(
       harnessName, {}, {}, harnessModule, true);
   auto entry = llvm::BasicBlock::Create(LLVM_CTX, "entry", harness);
-  llvm::CallInst *call = llvm::CallInst::Create(llvmFuncProto, args, "", entry);
+
+  // Load the set structs that set arguments are passed as pointers to
+  llvm::SmallVector<llvm::Value*,8> callArgs;
+  for (size_t i=0; i < args.size(); ++i) {
+    llvm::Value* arg = args[i];
+    if (arg->getType() != argTypes[i] &&
+        arg->getType() == argTypes[i]->getPointerTo()) {
+      arg = new llvm::LoadInst(arg, argNames[i], entry);
+    }
+    callArgs.push_back(arg);
+  }
+  llvm::CallInst *call =
+      llvm::CallInst::Create(llvmFuncProto, callArgs, "", entry);
   call->setCallingConv(llvmFunc->getCallingConv());
   llvm::ReturnInst::Create(harnessModule->getContext(), entry);
   return harness;
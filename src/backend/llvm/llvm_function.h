@@ -10,6 +10,7 @@
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 
 #include "backend/backend_function.h"
+#include "allocator.h"
 #include "ir.h"
 #include "storage.h"
 #include "tensor_data.h"
@@ -18,12 +19,17 @@ namespace llvm {
 class ExecutionEngine;
 }
 
+namespace llvm {
+class StructType;
+}
+
 namespace simit {
 
 namespace pe {
 class PathExpression;
 class PathIndex;
 class PathIndexBuilder;
+class SlicedPathIndex;
 }
 namespace backend {
 class Actual;
@@ -31,7 +37,8 @@ class Actual;
 /// A Simit function that has been compiled with LLVM.
 class LLVMFunction : public backend::Function {
  public:
-  LLVMFunction(ir::Func func, const ir::Storage &storage,
+  LLVMFunction(std::shared_ptr<llvm::LLVMContext> context,
+               ir::Func func, const ir::Storage &storage,
                llvm::Function* llvmFunc, llvm::Module* module,
                std::shared_ptr<llvm::EngineBuilder> engineBuilder,
                bool skipEEInit = false);
@@ -57,6 +64,18 @@ class LLVMFunction : public backend::Function {
   void initIndices(pe::PathIndexBuilder& piBuilder,
                    const ir::Environment& environment);
 
+  /// Allocate the temporaries, which are sized by the bound sets.
+  void initTemporaries(const ir::Environment& environment);
+
+  /// Builds the path indices. It is kept across calls to init, so that indices
+  /// are updated incrementally when elements are added to or removed from the
+  /// bound sets.
+  std::unique_ptr<pe::PathIndexBuilder> piBuilder;
+
+  /// The context the function's code lives in. It is declared first so that
+  /// it is destroyed after the modules and engines that use it.
+  std::shared_ptr<llvm::LLVMContext> context;
+
   bool initialized;
 
   llvm::Function*                        llvmFunc;
@@ -73,11 +92,43 @@ class LLVMFunction : public backend::Function {
 
   /// TensorIndices
   std::map<pe::PathExpression,
-           std::pair<const uint32_t**,const uint32_t**>> tensorIndexPtrs;
+           std::pair<const void**,const void**>> tensorIndexPtrs;
   std::map<pe::PathExpression, pe::PathIndex>            pathIndices;
 
-  /// Temporaries
+  /// Sliced views of tensor indices (see TensorIndex::setSliced), and the
+  /// pointers to their slice, row, length, sink and loc arrays.
+  struct SlicedIndex {
+    std::vector<const void**> ptrs;
+    std::shared_ptr<pe::SlicedPathIndex> index;
+  };
+  std::map<pe::PathExpression, SlicedIndex> slicedIndices;
+
+  /// Temporaries, and the number of bytes allocated for each
   std::map<std::string, void**> temporaryPtrs;
+  std::map<std::string, size_t> temporaryBytes;
+
+  /// A set bound to the function, and the set struct the compiled code reads
+  /// its size, endpoints and field pointers from when it is called.
+  struct BoundSet {
+    Set* set;
+    ir::Type type;
+    llvm::StructType* llvmType;
+    void* setStruct;                  // an extern, or storage for arguments
+    std::unique_ptr<char[]> storage;
+    uint64_t topologyVersion;         // the version the struct was written at
+  };
+  std::map<std::string, BoundSet> boundSets;
+
+  /// The set struct types of set externs.
+  std::map<std::string, llvm::StructType*> externSetTypes;
+
+  /// Write a bound set's struct.
+  void writeSetStruct(BoundSet* boundSet);
+
+  /// If the topology of a bound set changed since the last call, rewrite the
+  /// set structs, update the indices and reallocate the temporaries and
+  /// buffers. Lets sets be resized between calls without calling init.
+  void refresh();
 
  private:
   std::shared_ptr<llvm::EngineBuilder>   engineBuilder;
@@ -85,8 +136,12 @@ class LLVMFunction : public backend::Function {
   std::unique_ptr<llvm::EngineBuilder>   harnessEngineBuilder;
   std::unique_ptr<llvm::ExecutionEngine> harnessExecEngine;
 
+  FuncType initialize;
   FuncType deinit;
 
+  /// The allocator of the temporaries
+  Allocator* allocator;
+
   // MCJIT does not allow module modification after code generation. Instead,
   // create all harness functions in the harness module first, then fetch
   // generated addresses using getHarnessFunctionAddress.
@@ -12,26 +12,6 @@ using namespace simit::ir;
 namespace simit {
 namespace backend {
 
-llvm::Type* const LLVM_VOID              = llvm::Type::getVoidTy(LLVM_CTX);
-
-llvm::IntegerType* const LLVM_BOOL       = llvm::Type::getInt1Ty(LLVM_CTX);
-llvm::IntegerType* const LLVM_INT        = llvm::Type::getInt32Ty(LLVM_CTX);
-llvm::IntegerType* const LLVM_INT8       = llvm::Type::getInt8Ty(LLVM_CTX);
-llvm::IntegerType* const LLVM_INT32      = llvm::Type::getInt32Ty(LLVM_CTX);
-llvm::IntegerType* const LLVM_INT64      = llvm::Type::getInt64Ty(LLVM_CTX);
-
-llvm::Type* const LLVM_FLOAT             = llvm::Type::getFloatTy(LLVM_CTX);
-llvm::Type* const LLVM_DOUBLE            = llvm::Type::getDoubleTy(LLVM_CTX);
-
-llvm::PointerType* const LLVM_FLOAT_PTR  = llvm::Type::getFloatPtrTy(LLVM_CTX);
-llvm::PointerType* const LLVM_DOUBLE_PTR = llvm::Type::getDoublePtrTy(LLVM_CTX);
-
-llvm::PointerType* const LLVM_BOOL_PTR   = llvm::Type::getInt1PtrTy(LLVM_CTX);
-llvm::PointerType* const LLVM_INT_PTR    = llvm::Type::getInt32PtrTy(LLVM_CTX);
-llvm::PointerType* const LLVM_INT8_PTR   = llvm::Type::getInt8PtrTy(LLVM_CTX);
-llvm::PointerType* const LLVM_INT32_PTR  = llvm::Type::getInt32PtrTy(LLVM_CTX);
-llvm::PointerType* const LLVM_INT64_PTR  = llvm::Type::getInt64PtrTy(LLVM_CTX);
-
 /// One for endpoints, two for neighbor index
 extern const int NUM_EDGE_INDEX_ELEMENTS = 3;
 
@@ -84,7 +64,7 @@ llvm::StructType *llvmType(const ir::UnstructuredSetType& setType,
   vector<llvm::Type*> llvmFieldTypes;
 
   // Set size
-  llvmFieldTypes.push_back(LLVM_INT);
+  llvmFieldTypes.push_back(llvmIndexType());
 
   // Edge indices (if the set is an edge set)
   if (setType.endpointSets.size() > 0) {
@@ -94,7 +74,7 @@ llvm::StructType *llvmType(const ir::UnstructuredSetType& setType,
 
   // Fields
   for (const Field &field : elemType->fields) {
-    llvmFieldTypes.push_back(llvmType(field.type, addrspace));
+    llvmFieldTypes.push_back(llvmType(field, addrspace));
   }
   return llvm::StructType::get(LLVM_CTX, llvmFieldTypes, packed);
 }
@@ -115,23 +95,38 @@ llvm::StructType *llvmType(const ir::GridSetType& setType,
 
   // Fields
   for (const Field &field : elemType->fields) {
-    llvmFieldTypes.push_back(llvmType(field.type, addrspace));
+    llvmFieldTypes.push_back(llvmType(field, addrspace));
   }
   return llvm::StructType::get(LLVM_CTX, llvmFieldTypes, packed);
 }
 
+llvm::Type* llvmType(const ir::Field& field, unsigned addrspace) {
+  if (field.floatBytes != 0 && field.type.isTensor() &&
+      field.type.toTensor()->getComponentType().isFloat()) {
+    simit_iassert(field.floatBytes == 4 || field.floatBytes == 8);
+    return (field.floatBytes == 4)
+        ? llvm::Type::getFloatPtrTy(LLVM_CTX, addrspace)
+        : llvm::Type::getDoublePtrTy(LLVM_CTX, addrspace);
+  }
+  return llvmType(field.type, addrspace);
+}
+
 llvm::PointerType* llvmType(const TensorType& type, unsigned addrspace) {
   return llvmPtrType(type.getComponentType(), addrspace);
 }
 
 llvm::PointerType* llvmType(const ir::ArrayType& type, unsigned addrspace) {
+  // Int arrays are index arrays (e.g. tensor index coords and sinks)
+  if (type.elementType.isInt()) {
+    return llvmIndexPtrType(addrspace);
+  }
   return llvmPtrType(type.elementType, addrspace);
 }
 
 llvm::Type* llvmType(ScalarType stype) {
   switch (stype.kind) {
     case ScalarType::Int:
-      return LLVM_INT;
+      return llvmIndexType();
     case ScalarType::Float:
       return llvmFloatType();
     case ScalarType::Boolean:
@@ -184,6 +179,19 @@ llvm::PointerType *llvmFloatPtrType(unsigned addrspace) {
   }
 }
 
+llvm::IntegerType *llvmIndexType() {
+  return ScalarType::longIndices() ? LLVM_INT64 : LLVM_INT32;
+}
+
+llvm::PointerType *llvmIndexPtrType(unsigned addrspace) {
+  if (ScalarType::longIndices()) {
+    return llvm::Type::getInt64PtrTy(LLVM_CTX, addrspace);
+  }
+  else {
+    return llvm::Type::getInt32PtrTy(LLVM_CTX, addrspace);
+  }
+}
+
 llvm::PointerType *llvmComplexPtrType(unsigned addrspace) {
   return llvm::PointerType::get(llvmComplexType(), addrspace);
 }
@@ -4,6 +4,8 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/DerivedTypes.h"
 
+#include "llvm_context.h"
+
 namespace simit {
 namespace ir {
 class Type;
@@ -13,29 +15,32 @@ struct GridSetType;
 struct TensorType;
 struct ArrayType;
 struct ScalarType;
+struct Field;
 }
 
 namespace backend {
 
-extern llvm::Type* const LLVM_VOID;
+// LLVM types belong to a context, so these are looked up in the current
+// context (see llvm_context.h) rather than cached.
+#define LLVM_VOID       llvm::Type::getVoidTy(LLVM_CTX)
 
-extern llvm::Type* const LLVM_FLOAT;
-extern llvm::Type* const LLVM_DOUBLE;
+#define LLVM_FLOAT      llvm::Type::getFloatTy(LLVM_CTX)
+#define LLVM_DOUBLE     llvm::Type::getDoubleTy(LLVM_CTX)
 
-extern llvm::IntegerType* const LLVM_BOOL;
-extern llvm::IntegerType* const LLVM_INT;
-extern llvm::IntegerType* const LLVM_INT8;
-extern llvm::IntegerType* const LLVM_INT32;
-extern llvm::IntegerType* const LLVM_INT64;
+#define LLVM_BOOL       llvm::Type::getInt1Ty(LLVM_CTX)
+#define LLVM_INT        llvm::Type::getInt32Ty(LLVM_CTX)
+#define LLVM_INT8       llvm::Type::getInt8Ty(LLVM_CTX)
+#define LLVM_INT32      llvm::Type::getInt32Ty(LLVM_CTX)
+#define LLVM_INT64      llvm::Type::getInt64Ty(LLVM_CTX)
 
-extern llvm::PointerType* const LLVM_FLOAT_PTR;
-extern llvm::PointerType* const LLVM_DOUBLE_PTR;
+#define LLVM_FLOAT_PTR  llvm::Type::getFloatPtrTy(LLVM_CTX)
+#define LLVM_DOUBLE_PTR llvm::Type::getDoublePtrTy(LLVM_CTX)
 
-extern llvm::PointerType* const LLVM_BOOL_PTR;
-extern llvm::PointerType* const LLVM_INT_PTR;
-extern llvm::PointerType* const LLVM_INT8_PTR;
-extern llvm::PointerType* const LLVM_INT32_PTR;
-extern llvm::PointerType* const LLVM_INT64_PTR;
+#define LLVM_BOOL_PTR   llvm::Type::getInt1PtrTy(LLVM_CTX)
+#define LLVM_INT_PTR    llvm::Type::getInt32PtrTy(LLVM_CTX)
+#define LLVM_INT8_PTR   llvm::Type::getInt8PtrTy(LLVM_CTX)
+#define LLVM_INT32_PTR  llvm::Type::getInt32PtrTy(LLVM_CTX)
+#define LLVM_INT64_PTR  llvm::Type::getInt64PtrTy(LLVM_CTX)
 
 
 llvm::Type*        llvmType(const ir::Type&,       unsigned addrspace=0);
@@ -49,11 +54,20 @@ llvm::PointerType* llvmType(const ir::TensorType&, unsigned addrspace=0);
 llvm::PointerType* llvmType(const ir::ArrayType&,  unsigned addrspace=0);
 llvm::Type*        llvmType(ir::ScalarType);
 
+/// The type of an element field in a set struct. Float fields are stored at
+/// their declared width (see ir::Field::floatBytes).
+llvm::Type*        llvmType(const ir::Field&,      unsigned addrspace=0);
+
 llvm::PointerType* llvmPtrType(ir::ScalarType stype, unsigned addrspace);
 
 llvm::PointerType* llvmFloatPtrType(unsigned addrspace=0);
 llvm::Type*        llvmFloatType();
 
+/// The type of Int values, set sizes and path index arrays. It is i32 or i64,
+/// depending on the index size setting (ScalarType::indexBytes).
+llvm::PointerType* llvmIndexPtrType(unsigned addrspace=0);
+llvm::IntegerType* llvmIndexType();
+
 llvm::PointerType* llvmComplexPtrType(unsigned addrspace=0);
 llvm::StructType*  llvmComplexType();
 
@@ -0,0 +1,101 @@
+#include "llvm_vectorization_report.h"
+
+#include <iostream>
+#include <map>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+namespace backend {
+
+// class VectorizationReport
+VectorizationReport::VectorizationReport(llvm::LLVMContext* context)
+    : context(context), previousHandler(context->getDiagnosticHandler()),
+      previousHandlerContext(context->getDiagnosticContext()) {
+  context->setDiagnosticHandler(handleDiagnostic, this);
+}
+
+VectorizationReport::~VectorizationReport() {
+  context->setDiagnosticHandler(previousHandler, previousHandlerContext);
+}
+
+void VectorizationReport::print(std::ostream& os) const {
+  map<string, vector<const Remark*>> functionRemarks;
+  unsigned numLoops = 0;
+  unsigned numVectorized = 0;
+  for (const Remark& remark : remarks) {
+    functionRemarks[remark.function].push_back(&remark);
+    if (remark.kind == Remark::Vectorized) {
+      ++numVectorized;
+      ++numLoops;
+    }
+    else if (remark.kind == Remark::NotVectorized) {
+      ++numLoops;
+    }
+  }
+
+  os << "=== Loop vectorization report ===" << endl;
+  for (auto& function : functionRemarks) {
+    os << function.first << ":" << endl;
+    for (const Remark* remark : function.second) {
+      os << "  " << remark->message << endl;
+    }
+  }
+  os << numVectorized << " of " << numLoops << " loops vectorized" << endl;
+}
+
+void VectorizationReport::handleDiagnostic(const llvm::DiagnosticInfo& info,
+                                           void* report) {
+  VectorizationReport* self = static_cast<VectorizationReport*>(report);
+
+  Remark::Kind kind;
+  switch (info.getKind()) {
+    case llvm::DK_OptimizationRemark:
+      kind = Remark::Vectorized;
+      break;
+    case llvm::DK_OptimizationRemarkMissed:
+      kind = Remark::NotVectorized;
+      break;
+    case llvm::DK_OptimizationRemarkAnalysis:
+      kind = Remark::Reason;
+      break;
+    default: {
+      if (self->previousHandler != nullptr) {
+        self->previousHandler(info, self->previousHandlerContext);
+        return;
+      }
+      if (info.getSeverity() == llvm::DS_Remark) {
+        return;
+      }
+      string message;
+      llvm::raw_string_ostream messageStream(message);
+      llvm::DiagnosticPrinterRawOStream printer(messageStream);
+      info.print(printer);
+      messageStream.flush();
+      simit_iassert(info.getSeverity() != llvm::DS_Error) << message;
+      std::cerr << message << std::endl;
+      return;
+    }
+  }
+
+  // Only loop vectorizer remarks go into the report
+  const llvm::DiagnosticInfoOptimizationBase& remark =
+      static_cast<const llvm::DiagnosticInfoOptimizationBase&>(info);
+  if (llvm::StringRef(remark.getPassName()) != "loop-vectorize") {
+    return;
+  }
+  self->remarks.push_back({kind, remark.getFunction().getName().str(),
+                           llvm::Twine(remark.getMsg()).str()});
+}
+
+}}
@@ -0,0 +1,52 @@
+#ifndef SIMIT_LLVM_VECTORIZATION_REPORT_H
+#define SIMIT_LLVM_VECTORIZATION_REPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class LLVMContext;
+class DiagnosticInfo;
+}
+
+namespace simit {
+namespace backend {
+
+/// Collects the remarks LLVM's loop vectorizer makes about the code optimized
+/// in a context while the report is in scope, that is, which loops it
+/// vectorized and why it did not vectorize the others. Other diagnostics are
+/// printed to stderr, and errors raise internal errors.
+class VectorizationReport {
+public:
+  VectorizationReport(llvm::LLVMContext* context);
+  ~VectorizationReport();
+
+  /// Print the remarks, grouped by function, and how many of the loops the
+  /// vectorizer considered were vectorized.
+  void print(std::ostream& os) const;
+
+private:
+  struct Remark {
+    enum Kind {Vectorized, NotVectorized, Reason};
+    Kind kind;
+    std::string function;
+    std::string message;
+  };
+
+  llvm::LLVMContext* context;
+  std::vector<Remark> remarks;
+
+  /// The context's diagnostic handler before the report, restored afterwards.
+  void (*previousHandler)(const llvm::DiagnosticInfo&, void*);
+  void* previousHandlerContext;
+
+  static void handleDiagnostic(const llvm::DiagnosticInfo& info,
+                               void* report);
+
+  VectorizationReport(const VectorizationReport&) = delete;
+  VectorizationReport& operator=(const VectorizationReport&) = delete;
+};
+
+}}
+#endif
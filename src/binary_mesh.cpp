@@ -0,0 +1,574 @@
+#include "binary_mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "graph.h"
+
+using namespace std;
+
+namespace simit {
+
+static const char     MAGIC[8]   = {'S','I','M','I','T','M','S','H'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const size_t   ALIGNMENT  = 64;
+
+/// Zero runs shorter than this are stored as literals.
+static const size_t MIN_ZERO_RUN = 16;
+
+enum ChunkKind : uint32_t {SetChunk=1, EndpointsChunk=2, FieldChunk=3,
+                           TensorChunk=4};
+
+/// The set index of chunks that do not belong to a set.
+static const uint32_t NO_SET = UINT32_MAX;
+
+struct FileHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t numChunks;
+  uint64_t reserved[5];
+};
+static_assert(sizeof(FileHeader) == ALIGNMENT, "unexpected header size");
+
+/// A chunk header, followed by its payload and padding up to the next 64-byte
+/// boundary.
+struct BinaryMesh::Chunk {
+  uint32_t kind;
+  uint32_t compression;
+  uint32_t set;             // index of the set the chunk belongs to
+  uint32_t componentType;   // component type of a field
+  uint64_t count;           // number of elements of the set
+  uint64_t storedBytes;     // size of the payload in the file
+  uint64_t rawBytes;        // size of the payload once decompressed
+  uint32_t order;           // order of a field, or cardinality of a set
+  uint32_t dimensions[4];   // dimensions of a field
+  uint32_t reserved;
+  char     name[64];
+
+  const char* payload() const {return (const char*)(this + 1);}
+};
+static_assert(sizeof(BinaryMesh::Chunk) == 2*ALIGNMENT,
+              "unexpected chunk header size");
+
+// The component type codes stored in files, which must not change
+static uint32_t componentTypeCode(ComponentType componentType) {
+  switch (componentType) {
+    case ComponentType::Float:         return 1;
+    case ComponentType::Double:        return 2;
+    case ComponentType::Int:           return 3;
+    case ComponentType::Boolean:       return 4;
+    case ComponentType::FloatComplex:  return 5;
+    case ComponentType::DoubleComplex: return 6;
+  }
+  simit_unreachable;
+  return 0;
+}
+
+static bool componentTypeFromCode(uint32_t code, ComponentType* componentType) {
+  switch (code) {
+    case 1: *componentType = ComponentType::Float;         return true;
+    case 2: *componentType = ComponentType::Double;        return true;
+    case 3: *componentType = ComponentType::Int;           return true;
+    case 4: *componentType = ComponentType::Boolean;       return true;
+    case 5: *componentType = ComponentType::FloatComplex;  return true;
+    case 6: *componentType = ComponentType::DoubleComplex; return true;
+  }
+  return false;
+}
+
+static size_t padding(size_t bytes) {
+  return (ALIGNMENT - bytes % ALIGNMENT) % ALIGNMENT;
+}
+
+/// Encode `data` as a sequence of (literal length, literals, zero run length)
+/// tokens with 32-bit lengths.
+static void encodeZeroRuns(const char* data, size_t size, vector<char>* out) {
+  auto writeLength = [out](uint32_t length) {
+    const char* bytes = (const char*)&length;
+    out->insert(out->end(), bytes, bytes + sizeof(length));
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    // Find the next zero run that is worth encoding
+    size_t literalEnd = i;
+    size_t zeroEnd = i;
+    while (literalEnd < size && literalEnd - i < UINT32_MAX) {
+      zeroEnd = literalEnd;
+      while (zeroEnd < size && data[zeroEnd] == 0 &&
+             zeroEnd - literalEnd < UINT32_MAX) {
+        ++zeroEnd;
+      }
+      if (zeroEnd - literalEnd >= MIN_ZERO_RUN || zeroEnd == size) {
+        break;
+      }
+      literalEnd = std::max(zeroEnd, literalEnd + 1);
+    }
+    literalEnd = std::min(literalEnd, size);
+    zeroEnd = std::max(zeroEnd, literalEnd);
+
+    writeLength(literalEnd - i);
+    out->insert(out->end(), data + i, data + literalEnd);
+    writeLength(zeroEnd - literalEnd);
+    i = zeroEnd;
+  }
+}
+
+static bool decodeZeroRuns(const char* data, size_t size, char* out,
+                           size_t outSize) {
+  size_t i = 0;
+  size_t o = 0;
+  auto readLength = [&](uint32_t* length) {
+    if (size - i < sizeof(*length)) return false;
+    memcpy(length, data + i, sizeof(*length));
+    i += sizeof(*length);
+    return true;
+  };
+
+  while (i < size) {
+    uint32_t literals, zeros;
+    if (!readLength(&literals) || size - i < literals ||
+        outSize - o < literals) {
+      return false;
+    }
+    memcpy(out + o, data + i, literals);
+    i += literals;
+    o += literals;
+    if (!readLength(&zeros) || outSize - o < zeros) {
+      return false;
+    }
+    memset(out + o, 0, zeros);
+    o += zeros;
+  }
+  return o == outSize;
+}
+
+/// Copy the payload of a chunk to `out`, decompressing it if necessary.
+static bool readPayload(const BinaryMesh::Chunk* chunk, char* out) {
+  switch ((MeshCompression)chunk->compression) {
+    case MeshCompression::None:
+      if (chunk->storedBytes != chunk->rawBytes) return false;
+      memcpy(out, chunk->payload(), chunk->rawBytes);
+      return true;
+    case MeshCompression::ZeroRuns:
+      return decodeZeroRuns(chunk->payload(), chunk->storedBytes, out,
+                            chunk->rawBytes);
+  }
+  return false;
+}
+
+// class BinaryMeshWriter
+/// A chunk header and its payload, which is either borrowed from a set or
+/// tensor or, after a snapshot, owned by the chunk.
+struct BinaryMeshWriter::PendingChunk {
+  BinaryMesh::Chunk header;
+  const char* payload;
+  std::vector<char> ownedPayload;
+};
+
+BinaryMeshWriter::BinaryMeshWriter(MeshCompression compression)
+    : compression(compression), numChunks(0) {
+}
+
+BinaryMeshWriter::~BinaryMeshWriter() {
+}
+
+BinaryMeshWriter::PendingChunk*
+BinaryMeshWriter::addChunk(uint32_t kind, uint32_t set,
+                           const std::string& name) {
+  // Reuse chunks from before the last clear, with their payload buffers
+  if (numChunks == chunks.size()) {
+    chunks.push_back(std::unique_ptr<PendingChunk>(new PendingChunk));
+  }
+  PendingChunk* chunk = chunks[numChunks++].get();
+  memset(&chunk->header, 0, sizeof(chunk->header));
+  chunk->header.kind = kind;
+  chunk->header.set = set;
+  strncpy(chunk->header.name, name.c_str(), sizeof(chunk->header.name)-1);
+  chunk->payload = nullptr;
+  chunk->ownedPayload.clear();
+  return chunk;
+}
+
+int BinaryMeshWriter::addSet(const std::string& name, Set* set) {
+  if (name.size() >= sizeof(BinaryMesh::Chunk::name)) {
+    std::cerr << "Set name too long: " << name << std::endl;
+    return -1;
+  }
+  if (set->getKind() != Set::Unstructured) {
+    std::cerr << "Cannot save grid set " << name << std::endl;
+    return -1;
+  }
+  for (const Set::FieldData* field : set->getFields()) {
+    if (field->name.size() >= sizeof(BinaryMesh::Chunk::name) ||
+        field->type->getOrder() > 4) {
+      std::cerr << "Cannot save field " << name << "." << field->name
+                << std::endl;
+      return -1;
+    }
+  }
+
+  const uint32_t setIndex = sets.size();
+  const int cardinality = set->getCardinality();
+  PendingChunk* chunk = addChunk(SetChunk, setIndex, name);
+  chunk->header.count = set->getSize();
+  chunk->header.order = cardinality;
+  chunk->header.rawBytes = cardinality * sizeof(int32_t);
+  for (int ep=0; ep < cardinality; ++ep) {
+    auto it = std::find(sets.begin(), sets.end(), set->getEndpointSet(ep));
+    int32_t endpointSet = (it == sets.end()) ? -1 : (it - sets.begin());
+    const char* bytes = (const char*)&endpointSet;
+    chunk->ownedPayload.insert(chunk->ownedPayload.end(),
+                               bytes, bytes + sizeof(endpointSet));
+  }
+  chunk->payload = chunk->ownedPayload.data();
+
+  if (cardinality > 0) {
+    chunk = addChunk(EndpointsChunk, setIndex, name);
+    chunk->header.count = set->getSize();
+    chunk->header.rawBytes = (size_t)set->getSize()*cardinality*sizeof(int);
+    chunk->payload = (const char*)set->getEndpointsData();
+  }
+
+  for (const Set::FieldData* field : set->getFields()) {
+    chunk = addChunk(FieldChunk, setIndex, field->name);
+    chunk->header.count = set->getSize();
+    chunk->header.componentType =
+        componentTypeCode(field->type->getComponentType());
+    chunk->header.order = field->type->getOrder();
+    for (size_t d=0; d < field->type->getOrder(); ++d) {
+      chunk->header.dimensions[d] = field->type->getDimension(d);
+    }
+    chunk->header.rawBytes = set->getSize() * field->sizeOfType;
+    chunk->payload = (const char*)field->data;
+  }
+  sets.push_back(set);
+  return 0;
+}
+
+int BinaryMeshWriter::addTensor(const std::string& name, const void* data,
+                                size_t bytes) {
+  if (name.size() >= sizeof(BinaryMesh::Chunk::name)) {
+    std::cerr << "Tensor name too long: " << name << std::endl;
+    return -1;
+  }
+  PendingChunk* chunk = addChunk(TensorChunk, NO_SET, name);
+  chunk->header.rawBytes = bytes;
+  chunk->payload = (const char*)data;
+  return 0;
+}
+
+void BinaryMeshWriter::snapshot() {
+  for (size_t i=0; i < numChunks; ++i) {
+    PendingChunk* chunk = chunks[i].get();
+    if (chunk->payload != chunk->ownedPayload.data()) {
+      chunk->ownedPayload.assign(chunk->payload,
+                                 chunk->payload + chunk->header.rawBytes);
+      chunk->payload = chunk->ownedPayload.data();
+    }
+  }
+}
+
+void BinaryMeshWriter::clear() {
+  sets.clear();
+  numChunks = 0;
+}
+
+int BinaryMeshWriter::save(const std::string& filename) const {
+  ofstream out(filename, ios::binary);
+  if (!out.good()) {
+    std::cerr << "Cannot write to " << filename << std::endl;
+    return -1;
+  }
+
+  FileHeader fileHeader;
+  memset(&fileHeader, 0, sizeof(fileHeader));
+  memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+  fileHeader.version = BinaryMesh::version;
+  fileHeader.byteOrder = BYTE_ORDER_MARK;
+  fileHeader.numChunks = numChunks;
+  out.write((const char*)&fileHeader, sizeof(fileHeader));
+
+  const char zeros[ALIGNMENT] = {0};
+  vector<char> compressed;
+  for (size_t i=0; i < numChunks; ++i) {
+    BinaryMesh::Chunk header = chunks[i]->header;
+    const char* payload = chunks[i]->payload;
+    header.compression = (uint32_t)MeshCompression::None;
+    header.storedBytes = header.rawBytes;
+
+    // Only keep compressed payloads that are smaller
+    if (compression == MeshCompression::ZeroRuns && header.kind != SetChunk) {
+      compressed.clear();
+      encodeZeroRuns(payload, header.rawBytes, &compressed);
+      if (compressed.size() < header.rawBytes) {
+        header.compression = (uint32_t)MeshCompression::ZeroRuns;
+        header.storedBytes = compressed.size();
+        payload = compressed.data();
+      }
+    }
+
+    out.write((const char*)&header, sizeof(header));
+    out.write(payload, header.storedBytes);
+    out.write(zeros, padding(header.storedBytes));
+  }
+
+  if (!out.good()) {
+    std::cerr << "Failed writing " << filename << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+// class BinaryMesh
+BinaryMesh::~BinaryMesh() {
+  close();
+}
+
+int BinaryMesh::open(const std::string& filename) {
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot read " << filename << std::endl;
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+    std::cerr << filename << " is not a binary mesh" << std::endl;
+    ::close(fd);
+    return -1;
+  }
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map " << filename << std::endl;
+    return -1;
+  }
+  posix_madvise(mapping, st.st_size, POSIX_MADV_SEQUENTIAL);
+  data = (const char*)mapping;
+  size = st.st_size;
+
+  const FileHeader* header = (const FileHeader*)data;
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+    std::cerr << filename << " is not a binary mesh" << std::endl;
+    close();
+    return -1;
+  }
+  if (header->byteOrder != BYTE_ORDER_MARK) {
+    std::cerr << filename << " has a different byte order" << std::endl;
+    close();
+    return -1;
+  }
+  if (header->version > version) {
+    std::cerr << filename << " has version " << header->version
+              << ", but only versions up to " << version << " are supported"
+              << std::endl;
+    close();
+    return -1;
+  }
+
+  size_t offset = sizeof(FileHeader);
+  for (uint64_t i=0; i < header->numChunks; ++i) {
+    if (offset > size || size - offset < sizeof(Chunk)) {
+      std::cerr << filename << " is truncated" << std::endl;
+      close();
+      return -1;
+    }
+    const Chunk* chunk = (const Chunk*)(data + offset);
+    if (size - offset - sizeof(Chunk) < chunk->storedBytes) {
+      std::cerr << filename << " is truncated" << std::endl;
+      close();
+      return -1;
+    }
+    // Uncompressed payloads are read in place, so they must hold rawBytes
+    if (memchr(chunk->name, 0, sizeof(chunk->name)) == nullptr ||
+        (chunk->compression == (uint32_t)MeshCompression::None &&
+         chunk->storedBytes != chunk->rawBytes)) {
+      std::cerr << filename << " has a corrupt chunk" << std::endl;
+      close();
+      return -1;
+    }
+    chunks.push_back(chunk);
+    offset += sizeof(Chunk) + chunk->storedBytes + padding(chunk->storedBytes);
+  }
+  if (offset > size) {
+    std::cerr << filename << " is truncated" << std::endl;
+    close();
+    return -1;
+  }
+  return 0;
+}
+
+void BinaryMesh::close() {
+  if (data != nullptr) {
+    munmap((void*)data, size);
+  }
+  data = nullptr;
+  size = 0;
+  chunks.clear();
+}
+
+std::vector<std::string> BinaryMesh::getSetNames() const {
+  vector<string> names;
+  for (const Chunk* chunk : chunks) {
+    if (chunk->kind == SetChunk) {
+      names.push_back(chunk->name);
+    }
+  }
+  return names;
+}
+
+int BinaryMesh::load(const std::string& name, Set* set) const {
+  auto setChunk = std::find_if(chunks.begin(), chunks.end(),
+      [&name](const Chunk* chunk) {
+        return chunk->kind == SetChunk && name == chunk->name;
+      });
+  if (setChunk == chunks.end()) {
+    std::cerr << "No set " << name << " in binary mesh" << std::endl;
+    return -1;
+  }
+  const uint32_t setIndex = (*setChunk)->set;
+  const uint64_t count = (*setChunk)->count;
+  if ((*setChunk)->order != (uint32_t)set->getCardinality() ||
+      count > (uint64_t)INT32_MAX - set->getSize()) {
+    std::cerr << "Cannot load " << name << " into a set with cardinality "
+              << set->getCardinality() << std::endl;
+    return -1;
+  }
+  if ((*setChunk)->compression != (uint32_t)MeshCompression::None ||
+      (*setChunk)->rawBytes != (*setChunk)->order * sizeof(int32_t)) {
+    std::cerr << "Corrupt set " << name << std::endl;
+    return -1;
+  }
+
+  // Find the set's endpoints and fields, which follow its set chunk
+  const Chunk* endpointsChunk = nullptr;
+  vector<const Chunk*> fieldChunks;
+  for (auto it = setChunk+1; it != chunks.end() && (*it)->set == setIndex &&
+       (*it)->kind != SetChunk; ++it) {
+    if ((*it)->count != count) {
+      std::cerr << "Corrupt chunk " << (*it)->name << " in " << name
+                << std::endl;
+      return -1;
+    }
+    if ((*it)->kind == EndpointsChunk) {
+      endpointsChunk = *it;
+    }
+    else if ((*it)->kind == FieldChunk) {
+      fieldChunks.push_back(*it);
+    }
+  }
+
+  // Add the elements and their endpoints
+  const int cardinality = set->getCardinality();
+  int first;
+  if (cardinality > 0) {
+    if (endpointsChunk == nullptr ||
+        endpointsChunk->rawBytes != count * cardinality * sizeof(int)) {
+      std::cerr << "Corrupt endpoints of " << name << std::endl;
+      return -1;
+    }
+    vector<int> endpoints(count * cardinality);
+    if (!readPayload(endpointsChunk, (char*)endpoints.data())) {
+      std::cerr << "Corrupt endpoints of " << name << std::endl;
+      return -1;
+    }
+
+    // The endpoint sets were loaded after `offsets[ep]` elements they had
+    // before, so the stored endpoints are rebased by those. Endpoint sets that
+    // were not saved with the file are not rebased.
+    vector<int> offsets(cardinality, 0);
+    vector<int> sizes(cardinality);
+    const int32_t* endpointSets = (const int32_t*)(*setChunk)->payload();
+    for (int ep=0; ep < cardinality; ++ep) {
+      sizes[ep] = set->getEndpointSet(ep)->getSize();
+      auto endpointSetChunk = std::find_if(chunks.begin(), chunks.end(),
+          [&](const Chunk* chunk) {
+            return chunk->kind == SetChunk && endpointSets[ep] >= 0 &&
+                   chunk->set == (uint32_t)endpointSets[ep];
+          });
+      if (endpointSetChunk == chunks.end()) {
+        continue;
+      }
+      if ((*endpointSetChunk)->count > (uint64_t)sizes[ep]) {
+        std::cerr << "Cannot load " << name << " before its endpoint set "
+                  << (*endpointSetChunk)->name << std::endl;
+        return -1;
+      }
+      offsets[ep] = sizes[ep] - (*endpointSetChunk)->count;
+    }
+    for (size_t i=0; i < endpoints.size(); ++i) {
+      const int ep = i % cardinality;
+      if (endpoints[i] < 0 || endpoints[i] >= sizes[ep] - offsets[ep]) {
+        std::cerr << "Corrupt endpoints of " << name << std::endl;
+        return -1;
+      }
+      endpoints[i] += offsets[ep];
+    }
+    first = set->addElements(count, endpoints.data()).getIdent();
+  }
+  else {
+    first = set->addElements(count).getIdent();
+  }
+
+  // Copy the fields into the set's storage
+  for (const Chunk* chunk : fieldChunks) {
+    ComponentType componentType;
+    if (!componentTypeFromCode(chunk->componentType, &componentType) ||
+        chunk->order > 4) {
+      std::cerr << "Corrupt field " << name << "." << chunk->name << std::endl;
+      return -1;
+    }
+    vector<int> dimensions(chunk->dimensions, chunk->dimensions+chunk->order);
+
+    if (!set->hasField(chunk->name)) {
+      set->addField(chunk->name, componentType, dimensions);
+    }
+    const Set::FieldData* field = set->getFields()[
+        set->getFieldIndex(chunk->name)];
+    bool sameType = field->type->getComponentType() == componentType &&
+                    field->type->getOrder() == dimensions.size();
+    for (size_t d=0; sameType && d < dimensions.size(); ++d) {
+      sameType = (field->type->getDimension(d) == (size_t)dimensions[d]);
+    }
+    if (!sameType) {
+      std::cerr << "Field " << name << "." << chunk->name << " has a "
+                << "different type in the set" << std::endl;
+      return -1;
+    }
+    if (chunk->rawBytes != count * field->sizeOfType ||
+        !readPayload(chunk, (char*)field->data + first*field->sizeOfType)) {
+      std::cerr << "Corrupt field " << name << "." << chunk->name << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int BinaryMesh::loadTensor(const std::string& name, void* data,
+                           size_t bytes) const {
+  auto chunk = std::find_if(chunks.begin(), chunks.end(),
+      [&name](const Chunk* chunk) {
+        return chunk->kind == TensorChunk && name == chunk->name;
+      });
+  if (chunk == chunks.end()) {
+    std::cerr << "No tensor " << name << " in binary mesh" << std::endl;
+    return -1;
+  }
+  if ((*chunk)->rawBytes != bytes || !readPayload(*chunk, (char*)data)) {
+    std::cerr << "Tensor " << name << " has a different size" << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef SIMIT_BINARY_MESH_H
+#define SIMIT_BINARY_MESH_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \file
+/// A binary container for sets, their endpoints and their fields, and for
+/// dense tensors, that loads without a parse step. Files are little-endian and
+/// consist of a header followed by chunks: one per set, one for the endpoints
+/// of each edge set, one per field and one per tensor. Chunk payloads start at 64-byte aligned offsets, so a
+/// memory-mapped file can be copied into set storage with plain memcpys.
+/// Chunks may be compressed individually.
+///
+/// Use simit-mesh (tools/simit-mesh.cpp) to convert .node/.ele and .obj files.
+
+namespace simit {
+class Set;
+
+/// How the chunks of a binary mesh are compressed.
+enum class MeshCompression {
+  /// Chunks are stored as is and are copied straight from the mapping.
+  None,
+
+  /// Runs of zero bytes are run-length encoded. Cheap to decode, and worth
+  /// it for fields that are mostly zero (e.g. velocities and forces).
+  ZeroRuns
+};
+
+/// Writes sets and tensors to a binary mesh file. Data is read from the sets
+/// and tensors when the file is saved, unless it was copied into the writer
+/// with snapshot.
+class BinaryMeshWriter {
+public:
+  BinaryMeshWriter(MeshCompression compression=MeshCompression::None);
+  ~BinaryMeshWriter();
+
+  /// Add a set under `name`. The endpoints of an edge set are saved as
+  /// indices into their endpoint sets, which are only recorded for endpoint
+  /// sets that were added before it.
+  ///return -1 if the set cannot be saved (e.g. it is a grid set)
+  int addSet(const std::string& name, Set* set);
+
+  /// Add `bytes` bytes of dense tensor data under `name`.
+  ///return -1 if the tensor cannot be saved
+  int addTensor(const std::string& name, const void* data, size_t bytes);
+
+  /// Copy the data of the added sets and tensors into the writer, so that
+  /// they may change before save is called (e.g. on another thread). Buffers
+  /// are kept across clear and reused by the next snapshot.
+  void snapshot();
+
+  /// Remove the added sets and tensors.
+  void clear();
+
+  ///return -1 if failed to save
+  int save(const std::string& filename) const;
+
+private:
+  struct PendingChunk;
+
+  MeshCompression compression;
+  std::vector<const Set*> sets;
+
+  /// The chunks in use are the first numChunks.
+  std::vector<std::unique_ptr<PendingChunk>> chunks;
+  size_t numChunks;
+
+  PendingChunk* addChunk(uint32_t kind, uint32_t set, const std::string& name);
+
+  BinaryMeshWriter(const BinaryMeshWriter&) = delete;
+  BinaryMeshWriter& operator=(const BinaryMeshWriter&) = delete;
+};
+
+/// A memory-mapped binary mesh file, from which sets are loaded.
+class BinaryMesh {
+public:
+  /// Version written by BinaryMeshWriter. Files of newer versions are
+  /// rejected.
+  static const uint32_t version = 1;
+
+  /// The header of a chunk in the file (defined in binary_mesh.cpp).
+  struct Chunk;
+
+  BinaryMesh() : data(nullptr), size(0) {}
+  ~BinaryMesh();
+
+  ///return -1 if failed to open or the file is not a binary mesh
+  int open(const std::string& filename);
+  void close();
+
+  /// The names of the sets in the file, in the order they were written.
+  std::vector<std::string> getSetNames() const;
+
+  /// Load the elements, endpoints and fields of the set called `name` into
+  /// `set`, appending them to its elements. An edge set's endpoints must be
+  /// elements of its endpoint sets, so those are loaded first, and are
+  /// rebased to the endpoint sets' elements loaded from the file. Endpoint
+  /// sets that were not saved with the edge set are not rebased. Fields the
+  /// set does not have are added to it, and fields it has must have the same
+  /// type.
+  ///return -1 if failed to load
+  int load(const std::string& name, Set* set) const;
+
+  /// Copy the tensor called `name` to `data`, which has room for `bytes`
+  /// bytes.
+  ///return -1 if there is no such tensor or it has a different size
+  int loadTensor(const std::string& name, void* data, size_t bytes) const;
+
+private:
+  const char* data;
+  size_t size;
+  std::vector<const Chunk*> chunks;
+
+  BinaryMesh(const BinaryMesh&) = delete;
+  BinaryMesh& operator=(const BinaryMesh&) = delete;
+};
+
+}
+#endif
@@ -0,0 +1,196 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+
+#include "error.h"
+#include "graph.h"
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// class Checkpointer
+Checkpointer::Checkpointer() : failed(false), stopping(false) {
+  busy[0] = busy[1] = false;
+}
+
+Checkpointer::~Checkpointer() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (writer.joinable()) {
+    writer.join();
+  }
+}
+
+void Checkpointer::bind(const Bindable& bindable) {
+  for (Bindable& bound : bindables) {
+    if (bound.name == bindable.name) {
+      bound = bindable;
+      return;
+    }
+  }
+  bindables.push_back(bindable);
+}
+
+void Checkpointer::bindSet(const std::string& name, Set* set) {
+  bind({name, set, nullptr, 0});
+}
+
+void Checkpointer::bindTensor(const std::string& name, void* data,
+                              size_t bytes) {
+  bind({name, nullptr, data, bytes});
+}
+
+std::vector<const Checkpointer::Bindable*>
+Checkpointer::getSetsInEndpointOrder() const {
+  vector<const Bindable*> sets;
+  for (const Bindable& bindable : bindables) {
+    if (bindable.set != nullptr) {
+      sets.push_back(&bindable);
+    }
+  }
+
+  // Repeatedly take the sets whose bound endpoint sets have been taken
+  vector<const Bindable*> ordered;
+  size_t numOrdered;
+  do {
+    numOrdered = ordered.size();
+    for (const Bindable* bindable : sets) {
+      if (std::find(ordered.begin(), ordered.end(), bindable) !=
+          ordered.end()) {
+        continue;
+      }
+      bool ready = true;
+      for (int i=0; ready && i < bindable->set->getCardinality(); ++i) {
+        const Set* endpointSet = bindable->set->getEndpointSet(i);
+        for (const Bindable* other : sets) {
+          if (other->set == endpointSet && other != bindable &&
+              std::find(ordered.begin(), ordered.end(), other) ==
+              ordered.end()) {
+            ready = false;
+          }
+        }
+      }
+      if (ready) {
+        ordered.push_back(bindable);
+      }
+    }
+  } while (ordered.size() > numOrdered);
+  simit_iassert(ordered.size() == sets.size());
+  return ordered;
+}
+
+void Checkpointer::checkpoint(const std::string& filename) {
+  for (const Bindable& bindable : bindables) {
+    simit_uassert(bindable.set != nullptr || bindable.bytes > 0)
+        << "cannot checkpoint " << util::quote(bindable.name)
+        << ", only sets and dense tensors are supported";
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!writer.joinable()) {
+    writer = std::thread(&Checkpointer::writeLoop, this);
+  }
+  changed.wait(lock, [this]() {return !busy[0] || !busy[1];});
+  int buffer = busy[0] ? 1 : 0;
+  busy[buffer] = true;
+  lock.unlock();
+
+  // The buffer is ours until it is queued, so fill it without the lock
+  BinaryMeshWriter& snapshot = buffers[buffer];
+  snapshot.clear();
+  string unsaved;
+  for (const Bindable* bindable : getSetsInEndpointOrder()) {
+    if (snapshot.addSet(bindable->name, bindable->set) != 0) {
+      unsaved = bindable->name;
+    }
+  }
+  for (const Bindable& bindable : bindables) {
+    if (bindable.set == nullptr &&
+        snapshot.addTensor(bindable.name, bindable.data, bindable.bytes) != 0) {
+      unsaved = bindable.name;
+    }
+  }
+  if (!unsaved.empty()) {
+    lock.lock();
+    busy[buffer] = false;
+    lock.unlock();
+    changed.notify_all();
+    simit_uerror << "cannot checkpoint " << util::quote(unsaved);
+  }
+  snapshot.snapshot();
+
+  lock.lock();
+  pending.push_back({buffer, filename});
+  lock.unlock();
+  changed.notify_all();
+}
+
+int Checkpointer::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this]() {return !busy[0] && !busy[1];});
+  int status = failed ? -1 : 0;
+  failed = false;
+  return status;
+}
+
+int Checkpointer::restore(const std::string& filename) {
+  int status = wait();
+  BinaryMesh checkpoint;
+  if (checkpoint.open(filename) != 0) {
+    return -1;
+  }
+
+  // Clear all sets before loading any, as endpoints are checked against the
+  // sizes of their endpoint sets. Edge sets are cleared before their endpoint
+  // sets, so no edge is left pointing at a removed element.
+  vector<const Bindable*> sets = getSetsInEndpointOrder();
+  for (auto it = sets.rbegin(); it != sets.rend(); ++it) {
+    vector<ElementRef> elements;
+    for (ElementRef element : *(*it)->set) {
+      elements.push_back(element);
+    }
+    (*it)->set->removeElements(elements);
+  }
+  for (const Bindable* bindable : sets) {
+    if (checkpoint.load(bindable->name, bindable->set) != 0) {
+      return -1;
+    }
+  }
+  for (const Bindable& bindable : bindables) {
+    if (bindable.set == nullptr &&
+        checkpoint.loadTensor(bindable.name, bindable.data,
+                              bindable.bytes) != 0) {
+      return -1;
+    }
+  }
+  return status;
+}
+
+void Checkpointer::writeLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    changed.wait(lock, [this]() {return stopping || !pending.empty();});
+    if (pending.empty()) {
+      return;
+    }
+    pair<int,string> checkpoint = pending.front();
+    pending.pop_front();
+    lock.unlock();
+
+    int status = buffers[checkpoint.first].save(checkpoint.second);
+
+    lock.lock();
+    if (status != 0) {
+      failed = true;
+    }
+    busy[checkpoint.first] = false;
+    changed.notify_all();
+  }
+}
+
+}}
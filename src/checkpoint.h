@@ -0,0 +1,82 @@
+#ifndef SIMIT_CHECKPOINT_H
+#define SIMIT_CHECKPOINT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "binary_mesh.h"
+
+namespace simit {
+class Set;
+
+namespace internal {
+
+/// Writes checkpoints of the sets and dense tensors bound to a function to
+/// binary mesh files (see binary_mesh.h). A checkpoint copies the bound data
+/// into one of two snapshot buffers and returns, and a background thread
+/// writes the snapshot to its file. The function can therefore run again
+/// while the previous state is written, and a checkpoint only waits if both
+/// buffers are still being written.
+class Checkpointer {
+public:
+  Checkpointer();
+
+  /// Waits for the pending checkpoints to be written.
+  ~Checkpointer();
+
+  void bindSet(const std::string& name, Set* set);
+
+  /// Bind `bytes` bytes of tensor data. Tensors with a `bytes` of 0 (e.g.
+  /// sparse tensors) cannot be checkpointed.
+  void bindTensor(const std::string& name, void* data, size_t bytes);
+
+  /// Snapshot the bound sets and tensors and write them to `filename` in the
+  /// background.
+  void checkpoint(const std::string& filename);
+
+  /// Wait for the pending checkpoints to be written.
+  ///return -1 if a checkpoint failed to write since the last wait
+  int wait();
+
+  /// Replace the bound sets' elements and the bound tensors' data with those
+  /// of a checkpoint, after waiting for the pending checkpoints.
+  ///return -1 if failed to restore, in which case the bound data is undefined
+  int restore(const std::string& filename);
+
+private:
+  struct Bindable {
+    std::string name;
+    Set* set;
+    void* data;
+    size_t bytes;
+  };
+  std::vector<Bindable> bindables;
+
+  /// Snapshot buffers and the files they are written to. A buffer is busy
+  /// from the checkpoint that fills it until it has been written.
+  BinaryMeshWriter buffers[2];
+  bool busy[2];
+  std::deque<std::pair<int,std::string>> pending;
+  bool failed;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::thread writer;
+
+  void bind(const Bindable& bindable);
+
+  /// The bound sets, with the endpoint sets of edge sets before them.
+  std::vector<const Bindable*> getSetsInEndpointOrder() const;
+
+  void writeLoop();
+
+  Checkpointer(const Checkpointer&) = delete;
+  Checkpointer& operator=(const Checkpointer&) = delete;
+};
+
+}}
+#endif
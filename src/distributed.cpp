@@ -0,0 +1,348 @@
+#include "distributed.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "error.h"
+#include "function.h"
+#include "partition.h"
+#include "path_expressions.h"
+#include "path_indices.h"
+#include "transport.h"
+
+using namespace std;
+
+namespace simit {
+
+// class DistributedSets
+DistributedSets::DistributedSets(Transport* transport, Set* vertices,
+                                 const std::vector<Set*>& edgeSets)
+    : transport(transport) {
+  simit_uassert(transport != nullptr) << "distributed sets need a transport";
+  vector<const Set*> constEdgeSets(edgeSets.begin(), edgeSets.end());
+  partition = partitionGraph(*vertices, constEdgeSets,
+                             transport->getNumRanks());
+
+  Distribution vertexDistribution;
+  vertexDistribution.global = vertices;
+  vertexDistribution.owners = partition;
+  distributions.push_back(vertexDistribution);
+
+  for (Set* edges : edgeSets) {
+    Distribution edgeDistribution;
+    edgeDistribution.global = edges;
+    edgeDistribution.owners.reserve(edges->getSize());
+    for (ElementRef edge : *edges) {
+      int first = edges->getEndpoint(edge, 0).getIdent();
+      edgeDistribution.owners.push_back(partition[first]);
+    }
+    distributions.push_back(edgeDistribution);
+  }
+}
+
+void DistributedSets::distribute(Set* localVertices,
+                                 const std::vector<Set*>& localEdgeSets) {
+  simit_uassert(localEdgeSets.size() == distributions.size()-1)
+      << "expected " << distributions.size()-1 << " local edge sets";
+  simit_uassert(localVertices->getSize() == 0)
+      << "local sets must be empty";
+  const int rank = transport->getRank();
+  const int numRanks = transport->getNumRanks();
+  Set* vertices = distributions[0].global;
+
+  // The owned vertices, then the vertices reached from the owned vertices'
+  // edges, found through the vertex-edge and edge-vertex path expressions
+  Distribution& vertexDistribution = distributions[0];
+  vertexDistribution.local = localVertices;
+  vertexDistribution.globals.clear();
+  for (int v = 0; v < vertices->getSize(); ++v) {
+    if (partition[v] == rank) {
+      vertexDistribution.globals.push_back(v);
+    }
+  }
+  vertexDistribution.numOwned = vertexDistribution.globals.size();
+
+  pe::PathIndexBuilder builder;
+  builder.bind("V", vertices);
+  pe::Var v("v", pe::Set("V"));
+  vector<int> haloVertices;
+  for (size_t i = 0; i < localEdgeSets.size(); ++i) {
+    Distribution& edgeDistribution = distributions[i+1];
+    Set* edges = edgeDistribution.global;
+    Set* localEdges = localEdgeSets[i];
+    simit_uassert(localEdges->getSize() == 0) << "local sets must be empty";
+    simit_uassert(localEdges->getCardinality() == edges->getCardinality())
+        << "local edge sets must have as many endpoints as the global ones";
+    for (int j = 0; j < localEdges->getCardinality(); ++j) {
+      simit_uassert(localEdges->getEndpointSet(j) == localVertices &&
+                    edges->getEndpointSet(j) == vertices)
+          << "the endpoints of edge sets must be the vertices";
+    }
+    edgeDistribution.local = localEdges;
+
+    string name = "E" + to_string(i);
+    builder.bind(name, edges);
+    pe::Var e("e", pe::Set(name));
+    pe::PathIndex ve = builder.buildSegmented(pe::Link::make(v,e,pe::Link::ve),
+                                              0);
+    pe::PathIndex ev = builder.buildSegmented(pe::Link::make(e,v,pe::Link::ev),
+                                              0);
+
+    vector<bool> isLocal(edges->getSize(), false);
+    for (int k = 0; k < vertexDistribution.numOwned; ++k) {
+      for (unsigned edge : ve.neighbors(vertexDistribution.globals[k])) {
+        isLocal[edge] = true;
+      }
+    }
+    edgeDistribution.globals.clear();
+    for (int pass = 0; pass < 2; ++pass) {
+      for (int edge = 0; edge < edges->getSize(); ++edge) {
+        bool owned = edgeDistribution.owners[edge] == rank;
+        if (isLocal[edge] && owned == (pass == 0)) {
+          edgeDistribution.globals.push_back(edge);
+        }
+      }
+      if (pass == 0) {
+        edgeDistribution.numOwned = edgeDistribution.globals.size();
+      }
+    }
+    for (int edge : edgeDistribution.globals) {
+      for (unsigned endpoint : ev.neighbors(edge)) {
+        if (partition[endpoint] != rank) {
+          haloVertices.push_back(endpoint);
+        }
+      }
+    }
+  }
+  std::sort(haloVertices.begin(), haloVertices.end());
+  haloVertices.erase(std::unique(haloVertices.begin(), haloVertices.end()),
+                     haloVertices.end());
+  vertexDistribution.globals.insert(vertexDistribution.globals.end(),
+                                    haloVertices.begin(), haloVertices.end());
+
+  // Add the local elements, with endpoints renumbered to the local vertices
+  vector<int> localVertex(vertices->getSize(), -1);
+  for (size_t i = 0; i < vertexDistribution.globals.size(); ++i) {
+    localVertex[vertexDistribution.globals[i]] = i;
+  }
+  localVertices->addElements(vertexDistribution.globals.size());
+  for (size_t i = 1; i < distributions.size(); ++i) {
+    Distribution& edgeDistribution = distributions[i];
+    Set* edges = edgeDistribution.global;
+    const int cardinality = edges->getCardinality();
+    vector<int> endpoints;
+    endpoints.reserve(edgeDistribution.globals.size() * cardinality);
+    for (int edge : edgeDistribution.globals) {
+      for (int j = 0; j < cardinality; ++j) {
+        ElementRef endpoint = edges->getEndpoint(ElementRef(edge), j);
+        endpoints.push_back(localVertex[endpoint.getIdent()]);
+      }
+    }
+    edgeDistribution.local->addElements(edgeDistribution.globals.size(),
+                                        endpoints.data());
+  }
+
+  // Copy the fields, and tell the owners of the halo elements to send them
+  for (Distribution& distribution : distributions) {
+    for (const Set::FieldData* field : distribution.global->getFields()) {
+      Set* local = distribution.local;
+      if (!local->hasField(field->name)) {
+        vector<int> dimensions;
+        for (size_t d = 0; d < field->type->getOrder(); ++d) {
+          dimensions.push_back(field->type->getDimension(d));
+        }
+        local->addField(field->name, field->type->getComponentType(),
+                        dimensions);
+      }
+      const Set::FieldData* localField =
+          local->getFields()[local->getFieldIndex(field->name)];
+      simit_uassert(localField->sizeOfType == field->sizeOfType)
+          << "field " << util::quote(field->name)
+          << " has a different type in the local set";
+      for (size_t i = 0; i < distribution.globals.size(); ++i) {
+        memcpy((char*)localField->data + i*field->sizeOfType,
+               (const char*)field->data +
+                   (size_t)distribution.globals[i]*field->sizeOfType,
+               field->sizeOfType);
+      }
+    }
+
+    vector<int> localElement(distribution.global->getSize(), -1);
+    for (int i = 0; i < distribution.numOwned; ++i) {
+      localElement[distribution.globals[i]] = i;
+    }
+    distribution.sends.assign(numRanks, vector<int>());
+    distribution.recvs.assign(numRanks, vector<int>());
+    vector<vector<int>> requests(numRanks);
+    for (size_t i = distribution.numOwned; i < distribution.globals.size();
+         ++i) {
+      int owner = distribution.owners[distribution.globals[i]];
+      distribution.recvs[owner].push_back(i);
+      requests[owner].push_back(distribution.globals[i]);
+    }
+    for (int r = 0; r < numRanks; ++r) {
+      if (r == rank) {
+        continue;
+      }
+      size_t numRequested = requests[r].size();
+      size_t numToSend;
+      transport->exchange(r, &numRequested, sizeof(size_t),
+                          &numToSend, sizeof(size_t));
+      vector<int> requested(numToSend);
+      transport->exchange(r, requests[r].data(), numRequested*sizeof(int),
+                          requested.data(), numToSend*sizeof(int));
+      for (int global : requested) {
+        simit_uassert(localElement[global] >= 0)
+            << "rank " << r << " requested an element that rank " << rank
+            << " does not own";
+        distribution.sends[r].push_back(localElement[global]);
+      }
+    }
+  }
+}
+
+const std::vector<int>& DistributedSets::getPartition() const {
+  return partition;
+}
+
+int DistributedSets::getNumOwned(const Set* localSet) const {
+  return getDistribution(localSet).numOwned;
+}
+
+ElementRef DistributedSets::getGlobal(const Set* localSet,
+                                      ElementRef localElement) const {
+  const Distribution& distribution = getDistribution(localSet);
+  simit_uassert(localElement.getIdent() >= 0 &&
+                localElement.getIdent() < (int)distribution.globals.size())
+      << "not an element of the local set";
+  return ElementRef(distribution.globals[localElement.getIdent()]);
+}
+
+void DistributedSets::update() {
+  vector<pair<const Distribution*,int>> fields;
+  for (const Distribution& distribution : distributions) {
+    for (size_t i = 0; i < distribution.local->getFields().size(); ++i) {
+      fields.push_back({&distribution, i});
+    }
+  }
+  exchange(fields);
+}
+
+void DistributedSets::update(const Set* localSet, const std::string& field) {
+  const Distribution& distribution = getDistribution(localSet);
+  simit_uassert(localSet->hasField(field))
+      << "no field " << util::quote(field) << " in set";
+  exchange({{&distribution, distribution.local->getFieldIndex(field)}});
+}
+
+void DistributedSets::gather(const Set* localSet, const std::string& field) {
+  const Distribution& distribution = getDistribution(localSet);
+  simit_uassert(localSet->hasField(field))
+      << "no field " << util::quote(field) << " in set";
+  Set* local = distribution.local;
+  const Set::FieldData* localField =
+      local->getFields()[local->getFieldIndex(field)];
+  const size_t bytes = localField->sizeOfType;
+
+  if (transport->getRank() != 0) {
+    transport->send(0, localField->data, distribution.numOwned*bytes);
+    return;
+  }
+
+  Set* global = distribution.global;
+  simit_uassert(global->hasField(field))
+      << "no field " << util::quote(field) << " in the global set";
+  const Set::FieldData* globalField =
+      global->getFields()[global->getFieldIndex(field)];
+  vector<vector<int>> owned(transport->getNumRanks());
+  for (size_t i = 0; i < distribution.owners.size(); ++i) {
+    owned[distribution.owners[i]].push_back(i);
+  }
+  vector<char> values;
+  for (int r = 0; r < transport->getNumRanks(); ++r) {
+    const char* data = (const char*)localField->data;
+    if (r != 0) {
+      values.resize(owned[r].size()*bytes);
+      transport->recv(r, values.data(), values.size());
+      data = values.data();
+    }
+    for (size_t i = 0; i < owned[r].size(); ++i) {
+      memcpy((char*)globalField->data + (size_t)owned[r][i]*bytes,
+             data + i*bytes, bytes);
+    }
+  }
+}
+
+void DistributedSets::run(Function& function) {
+  std::string hazard = function.getHaloHazard();
+  simit_uassert(hazard.empty())
+      << "distributed sets only update the halos before a function runs, so "
+      << "they can not run a function that " << hazard;
+  update();
+  function.runSafe();
+}
+
+const DistributedSets::Distribution&
+DistributedSets::getDistribution(const Set* localSet) const {
+  for (const Distribution& distribution : distributions) {
+    if (distribution.local == localSet) {
+      return distribution;
+    }
+  }
+  simit_uerror << "not a local set of the distributed sets";
+  return distributions[0];
+}
+
+void DistributedSets::exchange(
+    const std::vector<std::pair<const Distribution*,int>>& fields) {
+  const int rank = transport->getRank();
+  vector<char> sendBuffer;
+  vector<char> recvBuffer;
+
+  // One message per neighbor rank, in increasing rank order, with the fields
+  // packed one after the other
+  for (int r = 0; r < transport->getNumRanks(); ++r) {
+    if (r == rank) {
+      continue;
+    }
+    size_t sendBytes = 0;
+    size_t recvBytes = 0;
+    for (const pair<const Distribution*,int>& field : fields) {
+      size_t bytes = field.first->local->getFields()[field.second]->sizeOfType;
+      sendBytes += field.first->sends[r].size() * bytes;
+      recvBytes += field.first->recvs[r].size() * bytes;
+    }
+    if (sendBytes == 0 && recvBytes == 0) {
+      continue;
+    }
+
+    sendBuffer.resize(sendBytes);
+    char* next = sendBuffer.data();
+    for (const pair<const Distribution*,int>& field : fields) {
+      const Set::FieldData* data =
+          field.first->local->getFields()[field.second];
+      for (int element : field.first->sends[r]) {
+        memcpy(next, (const char*)data->data + (size_t)element*data->sizeOfType,
+               data->sizeOfType);
+        next += data->sizeOfType;
+      }
+    }
+
+    recvBuffer.resize(recvBytes);
+    transport->exchange(r, sendBuffer.data(), sendBytes,
+                        recvBuffer.data(), recvBytes);
+
+    const char* received = recvBuffer.data();
+    for (const pair<const Distribution*,int>& field : fields) {
+      const Set::FieldData* data =
+          field.first->local->getFields()[field.second];
+      for (int element : field.first->recvs[r]) {
+        memcpy((char*)data->data + (size_t)element*data->sizeOfType, received,
+               data->sizeOfType);
+        received += data->sizeOfType;
+      }
+    }
+  }
+}
+
+}
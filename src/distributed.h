@@ -0,0 +1,119 @@
+#ifndef SIMIT_DISTRIBUTED_H
+#define SIMIT_DISTRIBUTED_H
+
+#include <string>
+#include <vector>
+
+#include "graph.h"
+
+namespace simit {
+class Function;
+class Transport;
+
+/// Distributes a vertex set and edge sets over it across the ranks of a
+/// transport. The vertices are partitioned with partitionGraph, and every
+/// rank gets local sets with the elements it owns followed by its halo: the
+/// edges that reach an owned vertex, through each edge set's vertex-edge path
+/// expression, and the vertices those edges reach. An edge is owned by the
+/// owner of its first endpoint, so edges between parts are in the halo of
+/// one of their ranks.
+///
+/// Because every edge of an owned vertex is local, maps over the local edge
+/// sets compute complete reductions into the owned vertices, and matrices
+/// they assemble have complete rows for them. A function bound to the local
+/// sets therefore computes correct results for the owned elements as long as
+/// the fields it reads are up to date on the halo when it starts, which run
+/// ensures. Results on halo elements are partial, and are overwritten by the
+/// next update. Functions that read a field at neighbors after writing it,
+/// or that reduce over a whole set into a global, must be split so that the
+/// host updates the halo or sums the owned contributions (with
+/// Transport::allreduce) in between. run fails on functions that do either,
+/// such as a conjugate gradient solve.
+///
+/// The distribution is limited to what one halo update per run supports:
+/// halos and reduction contributions are not exchanged around the maps and
+/// matrix-vector products inside a function. Every rank also holds the
+/// global topology to partition it, so the mesh must fit in the memory of
+/// one node. Only the field data and the work are distributed.
+///
+/// \code
+/// DistributedSets distributed(&transport, &points, {&springs});
+/// Set localPoints;
+/// Set localSprings(localPoints, localPoints);
+/// distributed.distribute(&localPoints, {&localSprings});
+/// function.bind("points", &localPoints);
+/// function.bind("springs", &localSprings);
+/// for (int i = 0; i < steps; ++i) {
+///   distributed.run(function);
+/// }
+/// distributed.gather(&localPoints, "x");
+/// \endcode
+class DistributedSets {
+public:
+  /// Partition the global `vertices` across the ranks of `transport`. Every
+  /// rank must hold the global sets with the same topology, while fields only
+  /// need values where they are distributed from.
+  DistributedSets(Transport* transport, Set* vertices,
+                  const std::vector<Set*>& edgeSets);
+
+  /// Fill the empty `localVertices` and `localEdgeSets`, whose endpoints must
+  /// be `localVertices`, with this rank's owned and halo elements, and copy
+  /// their fields from the global sets. The local sets must have the same
+  /// fields on every rank.
+  void distribute(Set* localVertices, const std::vector<Set*>& localEdgeSets);
+
+  /// The rank that owns each global vertex.
+  const std::vector<int>& getPartition() const;
+
+  /// The number of elements of a local set owned by this rank. They come
+  /// before the halo elements, in the order of their global elements.
+  int getNumOwned(const Set* localSet) const;
+
+  /// The global element of a local element.
+  ElementRef getGlobal(const Set* localSet, ElementRef localElement) const;
+
+  /// Copy the fields of owned elements to the ranks that have them in their
+  /// halo. Every rank must update at the same time.
+  void update();
+
+  /// Update one field of a local set.
+  void update(const Set* localSet, const std::string& field);
+
+  /// Copy `field` of the elements owned by every rank into the global set on
+  /// rank 0.
+  void gather(const Set* localSet, const std::string& field);
+
+  /// Update the halos and run `function`, which must be bound to the local
+  /// sets, on every rank. Raises a user error if the function reads values it
+  /// computed at neighbors or reduces a set into a global (see
+  /// Function::getHaloHazard), since the halos are not updated during a run.
+  void run(Function& function);
+
+private:
+  /// A global set, the local set it is distributed to, and the elements each
+  /// rank sends to and receives from this rank on update.
+  struct Distribution {
+    Set* global;
+    Set* local;
+    std::vector<int> owners;                  // owner of each global element
+    std::vector<int> globals;                 // global of each local element
+    int numOwned;
+    std::vector<std::vector<int>> sends;      // owned local elements per rank
+    std::vector<std::vector<int>> recvs;      // halo local elements per rank
+  };
+
+  Transport* transport;
+  std::vector<int> partition;
+  std::vector<Distribution> distributions;   // the vertices, then the edges
+
+  const Distribution& getDistribution(const Set* localSet) const;
+
+  /// Exchange the given fields (indices into the local sets' fields).
+  void exchange(const std::vector<std::pair<const Distribution*,int>>& fields);
+
+  DistributedSets(const DistributedSets&) = delete;
+  DistributedSets& operator=(const DistributedSets&) = delete;
+};
+
+}
+#endif
@@ -0,0 +1,321 @@
+#include "field_output.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "binary_mesh.h"
+#include "error.h"
+#include "graph.h"
+
+using namespace std;
+
+namespace simit {
+
+static const Set::FieldData* getFieldData(Set* set, const string& field) {
+  simit_uassert(set->hasField(field))
+      << "no field " << util::quote(field) << " in set";
+  return set->getFields()[set->getFieldIndex(field)];
+}
+
+/// The VTK cell type of elements with `cellSize` endpoints.
+static int vtkCellType(int cellSize) {
+  switch (cellSize) {
+    case 1: return 1;   // VTK_VERTEX
+    case 2: return 3;   // VTK_LINE
+    case 3: return 5;   // VTK_TRIANGLE
+    case 4: return 10;  // VTK_TETRA
+  }
+  return 0;
+}
+
+static const char* vtkTypeName(ComponentType componentType) {
+  switch (componentType) {
+    case ComponentType::Float:   return "float";
+    case ComponentType::Double:  return "double";
+    case ComponentType::Int:     return "int";
+    case ComponentType::Boolean: return "unsigned_char";
+    default:                     return nullptr;
+  }
+}
+
+/// Write `count` values of `valueBytes` bytes each, converted to big-endian
+/// as legacy VTK binary files require.
+static void writeBigEndian(ostream& out, const void* data, size_t count,
+                           size_t valueBytes) {
+  const size_t blockValues = 4096;
+  vector<char> block(blockValues * valueBytes);
+  const char* values = (const char*)data;
+  for (size_t first = 0; first < count; first += blockValues) {
+    size_t n = std::min(blockValues, count - first);
+    const char* src = values + first*valueBytes;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t b = 0; b < valueBytes; ++b) {
+        block[i*valueBytes + b] = src[i*valueBytes + valueBytes-1-b];
+      }
+    }
+    out.write(block.data(), n*valueBytes);
+  }
+}
+
+// class FieldOutput
+FieldOutput::FieldOutput(const std::string& prefix, OutputFormat format,
+                         unsigned numSlots)
+    : prefix(prefix), format(format), points(nullptr), cells(nullptr),
+      numDropped(0), slots(std::max(numSlots, 1u)),
+      slotQueued(slots.size(), false), failed(false), stopping(false) {
+}
+
+FieldOutput::~FieldOutput() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (writer.joinable()) {
+    writer.join();
+  }
+}
+
+void FieldOutput::setMesh(Set* points, const std::string& positionField,
+                          Set* cells) {
+  const Set::FieldData* position = getFieldData(points, positionField);
+  simit_uassert(position->type->getSize() == 3 &&
+                (position->type->getComponentType() == ComponentType::Float ||
+                 position->type->getComponentType() == ComponentType::Double))
+      << "positions must have three float components";
+  if (cells != nullptr) {
+    simit_uassert(vtkCellType(cells->getCardinality()) != 0)
+        << "cells must be lines, triangles or tetrahedra";
+    for (int i = 0; i < cells->getCardinality(); ++i) {
+      simit_uassert(cells->getEndpointSet(i) == points)
+          << "cells must be edges of the points";
+    }
+  }
+  this->points = points;
+  this->positionField = positionField;
+  this->cells = cells;
+}
+
+void FieldOutput::addField(Set* set, const std::string& field,
+                           const std::string& name) {
+  const Set::FieldData* fieldData = getFieldData(set, field);
+  Output output;
+  output.set = set;
+  output.field = field;
+  output.name = name.empty() ? field : name;
+  output.componentType = fieldData->type->getComponentType();
+  output.componentsPerElement = fieldData->type->getSize();
+
+  if (format == OutputFormat::VTK) {
+    simit_uassert(set == points || (set == cells && cells != nullptr))
+        << "VTK fields must be on the mesh's points or cells";
+    simit_uassert(vtkTypeName(output.componentType) != nullptr)
+        << "VTK fields must be float, int or boolean";
+    simit_uassert(output.componentsPerElement <= 4 ||
+                  output.componentsPerElement == 9)
+        << "VTK fields must be scalars, vectors or 3x3 tensors";
+    simit_uassert(output.name.find(' ') == string::npos)
+        << "VTK field names cannot contain spaces";
+  }
+  outputs.push_back(output);
+}
+
+bool FieldOutput::write(int step) {
+  simit_uassert(format != OutputFormat::VTK || points != nullptr)
+      << "VTK output requires a mesh";
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!writer.joinable()) {
+    writer = std::thread(&FieldOutput::writeLoop, this);
+  }
+  auto free = std::find(slotQueued.begin(), slotQueued.end(), false);
+  if (free == slotQueued.end()) {
+    ++numDropped;
+    return false;
+  }
+  size_t slotIndex = free - slotQueued.begin();
+  lock.unlock();
+
+  // Queued slots are only read by the writer, so the free slot is ours
+  Slot& slot = slots[slotIndex];
+  slot.step = step;
+  slot.numPoints = 0;
+  slot.numCells = 0;
+  slot.cellSize = 0;
+  if (points != nullptr) {
+    const Set::FieldData* position = getFieldData(points, positionField);
+    slot.numPoints = points->getSize();
+    slot.doublePoints =
+        position->type->getComponentType() == ComponentType::Double;
+    const char* data = (const char*)position->data;
+    slot.points.assign(data, data + slot.numPoints*position->sizeOfType);
+  }
+  if (cells != nullptr) {
+    slot.numCells = cells->getSize();
+    slot.cellSize = cells->getCardinality();
+    const int* endpoints = cells->getEndpointsData();
+    slot.cells.assign(endpoints, endpoints + slot.numCells*slot.cellSize);
+  }
+  slot.fields.resize(outputs.size());
+  slot.fieldElements.resize(outputs.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const Set::FieldData* field = getFieldData(outputs[i].set,
+                                               outputs[i].field);
+    const char* data = (const char*)field->data;
+    slot.fieldElements[i] = outputs[i].set->getSize();
+    slot.fields[i].assign(data,
+                          data + slot.fieldElements[i]*field->sizeOfType);
+  }
+
+  lock.lock();
+  slotQueued[slotIndex] = true;
+  queue.push_back(slotIndex);
+  lock.unlock();
+  changed.notify_all();
+  return true;
+}
+
+int FieldOutput::flush() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this]() {
+    return std::find(slotQueued.begin(), slotQueued.end(), true) ==
+           slotQueued.end();
+  });
+  int status = failed ? -1 : 0;
+  failed = false;
+  return status;
+}
+
+void FieldOutput::writeLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    changed.wait(lock, [this]() {return stopping || !queue.empty();});
+    if (queue.empty()) {
+      return;
+    }
+    size_t slotIndex = queue.front();
+    queue.pop_front();
+    lock.unlock();
+
+    int status = writeSlot(slots[slotIndex]);
+
+    lock.lock();
+    if (status != 0) {
+      failed = true;
+    }
+    slotQueued[slotIndex] = false;
+    changed.notify_all();
+  }
+}
+
+int FieldOutput::writeSlot(const Slot& slot) const {
+  string filename = prefix + std::to_string(slot.step);
+  switch (format) {
+    case OutputFormat::Binary:
+      return writeBinary(slot, filename + ".smsh");
+    case OutputFormat::VTK:
+      return writeVTK(slot, filename + ".vtk");
+  }
+  return -1;
+}
+
+int FieldOutput::writeBinary(const Slot& slot,
+                             const std::string& filename) const {
+  BinaryMeshWriter writer;
+  if (!slot.points.empty() &&
+      writer.addTensor(positionField, slot.points.data(),
+                       slot.points.size()) != 0) {
+    return -1;
+  }
+  if (!slot.cells.empty() &&
+      writer.addTensor("cells", slot.cells.data(),
+                       slot.cells.size()*sizeof(int)) != 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (writer.addTensor(outputs[i].name, slot.fields[i].data(),
+                         slot.fields[i].size()) != 0) {
+      return -1;
+    }
+  }
+  return writer.save(filename);
+}
+
+int FieldOutput::writeVTK(const Slot& slot,
+                          const std::string& filename) const {
+  ofstream out(filename, ios::binary);
+  if (!out.good()) {
+    std::cerr << "Cannot write to " << filename << std::endl;
+    return -1;
+  }
+
+  out << "# vtk DataFile Version 3.0\n"
+      << "simit step " << slot.step << "\n"
+      << "BINARY\n"
+      << "DATASET UNSTRUCTURED_GRID\n";
+  size_t pointBytes = slot.doublePoints ? sizeof(double) : sizeof(float);
+  out << "POINTS " << slot.numPoints << " "
+      << (slot.doublePoints ? "double" : "float") << "\n";
+  writeBigEndian(out, slot.points.data(), 3*slot.numPoints, pointBytes);
+  out << "\n";
+
+  // Cells are the mesh's cells, or else one vertex cell per point
+  size_t numCells = (cells != nullptr) ? slot.numCells : slot.numPoints;
+  int cellSize = (cells != nullptr) ? slot.cellSize : 1;
+  vector<int> cellData;
+  cellData.reserve(numCells * (cellSize+1));
+  for (size_t c = 0; c < numCells; ++c) {
+    cellData.push_back(cellSize);
+    for (int i = 0; i < cellSize; ++i) {
+      cellData.push_back((cells != nullptr) ? slot.cells[c*cellSize + i] : c);
+    }
+  }
+  out << "CELLS " << numCells << " " << cellData.size() << "\n";
+  writeBigEndian(out, cellData.data(), cellData.size(), sizeof(int));
+  out << "\n";
+  vector<int> cellTypes(numCells, vtkCellType(cellSize));
+  out << "CELL_TYPES " << numCells << "\n";
+  writeBigEndian(out, cellTypes.data(), cellTypes.size(), sizeof(int));
+  out << "\n";
+
+  for (int pass = 0; pass < 2; ++pass) {
+    const Set* set = (pass == 0) ? points : cells;
+    bool first = true;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      const Output& output = outputs[i];
+      if (output.set != set) {
+        continue;
+      }
+      if (first) {
+        out << ((pass == 0) ? "POINT_DATA " : "CELL_DATA ")
+            << slot.fieldElements[i] << "\n";
+        first = false;
+      }
+      const char* type = vtkTypeName(output.componentType);
+      if (output.componentsPerElement == 3) {
+        out << "VECTORS " << output.name << " " << type << "\n";
+      }
+      else if (output.componentsPerElement == 9) {
+        out << "TENSORS " << output.name << " " << type << "\n";
+      }
+      else {
+        out << "SCALARS " << output.name << " " << type << " "
+            << output.componentsPerElement << "\n"
+            << "LOOKUP_TABLE default\n";
+      }
+      size_t componentBytes = componentSize(output.componentType);
+      writeBigEndian(out, slot.fields[i].data(),
+                     slot.fields[i].size() / componentBytes, componentBytes);
+      out << "\n";
+    }
+  }
+
+  if (!out.good()) {
+    std::cerr << "Failed writing " << filename << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+}
@@ -0,0 +1,126 @@
+#ifndef SIMIT_FIELD_OUTPUT_H
+#define SIMIT_FIELD_OUTPUT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensor_type.h"
+
+namespace simit {
+class Set;
+
+/// File formats of FieldOutput.
+enum class OutputFormat {
+  /// Binary mesh files (see binary_mesh.h) with one tensor per field, named
+  /// `name`, and the mesh's cell endpoints as the tensor "cells".
+  Binary,
+
+  /// Legacy VTK unstructured grid files in binary form, with the points and
+  /// cells of the mesh and the fields as point and cell data.
+  VTK
+};
+
+/// Writes selected fields to one file per time step. A write copies the
+/// fields into a free slot of a ring buffer and returns, and a background
+/// thread writes the queued slots to files, so the simulation thread does
+/// not wait for I/O. If every slot is still queued the write is dropped
+/// instead (see getNumDropped), so the ring should be large enough to absorb
+/// bursts.
+///
+/// \code
+/// FieldOutput output("out/springs-", OutputFormat::VTK);
+/// output.setMesh(&points, "x", &springs);
+/// output.addField(&points, "v");
+/// for (int i = 0; i < steps; ++i) {
+///   timestep.run();
+///   output.write(i);
+/// }
+/// output.flush();
+/// \endcode
+class FieldOutput {
+public:
+  /// Files are named `prefix` followed by the step number and the format's
+  /// extension (.smsh or .vtk).
+  FieldOutput(const std::string& prefix, OutputFormat format,
+              unsigned numSlots=4);
+
+  /// Flushes the queued writes.
+  ~FieldOutput();
+
+  /// Set the mesh the fields are defined on: `points` with a 3-component
+  /// position field, and optionally an edge set of `points` whose edges are
+  /// the cells (lines, triangles or tetrahedra). Required for VTK output.
+  void setMesh(Set* points, const std::string& positionField,
+               Set* cells=nullptr);
+
+  /// Output the field of `set` called `field` under `name` (defaults to the
+  /// field's name). For VTK output the set must be the mesh's points or cells.
+  /// Fields and the mesh must be set before the first write.
+  void addField(Set* set, const std::string& field,
+                const std::string& name="");
+
+  /// Copy the fields into a free slot and queue it to be written as `step`.
+  /// Returns false if no slot was free and the step was dropped.
+  bool write(int step);
+
+  /// Wait for the queued writes.
+  ///return -1 if a write failed since the last flush
+  int flush();
+
+  /// The number of steps dropped because no slot was free.
+  size_t getNumDropped() const {return numDropped;}
+
+private:
+  struct Output {
+    Set* set;
+    std::string field;
+    std::string name;
+    ComponentType componentType;
+    size_t componentsPerElement;
+  };
+
+  /// A copy of the fields, and of the mesh topology, for one step.
+  struct Slot {
+    int step;
+    size_t numPoints;
+    size_t numCells;
+    int cellSize;
+    std::vector<char> points;
+    bool doublePoints;
+    std::vector<int> cells;
+    std::vector<std::vector<char>> fields;
+    std::vector<size_t> fieldElements;
+  };
+
+  std::string prefix;
+  OutputFormat format;
+  Set* points;
+  std::string positionField;
+  Set* cells;
+  std::vector<Output> outputs;
+  size_t numDropped;
+
+  std::vector<Slot> slots;
+  std::vector<bool> slotQueued;
+  std::deque<size_t> queue;
+  bool failed;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::thread writer;
+
+  void writeLoop();
+  int writeSlot(const Slot& slot) const;
+  int writeBinary(const Slot& slot, const std::string& filename) const;
+  int writeVTK(const Slot& slot, const std::string& filename) const;
+
+  FieldOutput(const FieldOutput&) = delete;
+  FieldOutput& operator=(const FieldOutput&) = delete;
+};
+
+}
+#endif
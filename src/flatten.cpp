@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 
 #include "ir.h"
 #include "intrinsics.h"
@@ -23,7 +24,7 @@ bool overlaps(const std::vector<IndexVar> &as, const std::vector<IndexVar> &bs);
 
 /// Static namegen (hacky: fix later)
 std::string tmpNameGen() {
-  static int i = 0;
+  static std::atomic<int> i(0);
   return INTERNAL_PREFIX("spilledTmp") + std::to_string(i++);
 }
 
@@ -266,7 +267,59 @@ private:
     }
   }
 
+  /// Flattens a matrix-vector product with a transposed system matrix,
+  /// (i (j,k A(k,j))(i,+l) * x(+l)), to (i A(+l,i) * x(+l)). Spilling the
+  /// transpose would assemble a transposed copy of A, whereas the flattened
+  /// product is lowered to a scatter over A's own index. Returns an undefined
+  /// Expr if op is not of this form.
+  Expr flattenTransposedGemv(const IndexExpr *op) {
+    if (op->resultVars.size() != 1 || !isa<Mul>(op->value)) {
+      return Expr();
+    }
+    Expr a = to<Mul>(op->value)->a;
+    Expr b = to<Mul>(op->value)->b;
+    bool transposedFirst = isa<IndexedTensor>(a) &&
+                           isa<IndexExpr>(to<IndexedTensor>(a)->tensor);
+    Expr matrix = transposedFirst ? a : b;
+    Expr vector = transposedFirst ? b : a;
+    if (!isa<IndexedTensor>(matrix) || !isa<IndexedTensor>(vector) ||
+        !isa<IndexExpr>(to<IndexedTensor>(matrix)->tensor) ||
+        to<IndexedTensor>(vector)->indexVars.size() != 1) {
+      return Expr();
+    }
+
+    const IndexedTensor *operand = to<IndexedTensor>(matrix);
+    const IndexExpr *transpose = to<IndexExpr>(operand->tensor);
+    if (transpose->resultVars.size() != 2 || operand->indexVars.size() != 2 ||
+        !isa<IndexedTensor>(transpose->value)) {
+      return Expr();
+    }
+    const IndexedTensor *source = to<IndexedTensor>(transpose->value);
+    if (!isa<VarExpr>(source->tensor) ||
+        !source->tensor.type().toTensor()->isSparse() ||
+        source->indexVars.size() != 2 ||
+        source->indexVars[0] != transpose->resultVars[1] ||
+        source->indexVars[1] != transpose->resultVars[0]) {
+      return Expr();
+    }
+
+    map<IndexVar,IndexVar> substitutions;
+    for (size_t i=0; i < transpose->resultVars.size(); ++i) {
+      substitutions.insert({transpose->resultVars[i], operand->indexVars[i]});
+    }
+    matrix = substitute(substitutions, transpose->value);
+    vector = rewrite(vector);
+    return IndexExpr::make(op->resultVars, transposedFirst
+                                           ? Mul::make(matrix, vector)
+                                           : Mul::make(vector, matrix));
+  }
+
   void visit(const IndexExpr *op) {
+    Expr transposedGemv = flattenTransposedGemv(op);
+    if (transposedGemv.defined()) {
+      expr = transposedGemv;
+      return;
+    }
     IRRewriter::visit(op);
 
     // If expression corresponds to transpose of a system tensor element-wise 
@@ -258,6 +258,7 @@ void ScalarType::copy(FIRNode::Ptr node) {
   const auto scalarType = to<ScalarType>(node);
   TensorType::copy(scalarType);
   type = scalarType->type;
+  floatBytes = scalarType->floatBytes;
 }
 
 FIRNode::Ptr ScalarType::cloneNode() {
@@ -578,6 +579,12 @@ void ReducedMapExpr::copy(FIRNode::Ptr node) {
   const auto reducedMapExpr = to<ReducedMapExpr>(node);
   MapExpr::copy(reducedMapExpr);
   op = reducedMapExpr->op;
+  if (reducedMapExpr->reducer) {
+    reducer = reducedMapExpr->reducer->clone<Identifier>();
+  }
+  if (reducedMapExpr->identity) {
+    identity = reducedMapExpr->identity->clone<Expr>();
+  }
 }
 
 FIRNode::Ptr ReducedMapExpr::cloneNode() {
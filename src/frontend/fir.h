@@ -378,6 +378,10 @@ struct ScalarType : public TensorType {
   enum class Type {INT, FLOAT, BOOL, COMPLEX, STRING};
 
   Type type;
+
+  /// Storage width of float32/float64 element fields, which are computed on
+  /// at the program's float precision. 0 for float.
+  unsigned floatBytes = 0;
   
   typedef std::shared_ptr<ScalarType> Ptr;
  
@@ -812,7 +816,7 @@ protected:
 };
 
 struct MapExpr : public Expr {
-  enum class ReductionOp {NONE, SUM};
+  enum class ReductionOp {NONE, SUM, PRODUCT, MAX, MIN, USER};
   
   Identifier::Ptr            func;
   std::vector<IndexSet::Ptr> genericArgs;
@@ -833,7 +837,9 @@ protected:
 };
 
 struct ReducedMapExpr : public MapExpr {
-  ReductionOp op;
+  ReductionOp     op;
+  Identifier::Ptr reducer;   // Reducer function of user-defined reductions.
+  Expr::Ptr       identity;  // Literal identity of user-defined reductions.
 
   typedef std::shared_ptr<ReducedMapExpr> Ptr;
 
@@ -122,7 +122,17 @@ void FIRPrinter::visit(ScalarType::Ptr type) {
       oss << "int";
       break;
     case ScalarType::Type::FLOAT:
-      oss << "float";
+      switch (type->floatBytes) {
+        case 4:
+          oss << "float32";
+          break;
+        case 8:
+          oss << "float64";
+          break;
+        default:
+          oss << "float";
+          break;
+      }
       break;
     case ScalarType::Type::BOOL:
       oss << "bool";
@@ -802,6 +812,21 @@ void FIRPrinter::printMapOrApply(MapExpr::Ptr expr, const bool isApply) {
       case MapExpr::ReductionOp::SUM:
         oss << "+";
         break;
+      case MapExpr::ReductionOp::PRODUCT:
+        oss << "*";
+        break;
+      case MapExpr::ReductionOp::MAX:
+        oss << "max";
+        break;
+      case MapExpr::ReductionOp::MIN:
+        oss << "min";
+        break;
+      case MapExpr::ReductionOp::USER:
+        to<ReducedMapExpr>(expr)->reducer->accept(this);
+        oss << "(";
+        to<ReducedMapExpr>(expr)->identity->accept(this);
+        oss << ")";
+        break;
       default:
         simit_unreachable;
         break;
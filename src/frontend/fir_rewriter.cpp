@@ -195,6 +195,17 @@ void FIRRewriter::visit(MapExpr::Ptr expr) {
   node = expr;
 }
 
+void FIRRewriter::visit(ReducedMapExpr::Ptr expr) {
+  visit(to<MapExpr>(expr));
+  if (expr->reducer) {
+    expr->reducer = rewrite<Identifier>(expr->reducer);
+  }
+  if (expr->identity) {
+    expr->identity = rewrite<Expr>(expr->identity);
+  }
+  node = expr;
+}
+
 void FIRRewriter::visit(OrExpr::Ptr expr) {
   visitBinaryExpr(expr);
 }
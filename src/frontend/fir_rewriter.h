@@ -46,6 +46,7 @@ struct FIRRewriter : public FIRVisitor {
   virtual void visit(Slice::Ptr op) { node = op; }
   virtual void visit(ExprParam::Ptr);
   virtual void visit(MapExpr::Ptr);
+  virtual void visit(ReducedMapExpr::Ptr);
   virtual void visit(OrExpr::Ptr);
   virtual void visit(AndExpr::Ptr);
   virtual void visit(XorExpr::Ptr);
@@ -150,10 +150,21 @@ void IREmitter::visit(OpaqueType::Ptr lit) {
   retType = ir::Type(ir::Type::Opaque);
 }
 
+/// Returns the storage width declared with float32/float64, or 0.
+static unsigned getFloatBytes(Type::Ptr type) {
+  if (isa<ScalarType>(type)) {
+    return to<ScalarType>(type)->floatBytes;
+  }
+  else if (isa<NDTensorType>(type)) {
+    return getFloatBytes(to<NDTensorType>(type)->blockType);
+  }
+  return 0;
+}
+
 void IREmitter::visit(IdentDecl::Ptr decl) {
   const ir::Type type = emitType(decl->type);
   retVar = ir::Var(decl->name->ident, type);
-  retField = ir::Field(decl->name->ident, type);
+  retField = ir::Field(decl->name->ident, type, getFloatBytes(decl->type));
 }
 
 void IREmitter::visit(ElementTypeDecl::Ptr decl) {
@@ -221,6 +232,9 @@ void IREmitter::visit(FuncDecl::Ptr decl) {
 
   simit_iassert(!ctx->containsFunction(funcName));
   ctx->addFunction(func);
+  if (decl->type == FuncDecl::Type::EXPORTED) {
+    ctx->exportFunction(funcName);
+  }
 }
 
 void IREmitter::visit(VarDecl::Ptr decl) {
@@ -435,6 +449,33 @@ void IREmitter::visit(MapExpr::Ptr expr) {
     case MapExpr::ReductionOp::SUM:
       reduction = ir::ReductionOperator::Sum;
       break;
+    case MapExpr::ReductionOp::PRODUCT:
+      reduction = ir::ReductionOperator::Product;
+      break;
+    case MapExpr::ReductionOp::MAX:
+      reduction = ir::ReductionOperator::Max;
+      break;
+    case MapExpr::ReductionOp::MIN:
+      reduction = ir::ReductionOperator::Min;
+      break;
+    case MapExpr::ReductionOp::USER: {
+      const auto reducedMapExpr = to<ReducedMapExpr>(expr);
+      const auto identity = reducedMapExpr->identity;
+      double_complex identityVal;
+      if (isa<IntLiteral>(identity)) {
+        identityVal.real = to<IntLiteral>(identity)->val;
+      } else if (isa<FloatLiteral>(identity)) {
+        identityVal.real = to<FloatLiteral>(identity)->val;
+      } else if (isa<BoolLiteral>(identity)) {
+        identityVal.real = to<BoolLiteral>(identity)->val ? 1.0 : 0.0;
+      } else {
+        identityVal = to<ComplexLiteral>(identity)->val;
+      }
+      const ir::Func reducer =
+          ctx->getFunction(reducedMapExpr->reducer->ident);
+      reduction = ir::ReductionOperator(reducer, identityVal);
+      break;
+    }
     default:
       not_supported_yet;
       break;
@@ -786,7 +786,9 @@ fir::Expr::Ptr Parser::parseExpr() {
 }
 
 // map_expr: 'map' ident ['<' endpoints '>'] ['(' [expr_params] ')'] 
-//           'to' set_index_set ['through' set_index_set] ['reduce' '+']
+//           'to' set_index_set ['through' set_index_set] 
+//           ['reduce' ('+' | '*' | 'min' | 'max' |
+//                      ident '(' reducer_identity ')')]
 fir::MapExpr::Ptr Parser::parseMapExpr() {
   const Token mapToken = consume(Token::Type::MAP);
   const fir::Identifier::Ptr func = parseIdent();
@@ -822,10 +824,35 @@ fir::MapExpr::Ptr Parser::parseMapExpr() {
     mapExpr->partialActuals = partialActuals;
     mapExpr->target = target;
     mapExpr->through = through;
-    mapExpr->op = fir::MapExpr::ReductionOp::SUM;
 
-    const Token plusToken = consume(Token::Type::PLUS);
-    mapExpr->setEndLoc(plusToken);
+    // Reductions other than '+' and '*' are named: min, max, or the name of a
+    // user-defined reducer function followed by its identity.
+    if (peek().type == Token::Type::IDENT) {
+      const Token reducerToken = peek();
+      const fir::Identifier::Ptr reducer = parseIdent();
+      if (reducer->ident == "max") {
+        mapExpr->op = fir::MapExpr::ReductionOp::MAX;
+        mapExpr->setEndLoc(reducerToken);
+      } else if (reducer->ident == "min") {
+        mapExpr->op = fir::MapExpr::ReductionOp::MIN;
+        mapExpr->setEndLoc(reducerToken);
+      } else {
+        mapExpr->op = fir::MapExpr::ReductionOp::USER;
+        mapExpr->reducer = reducer;
+        consume(Token::Type::LP);
+        mapExpr->identity = parseReducerIdentity();
+        const Token rightParenToken = consume(Token::Type::RP);
+        mapExpr->setEndLoc(rightParenToken);
+      }
+    } else if (peek().type == Token::Type::STAR) {
+      const Token starToken = consume(Token::Type::STAR);
+      mapExpr->op = fir::MapExpr::ReductionOp::PRODUCT;
+      mapExpr->setEndLoc(starToken);
+    } else {
+      const Token plusToken = consume(Token::Type::PLUS);
+      mapExpr->op = fir::MapExpr::ReductionOp::SUM;
+      mapExpr->setEndLoc(plusToken);
+    }
 
     return mapExpr;
   }
@@ -1354,6 +1381,8 @@ fir::Type::Ptr Parser::parseType() {
       break;
     case Token::Type::INT:
     case Token::Type::FLOAT:
+    case Token::Type::FLOAT32:
+    case Token::Type::FLOAT64:
     case Token::Type::BOOL:
     case Token::Type::COMPLEX:
     case Token::Type::STRING:
@@ -1539,6 +1568,8 @@ fir::TensorType::Ptr Parser::parseTensorType() {
   switch (peek().type) {
     case Token::Type::INT:
     case Token::Type::FLOAT:
+    case Token::Type::FLOAT32:
+    case Token::Type::FLOAT64:
     case Token::Type::BOOL:
     case Token::Type::COMPLEX:
     case Token::Type::STRING:
@@ -1649,7 +1680,8 @@ fir::NDTensorType::Ptr Parser::parseTensorBlockType() {
   return tensorType;
 }
 
-// tensor_component_type: 'int' | 'float' | 'bool' | 'complex'
+// tensor_component_type: 'int' | 'float' | 'float32' | 'float64' | 'bool'
+//                      | 'complex'
 fir::ScalarType::Ptr Parser::parseTensorComponentType() {
   auto scalarType = std::make_shared<fir::ScalarType>();
 
@@ -1665,6 +1697,16 @@ fir::ScalarType::Ptr Parser::parseTensorComponentType() {
       consume(Token::Type::FLOAT);
       scalarType->type = fir::ScalarType::Type::FLOAT;
       break;
+    case Token::Type::FLOAT32:
+      consume(Token::Type::FLOAT32);
+      scalarType->type = fir::ScalarType::Type::FLOAT;
+      scalarType->floatBytes = 4;
+      break;
+    case Token::Type::FLOAT64:
+      consume(Token::Type::FLOAT64);
+      scalarType->type = fir::ScalarType::Type::FLOAT;
+      scalarType->floatBytes = 8;
+      break;
     case Token::Type::BOOL:
       consume(Token::Type::BOOL);
       scalarType->type = fir::ScalarType::Type::BOOL;
@@ -1778,6 +1820,34 @@ fir::SetIndexSet::Ptr Parser::parseSetIndexSet() {
   return setIndexSet;
 }
 
+// reducer_identity: signed_int_literal | signed_float_literal | tensor_literal
+fir::Expr::Ptr Parser::parseReducerIdentity() {
+  const Token beginToken = peek();
+  const unsigned sign = (peek().type == Token::Type::PLUS ||
+                         peek().type == Token::Type::MINUS) ? 1 : 0;
+  switch (peek(sign).type) {
+    case Token::Type::INT_LITERAL:
+    {
+      auto intLiteral = std::make_shared<fir::IntLiteral>();
+      intLiteral->setBeginLoc(beginToken);
+      intLiteral->setEndLoc(peek(sign));
+      intLiteral->val = parseSignedIntLiteral();
+      return intLiteral;
+    }
+    case Token::Type::FLOAT_LITERAL:
+    {
+      auto floatLiteral = std::make_shared<fir::FloatLiteral>();
+      floatLiteral->setBeginLoc(beginToken);
+      floatLiteral->setEndLoc(peek(sign));
+      floatLiteral->val = parseSignedFloatLiteral();
+      return floatLiteral;
+    }
+    default:
+      break;
+  }
+  return parseTensorLiteral();
+}
+
 // tensor_literal: INT_LITERAL | FLOAT_LITERAL | 'true' | 'false'
 //               | STRING_LITERAL | complex_literal | dense_tensor_literal
 fir::Expr::Ptr Parser::parseTensorLiteral() {
@@ -104,6 +104,7 @@ private:
   std::vector<fir::IndexSet::Ptr>     parseIndexSets();
   fir::IndexSet::Ptr                  parseIndexSet();
   fir::SetIndexSet::Ptr               parseSetIndexSet();
+  fir::Expr::Ptr                      parseReducerIdentity();
   fir::Expr::Ptr                      parseTensorLiteral();
   fir::DenseTensorLiteral::Ptr        parseDenseTensorLiteral();
   fir::DenseTensorLiteral::Ptr        parseDenseTensorLiteralInner();
@@ -525,6 +525,11 @@ void TypeChecker::visit(MapExpr::Ptr expr) {
   typeCheckMapOrApply(expr);
 }
 
+void TypeChecker::visit(ReducedMapExpr::Ptr expr) {
+  typeCheckMapOrApply(expr);
+  typeCheckReduction(expr, retType);
+}
+
 void TypeChecker::visit(OrExpr::Ptr expr) {
   typeCheckBinaryBoolean(expr);
 }
@@ -2084,6 +2089,117 @@ void TypeChecker::typeCheckMapOrApply(MapExpr::Ptr expr, const bool isApply) {
   }
 }
 
+void TypeChecker::typeCheckReduction(ReducedMapExpr::Ptr expr,
+                                     ExprType resultType) {
+  if (expr->op == MapExpr::ReductionOp::SUM || !resultType.defined) {
+    return;
+  }
+
+  std::string opString;
+  switch (expr->op) {
+    case MapExpr::ReductionOp::PRODUCT:
+      opString = "*";
+      break;
+    case MapExpr::ReductionOp::MAX:
+      opString = "max";
+      break;
+    case MapExpr::ReductionOp::MIN:
+      opString = "min";
+      break;
+    case MapExpr::ReductionOp::USER:
+      opString = expr->reducer->ident;
+      break;
+    default:
+      simit_unreachable;
+      break;
+  }
+
+  // Check that user-defined reducer has been declared.
+  FuncDecl::Ptr reducer;
+  if (expr->op == MapExpr::ReductionOp::USER) {
+    if (!env.hasFunction(expr->reducer->ident)) {
+      reportUndeclared("function", expr->reducer->ident, expr->reducer);
+      return;
+    }
+    reducer = env.getFunction(expr->reducer->ident);
+  }
+
+  for (const auto& type : resultType.type) {
+    // Non-sum reductions combine the results component by component, so 
+    // (blocked) tensors must have scalar blocks.
+    Type::Ptr blockType = type;
+    if (isa<NDTensorType>(blockType)) {
+      blockType = to<NDTensorType>(blockType)->blockType;
+    }
+    if (!isa<ScalarType>(blockType)) {
+      std::stringstream errMsg;
+      errMsg << "map operation can only reduce results with scalar components "
+             << "with " << opString << " but got a result of type " 
+             << toString(type);
+      reportError(errMsg.str(), expr);
+      continue;
+    }
+    const auto componentType = to<ScalarType>(blockType);
+
+    switch (expr->op) {
+      case MapExpr::ReductionOp::PRODUCT:
+        if (componentType->type != ScalarType::Type::INT &&
+            componentType->type != ScalarType::Type::FLOAT &&
+            componentType->type != ScalarType::Type::COMPLEX) {
+          std::stringstream errMsg;
+          errMsg << "map operation can only reduce numeric results with * "
+                 << "but got a result of type " << toString(type);
+          reportError(errMsg.str(), expr);
+        }
+        break;
+      case MapExpr::ReductionOp::MAX:
+      case MapExpr::ReductionOp::MIN:
+        if (componentType->type != ScalarType::Type::INT &&
+            componentType->type != ScalarType::Type::FLOAT) {
+          std::stringstream errMsg;
+          errMsg << "map operation can only reduce int or float results with "
+                 << opString << " but got a result of type " << toString(type);
+          reportError(errMsg.str(), expr);
+        }
+        break;
+      case MapExpr::ReductionOp::USER: {
+        // Check that reducer combines two components into one.
+        bool validReducer = reducer->genericParams.empty() &&
+                            reducer->args.size() == 2 &&
+                            reducer->results.size() == 1;
+        for (unsigned i = 0; validReducer && i < 2; ++i) {
+          validReducer = env.compareTypes(reducer->args[i]->type, blockType);
+        }
+        if (validReducer) {
+          validReducer = env.compareTypes(reducer->results[0]->type, blockType);
+        }
+        if (!validReducer) {
+          std::stringstream errMsg;
+          errMsg << "reducer '" << opString << "' must take two arguments of "
+                 << "type " << toString(blockType) << " and return one value "
+                 << "of that type";
+          reportError(errMsg.str(), expr->reducer);
+        }
+
+        // Check that identity has the type of the reduced components.
+        const ExprType identityType = inferType(expr->identity);
+        if (identityType.defined && (identityType.type.size() != 1 ||
+            !env.compareTypes(identityType.type[0], blockType))) {
+          std::stringstream errMsg;
+          errMsg << "identity of reducer '" << opString << "' must be of "
+                 << "type " << toString(blockType) << " but got a value of "
+                 << "type " << toString(identityType);
+          reportError(errMsg.str(), expr->identity);
+        }
+        break;
+      }
+      default:
+        simit_unreachable;
+        break;
+    }
+  }
+}
+
 void TypeChecker::typeCheckBinaryElwise(BinaryExpr::Ptr expr, 
                                         bool allowStringOperands) {
   const ExprType lhsType = inferType(expr->lhs);
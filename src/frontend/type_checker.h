@@ -60,6 +60,7 @@ private:
   virtual void visit(AssignStmt::Ptr);
   virtual void visit(ExprParam::Ptr);
   virtual void visit(MapExpr::Ptr);
+  virtual void visit(ReducedMapExpr::Ptr);
   virtual void visit(OrExpr::Ptr);
   virtual void visit(AndExpr::Ptr);
   virtual void visit(XorExpr::Ptr);
@@ -370,6 +371,7 @@ private:
 private:
   void typeCheckVarOrConstDecl(VarDecl::Ptr, bool = false, bool = false);
   void typeCheckMapOrApply(MapExpr::Ptr, bool = false);
+  void typeCheckReduction(ReducedMapExpr::Ptr, ExprType);
   void typeCheckBinaryElwise(BinaryExpr::Ptr, bool = false);
   void typeCheckBinaryBoolean(BinaryExpr::Ptr);
   void typeCheckDenseTensorLiteral(DenseTensorLiteral::Ptr);
@@ -1,6 +1,7 @@
 #include "function.h"
 
 #include "backend/backend_function.h"
+#include "checkpoint.h"
 #include "types_convert.h"
 #include "graph.h"  // TODO: should not need this include
 
@@ -12,11 +13,30 @@ namespace simit {
 Function::Function() : Function(nullptr) {
 }
 
-Function::Function(backend::Function* func) : impl(func), funcPtr(nullptr) {
+Function::Function(backend::Function* func)
+    : impl(func), checkpointer(new internal::Checkpointer), funcPtr(nullptr) {
 }
 
 void Function::clear() {
   impl = nullptr;
+  checkpointer = std::make_shared<internal::Checkpointer>();
+}
+
+/// The size of a dense tensor of the given type, or 0 if its size is not known
+/// statically. Must be called with the function's settings in effect.
+static size_t denseTensorBytes(const ir::Type& type) {
+  if (!type.isTensor()) {
+    return 0;
+  }
+  const ir::TensorType* tensorType = type.toTensor();
+  for (const ir::IndexDomain& dimension : tensorType->getDimensions()) {
+    for (const ir::IndexSet& indexSet : dimension.getIndexSets()) {
+      if (indexSet.getKind() != ir::IndexSet::Range) {
+        return 0;
+      }
+    }
+  }
+  return tensorType->size() * tensorType->getComponentType().bytes();
 }
 
 void Function::bind(const std::string& name, simit::Set *set) {
@@ -47,7 +67,6 @@ void Function::bind(const std::string& name, simit::Set *set) {
         setFieldTypeComponentType = ir::ScalarType(ir::ScalarType::Float);
         break;
       case ComponentType::Double:
-        simit_iassert(ir::ScalarType::floatBytes == sizeof(double));
         setFieldTypeComponentType = ir::ScalarType(ir::ScalarType::Float);
         break;
       case ComponentType::Int:
@@ -72,6 +91,21 @@ void Function::bind(const std::string& name, simit::Set *set) {
                   && setFieldType->getOrder() == elemFieldType->order())
         << fieldTypeErrorString;
 
+    // Float fields are stored at their declared width, or at the program's
+    // float precision
+    if (setFieldTypeComponentType.isFloat()) {
+      unsigned floatBytes = elemType->field(fieldData->name).floatBytes;
+      if (floatBytes == 0) {
+        floatBytes = impl->getSettings().floatSize;
+      }
+      unsigned setFieldFloatBytes =
+          (setFieldType->getComponentType() == ComponentType::Float)
+          ? sizeof(float) : sizeof(double);
+      simit_uassert(setFieldFloatBytes == floatBytes)
+          << fieldTypeErrorString << " (a " << floatBytes << "-byte float is "
+          << "required)";
+    }
+
     const vector<ir::IndexDomain> &fieldDims = elemFieldType->getDimensions();
     for (size_t i=0; i < elemFieldType->order(); ++i) {
       simit_uassert(fieldDims[i].getIndexSets().size() == 1)
@@ -85,7 +119,9 @@ void Function::bind(const std::string& name, simit::Set *set) {
   }
 #endif
 
+  internal::SettingsScope scope(impl->getSettings());
   impl->bind(name, set);
+  checkpointer->bindSet(name, set);
 }
 
 void Function::bind(const string& name, const TensorType& ttype, void* data) {
@@ -106,16 +142,35 @@ void Function::bind(const std::string& name, void* data) {
   simit_uassert(defined()) << "undefined function";
   simit_uassert(impl->hasBindable(name))
       << "no argument or global of this name in the function";
+  internal::SettingsScope scope(impl->getSettings());
   impl->bind(name, data);
+  checkpointer->bindTensor(name, data,
+                           denseTensorBytes(impl->getBindableType(name)));
 }
 
 void Function::bind(const string& name, TensorData& data) {
+  simit_uassert(defined()) << "undefined function";
+  internal::SettingsScope scope(impl->getSettings());
   impl->bind(name, data);
+  // Sparse tensors are not checkpointed
+  checkpointer->bindTensor(name, nullptr, 0);
 }
 
 void Function::init() {
   simit_uassert(defined()) << "undefined function";
+  internal::SettingsScope scope(impl->getSettings());
   funcPtr = impl->init();
+
+  // Profiled functions report to the profiler that is current on the thread
+  // that runs them.
+  if (isProfiled()) {
+    std::shared_ptr<internal::Profiler> profiler = impl->getProfiler();
+    backend::Function::FuncType func = funcPtr;
+    funcPtr = [profiler, func]() {
+      internal::Profiler::Scope scope(profiler.get());
+      func();
+    };
+  }
 }
 
 void Function::runSafe() {
@@ -130,11 +185,13 @@ void Function::runSafe() {
 
 void Function::mapArgs() {
   simit_uassert(defined()) << "undefined function";
+  internal::SettingsScope scope(impl->getSettings());
   impl->mapArgs();
 }
 
 void Function::unmapArgs(bool updated) {
   simit_uassert(defined()) << "undefined function";
+  internal::SettingsScope scope(impl->getSettings());
   impl->unmapArgs(updated);
 }
 
@@ -150,6 +207,40 @@ void Function::printMachine(std::ostream& os) const {
   }
 }
 
+void Function::checkpoint(const std::string& filename) {
+  simit_uassert(defined()) << "undefined function";
+  checkpointer->checkpoint(filename);
+}
+
+int Function::waitForCheckpoints() {
+  simit_uassert(defined()) << "undefined function";
+  return checkpointer->wait();
+}
+
+int Function::restore(const std::string& filename) {
+  simit_uassert(defined()) << "undefined function";
+  return checkpointer->restore(filename);
+}
+
+bool Function::isProfiled() const {
+  return defined() && impl->getProfiler() != nullptr;
+}
+
+std::string Function::getHaloHazard() const {
+  simit_uassert(defined()) << "undefined function";
+  return impl->getHaloHazard();
+}
+
+Profile Function::getProfile() const {
+  simit_uassert(isProfiled()) << "function was not compiled with a profiler";
+  return impl->getProfiler()->getProfile();
+}
+
+void Function::resetProfile() {
+  simit_uassert(isProfiled()) << "function was not compiled with a profiler";
+  impl->getProfiler()->reset();
+}
+
 std::ostream& operator<<(std::ostream& os, const Function& f) {
   f.print(os);
   return os;
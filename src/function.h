@@ -4,6 +4,7 @@
 #include <string>
 #include <functional>
 #include "tensor.h"
+#include "profiler.h"
 
 namespace simit {
 class Set;
@@ -12,6 +13,9 @@ class TensorData;
 namespace backend {
 class Function;
 }
+namespace internal {
+class Checkpointer;
+}
 
 /// A callable Simit function. You can bind arguments and externs (bindables) to
 /// a function using the `bind` methods and call it using the `run` and
@@ -27,6 +31,11 @@ class Function;
 /// If you call the function using `runSafe` (recommended for testing) you don't
 /// need to call `init`, `mapArgs` or `unmapArgs` as they will be called
 /// automatically.
+///
+/// Distinct functions may be bound, initialized and run concurrently from
+/// different threads, provided they are not bound to the same sets or tensors
+/// that they write. A single function must not be used from several threads at
+/// once.
 class Function {
 public:
   Function();
@@ -77,6 +86,24 @@ public:
   void mapArgs();
   void unmapArgs(bool updated=true);
 
+  /// Write the bound sets and dense tensors to a binary mesh file (see
+  /// binary_mesh.h), e.g. to restart a simulation from it. The data is copied
+  /// into a snapshot before checkpoint returns and written on a background
+  /// thread, so the function can run again right away. A checkpoint waits if
+  /// the two before it are still being written. Call unmapArgs first, so that
+  /// the host data is up to date.
+  void checkpoint(const std::string& filename);
+
+  /// Wait for the pending checkpoints to be written.
+  ///return -1 if a checkpoint failed to write since the last call
+  int waitForCheckpoints();
+
+  /// Replace the elements of the bound sets and the data of the bound dense
+  /// tensors with those of a checkpoint. Bound sets may change size, and the
+  /// function need not be initialized again.
+  ///return -1 if failed to restore, in which case the bound data is undefined
+  int restore(const std::string& filename);
+
   /// True if the function has been defined, false otherwise.
   bool defined() const {return impl != nullptr;}
 
@@ -87,9 +114,25 @@ public:
   /// Print the function to the stream as machine assembly code.
   void printMachine(std::ostream& os) const;
 
+  /// True if the function was compiled with Program::compileWithProfiler.
+  bool isProfiled() const;
+
+  /// The counters accumulated by the runs of a profiled function since it was
+  /// compiled or since the last call to resetProfile.
+  Profile getProfile() const;
+  void resetProfile();
+
+  /// Why the function can not run on distributed sets that only update their
+  /// halos before each run (see DistributedSets::run), or an empty string if
+  /// it can.
+  std::string getHaloHazard() const;
+
 private:
   std::shared_ptr<backend::Function> impl;
 
+  /// The bound sets and tensors, and the snapshots of pending checkpoints.
+  std::shared_ptr<internal::Checkpointer> checkpointer;
+
   // To make the run method faster we store the function pointer here.
   std::function<void()> funcPtr;
 };
@@ -1,25 +1,50 @@
 #include "graph.h"
 
+#include <cmath>
 #include <iostream>
 
+#include "binary_mesh.h"
+#include "numa.h"
+#include "util/parallel.h"
+
 using namespace std;
 
 namespace simit {
 
+/// Calls `body(begin, end)` on blocks of [0,n), on several threads if there
+/// are enough blocks to be worth it.
+static void parallelBlocks(size_t n,
+                           const std::function<void(size_t,size_t)>& body) {
+  // Large enough blocks that the threads stream through memory
+  const size_t blockSize = 1 << 14;
+  if (n <= blockSize) {
+    body(0, n);
+    return;
+  }
+  util::parallelFor((n + blockSize-1) / blockSize, [&](size_t block) {
+    body(block*blockSize, std::min(n, (block+1)*blockSize));
+  });
+}
+
 Set::~Set() {
   for (auto f: fields) {
     delete f;
   }
-  free(endpoints);
-  free(gridPoints);
-  free(gridEdges);
+  allocator->deallocate(endpoints, capacity*getCardinality()*sizeof(int));
+  size_t numGridPoints = 1;
+  for (int d : dimensions) {
+    numGridPoints *= d;
+  }
+  allocator->deallocate(gridPoints, numGridPoints*sizeof(ElementRef));
+  allocator->deallocate(gridEdges,
+                        numGridPoints*dimensions.size()*sizeof(ElementRef));
 }
 
 void Set::increaseCapacity() {
   for (auto f : fields) {
-    int typeSize = f->sizeOfType;
-    f->data = realloc(f->data, (capacity+capacityIncrement) * typeSize);
-    memset((char*)(f->data)+capacity*typeSize, 0, capacityIncrement*typeSize);
+    f->data = internal::reallocateFieldData(allocator, f->data, capacity,
+                                            capacity+capacityIncrement,
+                                            numElements, f->sizeOfType);
 
     for (FieldRefBase *fieldRef : f->fieldReferences) {
       fieldRef->data = f->data;
@@ -28,90 +53,510 @@ void Set::increaseCapacity() {
   capacity += capacityIncrement;
 }
 
+void Set::ensureCapacity(int n) {
+  if (n <= capacity) {
+    return;
+  }
+  int newCapacity = capacity +
+      (n - capacity + capacityIncrement-1) / capacityIncrement *
+      capacityIncrement;
+
+  for (auto f : fields) {
+    f->data = internal::reallocateFieldData(allocator, f->data, capacity,
+                                            newCapacity, n, f->sizeOfType);
+
+    for (FieldRefBase *fieldRef : f->fieldReferences) {
+      fieldRef->data = f->data;
+    }
+  }
+  if (getCardinality() > 0) {
+    endpoints = (int*)allocator->reallocate(
+        endpoints, capacity*getCardinality()*sizeof(int),
+        newCapacity*getCardinality()*sizeof(int));
+  }
+  capacity = newCapacity;
+}
+
+ElementRef Set::addElements(int n, const int* edgeEndpoints) {
+  simit_uassert(n >= 0) << "Cannot add a negative number of elements";
+  const int cardinality = getCardinality();
+  simit_uassert(cardinality == 0 || n == 0 || edgeEndpoints != nullptr)
+      << "Elements added to an edge set must have endpoints";
+
+  // Keep the invariant that elements < capacity
+  ensureCapacity(numElements + n + 1);
+
+  // Slots past the last element may hold data of removed elements
+  for (auto f : fields) {
+    memset((char*)(f->data) + numElements*f->sizeOfType, 0, n*f->sizeOfType);
+  }
+
+  int* newEndpoints = endpoints + (size_t)numElements*cardinality;
+  parallelBlocks((size_t)n*cardinality, [&](size_t begin, size_t end) {
+    for (size_t i=begin; i < end; ++i) {
+      const Set* endpointSet = endpointSets[i % cardinality];
+      simit_uassert(edgeEndpoints[i] >= 0 &&
+                    edgeEndpoints[i] < endpointSet->getSize())
+          << "Invalid member of set (" << endpointSet->getName()
+          << ") in addElements (" << edgeEndpoints[i] << " < "
+          << endpointSet->getSize() << ")";
+      newEndpoints[i] = edgeEndpoints[i];
+    }
+  });
+
+  ElementRef first(numElements);
+  numElements += n;
+  if (n > 0) {
+    ++topologyVersion;
+  }
+  return first;
+}
+
+/// Move the elements of `data` that are not removed by `remap` to their new
+/// locations. Runs of consecutive remaining elements are moved together.
+static void compact(char* data, size_t elementSize, const vector<int>& remap) {
+  size_t i = 0;
+  while (i < remap.size()) {
+    if (remap[i] < 0 || remap[i] == (int)i) {
+      ++i;
+      continue;
+    }
+    size_t end = i+1;
+    while (end < remap.size() && remap[end] == remap[end-1]+1) {
+      ++end;
+    }
+    memmove(data + remap[i]*elementSize, data + i*elementSize,
+            (end-i)*elementSize);
+    i = end;
+  }
+}
+
+vector<int> Set::removeElements(const vector<ElementRef>& elements) {
+  simit_uassert(kind != Grid)
+      << "Element removal disallowed for grid edge sets";
+
+  vector<int> remap(numElements, 0);
+  for (ElementRef element : elements) {
+    simit_uassert(element.ident >= 0 && element.ident < numElements)
+        << "Invalid member of set (" << name << ") in removeElements ("
+        << element.ident << " < " << numElements << ")";
+    remap[element.ident] = -1;
+  }
+  int newSize = 0;
+  for (int& newIdent : remap) {
+    if (newIdent != -1) {
+      newIdent = newSize++;
+    }
+  }
+  if (newSize == numElements) {
+    return remap;
+  }
+
+  for (auto f : fields) {
+    compact((char*)f->data, f->sizeOfType, remap);
+    memset((char*)(f->data) + newSize*f->sizeOfType, 0,
+           (numElements-newSize)*f->sizeOfType);
+  }
+  if (getCardinality() > 0) {
+    compact((char*)endpoints, getCardinality()*sizeof(int), remap);
+  }
+  numElements = newSize;
+
+  ++topologyVersion;
+  removals.push_back({topologyVersion, remap});
+  if (removals.size() > maxRemovals) {
+    forgottenTopologyVersion = removals.front().version;
+    removals.pop_front();
+  }
+  return remap;
+}
+
+void Set::remapEndpoints(const Set& endpointSet, const vector<int>& remap) {
+  const int cardinality = getCardinality();
+  for (int i=0; i < cardinality; ++i) {
+    if (endpointSets[i] != &endpointSet) {
+      continue;
+    }
+    for (int e=0; e < numElements; ++e) {
+      int& endpoint = endpoints[e*cardinality + i];
+      simit_uassert(endpoint < (int)remap.size() && remap[endpoint] >= 0)
+          << "Edge " << e << " of set (" << name << ") has endpoint "
+          << endpoint << " that was removed from ("
+          << endpointSet.getName() << ")";
+      endpoint = remap[endpoint];
+    }
+  }
+  ++topologyVersion;
+}
+
+int Set::save(const std::string& filename) {
+  BinaryMeshWriter writer;
+  if (writer.addSet("set", this) != 0) {
+    return -1;
+  }
+  return writer.save(filename);
+}
+
+int Set::load(const std::string& filename) {
+  BinaryMesh mesh;
+  if (mesh.open(filename) != 0) {
+    return -1;
+  }
+  vector<ElementRef> elements;
+  for (ElementRef element : *this) {
+    elements.push_back(element);
+  }
+  removeElements(elements);
+  return mesh.load("set", this);
+}
+
+bool Set::getTopologyRemap(uint64_t version, int size,
+                           vector<int>* remap) const {
+  simit_iassert(version <= topologyVersion);
+  if (version < forgottenTopologyVersion) {
+    return false;
+  }
+  remap->resize(size);
+  for (int i=0; i < size; ++i) {
+    (*remap)[i] = i;
+  }
+  for (const Removal& removal : removals) {
+    if (removal.version <= version) {
+      continue;
+    }
+    for (int& newIdent : *remap) {
+      if (newIdent >= 0) {
+        simit_iassert((size_t)newIdent < removal.remap.size());
+        newIdent = removal.remap[newIdent];
+      }
+    }
+  }
+  return true;
+}
+
+
+// class FieldRefBase
+void FieldRefBase::forBlocks(size_t n,
+                             const std::function<void(size_t,size_t)>& body) {
+  parallelBlocks(n, body);
+}
+
 
 // Graph generators
 void createElements(Set *elements, unsigned num) {
-  for (size_t i=0; i < num; ++i) {
-    elements->add();
+  elements->addElements(num);
+}
+
+/// A well mixed hash of `x` (the splitmix64 finalizer), used to draw random
+/// numbers that depend only on the seed and the number's index, so generated
+/// graphs do not depend on the number of threads.
+static uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/// A uniformly distributed number in [0,1).
+static double uniform(uint64_t seed, uint64_t index) {
+  return (mix(mix(seed) + index) >> 11) * (1.0 / (1ull << 53));
+}
+
+static void checkEndpoints(const Set *vertices, const Set *edges,
+                           int cardinality) {
+  simit_uassert(edges->getCardinality() == cardinality)
+      << "expected an edge set with " << cardinality << " endpoints";
+  for (int i=0; i < cardinality; ++i) {
+    simit_uassert(edges->getEndpointSet(i) == vertices)
+        << "the edges must be edges of the vertices";
   }
 }
 
-#define node0(x,y,z)  x*numY*numZ + y*numZ + z      // node at x,y,z
-#define node1X(x,y,z) (x+1)*numY*numZ + y*numZ + z  // x's neighbor
-#define node1Y(x,y,z) x*numY*numZ + (y+1)*numZ + z  // y's neighbor
-#define node1Z(x,y,z) x*numY*numZ + y*numZ + (z+1)  // z's neighbor
+// class Box
+Box::Box(unsigned nX, unsigned nY, unsigned nZ, int firstVertex, int firstEdge)
+    : nX(nX), nY(nY), nZ(nZ), firstVertex(firstVertex), firstEdge(firstEdge) {
+}
 
-Box::Box(unsigned nX, unsigned nY, unsigned nZ,
-    std::vector<ElementRef> refs, std::map<Box::Coord, ElementRef> coords2edges)
-    : nX(nX), nY(nY), nZ(nZ), refs(refs), coords2edges(coords2edges) {
-  simit_iassert(refs.size() == nX*nY*nZ);
+size_t Box::getNumEdges() const {
+  if (firstEdge < 0) {
+    return 0;
+  }
+  return (size_t)(nX-1)*nY*nZ + (size_t)nX*(nY-1)*nZ + (size_t)nX*nY*(nZ-1);
 }
 
 ElementRef Box::getEdge(ElementRef p1, ElementRef p2) const {
-  Coord coord(p1,p2);
-  if (coords2edges.find(coord) == coords2edges.end()) {
+  const int64_t numVertices = (int64_t)nX*nY*nZ;
+  const int64_t i = (int64_t)p1.getIdent() - firstVertex;
+  const int64_t d = (int64_t)p2.getIdent() - p1.getIdent();
+  if (firstEdge < 0 || !p1.defined() || i < 0 || i >= numVertices) {
     return ElementRef();
   }
-  return coords2edges.at(coord);
+  const int64_t x = i / ((int64_t)nY*nZ);
+  const int64_t y = i / nZ % nY;
+  const int64_t z = i % nZ;
+  int64_t edge = firstEdge;
+
+  // x edges are numbered like the vertices they start at
+  if (d == (int64_t)nY*nZ && x+1 < nX) {
+    return ElementRef(edge + i);
+  }
+  edge += (int64_t)(nX-1)*nY*nZ;
+  if (d == nZ && y+1 < nY) {
+    return ElementRef(edge + (x*(nY-1) + y)*nZ + z);
+  }
+  edge += (int64_t)nX*(nY-1)*nZ;
+  if (d == 1 && z+1 < nZ) {
+    return ElementRef(edge + (x*nY + y)*(nZ-1) + z);
+  }
+  return ElementRef();
 }
 
-std::vector<ElementRef> Box::getEdges() {
+std::vector<ElementRef> Box::getEdges() const {
   std::vector<ElementRef> edges;
-  for (auto &coord2edge : coords2edges) {
-    edges.push_back(coord2edge.second);
+  edges.reserve(getNumEdges());
+  for (size_t i=0; i < getNumEdges(); ++i) {
+    edges.push_back(ElementRef(firstEdge + i));
   }
   return edges;
 }
 
+/// Add the nX*nY*nZ vertices of a box, returning the first.
+static int addBoxVertices(Set *vertices,
+                          unsigned numX, unsigned numY, unsigned numZ) {
+  simit_uassert(numX >= 1 && numY >= 1 && numZ >= 1);
+  simit_uassert((uint64_t)numX*numY*numZ <=
+                (uint64_t)(INT32_MAX - vertices->getSize()))
+      << "box is too large";
+  return vertices->addElements(numX*numY*numZ).getIdent();
+}
+
 Box createBox(Set *vertices, Set *edges,
               unsigned numX, unsigned numY, unsigned numZ) {
-  simit_uassert(numX >= 1 && numY >= 1 && numZ >= 1);
-  vector<ElementRef> points(numX*numY*numZ);
+  checkEndpoints(vertices, edges, 2);
+  const int first = addBoxVertices(vertices, numX, numY, numZ);
+  const size_t nX = numX, nY = numY, nZ = numZ;
+  const size_t numXEdges = (nX-1)*nY*nZ;
+  const size_t numYEdges = nX*(nY-1)*nZ;
+  const size_t numZEdges = nX*nY*(nZ-1);
+  simit_uassert(numXEdges+numYEdges+numZEdges <=
+                (size_t)(INT32_MAX - edges->getSize()))
+      << "box is too large";
 
-  for(unsigned x = 0; x < numX; ++x) {
-    for(unsigned y = 0; y < numY; ++y) {
-      for(unsigned z = 0; z < numZ; ++z) {
-        points[node0(x,y,z)] = vertices->add();
+  // Edges are numbered as in Box::getEdge: the x edges, then the y edges and
+  // then the z edges, each in vertex order
+  vector<int> endpoints(2*(numXEdges+numYEdges+numZEdges));
+  int* xEdges = endpoints.data();
+  int* yEdges = xEdges + 2*numXEdges;
+  int* zEdges = yEdges + 2*numYEdges;
+  util::parallelFor(nX, [&](size_t x) {
+    for (size_t y=0; y < nY; ++y) {
+      for (size_t z=0; z < nZ; ++z) {
+        const int v = first + (x*nY + y)*nZ + z;
+        if (x+1 < nX) {
+          size_t e = (x*nY + y)*nZ + z;
+          xEdges[2*e]   = v;
+          xEdges[2*e+1] = v + nY*nZ;
+        }
+        if (y+1 < nY) {
+          size_t e = (x*(nY-1) + y)*nZ + z;
+          yEdges[2*e]   = v;
+          yEdges[2*e+1] = v + nZ;
+        }
+        if (z+1 < nZ) {
+          size_t e = (x*nY + y)*(nZ-1) + z;
+          zEdges[2*e]   = v;
+          zEdges[2*e+1] = v + 1;
+        }
       }
     }
-  }
+  });
+  ElementRef firstEdge = edges->addElements(endpoints.size()/2,
+                                            endpoints.data());
+  return Box(numX, numY, numZ, first, firstEdge.getIdent());
+}
 
-  map<Box::Coord, ElementRef> coords2edges;
+Box createTetBox(Set *vertices, Set *tets,
+                 unsigned numX, unsigned numY, unsigned numZ) {
+  checkEndpoints(vertices, tets, 4);
+  const int first = addBoxVertices(vertices, numX, numY, numZ);
+  const size_t nX = numX, nY = numY, nZ = numZ;
+  const size_t numCubes = (nX-1)*(nY-1)*(nZ-1);
+  simit_uassert(6*numCubes <= (size_t)(INT32_MAX - tets->getSize()))
+      << "box is too large";
 
-  // x edges
-  for(unsigned x = 0; x < numX-1; ++x) {
-    for(unsigned y = 0; y < numY; ++y) {
-      for(unsigned z = 0; z < numZ; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1X(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
+  // The Kuhn subdivision of a cube into six tetrahedra around its diagonal,
+  // which conforms across cubes. Each tetrahedron steps from the cube's
+  // first to its last corner along the axes in one order, with the middle
+  // corners swapped for odd orders so that all are positively oriented.
+  const int orders[6][3] = {{0,1,2}, {1,2,0}, {2,0,1},
+                            {0,2,1}, {1,0,2}, {2,1,0}};
+  const int steps[3] = {(int)(nY*nZ), (int)nZ, 1};
+  vector<int> endpoints(4*6*numCubes);
+  util::parallelFor(nX-1, [&](size_t x) {
+    for (size_t y=0; y+1 < nY; ++y) {
+      for (size_t z=0; z+1 < nZ; ++z) {
+        const int v = first + (x*nY + y)*nZ + z;
+        int* cubeTets = &endpoints[4*6*((x*(nY-1) + y)*(nZ-1) + z)];
+        for (int t=0; t < 6; ++t) {
+          int* tet = cubeTets + 4*t;
+          tet[0] = v;
+          tet[1] = v + steps[orders[t][0]];
+          tet[2] = tet[1] + steps[orders[t][1]];
+          tet[3] = tet[2] + steps[orders[t][2]];
+          if (t >= 3) {
+            std::swap(tet[1], tet[2]);
+          }
+        }
       }
     }
+  });
+  tets->addElements(6*numCubes, endpoints.data());
+  return Box(numX, numY, numZ, first, -1);
+}
+
+/// Write the positions of vertices [first,first+n) to `positionField`, which
+/// must have three float or double components.
+static void setPositions(Set *vertices, const std::string& positionField,
+                         int first, const vector<double>& positions) {
+  simit_uassert(vertices->hasField(positionField))
+      << "no field " << util::quote(positionField);
+  const Set::FieldData* field =
+      vertices->getFields()[vertices->getFieldIndex(positionField)];
+  const ComponentType type = field->type->getComponentType();
+  simit_uassert(field->type->getSize() == 3 &&
+                (type == ComponentType::Float || type == ComponentType::Double))
+      << "positions must have three float components";
+  if (type == ComponentType::Double) {
+    std::copy(positions.begin(), positions.end(),
+              static_cast<double*>(field->data) + 3*(size_t)first);
   }
+  else {
+    std::copy(positions.begin(), positions.end(),
+              static_cast<float*>(field->data) + 3*(size_t)first);
+  }
+}
 
-  // y edges
-  for(unsigned x = 0; x < numX; ++x) {
-    for(unsigned y = 0; y < numY - 1; ++y) {
-      for(unsigned z = 0; z < numZ; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1Y(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
-      }
+void createRandomGeometricGraph(Set *vertices, Set *edges, unsigned num,
+                                double radius,
+                                const std::string& positionField,
+                                unsigned seed) {
+  checkEndpoints(vertices, edges, 2);
+  simit_uassert(radius > 0.0) << "radius must be positive";
+  simit_uassert(num <= (unsigned)(INT32_MAX - vertices->getSize()))
+      << "graph is too large";
+
+  vector<double> positions(3*(size_t)num);
+  util::parallelFor(num, [&](size_t i) {
+    for (int d=0; d < 3; ++d) {
+      positions[3*i+d] = uniform(seed, 3*i+d);
     }
+  });
+
+  // Bin the vertices in a grid with cells at least radius wide, so the
+  // neighbors of a vertex are in its own or the adjacent cells
+  const int gridSize = std::max(1, std::min((int)(1.0/radius),
+                                            (int)std::cbrt((double)num)));
+  auto cellOf = [&](size_t i, int d) {
+    return std::min(gridSize-1, (int)(positions[3*i+d] * gridSize));
+  };
+  auto cellIndex = [&](int x, int y, int z) {
+    return ((size_t)x*gridSize + y)*gridSize + z;
+  };
+  const size_t numCells = (size_t)gridSize*gridSize*gridSize;
+  vector<int> cellStart(numCells+1, 0);
+  for (size_t i=0; i < num; ++i) {
+    ++cellStart[cellIndex(cellOf(i,0), cellOf(i,1), cellOf(i,2)) + 1];
+  }
+  for (size_t c=0; c < numCells; ++c) {
+    cellStart[c+1] += cellStart[c];
+  }
+  vector<int> cellVertices(num);
+  vector<int> cellFill(cellStart.begin(), cellStart.end()-1);
+  for (size_t i=0; i < num; ++i) {
+    cellVertices[cellFill[cellIndex(cellOf(i,0), cellOf(i,1), cellOf(i,2))]++]
+        = i;
   }
 
-  // z edges
-  for(unsigned x = 0; x < numX; ++x) {
-    for(unsigned y = 0; y < numY; ++y) {
-      for(unsigned z = 0; z < numZ-1; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1Z(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
+  // Find each vertex's neighbors with greater idents twice: once to count
+  // them and once to write them at their offsets
+  const double radius2 = radius*radius;
+  auto forNeighbors = [&](size_t i, const std::function<void(int)>& visit) {
+    const int cx = cellOf(i,0), cy = cellOf(i,1), cz = cellOf(i,2);
+    for (int x=std::max(0,cx-1); x <= std::min(gridSize-1,cx+1); ++x) {
+      for (int y=std::max(0,cy-1); y <= std::min(gridSize-1,cy+1); ++y) {
+        for (int z=std::max(0,cz-1); z <= std::min(gridSize-1,cz+1); ++z) {
+          size_t c = cellIndex(x,y,z);
+          for (int k=cellStart[c]; k < cellStart[c+1]; ++k) {
+            size_t j = cellVertices[k];
+            if (j <= i) {
+              continue;
+            }
+            double dist2 = 0.0;
+            for (int d=0; d < 3; ++d) {
+              double diff = positions[3*i+d] - positions[3*j+d];
+              dist2 += diff*diff;
+            }
+            if (dist2 < radius2) {
+              visit(j);
+            }
+          }
+        }
       }
     }
+  };
+  vector<size_t> offsets(num+1, 0);
+  util::parallelFor(num, [&](size_t i) {
+    forNeighbors(i, [&](int) {++offsets[i+1];});
+  });
+  for (size_t i=0; i < num; ++i) {
+    offsets[i+1] += offsets[i];
   }
+  simit_uassert(offsets[num] <= (size_t)(INT32_MAX - edges->getSize()))
+      << "graph is too large";
 
-  return Box(numX, numY, numZ, points, coords2edges);
+  const int first = vertices->addElements(num).getIdent();
+  vector<int> endpoints(2*offsets[num]);
+  util::parallelFor(num, [&](size_t i) {
+    size_t e = offsets[i];
+    forNeighbors(i, [&](int j) {
+      endpoints[2*e]   = first + i;
+      endpoints[2*e+1] = first + j;
+      ++e;
+    });
+  });
+  edges->addElements(offsets[num], endpoints.data());
+  if (!positionField.empty()) {
+    setPositions(vertices, positionField, first, positions);
+  }
+}
+
+void createPowerLawGraph(Set *vertices, Set *edges, unsigned scale,
+                         unsigned edgeFactor, unsigned seed) {
+  checkEndpoints(vertices, edges, 2);
+  simit_uassert(scale < 31) << "scale must be less than 31";
+  const size_t numVertices = (size_t)1 << scale;
+  const size_t numEdges = numVertices * edgeFactor;
+  simit_uassert(numVertices <= (size_t)(INT32_MAX - vertices->getSize()) &&
+                numEdges <= (size_t)(INT32_MAX - edges->getSize()))
+      << "graph is too large";
+
+  // The R-MAT probabilities of the quadrants of the adjacency matrix
+  const double a = 0.57, b = 0.19, c = 0.19;
+  const int first = vertices->addElements(numVertices).getIdent();
+  vector<int> endpoints(2*numEdges);
+  util::parallelFor((numEdges + 4095) / 4096, [&](size_t block) {
+    for (size_t e=block*4096; e < std::min(numEdges, (block+1)*4096); ++e) {
+      int source = 0, target = 0;
+      for (unsigned bit=0; bit < scale; ++bit) {
+        double r = uniform(seed, e*scale + bit);
+        source = 2*source + (r >= a+b);
+        target = 2*target + ((r >= a && r < a+b) || r >= a+b+c);
+      }
+      endpoints[2*e]   = first + source;
+      endpoints[2*e+1] = first + target;
+    }
+  });
+  edges->addElements(numEdges, endpoints.data());
 }
 
 } // namespace simit
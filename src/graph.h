@@ -1,8 +1,12 @@
 #ifndef SIMIT_GRAPH_H
 #define SIMIT_GRAPH_H
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <vector>
 #include <string>
 #include <map>
@@ -10,7 +14,9 @@
 #include <ostream>
 
 #include "tensor_type.h"
+#include "allocator.h"
 #include "error.h"
+#include "numa.h"
 #include "types.h"
 #include "util/variadic.h"
 #include "interfaces/comparable.h"
@@ -21,6 +27,7 @@ class Function;
 
 class Set;
 class FieldRefBase;
+class DistributedSets;
 template <typename T, int... dimensions> class FieldRef;
 template <typename T, int... dimensions> class TensorRef;
 
@@ -32,6 +39,7 @@ class NeighborIndex;
 
 namespace pe {
 class SetEndpointPathIndex;
+class PathIndexBuilder;
 }
 
 /// A Simit element reference.  All Simit elements live in Simit sets and an
@@ -83,6 +91,9 @@ private:
   friend class internal::VertexToEdgeIndex;
   friend class internal::NeighborIndex;
   friend class pe::SetEndpointPathIndex;
+  friend class pe::PathIndexBuilder;
+  friend class Box;
+  friend class DistributedSets;
 };
 
 
@@ -102,7 +113,8 @@ public:
     static_assert(util::areSame<Set, Sets...>{},
         "Set constructor takes an optional name followed by zero or more Sets");
     this->endpointSets = {&endpoints...};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    this->endpoints    = (int*)allocator->allocate(
+        sizeof(int) * capacity * getCardinality());
   }
 
   /// Construct a named edge set with n endpoints.
@@ -127,7 +139,8 @@ public:
         << "Grid Edge Set constructor must be passed an empty underlying "
         << "point set, which it will then proceed to initialize.";
     this->endpointSets = {&points, &points};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    this->endpoints    = (int*)allocator->allocate(
+        sizeof(int) * capacity * getCardinality());
     this->dimensions = dims;
     this->underlyingPointSet = &points;
 
@@ -138,9 +151,10 @@ public:
       cumDims.push_back(totalPoints);
     }
 
-    this->gridPoints = (ElementRef*)calloc(sizeof(ElementRef), totalPoints);
-    this->gridEdges = (ElementRef*)calloc(
-        sizeof(ElementRef), totalPoints*dims.size());
+    this->gridPoints = (ElementRef*)allocator->allocate(
+        sizeof(ElementRef) * totalPoints);
+    this->gridEdges = (ElementRef*)allocator->allocate(
+        sizeof(ElementRef) * totalPoints*dims.size());
     
     std::vector<int> indices(dims.size());
     // Pad underlying set to have N_1 x N_2 x ... N_d elements, storing their
@@ -253,13 +267,27 @@ public:
   /// Field<double,2,3> matrix = addField<double,2,3>("mat");
   template <typename T, int... dimensions>
   FieldRef<T, dimensions...> addField(const std::string &name) {
+    addField(name, typeOf<T>(), {dimensions...});
+    return FieldRef<T, dimensions...>(fields.back());
+  }
+
+  /// Add a tensor field whose component type and dimension sizes are only
+  /// known at runtime (e.g. when the set is loaded from a file).
+  void addField(const std::string &name, ComponentType componentType,
+                const std::vector<int> &dimensions) {
     FieldData::TensorType *type =
-        new FieldData::TensorType(typeOf<T>(), {dimensions...});
+        new FieldData::TensorType(componentType, dimensions);
     FieldData *fieldData = new FieldData(name, type, this);
-    fieldData->data = calloc(capacity, fieldData->sizeOfType);
+    fieldData->data = internal::allocateFieldData(allocator, capacity,
+                                                  numElements,
+                                                  fieldData->sizeOfType);
     fields.push_back(fieldData);
     fieldNames[name] = fields.size()-1;
-    return FieldRef<T, dimensions...>(fieldData);
+  }
+
+  /// True if the set has a field called `name`.
+  bool hasField(const std::string &name) const {
+    return fieldNames.find(name) != fieldNames.end();
   }
  
   // Added for reordering
@@ -303,50 +331,58 @@ public:
     if (numElements > capacity-1) {
       increaseCapacity();
     }
+    ++topologyVersion;
     return ElementRef(numElements++);
   }
 
-  /// Remove an element from the Set
+  /// Add `n` elements to the set and return the first of them. The new
+  /// elements are numbered consecutively and their fields are zero. Edge sets
+  /// take the endpoints of the new edges, `getCardinality()` per edge.
+  ElementRef addElements(int n, const int* edgeEndpoints=nullptr);
+
+  /// Remove the given elements and compact the remaining ones, with all their
+  /// field components and endpoints, keeping their relative order. Returns the
+  /// remap from old to new element ids, where removed elements map to -1.
+  ///
+  /// Edges in other sets that have removed elements as endpoints must be
+  /// removed first, and the remaining edges updated with remapEndpoints.
+  /// Functions the set is bound to pick up its new size on their next run and
+  /// need not be initialized again.
+  std::vector<int> removeElements(const std::vector<ElementRef>& elements);
+
+  /// Rewrite the endpoints that belong to `endpointSet` with a remap returned
+  /// by `endpointSet.removeElements`. Must be called before elements are added
+  /// to `endpointSet` again.
+  void remapEndpoints(const Set& endpointSet, const std::vector<int>& remap);
+
+  /// Remove an element from the Set. This compacts the set, so prefer
+  /// removeElements to remove many elements.
   void remove(ElementRef element) {
-    simit_uassert(kind != Grid)
-        << "Element removal disallowed for grid edge sets";
-    for (auto f : fields){
-      switch (f->type->getComponentType()) {
-        case ComponentType::Float: {
-          float* data = (float*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Double: {
-          double* data = (double*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Int: {
-          int* data = (int*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Boolean: {
-          bool* data = (bool*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::FloatComplex: {
-          float_complex* data = (float_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::DoubleComplex: {
-          double_complex* data = (double_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-      }
-    }
-    numElements--;
+    removeElements({element});
   }
 
+  /// Save the elements, endpoints and fields of the set to a binary mesh file
+  /// (see binary_mesh.h).
+  ///return -1 if failed to save
+  int save(const std::string& filename);
+
+  /// Replace the elements of the set with those saved by `save`. Saved fields
+  /// the set does not have are added to it, and its other fields are zero.
+  /// The endpoints of an edge set must be elements of its endpoint sets.
+  ///return -1 if failed to load
+  int load(const std::string& filename);
+
+  /// Returns a counter that is incremented by every change to the elements or
+  /// endpoints of the set. Used to keep indices over the set up to date.
+  uint64_t getTopologyVersion() const { return topologyVersion; }
+
+  /// Compose the remaps of the removals since the set was at topology version
+  /// `version`, when it had `size` elements. Elements added since are not in
+  /// the remap: they follow the remaining old elements. Returns false if the
+  /// removals are too old to still be recorded.
+  bool getTopologyRemap(uint64_t version, int size,
+                        std::vector<int>* remap) const;
+
   /// Iterator that iterates over the elements in a Set
   ///
   /// This iterator is an input_iterator, and thus can only be
@@ -572,7 +608,7 @@ public:
     }
 
     ~FieldData() {
-      free(data);
+      set->allocator->deallocate(data, set->capacity * sizeOfType);
       delete type;
     }
 
@@ -610,7 +646,8 @@ private:
   Set(const std::string &name, Kind kind)
       : kind(kind), name(name), numElements(0), endpoints(nullptr),
         gridPoints(nullptr), gridEdges(nullptr),
-        capacity(capacityIncrement), neighbors(nullptr) {}
+        capacity(capacityIncrement), allocator(getAllocator()),
+        neighbors(nullptr), topologyVersion(0), forgottenTopologyVersion(0) {}
 
   // Set data
   Kind kind;
@@ -628,17 +665,31 @@ private:
 
   int capacity;                              // current capacity of the set
   static const int capacityIncrement = 1024; // increment for capacity increases
+  Allocator* allocator;                      // allocator of fields and endpoints
 
   mutable internal::NeighborIndex *neighbors;// neighbor index (lazily created)
   std::map<std::string, int> fieldNames;     // name to field lookups
   std::vector<FieldData*> fields;            // fields of elements in the set
 
+  // Topology changes, for incremental index maintenance
+  struct Removal {
+    uint64_t version;                        // version after the removal
+    std::vector<int> remap;                  // old to new element ids
+  };
+  uint64_t topologyVersion;                  // incremented on every change
+  std::deque<Removal> removals;              // the most recent removals
+  uint64_t forgottenTopologyVersion;         // removals up to here are dropped
+  static const size_t maxRemovals = 8;       // number of removals to keep
+
   /// disable copy
   Set& operator=(const Set& s);
 
   /// increase capacity of all fields
   void increaseCapacity();
 
+  /// increase capacity of all fields and endpoints to hold n elements
+  void ensureCapacity(int n);
+
   /// helpers for constructing endpoint sets
   template <typename F, typename ...T> std::vector<const Set*>
   epsMaker(std::vector<const Set*> sofar, const F& f, const T& ... sets) const {
@@ -654,8 +705,9 @@ private:
   epsMaker(std::vector<const Set*> sofar) {return sofar;}
 
   void increaseEdgeCapacity() {
+    size_t oldSize = capacity*getCardinality()*sizeof(int);
     size_t newSize = (capacity+capacityIncrement)*getCardinality()*sizeof(int);
-    endpoints = (int*)realloc(endpoints, newSize);
+    endpoints = (int*)allocator->reallocate(endpoints, oldSize, newSize);
   }
 
   // helper for adding edges
@@ -707,7 +759,9 @@ private:
       FieldData::TensorType *type =
           new FieldData::TensorType(ctype, dims);
       FieldData *fieldData = new FieldData(field.name, type, this);
-      fieldData->data = calloc(capacity, fieldData->sizeOfType);
+      fieldData->data = internal::allocateFieldData(allocator, capacity,
+                                                    numElements,
+                                                    fieldData->sizeOfType);
       fields.push_back(fieldData);
       fieldNames[field.name] = fields.size()-1;
     }
@@ -751,6 +805,40 @@ private:
 
 // Field References
 
+/// A contiguous, read-only view of the components of a field, for exporting
+/// it in bulk. Elements are in order, each with `getComponentsPerElement()`
+/// components in row-major order. A span is invalidated when elements are
+/// added to or removed from the set.
+template <typename T>
+class FieldSpan {
+public:
+  FieldSpan(const T* data, size_t numElements, size_t componentsPerElement)
+      : components(data), numElements(numElements),
+        componentsPerElement(componentsPerElement) {}
+
+  const T* data() const {return components;}
+
+  /// The number of components in the span.
+  size_t size() const {return numElements * componentsPerElement;}
+
+  size_t getNumElements() const {return numElements;}
+  size_t getComponentsPerElement() const {return componentsPerElement;}
+
+  const T* begin() const {return components;}
+  const T* end() const {return components + size();}
+  const T& operator[](size_t i) const {return components[i];}
+
+  /// The components of `element`.
+  const T* element(ElementRef element) const {
+    return components + element.getIdent() * componentsPerElement;
+  }
+
+private:
+  const T* components;
+  size_t numElements;
+  size_t componentsPerElement;
+};
+
 /// The base class of field references.
 class FieldRefBase {
 public:
@@ -811,6 +899,11 @@ protected:
     return &static_cast<T*>(data)[element.ident * elementFieldSize];
   }
 
+  /// Calls `body(begin, end)` on blocks of the elements [0,n), on several
+  /// threads if there are enough elements to be worth it.
+  static void forBlocks(size_t n,
+                        const std::function<void(size_t,size_t)>& body);
+
   Set::FieldData *fieldData;
 
 private:
@@ -834,10 +927,95 @@ class FieldRefBaseParameterized : public FieldRefBase {
     return get(element);
   }
 
+  /// A contiguous view of the field's components for all of the set's
+  /// elements, to copy them out in bulk rather than one element at a time.
+  FieldSpan<T> span() const {
+    return FieldSpan<T>(static_cast<const T*>(this->fieldData->data),
+                        this->fieldData->set->getSize(),
+                        TensorRef<T,dimensions...>::getSize());
+  }
+
   const TensorRef<T, dimensions...> operator()(ElementRef element) const {
     return get(element);
   }
 
+  /// The number of components of each element's tensor.
+  static const int componentsPerElement = util::product<dimensions...>::value;
+
+  /// The components of one element's tensor.
+  typedef T ElementData[componentsPerElement];
+
+  /// The field's data as an array with the tensor of each element, indexed by
+  /// the element's ident. Unlike get, this does no per-element bookkeeping,
+  /// so loops over it can be vectorized.
+  ElementData* data() {
+    return reinterpret_cast<ElementData*>(this->fieldData->data);
+  }
+
+  const ElementData* data() const {
+    return reinterpret_cast<const ElementData*>(this->fieldData->data);
+  }
+
+  /// Copy the tensors of the elements with idents [begin,end) from `src`,
+  /// which holds `componentsPerElement` components per element.
+  void assign(size_t begin, size_t end, const T* src) {
+    simit_uassert(begin <= end && end <= (size_t)this->getNumElements())
+        << "element range out of bounds";
+    T* dst = &data()[begin][0];
+    this->forBlocks(end-begin, [dst,src](size_t first, size_t last) {
+      std::copy(src + first*componentsPerElement,
+                src + last*componentsPerElement,
+                dst + first*componentsPerElement);
+    });
+  }
+
+  /// The tensors of the elements with the given idents, one after another.
+  std::vector<T> gather(const std::vector<int>& idents) const {
+    checkIdents(idents, false);
+    std::vector<T> values(idents.size() * componentsPerElement);
+    const ElementData* src = data();
+    T* dst = values.data();
+    const int* ids = idents.data();
+    this->forBlocks(idents.size(), [=](size_t first, size_t last) {
+      for (size_t i=first; i < last; ++i) {
+        std::copy(src[ids[i]], src[ids[i]] + componentsPerElement,
+                  dst + i*componentsPerElement);
+      }
+    });
+    return values;
+  }
+
+  /// Set the tensors of the elements with the given idents to `values`, which
+  /// holds one tensor per ident. The idents must be distinct, since the
+  /// elements are written from several threads.
+  void scatter(const std::vector<int>& idents, const std::vector<T>& values) {
+    simit_uassert(values.size() == idents.size() * componentsPerElement)
+        << "expected " << componentsPerElement << " values per element";
+    checkIdents(idents, true);
+    ElementData* dst = data();
+    const T* src = values.data();
+    const int* ids = idents.data();
+    this->forBlocks(idents.size(), [=](size_t first, size_t last) {
+      for (size_t i=first; i < last; ++i) {
+        std::copy(src + i*componentsPerElement,
+                  src + (i+1)*componentsPerElement, dst[ids[i]]);
+      }
+    });
+  }
+
+  /// Set the tensor of every element to `value`.
+  void fill(const ElementData& value) {
+    ElementData* dst = data();
+    this->forBlocks(this->getNumElements(), [dst,&value](size_t first,
+                                                        size_t last) {
+      for (size_t e=first; e < last; ++e) {
+        for (int i=0; i < componentsPerElement; ++i) {
+          dst[e][i] = value[i];
+        }
+      }
+    });
+  }
+
   void set(ElementRef element, std::initializer_list<T> values) {
     simit_iassert(values.size() == (TensorRef<T,dimensions...>::getSize()))
         << "Incorrect number of init values";
@@ -867,6 +1045,39 @@ class FieldRefBaseParameterized : public FieldRefBase {
   }
 
   FieldRefBaseParameterized(void *fieldData) : FieldRefBase(fieldData) {}
+
+  int getNumElements() const {return this->fieldData->set->getSize();}
+
+ private:
+  /// Check that `idents` are idents of the set's elements, and if `distinct`
+  /// that none of them repeats.
+  void checkIdents(const std::vector<int>& idents, bool distinct) const {
+    const int numElements = this->getNumElements();
+    for (int ident : idents) {
+      simit_uassert(ident >= 0 && ident < numElements)
+          << "ident " << ident << " is out of bounds";
+    }
+    if (!distinct) {
+      return;
+    }
+
+    // The marks are kept between calls and cleared after each, so a check
+    // only touches the marks of `idents`
+    static thread_local std::vector<bool> seen;
+    if (seen.size() < (size_t)numElements) {
+      seen.resize(numElements, false);
+    }
+    size_t numDistinct = 0;
+    while (numDistinct < idents.size() && !seen[idents[numDistinct]]) {
+      seen[idents[numDistinct++]] = true;
+    }
+    for (size_t i=0; i < numDistinct; ++i) {
+      seen[idents[i]] = false;
+    }
+    if (numDistinct < idents.size()) {
+      simit_uerror << "ident " << idents[numDistinct] << " repeats";
+    }
+  }
 };
 
 template <typename T, int... dimensions>
@@ -903,6 +1114,14 @@ class FieldRef<T> : public FieldRefBaseParameterized<T> {
     (*this->getElemDataPtr(element)) = val;
   }
 
+  using FieldRefBaseParameterized<T>::fill;
+
+  /// Set every element to `value`.
+  void fill(T value) {
+    const T values[1] = {value};
+    fill(values);
+  }
+
   friend std::ostream &operator<<(std::ostream &os, const FieldRef<T> &field) {
     os << "[";
     auto it = field.fieldData->set->begin();
@@ -1073,36 +1292,65 @@ std::ostream &operator<<(std::ostream &os, const TensorRef<T, size> &t) {
 
 
 // Graph generators
+
+/// Add `num` elements to `elements`.
 void createElements(Set *elements, unsigned num);
 
+/// The vertices and edges of a box made by createBox or createTetBox. Vertex
+/// (x,y,z) is the (x*numY + y)*numZ + z'th added vertex, and edges are found
+/// arithmetically from their endpoints.
 class Box {
 public:
-  typedef std::pair<ElementRef,ElementRef> Coord;
-
-  Box(unsigned nX, unsigned nY, unsigned nZ, std::vector<ElementRef> refs,
-      std::map<Box::Coord, ElementRef> coords2edges);
+  Box(unsigned nX, unsigned nY, unsigned nZ, int firstVertex, int firstEdge);
 
   unsigned numX() const {return nX;}
   unsigned numY() const {return nY;}
   unsigned numZ() const {return nZ;}
 
-  ElementRef operator()(unsigned x, unsigned y, unsigned z) {
-    return refs[z*nY*nX + y*nX + x];
+  ElementRef operator()(unsigned x, unsigned y, unsigned z) const {
+    return ElementRef(firstVertex + ((int)x*nY + y)*nZ + z);
   }
 
+  /// The edge from `p1` to its neighbor `p2` in the positive x, y or z
+  /// direction, or an undefined element if there is none.
   ElementRef getEdge(ElementRef p1, ElementRef p2) const;
 
-  std::vector<ElementRef> getEdges();
+  size_t getNumEdges() const;
+  std::vector<ElementRef> getEdges() const;
 
 private:
   unsigned nX, nY, nZ;
-  std::vector<ElementRef> refs;
-  std::map<Coord, ElementRef> coords2edges;
+  int firstVertex;
+  int firstEdge;     // -1 if the box has no edges
 };
 
+/// Add a numX*numY*numZ grid of vertices, and the edges between neighboring
+/// vertices, to sets that may already hold elements.
 Box createBox(Set *vertices, Set *edges,
               unsigned numX, unsigned numY, unsigned numZ);
 
+/// Add a numX*numY*numZ grid of vertices and split each grid cube into six
+/// positively oriented tetrahedra. The returned box has no edges.
+Box createTetBox(Set *vertices, Set *tets,
+                 unsigned numX, unsigned numY, unsigned numZ);
+
+/// Add `num` vertices at random positions in the unit cube and edges between
+/// the vertices closer than `radius`, from the lower to the higher ident. If
+/// `positionField` is not empty the positions are stored in that field, which
+/// must have three float or double components. The graph only depends on
+/// `seed`.
+void createRandomGeometricGraph(Set *vertices, Set *edges, unsigned num,
+                                double radius,
+                                const std::string& positionField="",
+                                unsigned seed=0);
+
+/// Add 2^scale vertices and edgeFactor*2^scale edges drawn by the R-MAT
+/// model, whose degrees follow a power law (as in the Graph500 benchmark).
+/// The graph may have self edges and repeated edges, and only depends on
+/// `seed`.
+void createPowerLawGraph(Set *vertices, Set *edges, unsigned scale,
+                         unsigned edgeFactor, unsigned seed=0);
+
 } // namespace simit
 
 #endif
@@ -0,0 +1,266 @@
+#include "halo_analysis.h"
+
+#include <set>
+#include <utility>
+
+#include "inline.h"
+#include "intrinsics.h"
+#include "ir.h"
+#include "ir_queries.h"
+#include "ir_visitor.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// True if `indexVar` ranges over a set, and so over halo elements.
+static bool isSetIndexVar(const IndexVar& indexVar) {
+  const IndexDomain& domain = indexVar.getDomain();
+  return domain.getNumIndexSets() > 0 &&
+         domain.getIndexSets()[0].getKind() == IndexSet::Set;
+}
+
+/// Follows which tensors and fields have partial values on halo elements, in
+/// program order. They start out complete, since DistributedSets::run updates
+/// the halos, and become partial when they are computed from reductions over
+/// a set's neighbors, like maps over edges and matrix-vector products, or from
+/// other partial values. Loops are followed until the partial values no
+/// longer change.
+class HaloHazards : public IRVisitor {
+public:
+  string find(Func func) {
+    func.getBody().accept(this);
+    return hazard;
+  }
+
+private:
+  set<Var> partialVars;
+  set<pair<Var,string>> partialFields;
+  string hazard;
+
+  using IRVisitor::visit;
+
+  void setHazard(const string& what, Stmt stmt) {
+    if (hazard.empty()) {
+      hazard = what + ", in: " + util::toString(stmt);
+    }
+  }
+
+  size_t numPartial() const {
+    return partialVars.size() + partialFields.size();
+  }
+
+  bool isPartial(Var var) const {
+    return util::contains(partialVars, var);
+  }
+
+  bool isPartial(Var set, const string& field) const {
+    return util::contains(partialFields, {set, field});
+  }
+
+  /// True if `expr` has partial values. Index expressions whose operands are
+  /// read at other set elements than the result's are hazards if the
+  /// operands are partial, and so are reductions of a set into a global.
+  bool isPartial(Expr expr, Stmt stmt) {
+    bool partial = false;
+    match(expr,
+      function<void(const VarExpr*)>([&](const VarExpr* op) {
+        partial |= isPartial(op->var);
+      }),
+      function<void(const FieldRead*,Matcher*)>(
+          [&](const FieldRead* op, Matcher* ctx) {
+        if (isa<VarExpr>(op->elementOrSet)) {
+          partial |= isPartial(to<VarExpr>(op->elementOrSet)->var,
+                               op->fieldName);
+        }
+        else {
+          ctx->match(op->elementOrSet);
+        }
+      }),
+      function<void(const IndexExpr*,Matcher*)>(
+          [&](const IndexExpr* op, Matcher*) {
+        partial |= isPartial(op, stmt);
+      })
+    );
+    return partial;
+  }
+
+  bool isPartial(const IndexExpr* iexpr, Stmt stmt) {
+    bool setResult = false;
+    for (const IndexVar& resultVar : iexpr->resultVars) {
+      setResult |= isSetIndexVar(resultVar);
+    }
+
+    bool partial = false;
+    bool reducesSet = false;
+    match(iexpr->value,
+      function<void(const IndexedTensor*,Matcher*)>(
+          [&](const IndexedTensor* op, Matcher*) {
+        bool partialOperand = isPartial(op->tensor, stmt);
+        partial |= partialOperand;
+        for (const IndexVar& indexVar : op->indexVars) {
+          reducesSet |= indexVar.isReductionVar() && isSetIndexVar(indexVar);
+        }
+        if (partialOperand && setResult && op->indexVars.size() > 0 &&
+            isSetIndexVar(op->indexVars[0]) &&
+            op->indexVars[0] != iexpr->resultVars[0]) {
+          setHazard("reads " + util::quote(op->tensor) + " at the "
+                    "neighbors of owned elements after computing it", stmt);
+        }
+      })
+    );
+    if (reducesSet && !setResult) {
+      setHazard("reduces a set into a global", stmt);
+    }
+    return partial || reducesSet;
+  }
+
+  void visit(const AssignStmt* op) {
+    if (isPartial(op->value, op)) {
+      partialVars.insert(op->var);
+    }
+  }
+
+  void visit(const FieldWrite* op) {
+    if (isa<VarExpr>(op->elementOrSet) && isPartial(op->value, op)) {
+      partialFields.insert({to<VarExpr>(op->elementOrSet)->var,
+                            op->fieldName});
+    }
+  }
+
+  void visit(const TensorWrite* op) {
+    bool partial = isPartial(op->value, op);
+    for (const Expr& index : op->indices) {
+      partial |= isPartial(index, op);
+    }
+    if (isa<VarExpr>(op->tensor) && partial) {
+      partialVars.insert(to<VarExpr>(op->tensor)->var);
+    }
+  }
+
+  void visit(const CallStmt* op) {
+    bool partial = false;
+    for (const Expr& actual : op->actuals) {
+      if (isSystemTensorType(actual.type()) &&
+          (op->callee == intrinsics::dot() || op->callee == intrinsics::norm())) {
+        setHazard("reduces a set into a global", op);
+      }
+      else if (isSystemTensorType(actual.type())) {
+        setHazard("passes " + util::quote(actual) + ", which only has this "
+                  "rank's elements, to " + util::quote(op->callee.getName()),
+                  op);
+      }
+      partial |= isPartial(actual, op);
+    }
+    if (partial) {
+      partialVars.insert(op->results.begin(), op->results.end());
+    }
+  }
+
+  void visit(const Map* op) {
+    simit_iassert(isa<VarExpr>(op->target));
+    Var target = to<VarExpr>(op->target)->var;
+    vector<Var> neighbors;
+    for (const Expr& neighbor : op->neighbors) {
+      if (isa<VarExpr>(neighbor)) {
+        neighbors.push_back(to<VarExpr>(neighbor)->var);
+      }
+    }
+    bool readsNeighbors = op->neighbors.size() > 0 || op->through.defined();
+
+    // The fields the mapped function reads, and the ones it writes to the
+    // target element and to its neighbors
+    set<string> reads;
+    set<string> targetWrites;
+    set<string> neighborWrites;
+    for (Func func : getCallTree(op->function)) {
+      if (func.getKind() != Func::Internal) {
+        continue;
+      }
+      Var element = (func == op->function && func.getArguments().size() > 0)
+                    ? func.getArguments()[0] : Var();
+      match(func.getBody(),
+        function<void(const FieldRead*)>([&](const FieldRead* read) {
+          reads.insert(read->fieldName);
+        }),
+        function<void(const FieldWrite*)>([&](const FieldWrite* write) {
+          bool writesTarget = isa<VarExpr>(write->elementOrSet) &&
+                              to<VarExpr>(write->elementOrSet)->var == element;
+          (writesTarget ? targetWrites : neighborWrites).insert(
+              write->fieldName);
+        })
+      );
+    }
+
+    bool partial = false;
+    for (const string& field : reads) {
+      partial |= isPartial(target, field);
+      for (const Var& neighbor : neighbors) {
+        if (isPartial(neighbor, field)) {
+          partial = true;
+          if (readsNeighbors) {
+            setHazard("reads " + util::quote(neighbor.getName()+"."+field) +
+                      " at the neighbors of owned elements after computing it",
+                      op);
+          }
+        }
+      }
+    }
+    for (const Expr& actual : op->partial_actuals) {
+      bool partialActual = isPartial(actual, op);
+      partial |= partialActual;
+      if (partialActual && readsNeighbors &&
+          isSystemTensorType(actual.type())) {
+        setHazard("reads " + util::quote(actual) + " at the neighbors of "
+                  "owned elements after computing it", op);
+      }
+    }
+
+    // Reductions over the neighbors of halo elements are partial, since not
+    // all of their neighbors are local
+    for (const Var& result : op->vars) {
+      if (partial || (readsNeighbors && isSystemTensorType(result.getType()))) {
+        partialVars.insert(result);
+      }
+    }
+    for (const string& field : targetWrites) {
+      if (partial) {
+        partialFields.insert({target, field});
+      }
+    }
+    for (const string& field : neighborWrites) {
+      for (const Var& neighbor : neighbors) {
+        partialFields.insert({neighbor, field});
+      }
+    }
+  }
+
+  void visitLoopBody(Stmt body) {
+    size_t numPartialBefore;
+    do {
+      numPartialBefore = numPartial();
+      body.accept(this);
+    } while (numPartial() != numPartialBefore && hazard.empty());
+  }
+
+  void visit(const While* op) {
+    visitLoopBody(op->body);
+  }
+
+  void visit(const For* op) {
+    visitLoopBody(op->body);
+  }
+
+  void visit(const ForRange* op) {
+    visitLoopBody(op->body);
+  }
+};
+
+std::string findHaloHazard(Func func) {
+  return HaloHazards().find(inlineCalls(func));
+}
+
+}}
@@ -0,0 +1,21 @@
+#ifndef SIMIT_HALO_ANALYSIS_H
+#define SIMIT_HALO_ANALYSIS_H
+
+#include <string>
+
+#include "func.h"
+
+namespace simit {
+namespace ir {
+
+/// Returns why `func` can not be run on distributed sets that only update
+/// their halos before each run (see DistributedSets::run), as what the
+/// function does (e.g. "reduces a set into a global, in: ..."), or an empty
+/// string if it can. The values a function computes for halo elements are
+/// partial, so it must not read them at the neighbors of owned elements, and
+/// it must not reduce a whole set into a global, since that sums the halo and
+/// misses the elements of the other ranks.
+std::string findHaloHazard(Func func);
+
+}}
+#endif
@@ -1,5 +1,17 @@
 #include "init.h"
 
 namespace simit {
-bool kIndexlessStencils;
+thread_local bool kIndexlessStencils =
+    internal::getDefaultSettings().indexlessStencils;
+thread_local int kSliceHeight = internal::getDefaultSettings().sliceHeight;
+thread_local int kSliceSortWindow =
+    internal::getDefaultSettings().sliceSortWindow;
+thread_local bool kSymmetricMatrices =
+    internal::getDefaultSettings().symmetricMatrices;
+thread_local int kEdgeBlockSize = internal::getDefaultSettings().edgeBlockSize;
+thread_local bool kPullMaps = internal::getDefaultSettings().pullMaps;
+thread_local int kNumThreads = internal::getDefaultSettings().numThreads;
+thread_local bool kPinThreads = internal::getDefaultSettings().pinThreads;
+thread_local bool kVectorizationReport =
+    internal::getDefaultSettings().vectorizationReport;
 }
@@ -7,35 +7,57 @@
 #include "error.h"
 #include "ir.h"
 #include "program.h"
+#include "settings.h"
 
 namespace simit {
 
 extern const std::vector<std::string> VALID_BACKENDS;
-extern std::string kBackend;
-extern bool kIndexlessStencils;
-
-// Settings struct with default values
-struct Settings {
-  std::string backend="cpu";
-  int floatSize = 8;
-  bool indexlessStencils = false;
-};
+extern thread_local std::string kBackend;
+extern thread_local bool kIndexlessStencils;
+extern thread_local int kSliceHeight;
+extern thread_local int kSliceSortWindow;
+extern thread_local bool kSymmetricMatrices;
+extern thread_local int kEdgeBlockSize;
+extern thread_local bool kPullMaps;
+extern thread_local int kNumThreads;
+extern thread_local bool kPinThreads;
+extern thread_local bool kVectorizationReport;
 
+/// Initialize Simit. The settings apply to the calling thread and become the
+/// defaults for threads that have not yet used Simit. Programs remember the
+/// settings they were created with, and compile with them on any thread.
 inline void init(const Settings& settings) {
   // backend
   simit_uassert(std::find(VALID_BACKENDS.begin(), VALID_BACKENDS.end(),
                     settings.backend) != VALID_BACKENDS.end())
       << "Invalid backend: " << settings.backend;
-  kBackend = settings.backend;
 
   // floatSize
   simit_uassert(settings.floatSize == 4 ||
           settings.floatSize == 8)
       << "Invalid float bytes: " << settings.floatSize;
-  ir::ScalarType::floatBytes = settings.floatSize;
 
-  // indexlessStencils
-  kIndexlessStencils = settings.indexlessStencils;
+  // indexSize
+  simit_uassert(settings.indexSize == 4 ||
+          settings.indexSize == 8)
+      << "Invalid index bytes: " << settings.indexSize;
+
+  // sliceHeight and sliceSortWindow
+  simit_uassert(settings.sliceHeight >= 0)
+      << "Invalid slice height: " << settings.sliceHeight;
+  simit_uassert(settings.sliceSortWindow > 0)
+      << "Invalid slice sort window: " << settings.sliceSortWindow;
+
+  // edgeBlockSize
+  simit_uassert(settings.edgeBlockSize >= 0)
+      << "Invalid edge block size: " << settings.edgeBlockSize;
+
+  // numThreads
+  simit_uassert(settings.numThreads >= 0)
+      << "Invalid number of threads: " << settings.numThreads;
+
+  internal::setDefaultSettings(settings);
+  internal::setThreadSettings(settings);
 }
 
 inline void init(std::string backend="cpu", int floatSize=8) {
@@ -116,7 +116,7 @@ void CallRewriter::visit(const CallStmt *op) {
   }
 
   IRBuilder builder;
-  static util::NameGenerator names;
+  static thread_local util::NameGenerator names;
 
   const std::set<Var> referencedVars = getReferencedVars(op->actuals);
 
@@ -520,7 +520,9 @@ static bool isHomogeneous(const std::vector<Expr*>& endpointSets) {
 ///     end
 ///   end
 /// ~~~~~~~~~~~~~~~
-/// (Locations for matrices with the same index are only computed once.)
+/// (Locations for matrices with the same index are only computed once. Upper
+/// triangular indices only have the locations of endpoint pairs with
+/// `.eps[i] <= .eps[j]`, and assembly drops the writes to the other pairs.)
 static Stmt gatherVVLocs(TensorIndex index, const std::vector<Expr*> &endpoints,
                          const std::vector<IndexSet> &dims, Var eps,
                          std::map<TensorIndex,Var>* indexToLocs) {
@@ -544,6 +546,10 @@ static Stmt gatherVVLocs(TensorIndex index, const std::vector<Expr*> &endpoints,
   Stmt locStmt = CallStmt::make({locVar}, intrinsics::loc(),
                                 {Load::make(eps,i),Load::make(eps,j),ptr, idx});
   Stmt locsInit = Block::make({locStmt, TensorWrite::make(locs,{i,j}, locVar)});
+  if (index.isUpperTriangular()) {
+    locsInit = IfThenElse::make(Le::make(Load::make(eps,i), Load::make(eps,j)),
+                                locsInit);
+  }
 
   if (isHomogeneous(endpoints)) {
     Stmt locsInitLoop = ForRange::make(j, 0, cardinality, locsInit);
@@ -725,7 +731,8 @@ Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
       auto var = vars[i];
       simit_iassert(storage->hasStorage(var));
       auto varStorage = storage->getStorage(var);
-      if (varStorage.getKind() == TensorStorage::Indexed) {
+      if (varStorage.getKind() == TensorStorage::Indexed ||
+          varStorage.getKind() == TensorStorage::Symmetric) {
         simit_iassert(varStorage.getTensorIndex().defined());
 
         auto result = results[i];
@@ -879,7 +886,7 @@ Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
     for (auto &var : map->vars) {
       simit_iassert(var.getType().isTensor());
       Stmt init = AssignStmt::make(var, var);
-      init = initializeLhsToZero(init);
+      init = initializeLhsToIdentity(init, map->reduction);
       inlinedMap = Block::make(init, inlinedMap);
     }
   }
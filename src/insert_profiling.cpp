@@ -0,0 +1,112 @@
+#include "insert_profiling.h"
+
+#include "ir.h"
+#include "ir_rewriter.h"
+#include "intrinsics.h"
+#include "profiler.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+static string firstLine(const string& str) {
+  size_t begin = str.find_first_not_of(" \n");
+  if (begin == string::npos) {
+    return "";
+  }
+  size_t end = str.find('\n', begin);
+  return str.substr(begin, (end == string::npos) ? string::npos : end-begin);
+}
+
+class InsertProfiling : public IRRewriter {
+public:
+  InsertProfiling(const Func& function, internal::Profiler* profiler)
+      : function(function), profiler(profiler) {}
+
+protected:
+  /// The function being profiled
+  Func function;
+  internal::Profiler* profiler;
+
+  template <typename T>
+  Stmt profile(ProfileRegion::Kind kind, const T* op) {
+    int region = profiler->addRegion(kind, function.getName(),
+                                     firstLine(util::toString(*op)));
+    return Block::make({CallStmt::make({}, intrinsics::profileBegin(),{region}),
+                        op,
+                        CallStmt::make({}, intrinsics::profileEnd(), {region})});
+  }
+};
+
+Func insertMapProfiling(Func func, internal::Profiler* profiler) {
+  class InsertMapProfiling : public InsertProfiling {
+  public:
+    using InsertProfiling::InsertProfiling;
+  private:
+    using IRRewriter::visit;
+    void visit(const Map* op) {
+      stmt = profile(ProfileRegion::Map, op);
+    }
+  };
+  Stmt body = InsertMapProfiling(func, profiler).rewrite(func.getBody());
+  return (body != func.getBody()) ? Func(func, body) : func;
+}
+
+Func insertLoopProfiling(Func func, internal::Profiler* profiler) {
+  class InsertLoopProfiling : public InsertProfiling {
+  public:
+    using InsertProfiling::InsertProfiling;
+  private:
+    /// Number of enclosing (map) regions
+    int regionDepth = 0;
+
+    using IRRewriter::visit;
+
+    void visit(const CallStmt* op) {
+      if (op->callee == intrinsics::profileBegin()) {
+        ++regionDepth;
+        stmt = op;
+      }
+      else if (op->callee == intrinsics::profileEnd()) {
+        --regionDepth;
+        stmt = op;
+      }
+      else if (regionDepth == 0 && isKernelCall(op)) {
+        stmt = profile(ProfileRegion::Call, op);
+      }
+      else {
+        stmt = op;
+      }
+    }
+
+    // Loop bodies are not visited, so only outermost loops become regions
+    void visit(const ForRange* op) {
+      stmt = (regionDepth == 0) ? profile(ProfileRegion::Loop, op) : op;
+    }
+
+    void visit(const For* op) {
+      stmt = (regionDepth == 0) ? profile(ProfileRegion::Loop, op) : op;
+    }
+
+    static bool isKernelCall(const CallStmt* op) {
+      if (op->callee.getKind() == Func::External) {
+        return true;
+      }
+      if (op->callee.getKind() != Func::Intrinsic) {
+        return false;
+      }
+      for (const Expr& actual : op->actuals) {
+        if (actual.type().isTensor() && actual.type().toTensor()->order() > 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+  Stmt body = InsertLoopProfiling(func, profiler).rewrite(func.getBody());
+  return (body != func.getBody()) ? Func(func, body) : func;
+}
+
+}}
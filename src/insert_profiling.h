@@ -0,0 +1,24 @@
+#ifndef SIMIT_INSERT_PROFILING_H
+#define SIMIT_INSERT_PROFILING_H
+
+#include "func.h"
+
+namespace simit {
+namespace internal {
+class Profiler;
+}
+
+namespace ir {
+
+/// Wrap every map in profileBegin/profileEnd calls of a new profiler region.
+/// Must run before maps are lowered.
+Func insertMapProfiling(Func func, internal::Profiler* profiler);
+
+/// Wrap outermost loops and calls to external kernels (externs and intrinsics
+/// with tensor arguments, e.g. solvers) that are not already inside a map
+/// region in profileBegin/profileEnd calls. Inner loops are not instrumented,
+/// to keep the overhead of profiling per loop nest rather than per iteration.
+Func insertLoopProfiling(Func func, internal::Profiler* profiler);
+
+}}
+#endif
@@ -1,6 +1,7 @@
 #include "intrinsics.h"
 
 #include <cassert>
+#include <mutex>
 #include "var.h"
 #include "func.h"
 
@@ -8,6 +9,8 @@ namespace simit {
 namespace ir {
 namespace intrinsics {
 
+static void initIntrinsics();
+
 static Func modVar;
 void modInit() {
   modVar = Func("mod",
@@ -16,9 +19,7 @@ void modInit() {
                 Func::Intrinsic);
 }
 const Func& mod() {
-  if (!modVar.defined()) {
-    modInit();
-  }
+  initIntrinsics();
   return modVar;
 }
 
@@ -30,9 +31,7 @@ void sinInit() {
                 Func::Intrinsic);
 }
 const Func& sin() {
-  if (!sinVar.defined()) {
-    sinInit();
-  }
+  initIntrinsics();
   return sinVar;
 }
 
@@ -44,9 +43,7 @@ void cosInit() {
                 Func::Intrinsic);
 }
 const Func& cos() {
-  if (!cosVar.defined()) {
-    cosInit();
-  }
+  initIntrinsics();
   return cosVar;
 }
 
@@ -58,9 +55,7 @@ void tanInit() {
                 Func::Intrinsic);
 }
 const Func& tan() {
-  if (!tanVar.defined()) {
-    tanInit();
-  }
+  initIntrinsics();
   return tanVar;
 }
 
@@ -72,9 +67,7 @@ void asinInit() {
                  Func::Intrinsic);
 }
 const Func& asin() {
-  if (!asinVar.defined()) {
-    asinInit();
-  }
+  initIntrinsics();
   return asinVar;
 }
 
@@ -86,9 +79,7 @@ void acosInit() {
                  Func::Intrinsic);
 }
 const Func& acos() {
-  if (!acosVar.defined()) {
-    acosInit();
-  }
+  initIntrinsics();
   return acosVar;
 }
 
@@ -100,9 +91,7 @@ void atan2Init() {
                   Func::Intrinsic);
 }
 const Func& atan2() {
-  if (!atan2Var.defined()) {
-    atan2Init();
-  }
+  initIntrinsics();
   return atan2Var;
 }
 
@@ -114,9 +103,7 @@ void sqrtInit() {
                  Func::Intrinsic);
 }
 const Func& sqrt() {
-  if (!sqrtVar.defined()) {
-    sqrtInit();
-  }
+  initIntrinsics();
   return sqrtVar;
 }
 
@@ -128,9 +115,7 @@ void cbrtInit() {
                  Func::Intrinsic);
 }
 const Func& cbrt() {
-  if (!cbrtVar.defined()) {
-    cbrtInit();
-  }
+  initIntrinsics();
   return cbrtVar;
 }
 
@@ -142,9 +127,7 @@ void absInit() {
                 Func::Intrinsic);
 }
 const Func& abs() {
-  if (!absVar.defined()) {
-    absInit();
-  }
+  initIntrinsics();
   return absVar;
 }
 
@@ -156,9 +139,7 @@ void maxInit() {
                 Func::Intrinsic);
 }
 const Func& max() {
-  if (!maxVar.defined()) {
-    maxInit();
-  }
+  initIntrinsics();
   return maxVar;
 }
 
@@ -170,9 +151,7 @@ void minInit() {
                 Func::Intrinsic);
 }
 const Func& min() {
-  if (!minVar.defined()) {
-    minInit();
-  }
+  initIntrinsics();
   return minVar;
 }
 
@@ -184,9 +163,7 @@ void logInit() {
                 Func::Intrinsic);
 }
 const Func& log() {
-  if (!logVar.defined()) {
-    logInit();
-  }
+  initIntrinsics();
   return logVar;
 }
 
@@ -198,9 +175,7 @@ void expInit() {
                 Func::Intrinsic);
 }
 const Func& exp() {
-  if (!expVar.defined()) {
-    expInit();
-  }
+  initIntrinsics();
   return expVar;
 }
 
@@ -212,9 +187,7 @@ void powInit() {
                 Func::Intrinsic);
 }
 const Func& pow() {
-  if (!powVar.defined()) {
-    powInit();
-  }
+  initIntrinsics();
   return powVar;
 }
 
@@ -226,9 +199,7 @@ void createComplexInit() {
                           Func::Intrinsic);
 }
 const Func& createComplex() {
-  if (!createComplexVar.defined()) {
-    createComplexInit();
-  }
+  initIntrinsics();
   return createComplexVar;
 }
 
@@ -240,9 +211,7 @@ void complexNormInit() {
                         Func::Intrinsic);
 }
 const Func& complexNorm() {
-  if (!complexNormVar.defined()) {
-    complexNormInit();
-  }
+  initIntrinsics();
   return complexNormVar;
 }
 
@@ -254,9 +223,7 @@ void complexGetRealInit() {
                            Func::Intrinsic);
 }
 const Func& complexGetReal() {
-  if (!complexGetRealVar.defined()) {
-    complexGetRealInit();
-  }
+  initIntrinsics();
   return complexGetRealVar;
 }
 
@@ -268,9 +235,7 @@ void complexGetImagInit() {
                            Func::Intrinsic);
 }
 const Func& complexGetImag() {
-  if (!complexGetImagVar.defined()) {
-    complexGetImagInit();
-  }
+  initIntrinsics();
   return complexGetImagVar;
 }
 
@@ -282,9 +247,7 @@ void complexConjInit() {
                         Func::Intrinsic);
 }
 const Func& complexConj() {
-  if (!complexConjVar.defined()) {
-    complexConjInit();
-  }
+  initIntrinsics();
   return complexConjVar;
 }
 
@@ -296,9 +259,7 @@ void normInit() {
                  Func::Intrinsic);
 }
 const Func& norm() {
-  if (!normVar.defined()) {
-    normInit();
-  }
+  initIntrinsics();
   return normVar;
 }
 
@@ -310,9 +271,7 @@ void dotInit() {
                 Func::Intrinsic);
 }
 const Func& dot() {
-  if (!dotVar.defined()) {
-    dotInit();
-  }
+  initIntrinsics();
   return dotVar;
 }
 
@@ -325,9 +284,7 @@ void detInit() {
                 Func::Intrinsic);
 }
 const Func& det() {
-  if (!detVar.defined()) {
-    detInit();
-  }
+  initIntrinsics();
   return detVar;
 }
 
@@ -340,9 +297,7 @@ void det2Init() {
                 Func::Intrinsic);
 }
 const Func& det2() {
-  if (!det2Var.defined()) {
-    det2Init();
-  }
+  initIntrinsics();
   return det2Var;
 }
 
@@ -355,9 +310,7 @@ void det4Init() {
                 Func::Intrinsic);
 }
 const Func& det4() {
-  if (!det4Var.defined()) {
-    det4Init();
-  }
+  initIntrinsics();
   return det4Var;
 }
 
@@ -371,9 +324,7 @@ void invInit() {
                 Func::Intrinsic);
 }
 const Func& inv() {
-  if (!invVar.defined()) {
-    invInit();
-  }
+  initIntrinsics();
   return invVar;
 }
 
@@ -387,9 +338,7 @@ void inv2Init() {
                 Func::Intrinsic);
 }
 const Func& inv2() {
-  if (!inv2Var.defined()) {
-    inv2Init();
-  }
+  initIntrinsics();
   return inv2Var;
 }
 
@@ -403,9 +352,7 @@ void inv4Init() {
                 Func::Intrinsic);
 }
 const Func& inv4() {
-  if (!inv4Var.defined()) {
-    inv4Init();
-  }
+  initIntrinsics();
   return inv4Var;
 }
 
@@ -421,9 +368,7 @@ void crossInit() {
                 Func::External);
 }
 const Func& cross() {
-  if (!crossVar.defined()) {
-    crossInit();
-  }
+  initIntrinsics();
   return crossVar;
 }
 
@@ -435,9 +380,7 @@ void solveInit() {
                   Func::Intrinsic);
 }
 const Func& solve() {
-  if (!solveVar.defined()) {
-    solveInit();
-  }
+  initIntrinsics();
   return solveVar;
 }
 
@@ -449,9 +392,7 @@ void luInit() {
                  Func::External);
 }
 const Func& lu() {
-  if (!luVar.defined()) {
-    luInit();
-  }
+  initIntrinsics();
   return luVar;
 }
 
@@ -463,9 +404,7 @@ void lufreeInit() {
                      Func::External);
 }
 const Func& lufree() {
-  if (!lufreeVar.defined()) {
-    lufreeInit();
-  }
+  initIntrinsics();
   return lufreeVar;
 }
 
@@ -477,9 +416,7 @@ void lusolveInit() {
                     Func::External);
 }
 const Func& lusolve() {
-  if (!lusolveVar.defined()) {
-    lusolveInit();
-  }
+  initIntrinsics();
   return lusolveVar;
 }
 
@@ -491,9 +428,7 @@ void triangularSolveInit() {
                  Func::External);
 }
 const Func& triangularSolve() {
-  if (!triangularSolveVar.defined()) {
-    triangularSolveInit();
-  }
+  initIntrinsics();
   return triangularSolveVar;
 }
 
@@ -505,9 +440,7 @@ void lumatsolveInit() {
                        Func::External);
 }
 const Func& lumatsolve() {
-  if (!lumatsolveVar.defined()) {
-    lumatsolveInit();
-  }
+  initIntrinsics();
   return lumatsolveVar;
 }
 
@@ -519,9 +452,7 @@ void cholInit() {
                  Func::External);
 }
 const Func& chol() {
-  if (!cholVar.defined()) {
-    cholInit();
-  }
+  initIntrinsics();
   return cholVar;
 }
 
@@ -533,9 +464,7 @@ void cholfreeInit() {
                      Func::External);
 }
 const Func& cholfree() {
-  if (!cholfreeVar.defined()) {
-    cholfreeInit();
-  }
+  initIntrinsics();
   return cholfreeVar;
 }
 
@@ -547,9 +476,7 @@ void lltsolveInit() {
                  Func::External);
 }
 const Func& lltsolve() {
-  if (!lltsolveVar.defined()) {
-    lltsolveInit();
-  }
+  initIntrinsics();
   return lltsolveVar;
 }
 
@@ -561,9 +488,7 @@ void lltmatsolveInit() {
                       Func::External);
 }
 const Func& lltmatsolve() {
-  if (!lltmatsolveVar.defined()) {
-    lltmatsolveInit();
-  }
+  initIntrinsics();
   return lltmatsolveVar;
 }
 
@@ -575,9 +500,7 @@ void strcmpInit() {
                    Func::Intrinsic);
 }
 const Func& strcmp() {
-  if (!strcmpVar.defined()) {
-    strcmpInit();
-  }
+  initIntrinsics();
   return strcmpVar;
 }
 
@@ -589,9 +512,7 @@ void strlenInit() {
                    Func::Intrinsic);
 }
 const Func& strlen() {
-  if (!strlenVar.defined()) {
-    strlenInit();
-  }
+  initIntrinsics();
   return strlenVar;
 }
 
@@ -603,9 +524,7 @@ void strcpyInit() {
                    Func::Intrinsic);
 }
 const Func& strcpy() {
-  if (!strcpyVar.defined()) {
-    strcpyInit();
-  }
+  initIntrinsics();
   return strcpyVar;
 }
 
@@ -617,9 +536,7 @@ void strcatInit() {
                    Func::Intrinsic);
 }
 const Func& strcat() {
-  if (!strcatVar.defined()) {
-    strcatInit();
-  }
+  initIntrinsics();
   return strcatVar;
 }
 
@@ -631,9 +548,7 @@ void clockInit() {
                   Func::Intrinsic);
 }
 const Func& clock() {
-  if (!clockVar.defined()) {
-    clockInit();
-  }
+  initIntrinsics();
   return clockVar;
 }
 
@@ -645,12 +560,34 @@ void storeTimeInit() {
                       Func::Intrinsic);
 }
 const Func& storeTime() {
-  if (!storeTimeVar.defined()) {
-    storeTimeInit();
-  }
+  initIntrinsics();
   return storeTimeVar;
 }
 
+static Func profileBeginVar;
+void profileBeginInit() {
+  profileBeginVar = Func("__profileBegin",
+                         {Var("region", Int)},
+                         {},
+                         Func::Intrinsic);
+}
+const Func& profileBegin() {
+  initIntrinsics();
+  return profileBeginVar;
+}
+
+static Func profileEndVar;
+void profileEndInit() {
+  profileEndVar = Func("__profileEnd",
+                       {Var("region", Int)},
+                       {},
+                       Func::Intrinsic);
+}
+const Func& profileEnd() {
+  initIntrinsics();
+  return profileEndVar;
+}
+
 static Func mallocVar;
 void mallocInit() {
   mallocVar = Func("malloc",
@@ -659,9 +596,7 @@ void mallocInit() {
                    Func::Intrinsic);
 }
 const Func& malloc() {
-  if (!mallocVar.defined()) {
-    mallocInit();
-  }
+  initIntrinsics();
   return mallocVar;
 }
 
@@ -673,9 +608,7 @@ void freeInit() {
                  Func::Intrinsic);
 }
 const Func& free() {
-  if (!freeVar.defined()) {
-    freeInit();
-  }
+  initIntrinsics();
   return freeVar;
 }
 
@@ -687,16 +620,16 @@ void locInit() {
                 Func::Intrinsic);
 }
 const Func& loc() {
-  if (!locVar.defined()) {
-    locInit();
-  }
+  initIntrinsics();
   return locVar;
 }
 
 
-const std::map<std::string,Func> &byNames() {
-  static std::map<std::string,Func> byNameMap;
-  if (byNameMap.size() == 0) {
+/// Intrinsics are shared by every program, so they are built exactly once
+/// even when several threads compile concurrently.
+static void initIntrinsics() {
+  static std::once_flag initialized;
+  std::call_once(initialized, []() {
     modInit();
     sinInit();
     cosInit();
@@ -705,7 +638,7 @@ const std::map<std::string,Func> &byNames() {
     acosInit();
     atan2Init();
     sqrtInit();
-    cbrtInit();    
+    cbrtInit();
     absInit();
     maxInit();
     minInit();
@@ -742,58 +675,72 @@ const std::map<std::string,Func> &byNames() {
     strcatInit();
     clockInit();
     storeTimeInit();
+    profileBeginInit();
+    profileEndInit();
     mallocInit();
     freeInit();
     locInit();
-    byNameMap.insert({{"mod",modVar},
-                      {"sin",sinVar},
-                      {"cos",cosVar},
-                      {"tan",tanVar},
-                      {"asin",asinVar},
-                      {"acos",acosVar},
-                      {"atan2",atan2Var},
-                      {"sqrt",sqrtVar},
-                      {"cbrt",cbrtVar},
-                      {"abs",absVar},
-                      {"max",maxVar},
-                      {"min",minVar},
-                      {"log",logVar},
-                      {"exp",expVar},
-                      {"pow",powVar},
-                      {"createComplex",createComplexVar},
-                      {"complexNorm",complexNormVar},
-                      {"complexGetReal",complexGetRealVar},
-                      {"complexGetImag",complexGetImagVar},
-                      {"complexConj",complexConjVar},
-                      {"norm",normVar},
-                      {"dot",dotVar},
-                      {"det",detVar},
-                      {"det2",det2Var},
-                      {"det4",det4Var},
-                      {"inv",invVar},
-                      {"inv2",inv2Var},
-                      {"inv4",inv4Var},
-                      {"cross",crossVar},
-                      {"__solve",solveVar},
-                      {"lu", luVar},
-                      {"lufree", lufreeVar},
-                      {"lusolve", lusolveVar},
-                      {"triangularSolve", triangularSolveVar},
+  });
+}
+
+static std::map<std::string,Func> makeByNameMap() {
+  initIntrinsics();
+  std::map<std::string,Func> byNameMap;
+  byNameMap.insert({{"mod",modVar},
+                    {"sin",sinVar},
+                    {"cos",cosVar},
+                    {"tan",tanVar},
+                    {"asin",asinVar},
+                    {"acos",acosVar},
+                    {"atan2",atan2Var},
+                    {"sqrt",sqrtVar},
+                    {"cbrt",cbrtVar},
+                    {"abs",absVar},
+                    {"max",maxVar},
+                    {"min",minVar},
+                    {"log",logVar},
+                    {"exp",expVar},
+                    {"pow",powVar},
+                    {"createComplex",createComplexVar},
+                    {"complexNorm",complexNormVar},
+                    {"complexGetReal",complexGetRealVar},
+                    {"complexGetImag",complexGetImagVar},
+                    {"complexConj",complexConjVar},
+                    {"norm",normVar},
+                    {"dot",dotVar},
+                    {"det",detVar},
+                    {"det2",det2Var},
+                    {"det4",det4Var},
+                    {"inv",invVar},
+                    {"inv2",inv2Var},
+                    {"inv4",inv4Var},
+                    {"cross",crossVar},
+                    {"__solve",solveVar},
+                    {"lu", luVar},
+                    {"lufree", lufreeVar},
+                    {"lusolve", lusolveVar},
+                    {"triangularSolve", triangularSolveVar},
 					  {"lumatsolve", lumatsolveVar},
-                      {"chol", cholVar},
-                      {"cholfree", cholfreeVar},
-                      {"lltsolve", lltsolveVar},
-                      {"lltmatsolve", lltmatsolveVar},
-                      {"strcmp", strcmpVar},
-                      {"strlen", strlenVar},
-                      {"strcpy", strcpyVar},
-                      {"strcat", strcatVar},
-                      {"clock",clockVar},
-                      {"storeTime",storeTimeVar},
-                      {"malloc", mallocVar},
-                      {"free", freeVar},
-                      {"__loc", locVar}});
-  }
+                    {"chol", cholVar},
+                    {"cholfree", cholfreeVar},
+                    {"lltsolve", lltsolveVar},
+                    {"lltmatsolve", lltmatsolveVar},
+                    {"strcmp", strcmpVar},
+                    {"strlen", strlenVar},
+                    {"strcpy", strcpyVar},
+                    {"strcat", strcatVar},
+                    {"clock",clockVar},
+                    {"storeTime",storeTimeVar},
+                    {"__profileBegin",profileBeginVar},
+                    {"__profileEnd",profileEndVar},
+                    {"malloc", mallocVar},
+                    {"free", freeVar},
+                    {"__loc", locVar}});
+  return byNameMap;
+}
+
+const std::map<std::string,Func> &byNames() {
+  static const std::map<std::string,Func> byNameMap = makeByNameMap();
   return byNameMap;
 }
 
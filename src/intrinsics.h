@@ -73,6 +73,10 @@ const Func& strcat();
 const Func& clock();
 const Func& storeTime();
 
+// Profiling (enter/exit a region registered with the function's profiler)
+const Func& profileBegin();
+const Func& profileEnd();
+
 // Internal functions
 const Func& malloc();
 const Func& free();
@@ -24,7 +24,7 @@ public:
   virtual void accept(IRVisitorStrict *visitor) const = 0;
 
 private:
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
   friend void aquire(const IRNode *node) {++node->ref;}
   friend void release(const IRNode *node) {if (--node->ref == 0) delete node;}
 };
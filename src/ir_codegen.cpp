@@ -1,5 +1,6 @@
 #include "ir_codegen.h"
 
+#include <limits>
 #include <vector>
 
 #include "ir_rewriter.h"
@@ -28,6 +29,59 @@ Expr getZeroVal(const TensorType *type) {
   }
 }
 
+static Expr getIdentityVal(const ReductionOperator &rop,
+                           const TensorType *type) {
+  const ScalarType::Kind kind = type->getComponentType().kind;
+  const double infinity = std::numeric_limits<double>::infinity();
+  switch (rop.getKind()) {
+    case ReductionOperator::Sum:
+      return getZeroVal(type);
+    case ReductionOperator::User: {
+      const double_complex identity = rop.getIdentity();
+      switch (kind) {
+        case ScalarType::Int:     return Literal::make((int)identity.real);
+        case ScalarType::Float:   return Literal::make(identity.real);
+        case ScalarType::Boolean: return Literal::make(identity.real != 0.0);
+        case ScalarType::Complex: return Literal::make(identity);
+        default: break;
+      }
+      break;
+    }
+    case ReductionOperator::Product:
+      switch (kind) {
+        case ScalarType::Int:     return Literal::make(1);
+        case ScalarType::Float:   return Literal::make(1.0);
+        case ScalarType::Boolean: return Literal::make(true);
+        case ScalarType::Complex: return Literal::make(double_complex(1.0,0.0));
+        default: break;
+      }
+      break;
+    case ReductionOperator::Max:
+      switch (kind) {
+        case ScalarType::Int:
+          return Literal::make(std::numeric_limits<int>::min());
+        case ScalarType::Float:   return Literal::make(-infinity);
+        case ScalarType::Boolean: return Literal::make(false);
+        default: break;
+      }
+      break;
+    case ReductionOperator::Min:
+      switch (kind) {
+        case ScalarType::Int:
+          return Literal::make(std::numeric_limits<int>::max());
+        case ScalarType::Float:   return Literal::make(infinity);
+        case ScalarType::Boolean: return Literal::make(true);
+        default: break;
+      }
+      break;
+    case ReductionOperator::Undefined:
+      break;
+  }
+  not_supported_yet << "no " << rop.getName() << " identity for "
+                    << type->getComponentType();
+  return Expr();
+}
+
 Stmt initializeLhsToZero(Stmt stmt) {
   class ReplaceRhsWithZero : public IRRewriter {
     void visit(const AssignStmt *op) {
@@ -48,8 +102,52 @@ Stmt initializeLhsToZero(Stmt stmt) {
   return ReplaceRhsWithZero().rewrite(stmt);
 }
 
+Stmt initializeLhsToIdentity(Stmt stmt, const ReductionOperator &rop) {
+  class ReplaceRhsWithIdentity : public IRRewriter {
+  public:
+    ReplaceRhsWithIdentity(const ReductionOperator &rop) : rop(rop) {}
+
+  private:
+    ReductionOperator rop;
+
+    void visit(const AssignStmt *op) {
+      const TensorType *type = op->var.getType().toTensor();
+      Expr identity = getIdentityVal(rop, type);
+      // Only zero can be assigned to a whole tensor, so other identities are
+      // assigned to each component
+      stmt = (type->order() == 0 || to<Literal>(identity)->isAllZeros())
+          ? AssignStmt::make(op->var, identity)
+          : initializeTensorToIdentity(AssignStmt::make(op->var, op->var), rop);
+    }
+
+    void visit(const FieldWrite *op) {
+      const TensorType *type = op->value.type().toTensor();
+      Expr identity = getIdentityVal(rop, type);
+      stmt = (type->order() == 0 || to<Literal>(identity)->isAllZeros())
+          ? FieldWrite::make(op->elementOrSet, op->fieldName, identity)
+          : initializeTensorToIdentity(op, rop);
+    }
+
+    void visit(const TensorWrite *op) {
+      Expr identity = getIdentityVal(rop, op->tensor.type().toTensor());
+      stmt = TensorWrite::make(op->tensor, op->indices, identity);
+    }
+  };
+  return ReplaceRhsWithIdentity(rop).rewrite(stmt);
+}
+
 Stmt initializeTensorToZero(Stmt stmt) {
+  return initializeTensorToIdentity(stmt, ReductionOperator::Sum);
+}
+
+Stmt initializeTensorToIdentity(Stmt stmt, const ReductionOperator &rop) {
   class BuildInitLoopNest : public IRRewriter {
+  public:
+    BuildInitLoopNest(const ReductionOperator &rop) : rop(rop) {}
+
+  private:
+    ReductionOperator rop;
+
     Stmt makeLoopNest(Expr tensor) {
       const TensorType *ttype = tensor.type().toTensor();
       std::vector<Var> indices;
@@ -67,7 +165,8 @@ Stmt initializeTensorToZero(Stmt stmt) {
         stmt = makeLoopNest(TensorRead::make(tensor, indicesExpr));
       }
       else {
-        stmt = TensorWrite::make(tensor, indicesExpr, getZeroVal(ttype));
+        stmt = TensorWrite::make(tensor, indicesExpr,
+                                 getIdentityVal(rop, ttype));
       }
 
       // Wrap in current level loops
@@ -85,7 +184,76 @@ Stmt initializeTensorToZero(Stmt stmt) {
       stmt = makeLoopNest(FieldRead::make(op->elementOrSet, op->fieldName));
     }
   };
-  return BuildInitLoopNest().rewrite(stmt);
+  return BuildInitLoopNest(rop).rewrite(stmt);
+}
+
+/// Compare-and-write reductions read their value twice, so bind values that
+/// are not variables or literals to a temporary first.
+static Stmt bindReducedValue(Expr value, function<Stmt(Expr)> reduce) {
+  if (isa<VarExpr>(value) || isa<Literal>(value)) {
+    return reduce(value);
+  }
+  Var reduced(INTERNAL_PREFIX("reduced"), value.type());
+  return Block::make({VarDecl::make(reduced), AssignStmt::make(reduced, value),
+                      reduce(reduced)});
+}
+
+Stmt compoundAssign(Var var, const ReductionOperator &rop, Expr value) {
+  switch (rop.getKind()) {
+    case ReductionOperator::Sum:
+      return AssignStmt::make(var, value, CompoundOperator::Add);
+    case ReductionOperator::Product:
+      return AssignStmt::make(var, Mul::make(var, value));
+    case ReductionOperator::Max:
+      return bindReducedValue(value, [&var](Expr value) {
+        return IfThenElse::make(Gt::make(value, var),
+                                AssignStmt::make(var, value));
+      });
+    case ReductionOperator::Min:
+      return bindReducedValue(value, [&var](Expr value) {
+        return IfThenElse::make(Lt::make(value, var),
+                                AssignStmt::make(var, value));
+      });
+    case ReductionOperator::User:
+      return CallStmt::make({var}, rop.getReducer(), {var, value});
+    case ReductionOperator::Undefined:
+      return AssignStmt::make(var, value);
+  }
+  simit_unreachable;
+  return Stmt();
+}
+
+Stmt compoundTensorWrite(Expr tensor, std::vector<Expr> indices,
+                         const ReductionOperator &rop, Expr value) {
+  Expr current = TensorRead::make(tensor, indices);
+  switch (rop.getKind()) {
+    case ReductionOperator::Sum:
+      return TensorWrite::make(tensor, indices, value, CompoundOperator::Add);
+    case ReductionOperator::Product:
+      return TensorWrite::make(tensor, indices, Mul::make(current, value));
+    case ReductionOperator::Max:
+      return bindReducedValue(value, [&](Expr value) {
+        return IfThenElse::make(Gt::make(value, current),
+                                TensorWrite::make(tensor, indices, value));
+      });
+    case ReductionOperator::Min:
+      return bindReducedValue(value, [&](Expr value) {
+        return IfThenElse::make(Lt::make(value, current),
+                                TensorWrite::make(tensor, indices, value));
+      });
+    case ReductionOperator::User: {
+      // Calls write variables, so reduce the component in a temporary
+      Var reduced(INTERNAL_PREFIX("reduced"), value.type());
+      return Block::make({VarDecl::make(reduced),
+                          AssignStmt::make(reduced, current),
+                          compoundAssign(reduced, rop, value),
+                          TensorWrite::make(tensor, indices, reduced)});
+    }
+    case ReductionOperator::Undefined:
+      return TensorWrite::make(tensor, indices, value);
+  }
+  simit_unreachable;
+  return Stmt();
 }
 
 Stmt find(const Var &result, const std::vector<Expr> &exprs, string name,
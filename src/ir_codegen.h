@@ -11,9 +11,27 @@ namespace ir {
 /// Create a simple assign to scalar zero (regardless of lhs dimensions)
 Stmt initializeLhsToZero(Stmt stmt);
 
+/// Create an assign of the reduction operator's identity to lhs (e.g. zero for
+/// sum and -infinity for max). Tensors are assigned the identity with a loop
+/// nest unless it is zero.
+Stmt initializeLhsToIdentity(Stmt stmt, const ReductionOperator &rop);
+
 /// Build a loop nest to assign all components of lhs to zero
 Stmt initializeTensorToZero(Stmt stmt);
 
+/// Build a loop nest to assign all components of lhs to the reduction
+/// operator's identity.
+Stmt initializeTensorToIdentity(Stmt stmt, const ReductionOperator &rop);
+
+/// Reduce value into the scalar var using the reduction operator (e.g.
+/// `var = max(var, value)`).
+Stmt compoundAssign(Var var, const ReductionOperator &rop, Expr value);
+
+/// Reduce the scalar value into the tensor component at indices using the
+/// reduction operator.
+Stmt compoundTensorWrite(Expr tensor, std::vector<Expr> indices,
+                         const ReductionOperator &rop, Expr value);
+
 /// Compute the smallest value of the given Exprs and assign the result to var.
 Stmt min(const Var &result, const std::vector<Expr> &exprs);
 
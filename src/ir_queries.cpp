@@ -204,6 +204,37 @@ bool isBlocked(Stmt stmt) {
   return IsBlockedVisitor().check(stmt);
 }
 
+bool isMatrixVectorProduct(const IndexExpr* iexpr, bool transposed,
+                           const IndexedTensor** matrix,
+                           const IndexedTensor** vector) {
+  if (iexpr->resultVars.size() != 1 || !isa<Mul>(iexpr->value)) {
+    return false;
+  }
+  const Mul* mul = to<Mul>(iexpr->value);
+  if (!isa<IndexedTensor>(mul->a) || !isa<IndexedTensor>(mul->b)) {
+    return false;
+  }
+  const IndexedTensor* m = to<IndexedTensor>(mul->a);
+  const IndexedTensor* v = to<IndexedTensor>(mul->b);
+  if (m->indexVars.size() != 2) {
+    std::swap(m, v);
+  }
+  if (m->indexVars.size() != 2 || v->indexVars.size() != 1) {
+    return false;
+  }
+
+  const IndexVar& freeVar = m->indexVars[transposed ? 1 : 0];
+  const IndexVar& sumVar  = m->indexVars[transposed ? 0 : 1];
+  if (freeVar != iexpr->resultVars[0] || v->indexVars[0] != sumVar ||
+      !sumVar.isReductionVar() ||
+      sumVar.getOperator() != ReductionOperator::Sum) {
+    return false;
+  }
+  *matrix = m;
+  *vector = v;
+  return true;
+}
+
 std::vector<Func> getCallTree(Func func) {
   class ReverseCallGraphBuilder : public IRVisitor {
   public:
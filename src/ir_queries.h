@@ -29,6 +29,14 @@ bool isFlattened(Stmt stmt);
 /// rhs is a blocked tensor
 bool isBlocked(Stmt stmt);
 
+/// Returns true if `iexpr` is a product of a matrix and a vector, and sets
+/// `matrix` and `vector` to the operands. Products `(i A(i,+j) * x(+j))` match
+/// if `transposed` is false and `(j A(+i,j) * x(+i))` if it is true, with the
+/// operands in either order.
+bool isMatrixVectorProduct(const IndexExpr* iexpr, bool transposed,
+                           const IndexedTensor** matrix,
+                           const IndexedTensor** vector);
+
 /// Returns the call tree of `func`. The call tree constains all functions
 /// (transitively) called from `func`.
 std::vector<Func> getCallTree(Func func);
@@ -590,9 +590,18 @@ void IRRewriterCallGraph::visit(const Map *op) {
     function = visited[op->function];
   }
 
-  stmt = (function != op->function)
+  ReductionOperator reduction = op->reduction;
+  Func reducer = reduction.getReducer();
+  if (reducer.defined()) {
+    if (visited.find(reducer) == visited.end()) {
+      visited[reducer] = rewrite(reducer);
+    }
+    reduction = ReductionOperator(visited[reducer], reduction.getIdentity());
+  }
+
+  stmt = (function != op->function || reduction != op->reduction)
       ? Map::make(op->vars, function, op->partial_actuals,
-                  op->target, op->neighbors, op->through, op->reduction)
+                  op->target, op->neighbors, op->through, reduction)
       : op;
 }
 }} // namespace simit::ir
@@ -267,6 +267,12 @@ void IRVisitorCallGraph::visit(const Map *op) {
     visited.insert(op->function);
   }
 
+  const Func& reducer = op->reduction.getReducer();
+  if (reducer.defined() && visited.find(reducer) == visited.end()) {
+    reducer.accept(this);
+    visited.insert(reducer);
+  }
+
   IRVisitor::visit(op);
 }
 
@@ -0,0 +1,99 @@
+#include "edge_loops.h"
+
+#include "util/collections.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+static bool matchInt(Expr expr, int* value) {
+  if (isa<Literal>(expr) && isInt(expr.type())) {
+    *value = to<Literal>(expr)->getIntVal(0);
+    return true;
+  }
+  return false;
+}
+
+// class EdgeLoop
+bool EdgeLoop::matchBuffer(Expr expr, Buffer* buffer) const {
+  if (!expr.type().isTensor() || expr.type().toTensor()->order() != 1) {
+    return false;
+  }
+  if (isa<FieldRead>(expr) && isa<VarExpr>(to<FieldRead>(expr)->elementOrSet)
+      && to<FieldRead>(expr)->elementOrSet.type().isSet()) {
+    *buffer = {to<VarExpr>(to<FieldRead>(expr)->elementOrSet)->var,
+               to<FieldRead>(expr)->fieldName};
+  }
+  else if (isa<VarExpr>(expr) &&
+           !util::contains(declared, to<VarExpr>(expr)->var)) {
+    *buffer = {to<VarExpr>(expr)->var, ""};
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+bool EdgeLoop::matchEndpoint(Expr expr, int* k) const {
+  if (!isa<Load>(expr) || !isa<IndexRead>(to<Load>(expr)->buffer)) {
+    return false;
+  }
+  const IndexRead* indexRead = to<IndexRead>(to<Load>(expr)->buffer);
+  if (indexRead->kind != IndexRead::Endpoints ||
+      !isa<VarExpr>(indexRead->edgeSet) ||
+      to<VarExpr>(indexRead->edgeSet)->var != edgeSet) {
+    return false;
+  }
+  Expr index = to<Load>(expr)->index;
+  *k = 0;
+  if (isa<Add>(index) && matchInt(to<Add>(index)->b, k)) {
+    index = to<Add>(index)->a;
+  }
+  int stride;
+  return isa<Mul>(index) && isa<VarExpr>(to<Mul>(index)->a) &&
+         to<VarExpr>(to<Mul>(index)->a)->var == edge &&
+         matchInt(to<Mul>(index)->b, &stride) && stride == cardinality &&
+         *k >= 0 && *k < cardinality;
+}
+
+bool EdgeLoop::matchSlot(Expr buffer, Expr index, Slot* slot) const {
+  int width = buffer.type().toTensor()->getBlockType().toTensor()->size();
+  slot->second = 0;
+  if (width == 1 && matchEndpoint(index, &slot->first)) {
+    return true;
+  }
+  if (isa<Add>(index) && matchInt(to<Add>(index)->b, &slot->second)) {
+    index = to<Add>(index)->a;
+  }
+  int stride;
+  return isa<Mul>(index) && matchInt(to<Mul>(index)->b, &stride) &&
+         stride == width && matchEndpoint(to<Mul>(index)->a, &slot->first) &&
+         slot->second >= 0 && slot->second < width;
+}
+
+Expr EdgeLoop::bufferExpr(const Buffer& buffer) {
+  return buffer.second.empty()
+      ? VarExpr::make(buffer.first)
+      : FieldRead::make(VarExpr::make(buffer.first), buffer.second);
+}
+
+int EdgeLoop::bufferWidth(const Buffer& buffer) {
+  return bufferExpr(buffer).type().toTensor()->getBlockType()
+                           .toTensor()->size();
+}
+
+Expr EdgeLoop::endpoint(int k) const {
+  return Load::make(IndexRead::make(VarExpr::make(edgeSet),
+                                    IndexRead::Endpoints),
+                    Add::make(Mul::make(edge, cardinality), k));
+}
+
+Expr EdgeLoop::location(const Buffer& buffer, const Slot& slot) const {
+  int width = bufferWidth(buffer);
+  return (width == 1) ? endpoint(slot.first)
+                      : Add::make(Mul::make(endpoint(slot.first), width),
+                                  slot.second);
+}
+
+}}
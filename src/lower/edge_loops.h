@@ -0,0 +1,60 @@
+#ifndef SIMIT_EDGE_LOOPS_H
+#define SIMIT_EDGE_LOOPS_H
+
+#include <set>
+#include <string>
+#include <utility>
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// A tensor indexed by endpoints: a set field (the set and the field name) or
+/// a tensor variable (the variable and an empty name).
+typedef std::pair<Var,std::string> Buffer;
+
+/// A location `endpoint(k)*width + c` in a buffer with `width` components per
+/// element, as the pair (k,c).
+typedef std::pair<int,int> Slot;
+
+/// Matches the endpoint reads and endpoint-indexed loads and stores of the
+/// body of a flattened and unrolled loop over an edge set.
+class EdgeLoop {
+public:
+  EdgeLoop(Var edge, Var edgeSet, int cardinality)
+      : edge(edge), edgeSet(edgeSet), cardinality(cardinality) {}
+
+  /// Match a buffer that is not declared in the loop body.
+  bool matchBuffer(Expr expr, Buffer* buffer) const;
+
+  /// Match `edgeSet.endpoints[edge*cardinality + k]`.
+  bool matchEndpoint(Expr expr, int* k) const;
+
+  /// Match the location `endpoint(k)*width + c` of `buffer`, where `width` is
+  /// the number of components of the buffer's elements.
+  bool matchSlot(Expr buffer, Expr index, Slot* slot) const;
+
+  /// The buffer expression of `buffer`.
+  static Expr bufferExpr(const Buffer& buffer);
+
+  /// The number of components of the elements of `buffer`.
+  static int bufferWidth(const Buffer& buffer);
+
+  /// The endpoint `k` of the current edge.
+  Expr endpoint(int k) const;
+
+  /// The location of `slot` of `buffer` for the current edge.
+  Expr location(const Buffer& buffer, const Slot& slot) const;
+
+  Var edge;
+  Var edgeSet;
+  int cardinality;
+
+  /// Variables declared in the loop body.
+  std::set<Var> declared;
+};
+
+}}
+
+#endif
@@ -1,12 +1,15 @@
 #include "lower_index_expressions.h"
 
 #include "ir.h"
+#include "ir_queries.h"
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 
 #include "lower_indexexprs.h"
 #include "lower_scatter_workspace.h"
 #include "lower_transpose.h"
+#include "lower_sliced_matrix_vector.h"
+#include "lower_symmetric_matrix_vector.h"
 #include "lower_matrix_multiply.h"
 
 #include "path_expressions.h"
@@ -120,6 +123,64 @@ inline bool isTranspose(const IndexExpr* iexpr) {
   return true;
 }
 
+inline bool isTransposedGemv(const IndexExpr* iexpr, const Storage& storage) {
+  // Index expression form: (j A(+i,j)*x(+i)), where A is an indexed system
+  // matrix
+  const IndexedTensor* matrix;
+  const IndexedTensor* vector;
+  if (!isMatrixVectorProduct(iexpr, true, &matrix, &vector) ||
+      !isa<VarExpr>(matrix->tensor)) {
+    return false;
+  }
+  const Var& var = to<VarExpr>(matrix->tensor)->var;
+  return storage.hasStorage(var) &&
+         storage.getStorage(var).getKind() == TensorStorage::Indexed;
+}
+
+inline bool isSlicedGemv(const IndexExpr* iexpr, const Storage& storage) {
+  // Index expression form: (i A(i,+j)*x(+j)), where A's index is sliced
+  const IndexedTensor* matrix;
+  const IndexedTensor* vector;
+  if (!isMatrixVectorProduct(iexpr, false, &matrix, &vector) ||
+      !isa<VarExpr>(matrix->tensor)) {
+    return false;
+  }
+  const Var& var = to<VarExpr>(matrix->tensor)->var;
+  return storage.hasStorage(var) &&
+         storage.getStorage(var).getKind() == TensorStorage::Indexed &&
+         storage.getStorage(var).getTensorIndex().isSliced();
+}
+
+inline bool isSymmetricGemv(const IndexExpr* iexpr, const Storage& storage) {
+  // Index expression form: (i A(i,+j)*x(+j)), or (j A(+i,j)*x(+i)) since a
+  // symmetric matrix A is its own transpose
+  const IndexedTensor* matrix;
+  const IndexedTensor* vector;
+  if (!isMatrixVectorProduct(iexpr, false, &matrix, &vector) &&
+      !isMatrixVectorProduct(iexpr, true, &matrix, &vector)) {
+    return false;
+  }
+  if (!isa<VarExpr>(matrix->tensor)) {
+    return false;
+  }
+  const Var& var = to<VarExpr>(matrix->tensor)->var;
+  return storage.hasStorage(var) &&
+         storage.getStorage(var).getKind() == TensorStorage::Symmetric;
+}
+
+inline bool readsSymmetricMatrix(Expr expr, const Storage& storage) {
+  bool result = false;
+  match(expr,
+    std::function<void(const VarExpr*)>([&](const VarExpr* op) {
+      if (storage.hasStorage(op->var) &&
+          storage.getStorage(op->var).getKind() == TensorStorage::Symmetric) {
+        result = true;
+      }
+    })
+  );
+  return result;
+}
+
 inline bool isGemm(const IndexExpr* iexpr) {
   // Very specific index expression form: (i,j B(i,+k)*C(+k,j))
   // "First" matrix is defined as the one with its first index var
@@ -215,6 +276,24 @@ Func lowerIndexExpressions(Func func) {
       }
 
       const IndexExpr* iexpr = to<IndexExpr>(op->value);
+      if (isSymmetricGemv(iexpr, *storage)) {
+        stmt = lowerSymmetricMatrixVector(op, VarExpr::make(op->var), iexpr,
+                                          op->cop, storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
+      if (isTransposedGemv(iexpr, *storage)) {
+        stmt = lowerTransposedMatrixVector(op, VarExpr::make(op->var), iexpr,
+                                           op->cop, storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
+      if (isSlicedGemv(iexpr, *storage)) {
+        stmt = lowerSlicedMatrixVector(VarExpr::make(op->var), iexpr, op->cop,
+                                       storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
 
       // Dispatch the index expression lowering to the correct lowering pass.
       enum Kind {Unknown, DenseResult, MatrixScale,
@@ -249,6 +328,17 @@ Func lowerIndexExpressions(Func func) {
           << "Index expression lowering does not know how to lower: "
           << Stmt(op);
 
+      // Symmetric matrices only store their upper triangle, which elementwise
+      // operations between matrices with the same index can work on directly
+      simit_uassert(!readsSymmetricMatrix(op->value, *storage) ||
+                    ((kind == MatrixScale ||
+                      kind == MatrixElwiseWithSameStructureOrDiagonal) &&
+                     storage->getStorage(var).getKind() ==
+                     TensorStorage::Symmetric))
+          << "symmetric matrices (Settings::symmetricMatrices) can only be "
+          << "scaled, added to matrices with the same sparsity and multiplied "
+          << "with vectors, but not in: " << Stmt(op);
+
       switch (kind) {
         case DenseResult:
         case MatrixScale:
@@ -277,6 +367,34 @@ Func lowerIndexExpressions(Func func) {
         IRRewriter::visit(op);
         return;
       }
+      if (isa<IndexExpr>(op->value) &&
+          isSymmetricGemv(to<IndexExpr>(op->value), *storage)) {
+        Expr field = FieldRead::make(op->elementOrSet, op->fieldName);
+        stmt = lowerSymmetricMatrixVector(op, field, to<IndexExpr>(op->value),
+                                          op->cop, storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
+      if (isa<IndexExpr>(op->value) &&
+          isTransposedGemv(to<IndexExpr>(op->value), *storage)) {
+        Expr field = FieldRead::make(op->elementOrSet, op->fieldName);
+        stmt = lowerTransposedMatrixVector(op, field, to<IndexExpr>(op->value),
+                                           op->cop, storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
+      if (isa<IndexExpr>(op->value) &&
+          isSlicedGemv(to<IndexExpr>(op->value), *storage)) {
+        Expr field = FieldRead::make(op->elementOrSet, op->fieldName);
+        stmt = lowerSlicedMatrixVector(field, to<IndexExpr>(op->value),
+                                       op->cop, storage);
+        stmt = Comment::make(util::toString(*op), stmt, false, true);
+        return;
+      }
+      simit_uassert(!readsSymmetricMatrix(op->value, *storage))
+          << "symmetric matrices (Settings::symmetricMatrices) can only be "
+          << "multiplied with vectors in field writes, but not in: "
+          << Stmt(op);
       stmt = lowerIndexStatement(op, &environment, *storage);
 
       if (isa<IndexExpr>(op->value)) {
@@ -289,6 +407,9 @@ Func lowerIndexExpressions(Func func) {
         IRRewriter::visit(op);
         return;
       }
+      simit_uassert(!readsSymmetricMatrix(op->value, *storage))
+          << "symmetric matrices (Settings::symmetricMatrices) cannot be "
+          << "read in tensor writes: " << Stmt(op);
       stmt = lowerIndexStatement(op, &environment, *storage);
       if (isa<IndexExpr>(op->value)) {
         stmt = Comment::make(util::toString(*op), stmt, false, true);
@@ -237,18 +237,6 @@ Stmt reduce(Stmt loopNest, Stmt kernel, ReductionOperator reductionOperator) {
       return GetReductionTmpNameVisitor().get(stmt);
     }
 
-    static Stmt compoundAssign(Var var, ReductionOperator op, Expr value) {
-      switch (op.getKind()) {
-        case ReductionOperator::Sum:
-          return AssignStmt::make(var, value, CompoundOperator::Add);
-        case ReductionOperator::Undefined:
-          simit_ierror;
-          return Stmt();
-      }
-      simit_unreachable;
-      return Stmt();
-    }
-
     void visit(const AssignStmt *op) {
       if (op == rstmt) {
         ScalarType ctype = op->var.getType().toTensor()->getComponentType();
@@ -274,9 +262,9 @@ Stmt reduce(Stmt loopNest, Stmt kernel, ReductionOperator reductionOperator) {
         stmt = compoundAssign(reductionVar, rop, op->value);
 
         if (isa<TensorRead>(op->tensor)) {
-          reductionVarWriteBackStmt = TensorWrite::make(op->tensor, op->indices,
-                                                        reductionVar,
-                                                        CompoundOperator::Add);
+          reductionVarWriteBackStmt = compoundTensorWrite(op->tensor,
+                                                          op->indices, rop,
+                                                          reductionVar);
         }
         else {
           reductionVarWriteBackStmt = TensorWrite::make(op->tensor, op->indices,
@@ -315,8 +303,9 @@ Stmt reduce(Stmt loopNest, Stmt kernel, ReductionOperator reductionOperator) {
 
   Type rvarType = rvar.getType();
   Stmt rvarDecl = VarDecl::make(rvar);
-  Stmt rvarInitZero = initializeLhsToZero(AssignStmt::make(rvar,rvar));
-  Stmt rvarInit = Block::make(rvarDecl, rvarInitZero);
+  Stmt rvarInitIdentity = initializeLhsToIdentity(AssignStmt::make(rvar,rvar),
+                                                   reductionOperator);
+  Stmt rvarInit = Block::make(rvarDecl, rvarInitIdentity);
 
   loopNest = Block::make(rvarInit, loopNest);
 
@@ -381,7 +370,8 @@ TensorIndex getTensorIndexOfStatement(Stmt stmt, const Storage& storage,
       if (type.isTensor() && type.toTensor()->order() == 2) {
         simit_iassert(storage.hasStorage(var));
         const TensorStorage& tensorStorage = storage.getStorage(var);
-        if (tensorStorage.getKind() == TensorStorage::Kind::Indexed) {
+        if (tensorStorage.getKind() == TensorStorage::Kind::Indexed ||
+            tensorStorage.getKind() == TensorStorage::Kind::Symmetric) {
           simit_iassert(tensorStorage.hasTensorIndex());
           tensorIndex = tensorStorage.getTensorIndex();
         }
@@ -588,8 +578,10 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
   Stmt kernel = specialize(stmt, loopVars);
 
   // Create loops (since we create the loops inside out, we must iterate over
-  // the loop vars in reverse order)
+  // the loop vars in reverse order). The result is initialized to the identity
+  // of the outermost reduction.
   Stmt loopNest = kernel;
+  ReductionOperator reduction = ReductionOperator::Sum;
   
   // HACK: Extract loop vars corresponding to grid loops
   map<Var, const LoopVar*> gridLoopVars;
@@ -724,7 +716,8 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
     }
 
     if (loopVar->hasReduction()) {
-      loopNest = reduce(loopNest, kernel, loopVar->getReductionOperator());
+      reduction = loopVar->getReductionOperator();
+      loopNest = reduce(loopNest, kernel, reduction);
     }
   }
 
@@ -741,13 +734,19 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
       (to<FieldWrite>(stmt)->cop != CompoundOperator::None));
   bool isVarSparse = (isa<AssignStmt>(stmt) && 
                       (storage.hasStorage(to<AssignStmt>(stmt)->var) &&
-                       storage.getStorage(to<AssignStmt>(stmt)->var).getKind()
-                       == TensorStorage::Indexed));
-  if (isResultScalar || isVarSparse) {
+                       (storage.getStorage(to<AssignStmt>(stmt)->var).getKind()
+                        == TensorStorage::Indexed ||
+                        storage.getStorage(to<AssignStmt>(stmt)->var).getKind()
+                        == TensorStorage::Symmetric)));
+  if (isResultScalar) {
+    loopNest = Block::make(initializeLhsToIdentity(stmt, reduction), loopNest);
+  }
+  else if (isVarSparse) {
     loopNest = Block::make(initializeLhsToZero(stmt), loopNest);
   }
   else if (sig.isSparse() && !isCompoundAssign) {
-    loopNest = Block::make(initializeTensorToZero(stmt), loopNest);
+    loopNest = Block::make(initializeTensorToIdentity(stmt, reduction),
+                           loopNest);
   }
 
   return loopNest;
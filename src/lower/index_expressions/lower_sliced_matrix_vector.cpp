@@ -0,0 +1,76 @@
+#include "lower_sliced_matrix_vector.h"
+
+#include "ir_queries.h"
+#include "storage.h"
+#include "tensor_index.h"
+
+namespace simit {
+namespace ir {
+
+Stmt lowerSlicedMatrixVector(Expr target, const IndexExpr* iexpr,
+                             CompoundOperator cop, Storage* storage) {
+  const IndexedTensor* matrix = nullptr;
+  const IndexedTensor* vector = nullptr;
+  isMatrixVectorProduct(iexpr, false, &matrix, &vector);
+  simit_iassert(matrix != nullptr && isa<VarExpr>(matrix->tensor));
+
+  Var source = to<VarExpr>(matrix->tensor)->var;
+  const TensorIndex& index = storage->getStorage(source).getTensorIndex();
+  simit_iassert(index.isSliced());
+
+  const TensorType* sourceType = source.getType().toTensor();
+  simit_iassert(isScalar(sourceType->getBlockType()));
+  Expr numRows = Length::make(sourceType->getOuterDimensions()[0]);
+  int sliceHeight = index.getSliceHeight();
+
+  // Each slice's rows are accumulated in a workspace of sliceHeight values
+  Var sums(INTERNAL_PREFIX("sliceSums"),
+           TensorType::make(sourceType->getComponentType(),
+                            {IndexDomain(sliceHeight)}));
+  storage->add(sums, TensorStorage::Dense);
+
+  Var s("s", Int);
+  Var k("k", Int);
+  Var r("r", Int);
+  Var start("start", Int);
+  Var width("width", Int);
+  Expr position = s*sliceHeight + r;
+  Expr slot = start + k*sliceHeight + r;
+
+  Expr zero = Literal::make(TensorType::make(sourceType->getComponentType()));
+  Stmt clearSums = ForRange::make(r, 0, sliceHeight,
+                                  Store::make(sums, r, zero));
+
+  Expr sliceptr = VarExpr::make(index.getSliceptrArray());
+  Stmt initStart = AssignStmt::make(start, Load::make(sliceptr, s));
+  Stmt initWidth = AssignStmt::make(width, (Load::make(sliceptr, s+1) - start)
+                                           / sliceHeight);
+
+  // Padded locations past a row's length are masked
+  Expr value = Load::make(matrix->tensor,
+                          Load::make(index.getSlicedLocArray(), slot));
+  Expr x = Load::make(vector->tensor,
+                      Load::make(index.getSlicedColidxArray(), slot));
+  Stmt accumulate =
+      IfThenElse::make(Lt::make(k, Load::make(index.getLengthArray(),
+                                              position)),
+                       Store::make(sums, r, Mul::make(value, x),
+                                   CompoundOperator::Add));
+  Stmt multiply = ForRange::make(k, 0, width,
+                                 ForRange::make(r, 0, sliceHeight, accumulate));
+
+  // Write the sums to their rows, skipping the padding rows of the last slice
+  Expr row = Load::make(index.getPermutationArray(), position);
+  Stmt write = IfThenElse::make(Lt::make(position, numRows),
+                                Store::make(target, row, Load::make(sums, r),
+                                            cop));
+  Stmt writeSums = ForRange::make(r, 0, sliceHeight, write);
+
+  Expr numSlices = (numRows + (sliceHeight-1)) / sliceHeight;
+  Stmt sliceLoop = ForRange::make(s, 0, numSlices,
+                                  Block::make({clearSums, initStart, initWidth,
+                                               multiply, writeSums}));
+  return Block::make(VarDecl::make(sums), sliceLoop);
+}
+
+}}
@@ -0,0 +1,19 @@
+#ifndef SIMIT_LOWER_SLICED_MATRIX_VECTOR_H
+#define SIMIT_LOWER_SLICED_MATRIX_VECTOR_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Lower a matrix-vector product `target = A*x`, given as the index
+/// expression `(i A(i,+j) * x(+j))`, where A's tensor index is sliced (see
+/// TensorIndex::setSliced). The loop nest multiplies each slice one padded
+/// column at a time, accumulating the slice's rows in a workspace that is
+/// then written to the rows' (permuted) locations in the target. The loop over
+/// the rows of a slice is innermost and unit stride, so it can be vectorized.
+Stmt lowerSlicedMatrixVector(Expr target, const IndexExpr* indexExpression,
+                             CompoundOperator cop, Storage* storage);
+
+}}
+#endif
@@ -0,0 +1,89 @@
+#include "lower_symmetric_matrix_vector.h"
+
+#include "ir_codegen.h"
+#include "ir_queries.h"
+#include "storage.h"
+#include "tensor_index.h"
+
+namespace simit {
+namespace ir {
+
+Stmt lowerSymmetricMatrixVector(Stmt stmt, Expr target,
+                                const IndexExpr* iexpr, CompoundOperator cop,
+                                Storage* storage) {
+  const IndexedTensor* matrix = nullptr;
+  const IndexedTensor* vector = nullptr;
+  if (!isMatrixVectorProduct(iexpr, false, &matrix, &vector)) {
+    isMatrixVectorProduct(iexpr, true, &matrix, &vector);
+  }
+  simit_iassert(matrix != nullptr && isa<VarExpr>(matrix->tensor));
+
+  Var source = to<VarExpr>(matrix->tensor)->var;
+  const TensorIndex& index = storage->getStorage(source).getTensorIndex();
+  simit_iassert(index.isUpperTriangular());
+
+  auto sourceType = source.getType().toTensor();
+  auto iRange   = sourceType->getOuterDimensions()[0];
+
+  Var  i("i",  Int);
+  Var ij("ij", Int);
+  Var  j("j",  Int);
+
+  CompoundOperator accumulate = (cop == CompoundOperator::Sub)
+                                ? CompoundOperator::Sub
+                                : CompoundOperator::Add;
+
+  // Block (i,j) contributes to row i, and its transpose, block (j,i), to row
+  // j unless the block is on the diagonal
+  Stmt diagonalBody;
+  Stmt body;
+  auto blockType = *sourceType->getBlockType().toTensor();
+  if (blockType.order() == 0) {  // Not blocked
+    Expr value = Load::make(matrix->tensor, ij);
+    Stmt upper = Store::make(target, i,
+                             Mul::make(value, Load::make(vector->tensor, j)),
+                             accumulate);
+    Stmt lower = Store::make(target, j,
+                             Mul::make(value, Load::make(vector->tensor, i)),
+                             accumulate);
+    diagonalBody = upper;
+    body = Block::make(upper, lower);
+  }
+  else {  // Blocked
+    simit_iassert(blockType.order() == 2);
+    Var ii("ii", Int);
+    Var jj("jj", Int);
+    auto d = blockType.getOuterDimensions()[0];
+    Expr l = Length::make(d);
+
+    Expr value = Load::make(matrix->tensor, ij*l*l + ii*l + jj);
+    Stmt upper = Store::make(target, i*l + ii,
+                             Mul::make(value,
+                                       Load::make(vector->tensor, j*l + jj)),
+                             accumulate);
+    Stmt lower = Store::make(target, j*l + jj,
+                             Mul::make(value,
+                                       Load::make(vector->tensor, i*l + ii)),
+                             accumulate);
+    diagonalBody = For::make(ii, ForDomain(d), For::make(jj, ForDomain(d),
+                                                         upper));
+    body = For::make(ii, ForDomain(d), For::make(jj, ForDomain(d),
+                                                 Block::make(upper, lower)));
+  }
+  simit_iassert(body.defined());
+
+  Stmt sinkStmt = AssignStmt::make(j, Load::make(index.getColidxArray(), ij));
+  Stmt blockStmt = IfThenElse::make(Eq::make(i, j), diagonalBody, body);
+  Expr start = Load::make(index.getRowptrArray(), i);
+  Expr stop  = Load::make(index.getRowptrArray(), i+1);
+  Stmt innerLoop  = ForRange::make(ij, start, stop,
+                                   Block::make(sinkStmt, blockStmt));
+  Stmt loopNest = For::make(i, iRange, innerLoop);
+
+  if (cop == CompoundOperator::None) {
+    loopNest = Block::make(initializeLhsToZero(stmt), loopNest);
+  }
+  return loopNest;
+}
+
+}}
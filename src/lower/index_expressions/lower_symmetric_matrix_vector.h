@@ -0,0 +1,22 @@
+#ifndef SIMIT_LOWER_SYMMETRIC_MATRIX_VECTOR_H
+#define SIMIT_LOWER_SYMMETRIC_MATRIX_VECTOR_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Lower a matrix-vector product `target = A*x`, given as the index
+/// expression `(i A(i,+j) * x(+j))`, or `(j A(+i,j) * x(+i))` since A equals
+/// its transpose, where A is a symmetric matrix (see TensorStorage::Symmetric).
+/// The loop nest streams the stored upper block triangle once, and applies
+/// each off-diagonal block to both halves of the product
+/// (`target[i] += A[ij]*x[j]` and `target[j] += A[ij]'*x[i]`). Compound
+/// assignments add to (or subtract from) the target instead of first clearing
+/// it.
+Stmt lowerSymmetricMatrixVector(Stmt stmt, Expr target,
+                                const IndexExpr* indexExpression,
+                                CompoundOperator cop, Storage* storage);
+
+}}
+#endif
@@ -3,6 +3,8 @@
 #include "storage.h"
 #include "tensor_index.h"
 #include "intrinsics.h"
+#include "ir_codegen.h"
+#include "ir_queries.h"
 
 namespace simit {
 namespace ir {
@@ -55,5 +57,69 @@ Stmt lowerTranspose(Var target, const IndexExpr* iexpr,
   Stmt innerLoop  = ForRange::make(ij, start, stop, Block::make(locStmt, body));
   return For::make(i, iRange, innerLoop);
 }
+
+Stmt lowerTransposedMatrixVector(Stmt stmt, Expr target,
+                                 const IndexExpr* iexpr, CompoundOperator cop,
+                                 Storage* storage) {
+  const IndexedTensor* matrix = nullptr;
+  const IndexedTensor* vector = nullptr;
+  isMatrixVectorProduct(iexpr, true, &matrix, &vector);
+  simit_iassert(matrix != nullptr && isa<VarExpr>(matrix->tensor));
+
+  Var source = to<VarExpr>(matrix->tensor)->var;
+  auto sourceIndex = storage->getStorage(source).getTensorIndex();
+
+  auto sourceType = source.getType().toTensor();
+  auto iRange   = sourceType->getOuterDimensions()[0];
+
+  Var  i("i",  Int);
+  Var ij("ij", Int);
+  Var  j("j",  Int);
+
+  CompoundOperator accumulate = (cop == CompoundOperator::Sub)
+                                ? CompoundOperator::Sub
+                                : CompoundOperator::Add;
+  Stmt body;
+  auto blockType = *sourceType->getBlockType().toTensor();
+  if (blockType.order() == 0) {  // Not blocked
+    body = Store::make(target, j,
+                       Mul::make(Load::make(matrix->tensor, ij),
+                                 Load::make(vector->tensor, i)),
+                       accumulate);
+  }
+  else {  // Blocked
+    simit_iassert(blockType.order() == 2);
+    Var ii("ii", Int);
+    Var jj("jj", Int);
+    auto d1 = blockType.getOuterDimensions()[0];
+    auto d2 = blockType.getOuterDimensions()[1];
+    Expr l1 = Length::make(d1);
+    Expr l2 = Length::make(d2);
+
+    // Block (i,j) of A is block (j,i) of A' transposed
+    body = Store::make(target, j*l2 + jj,
+                       Mul::make(Load::make(matrix->tensor,
+                                            ij*l1*l2 + ii*l2 + jj),
+                                 Load::make(vector->tensor, i*l1 + ii)),
+                       accumulate);
+
+    body = For::make(jj, ForDomain(d2), body);
+    body = For::make(ii, ForDomain(d1), body);
+  }
+  simit_iassert(body.defined());
+
+  Stmt sinkStmt = AssignStmt::make(j, Load::make(sourceIndex.getColidxArray(),
+                                                 ij));
+  Expr start = Load::make(sourceIndex.getRowptrArray(), i);
+  Expr stop  = Load::make(sourceIndex.getRowptrArray(), i+1);
+  Stmt innerLoop  = ForRange::make(ij, start, stop,
+                                   Block::make(sinkStmt, body));
+  Stmt loopNest = For::make(i, iRange, innerLoop);
+
+  if (cop == CompoundOperator::None) {
+    loopNest = Block::make(initializeLhsToZero(stmt), loopNest);
+  }
+  return loopNest;
+}
     
 }}
@@ -8,6 +8,16 @@ namespace ir {
 
 Stmt lowerTranspose(Var target, const IndexExpr* indexExpression,
                     Environment* env, Storage* storage);
+
+/// Lower a transposed matrix-vector product `target = A'*x`, given as the
+/// index expression `(j A(+i,j) * x(+i))`, to a loop nest that streams the
+/// rows of A's own index and scatters each non-zero block's contribution into
+/// the target (`target[j] += A[ij]' * x[i]`). A transposed copy of A is
+/// therefore never assembled. Compound assignments add to (or subtract from)
+/// the target instead of first clearing it.
+Stmt lowerTransposedMatrixVector(Stmt stmt, Expr target,
+                                 const IndexExpr* indexExpression,
+                                 CompoundOperator cop, Storage* storage);
     
 }}
 #endif
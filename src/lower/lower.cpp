@@ -11,10 +11,13 @@
 #include "lower_string_ops.h"
 #include "lower_stencil_assemblies.h"
 #include "lower_unroll.h"
+#include "lower_edge_blocks.h"
+#include "lower_pull_maps.h"
+#include "pass_manager.h"
 
 #include "inline.h"
 #include "storage.h"
-#include "timers.h"
+#include "insert_profiling.h"
 #include "temps.h"
 #include "flatten.h"
 #include "insert_frees.h"
@@ -30,171 +33,165 @@
 using namespace std;
 
 namespace simit {
-extern std::string kBackend;
+extern thread_local std::string kBackend;
+extern thread_local int kEdgeBlockSize;
+extern thread_local bool kPullMaps;
 
 namespace ir {
 
-static
-Func rewriteCallGraph(const Func& func, const function<Func(Func)>& rewriter) {
-  class Rewriter : public simit::ir::IRRewriterCallGraph {
-  public:
-    Rewriter(const function<Func(Func)>& rewriter) : rewriter(rewriter) {}
-    const function<Func(Func)>& rewriter;
-
-    using IRRewriter::visit;
-    void visit(const simit::ir::Func *op) {
-      if (op->getKind() != simit::ir::Func::Internal) {
-        func = *op;
-        return;
-      }
-      func = simit::ir::Func(*op, rewrite(op->getBody()));
-      func = rewriter(func);
+// class LowerCache
+Func LowerCache::get(unsigned pass, const Func& func,
+                     const std::function<Func()>& rewrite) {
+  std::promise<Func> promise;
+  std::shared_future<Func> result;
+  bool lowerHere = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lowered.find({pass, func});
+    if (it == lowered.end()) {
+      result = promise.get_future().share();
+      lowered.insert({{pass, func}, result});
+      lowerHere = true;
     }
-  };
-  return Rewriter(rewriter).rewrite(func);
-}
-
-void visitCallGraph(Func func, const function<void(Func)>& visitRule) {
-  class Visitor : public simit::ir::IRVisitorCallGraph {
-  public:
-    Visitor(const function<void(Func)>& visitRule) : visitRule(visitRule) {}
-    const function<void(Func)>& visitRule;
-
-    using simit::ir::IRVisitor::visit;
-    void visit(const simit::ir::Func *op) {
-      if (op->getKind() != simit::ir::Func::Internal) {
-        return;
-      }
-      simit::ir::IRVisitorCallGraph::visit(op);
-      visitRule(*op);
+    else {
+      result = it->second;
     }
-  };
-  Visitor visitor(visitRule);
-  func.accept(&visitor);
-}
-
-static inline
-void printTimedCallGraph(string headerText, Func func, ostream* os) {
-  stringstream ss;
-  simit::ir::IRPrinterCallGraph(ss).print(func);
-  TimerStorage::getInstance().addSourceLines(ss);
-  if (os) {
-    *os << ss.rdbuf();
   }
-}
 
-static inline
-void printCallGraph(string headerText, Func func, ostream* os) {
-  if (os) {
-    *os << "%% " << headerText << endl;
-    simit::ir::IRPrinterCallGraph(*os).print(func);
-    *os << endl;
+  // Simit call graphs are acyclic, so waiting for callees that are lowered by
+  // other threads cannot deadlock.
+  if (!lowerHere) {
+    return result.get();
+  }
+  try {
+    promise.set_value(rewrite());
   }
+  catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+  return result.get();
 }
 
-Func lower(Func func, std::ostream* os, bool time) {
+Func lower(Func func, std::ostream* os, internal::Profiler* profiler,
+           LowerCache* cache, const PassOptions* options) {
+  PassManager passes;
+
 #ifdef GPU
   // Rewrite system assignments
   if (kBackend == "gpu") {
-    func = rewriteCallGraph(func, rewriteSystemAssigns);
-    printCallGraph("Rewrite System Assigns (GPU)", func, os);
+    passes.add("rewrite-system-assigns", "Rewrite System Assigns (GPU)",
+               rewriteSystemAssigns);
   }
 #endif
 
   // Inline function calls
-  func = rewriteCallGraph(func, inlineCalls);
-  printCallGraph("Inline Function Calls", func, os);
+  passes.add("inline-calls", "Inline Function Calls", inlineCalls);
 
   // Flatten index expressions and insert temporaries
-  func = rewriteCallGraph(func, (Func(*)(Func))flattenIndexExpressions);
-  func = rewriteCallGraph(func, insertTemporaries);
-  printCallGraph("Insert Temporaries and Flatten Index Expressions", func, os);
+  passes.add("flatten-index-expressions", "",
+             (Func(*)(Func))flattenIndexExpressions);
+  passes.add("insert-temporaries",
+             "Insert Temporaries and Flatten Index Expressions",
+             insertTemporaries);
 
   // Determine Storage
-  func = rewriteCallGraph(func, [](Func func) -> Func {
+  passes.add("update-storage", [](Func func) -> Func {
     updateStorage(func, &func.getStorage(), &func.getEnvironment());
     return func;
-  });
-  if (os) {
-    *os << "%% Tensor storage" << endl;
-    visitCallGraph(func, [os](Func func) {
-      *os << "func " << func.getName() << ":" << endl;
+  }, [](Func func, std::ostream& os) {
+    os << "%% Tensor storage" << endl;
+    visitCallGraph(func, [&os](Func func) {
+      os << "func " << func.getName() << ":" << endl;
       for (auto &var : func.getStorage()) {
-        *os << "  " << var <<" : "<< func.getStorage().getStorage(var) << endl;
+        os << "  " << var <<" : "<< func.getStorage().getStorage(var) << endl;
       }
-      *os << endl;
+      os << endl;
     });
-    *os << endl;
-  }
+    os << endl;
+  });
 
-  func = rewriteCallGraph(func, insertFrees);
-  printCallGraph("Insert Frees", func, os);
+  passes.add("insert-frees", "Insert Frees", insertFrees);
 
-  func = rewriteCallGraph(func, lowerStringOps);
-  func = rewriteCallGraph(func, lowerPrints);
-  printCallGraph("Lower String Operations and Prints", func, os);
+  passes.add("lower-string-ops", "", lowerStringOps);
+  passes.add("lower-prints", "Lower String Operations and Prints",
+             lowerPrints);
 
   // Lower field accesses
-  func = rewriteCallGraph(func, lowerFieldAccesses);
-  printCallGraph("Lower Field Accesses", func, os);
+  passes.add("lower-field-accesses", "Lower Field Accesses",
+             lowerFieldAccesses);
 
   // Lower stencil assemblies
-  func = rewriteCallGraph(func, lowerStencilAssemblies);
-  printCallGraph("Normalize Row Indices", func, os);
+  passes.add("lower-stencil-assemblies", "Normalize Row Indices",
+             lowerStencilAssemblies);
+
+  // Profile maps
+  if (profiler) {
+    simit_uassert(kBackend != "gpu") << "The GPU backend does not support "
+                                     << "profiling";
+    passes.add("insert-map-profiling", "Insert Map Profiling",
+               [profiler](Func func) -> Func {
+      return insertMapProfiling(func, profiler);
+    });
+  }
 
   // Lower maps
-  func = rewriteCallGraph(func, lowerMaps);
-  printCallGraph("Lower Maps", func, os);
+  passes.add("lower-maps", "Lower Maps", lowerMaps);
 
 #ifdef GPU
   // GPU backend wants memsets as loops over set domains
   if (kBackend == "gpu") {
-    func = rewriteCallGraph(func, rewriteMemsets);
-    printCallGraph("Rewrite Memsets (GPU)", func, os);
+    passes.add("rewrite-memsets", "Rewrite Memsets (GPU)", rewriteMemsets);
   }
 #endif
 
   // Lower Index Expressions
-  func = rewriteCallGraph(func, lowerIndexExpressions);
-  printCallGraph("Lower Index Expressions", func, os);
+  passes.add("lower-index-expressions", "Lower Index Expressions",
+             lowerIndexExpressions);
 
   // Lower Tensor Reads and Writes
-  func = rewriteCallGraph(func, lowerTensorAccesses);
-  printCallGraph("Lower Tensor Reads and Writes", func, os);
-
-  // Insert timers
-  if (time) {
-    printTimedCallGraph("Insert Timers", func, os);
-    func = rewriteCallGraph(func, insertTimers);
-    printCallGraph("Insert Timers", func, os);
+  passes.add("lower-tensor-accesses", "Lower Tensor Reads and Writes",
+             lowerTensorAccesses);
+
+  // Profile loops and kernel calls
+  if (profiler) {
+    passes.add("insert-loop-profiling", "Insert Loop Profiling",
+               [profiler](Func func) -> Func {
+      return insertLoopProfiling(func, profiler);
+    });
   }
 
-  // Unroll Loops
-  func = rewriteCallGraph(func, lowerUnroll);
-  printCallGraph("Loops Unrolling", func, os);
-  func = rewriteCallGraph(func, lowerUnroll);
-  printCallGraph("Loops Unrolling", func, os);
-  func = rewriteCallGraph(func, lowerUnroll);
-  printCallGraph("Loops Unrolling", func, os);
+  // Unroll Loops, three times so that loops exposed by unrolling are unrolled
+  passes.add("unroll-1", "Loops Unrolling", lowerUnroll);
+  passes.add("unroll-2", "Loops Unrolling", lowerUnroll);
+  passes.add("unroll-3", "Loops Unrolling", lowerUnroll);
+
+  // Pull the results of edge loops to their vertices
+  if (kPullMaps && kBackend == "cpu") {
+    passes.add("lower-pull-maps", "Lower Pull Maps", lowerPullMaps);
+  }
+
+  // Gather and scatter the endpoints of edge loops in blocks
+  if (kEdgeBlockSize > 0 && kBackend == "cpu") {
+    passes.add("lower-edge-blocks", "Lower Edge Blocks", [](Func func) -> Func {
+      return lowerEdgeBlocks(func, kEdgeBlockSize);
+    });
+  }
 
   // Lower to GPU Kernels
 #if GPU
   if (kBackend == "gpu") {
-    func = rewriteCallGraph(func, rewriteCompoundOps);
-    printCallGraph("Rewrite Compound Ops (GPU)", func, os);
-    func = rewriteCallGraph(func, shardLoops);
-    printCallGraph("Shard Loops", func, os);
-    func = rewriteCallGraph(func, rewriteVarDecls);
-    printCallGraph("Rewritten Var Decls", func, os);
-    func = rewriteCallGraph(func, localizeTemps);
-    printCallGraph("Localize Temps", func, os);
-    func = rewriteCallGraph(func, kernelRWAnalysis);
-    printCallGraph("Kernel RW Analysis", func, os);
-    func = rewriteCallGraph(func, fuseKernels);
-    printCallGraph("Fuse Kernels", func, os);
+    passes.add("rewrite-compound-ops", "Rewrite Compound Ops (GPU)",
+               rewriteCompoundOps);
+    passes.add("shard-loops", "Shard Loops", shardLoops);
+    passes.add("rewrite-var-decls", "Rewritten Var Decls", rewriteVarDecls);
+    passes.add("localize-temps", "Localize Temps", localizeTemps);
+    passes.add("kernel-rw-analysis", "Kernel RW Analysis", kernelRWAnalysis);
+    passes.add("fuse-kernels", "Fuse Kernels", fuseKernels);
   }
 #endif
-  return func;
+
+  return passes.run(func, (options != nullptr) ? *options : PassOptions(), os,
+                    cache);
 }
 
 }}
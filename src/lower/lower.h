@@ -1,15 +1,48 @@
 #ifndef SIMIT_LOWER_H
 #define SIMIT_LOWER_H
 
+#include <map>
+#include <mutex>
+#include <future>
+#include <utility>
+#include <functional>
+
 #include "ir.h"
 
 namespace simit {
+namespace internal {
+class Profiler;
+}
+
 namespace ir {
+struct PassOptions;
+
+/// Functions lowered by several calls to lower, which may run concurrently.
+/// Internal functions that are in the call graph of more than one lowered
+/// function (e.g. a function applied by several exported functions) are then
+/// lowered once, and the lowered function is shared.
+class LowerCache {
+public:
+  /// Returns the result of lowering pass `pass` on `func`, computing it with
+  /// `rewrite` if no other caller has. Callers that ask for a function that is
+  /// being lowered on another thread wait for it.
+  Func get(unsigned pass, const Func& func, const std::function<Func()>& rewrite);
+
+private:
+  std::mutex mutex;
+  std::map<std::pair<unsigned,Func>, std::shared_future<Func>> lowered;
+};
 
 /// Optimize and lower `func` into the low level part of the Simit IR, that is
 /// is supported by backends. If `print` is true, then the IR will be printed
-/// to stdout between each lowering step.
-Func lower(Func func, std::ostream* os=nullptr, bool time=false);
+/// to stdout between each lowering step. If `profiler` is given, then maps,
+/// loops and kernel calls are instrumented with regions of the profiler. If
+/// `cache` is given, then internal functions are shared with other functions
+/// lowered with the same cache. If `options` is given, then passes are skipped,
+/// reordered or timed as it says.
+Func lower(Func func, std::ostream* os=nullptr,
+           internal::Profiler* profiler=nullptr, LowerCache* cache=nullptr,
+           const PassOptions* options=nullptr);
 
 }}
 #endif
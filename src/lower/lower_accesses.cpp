@@ -161,7 +161,10 @@ private:
         }
         break;
       }
-      case TensorStorage::Kind::Indexed: {
+      // Symmetric matrices only store the upper triangle, so they can only be
+      // accessed at (i,j) with i <= j, such as on the diagonal
+      case TensorStorage::Kind::Indexed:
+      case TensorStorage::Kind::Symmetric: {
         simit_iassert(tensor.type().isTensor());
         size_t order = tensor.type().toTensor()->order();
         simit_tassert(order == 2)
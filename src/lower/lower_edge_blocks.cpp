@@ -0,0 +1,311 @@
+#include "lower_edge_blocks.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "edge_loops.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "storage.h"
+#include "var_replace_rewriter.h"
+#include "util/collections.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// Finds the buffers an edge loop body can read from gathered endpoint values
+/// and the buffers it can scatter-add into after the block.
+class EdgeLoopAnalysis : public IRVisitor {
+public:
+  EdgeLoopAnalysis(EdgeLoop* loop) : supported(true), loop(loop) {}
+
+  map<Buffer, std::set<Slot>> gathers;
+  map<Buffer, std::set<Slot>> scatters;
+  bool supported;
+
+  void analyze(Stmt body) {
+    body.accept(this);
+
+    // Gathered buffers must not change during the block, and scattered
+    // buffers may only be added to
+    for (auto& buffer : loaded) {
+      if (!util::contains(stored, buffer.first) &&
+          !util::contains(added, buffer.first) &&
+          !util::contains(loop->declared, buffer.first.first)) {
+        gathers.insert(buffer);
+      }
+    }
+    for (auto& buffer : added) {
+      if (!util::contains(stored, buffer.first) &&
+          !util::contains(readBuffers, buffer.first) &&
+          !util::contains(loop->declared, buffer.first.first)) {
+        scatters.insert(buffer);
+      }
+    }
+  }
+
+private:
+  EdgeLoop* loop;
+  map<Buffer, std::set<Slot>> loaded;
+  map<Buffer, std::set<Slot>> added;
+  std::set<Buffer> readBuffers;
+  std::set<Buffer> stored;
+
+  using IRVisitor::visit;
+
+  void visit(const VarDecl* op) {
+    loop->declared.insert(op->var);
+  }
+
+  void visit(const Load* op) {
+    Buffer buffer;
+    Slot slot;
+    if (loop->matchBuffer(op->buffer, &buffer)) {
+      readBuffers.insert(buffer);
+      if (loop->matchSlot(op->buffer, op->index, &slot)) {
+        loaded[buffer].insert(slot);
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Store* op) {
+    Buffer buffer;
+    Slot slot;
+    if (loop->matchBuffer(op->buffer, &buffer)) {
+      ScalarType componentType =
+          op->buffer.type().toTensor()->getComponentType();
+      if (op->cop == CompoundOperator::Add &&
+          (componentType.isFloat() || componentType.isInt()) &&
+          loop->matchSlot(op->buffer, op->index, &slot)) {
+        added[buffer].insert(slot);
+      }
+      else {
+        stored.insert(buffer);
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  /// Intrinsics only write their results, but may read all of a buffer passed
+  /// to them, so neither their results nor their buffer arguments are blocked.
+  void visit(const CallStmt* op) {
+    if (op->callee.getKind() != Func::Intrinsic) {
+      supported = false;
+      return;
+    }
+    for (const Var& result : op->results) {
+      stored.insert({result, ""});
+    }
+    for (const Expr& actual : op->actuals) {
+      Buffer buffer;
+      if (loop->matchBuffer(actual, &buffer)) {
+        stored.insert(buffer);
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const FieldWrite* op) {
+    supported = false;
+  }
+
+  void visit(const TensorWrite* op) {
+    supported = false;
+  }
+};
+
+/// Redirects the gathered loads and scattered stores of an edge loop body to
+/// the block buffers.
+class EdgeBlockRewriter : public IRRewriter {
+public:
+  EdgeBlockRewriter(const EdgeLoop* loop, int blockSize, Expr blockIndex,
+                    const map<Buffer, pair<Var, map<Slot,int>>>* gathers,
+                    const map<Buffer, pair<Var, map<Slot,int>>>* scatters)
+      : loop(loop), blockSize(blockSize), blockIndex(blockIndex),
+        gathers(gathers), scatters(scatters) {}
+
+private:
+  const EdgeLoop* loop;
+  int blockSize;
+  Expr blockIndex;
+  const map<Buffer, pair<Var, map<Slot,int>>>* gathers;
+  const map<Buffer, pair<Var, map<Slot,int>>>* scatters;
+
+  using IRRewriter::visit;
+
+  Expr blockLocation(int slot) {
+    return Add::make(slot*blockSize, blockIndex);
+  }
+
+  void visit(const Load* op) {
+    Buffer buffer;
+    Slot slot;
+    if (loop->matchBuffer(op->buffer, &buffer) &&
+        util::contains(*gathers, buffer) &&
+        loop->matchSlot(op->buffer, op->index, &slot)) {
+      const auto& gather = gathers->at(buffer);
+      expr = Load::make(gather.first, blockLocation(gather.second.at(slot)));
+      return;
+    }
+    IRRewriter::visit(op);
+  }
+
+  void visit(const Store* op) {
+    Buffer buffer;
+    Slot slot;
+    if (op->cop == CompoundOperator::Add &&
+        loop->matchBuffer(op->buffer, &buffer) &&
+        util::contains(*scatters, buffer) &&
+        loop->matchSlot(op->buffer, op->index, &slot)) {
+      const auto& scatter = scatters->at(buffer);
+      stmt = Store::make(scatter.first, blockLocation(scatter.second.at(slot)),
+                         rewrite(op->value), CompoundOperator::Add);
+      return;
+    }
+    IRRewriter::visit(op);
+  }
+};
+
+class LowerEdgeBlocks : public IRRewriter {
+public:
+  LowerEdgeBlocks(int blockSize, Storage* storage)
+      : blockSize(blockSize), storage(storage) {}
+
+private:
+  int blockSize;
+  Storage* storage;
+
+  using IRRewriter::visit;
+
+  /// Declare a block buffer for the slots of `buffer`, numbering the slots.
+  pair<Var, map<Slot,int>> makeBlockBuffer(const Buffer& buffer,
+                                           const std::set<Slot>& slots,
+                                           vector<Stmt>* decls) {
+    map<Slot,int> slotNumbers;
+    for (const Slot& slot : slots) {
+      slotNumbers.insert({slot, (int)slotNumbers.size()});
+    }
+    ScalarType componentType =
+        EdgeLoop::bufferExpr(buffer).type().toTensor()->getComponentType();
+    string name = buffer.first.getName() +
+                  (buffer.second.empty() ? "" : "_" + buffer.second);
+    Var var(name + "_block",
+            TensorType::make(componentType,
+                             {IndexSet(slots.size() * blockSize)}));
+    storage->add(var, TensorStorage(TensorStorage::Dense));
+    decls->push_back(VarDecl::make(var));
+    return {var, slotNumbers};
+  }
+
+  void visit(const For* op) {
+    IRRewriter::visit(op);
+    const ForDomain& domain = op->domain;
+    if (domain.kind != ForDomain::IndexSet ||
+        domain.indexSet.getKind() != IndexSet::Set ||
+        !isa<VarExpr>(domain.indexSet.getSet()) ||
+        !domain.indexSet.getSet().type().isUnstructuredSet()) {
+      return;
+    }
+    Expr edgeSet = domain.indexSet.getSet();
+    int cardinality =
+        edgeSet.type().toUnstructuredSet()->endpointSets.size();
+    if (cardinality == 0) {
+      return;
+    }
+
+    Stmt body = to<For>(stmt)->body;
+    EdgeLoop loop(op->var, to<VarExpr>(edgeSet)->var, cardinality);
+    EdgeLoopAnalysis analysis(&loop);
+    analysis.analyze(body);
+    if (!analysis.supported ||
+        (analysis.gathers.empty() && analysis.scatters.empty())) {
+      return;
+    }
+
+    // Loop over blocks of edges [start, end)
+    Var block(op->var.getName() + "_block", Int);
+    Var end(op->var.getName() + "_end", Int);
+    Expr numEdges = Length::make(domain.indexSet);
+    Expr start = Mul::make(block, blockSize);
+    Expr numBlocks = Div::make(Add::make(numEdges, blockSize-1), blockSize);
+
+    vector<Stmt> decls = {VarDecl::make(end)};
+    vector<Stmt> blockStmts;
+    blockStmts.push_back(AssignStmt::make(end, Add::make(start, blockSize)));
+    blockStmts.push_back(IfThenElse::make(Gt::make(end, numEdges),
+                                          AssignStmt::make(end, numEdges)));
+
+    // Gather the endpoint values the block reads
+    map<Buffer, pair<Var, map<Slot,int>>> gathers;
+    vector<Stmt> gatherStmts;
+    for (auto& buffer : analysis.gathers) {
+      auto gather = makeBlockBuffer(buffer.first, buffer.second, &decls);
+      for (auto& slot : gather.second) {
+        gatherStmts.push_back(Store::make(
+            gather.first,
+            Add::make(slot.second*blockSize, Sub::make(op->var, start)),
+            Load::make(EdgeLoop::bufferExpr(buffer.first),
+                       loop.location(buffer.first, slot.first))));
+      }
+      gathers.insert({buffer.first, gather});
+    }
+    if (gatherStmts.size() > 0) {
+      Var gatherVar(op->var.getName(), Int);
+      Stmt gatherLoop = ForRange::make(op->var, start, end,
+                                       Block::make(gatherStmts));
+      blockStmts.push_back(replaceVar(gatherLoop, op->var, gatherVar));
+    }
+
+    // Accumulate the values the block adds to endpoints, and scatter them
+    map<Buffer, pair<Var, map<Slot,int>>> scatters;
+    vector<Stmt> scatterStmts;
+    for (auto& buffer : analysis.scatters) {
+      auto scatter = makeBlockBuffer(buffer.first, buffer.second, &decls);
+      ScalarType componentType = scatter.first.getType().toTensor()
+                                                          ->getComponentType();
+      Expr zero = componentType.isFloat() ? Literal::make(0.0)
+                                          : Literal::make(0);
+      blockStmts.push_back(AssignStmt::make(scatter.first, zero));
+      for (auto& slot : scatter.second) {
+        scatterStmts.push_back(Store::make(
+            EdgeLoop::bufferExpr(buffer.first),
+            loop.location(buffer.first, slot.first),
+            Load::make(scatter.first, Add::make(slot.second*blockSize,
+                                                Sub::make(op->var, start))),
+            CompoundOperator::Add));
+      }
+      scatters.insert({buffer.first, scatter});
+    }
+
+    EdgeBlockRewriter rewriter(&loop, blockSize, Sub::make(op->var, start),
+                               &gathers, &scatters);
+    blockStmts.push_back(ForRange::make(op->var, start, end,
+                                        rewriter.rewrite(body)));
+
+    if (scatterStmts.size() > 0) {
+      Var scatterVar(op->var.getName(), Int);
+      Stmt scatterLoop = ForRange::make(op->var, start, end,
+                                        Block::make(scatterStmts));
+      blockStmts.push_back(replaceVar(scatterLoop, op->var, scatterVar));
+    }
+
+    stmt = Block::make(Block::make(decls),
+                       ForRange::make(block, 0, numBlocks,
+                                      Block::make(blockStmts)));
+  }
+};
+
+Func lowerEdgeBlocks(Func func, int blockSize) {
+  simit_iassert(blockSize > 0);
+  LowerEdgeBlocks rewriter(blockSize, &func.getStorage());
+  Stmt body = rewriter.rewrite(func.getBody());
+  return Func(func, body);
+}
+
+}}
@@ -0,0 +1,21 @@
+#ifndef SIMIT_LOWER_EDGE_BLOCKS_H
+#define SIMIT_LOWER_EDGE_BLOCKS_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Lower loops over edge sets that gather endpoint fields and scatter-add
+/// into endpoint tensors to loops over blocks of `blockSize` edges. Each block
+/// first gathers the endpoint values the loop body reads into contiguous
+/// buffers, then runs the body over the block reading and accumulating into
+/// the buffers, and finally scatter-adds the accumulated values through the
+/// endpoints. The buffers are stored one endpoint component at a time, so the
+/// body reads them with unit stride. Must run on fully lowered (flattened and
+/// unrolled) functions.
+Func lowerEdgeBlocks(Func func, int blockSize);
+
+}}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "storage.h"
 #include "ir_builder.h"
+#include "ir_codegen.h"
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 #include "inline.h"
@@ -44,6 +45,13 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
       case ReductionOperator::Undefined: {
         return TensorWrite::make(tensor, indices, value);
       }
+      default: {
+        if (!isScalar(value.type())) {
+          not_supported_yet << "only maps with scalar components can be "
+                            << "reduced with " << reduction;
+        }
+        return compoundTensorWrite(tensor, indices, reduction, value);
+      }
     }
     simit_unreachable;
     return Stmt();
@@ -51,6 +59,25 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
 
   using MapFunctionRewriter::visit;
 
+  void visit(const AssignStmt *op) {
+    if (!isResult(op->var) || !isScalar(op->var.getType())) {
+      MapFunctionRewriter::visit(op);
+      return;
+    }
+
+    // Scalar results are reduced over the whole target set, so every write
+    // to them is combined into the map variable
+    Var mapVar = getMapVar(op->var);
+    Expr value = rewrite(op->value);
+    if (op->cop != CompoundOperator::None &&
+        reduction.getKind() != ReductionOperator::Undefined) {
+      not_supported_yet << "compound assignments to reduced map results";
+    }
+    stmt = (reduction.getKind() == ReductionOperator::Undefined)
+        ? AssignStmt::make(mapVar, value, op->cop)
+        : compoundAssign(mapVar, reduction, value);
+  }
+
   void visit(const TensorWrite *op) {
     // Rewrites the tensor write and assigns the result to stmt
     IRRewriter::visit(op);
@@ -98,7 +125,8 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
         stmt = makeCompoundTensorWrite(rewrite(op->tensor), {index},
                                        rewrite(op->value));
       }
-      else if (tensorStorage.getKind() == TensorStorage::Indexed) {
+      else if (tensorStorage.getKind() == TensorStorage::Indexed ||
+               tensorStorage.getKind() == TensorStorage::Symmetric) {
         auto index = tensorStorage.getTensorIndex();
         simit_iassert(util::contains(locs, index));
 
@@ -118,6 +146,15 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
         Expr indexExpr = TensorRead::make(locs[index], indices);
         stmt = makeCompoundTensorWrite(rewrite(op->tensor), {indexExpr},
                                        rewrite(op->value));
+
+        // Symmetric matrices only store the blocks of the upper triangle. The
+        // blocks of the lower triangle are their transposes, so writes to them
+        // are dropped.
+        if (tensorStorage.getKind() == TensorStorage::Symmetric) {
+          Expr row = TensorRead::make(endpoints, {indices[0]});
+          Expr col = TensorRead::make(endpoints, {indices[1]});
+          stmt = IfThenElse::make(Le::make(row, col), stmt);
+        }
       }
       else {
         stmt = makeCompoundTensorWrite(tensorWrite->tensor,tensorWrite->indices,
@@ -156,7 +193,8 @@ private:
     // Add result variable indices to the environment
     for (auto result : op->vars) {
       auto tensorStorage = storage->getStorage(result);
-      if (tensorStorage.getKind() == TensorStorage::Indexed) {
+      if (tensorStorage.getKind() == TensorStorage::Indexed ||
+          tensorStorage.getKind() == TensorStorage::Symmetric) {
         auto& pexpr = tensorStorage.getTensorIndex().getPathExpression();
         env->addTensorIndex(pexpr, result);
       }
@@ -115,6 +115,7 @@ private:
         
         break;
       }
+      case TensorStorage::Kind::Symmetric:
       case TensorStorage::Kind::Stencil: {
         not_supported_yet;
         break;
@@ -209,6 +210,7 @@ private:
 
         break;
       }
+      case TensorStorage::Kind::Symmetric:
       case TensorStorage::Kind::Stencil: {
         not_supported_yet;
         break;
@@ -319,6 +321,7 @@ private:
 
           break;
         }
+        case TensorStorage::Kind::Symmetric:
         case TensorStorage::Kind::Stencil: {
           not_supported_yet;
           break;
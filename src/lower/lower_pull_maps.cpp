@@ -0,0 +1,281 @@
+#include "lower_pull_maps.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "edge_loops.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "path_expressions.h"
+#include "tensor_index.h"
+#include "util/collections.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// Finds the endpoint buffers an edge loop body scatter-adds into, and whether
+/// those scatter-adds are the body's only effects outside of itself.
+class PullLoopAnalysis : public IRVisitor {
+public:
+  PullLoopAnalysis(EdgeLoop* loop) : supported(true), loop(loop) {}
+
+  map<Buffer, std::set<Slot>> scatters;
+  bool supported;
+
+  void analyze(Stmt body) {
+    body.accept(this);
+
+    // Vertices only see their own sums, so scattered buffers cannot be read
+    for (auto& buffer : scatters) {
+      if (util::contains(readBuffers, buffer.first)) {
+        supported = false;
+      }
+    }
+  }
+
+private:
+  EdgeLoop* loop;
+  std::set<Buffer> readBuffers;
+
+  using IRVisitor::visit;
+
+  bool isDeclared(const Var& var) {
+    return util::contains(loop->declared, var);
+  }
+
+  void visit(const VarDecl* op) {
+    loop->declared.insert(op->var);
+  }
+
+  void visit(const AssignStmt* op) {
+    if (!isDeclared(op->var)) {
+      supported = false;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Load* op) {
+    Buffer buffer;
+    if (loop->matchBuffer(op->buffer, &buffer)) {
+      readBuffers.insert(buffer);
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Store* op) {
+    Buffer buffer;
+    Slot slot;
+    if (loop->matchBuffer(op->buffer, &buffer)) {
+      ScalarType componentType =
+          op->buffer.type().toTensor()->getComponentType();
+      if (op->cop == CompoundOperator::Add &&
+          (componentType.isFloat() || componentType.isInt()) &&
+          loop->matchSlot(op->buffer, op->index, &slot)) {
+        scatters[buffer].insert(slot);
+      }
+      else {
+        supported = false;
+      }
+    }
+    else if (!isa<VarExpr>(op->buffer) ||
+             !isDeclared(to<VarExpr>(op->buffer)->var)) {
+      supported = false;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    if (op->callee.getKind() != Func::Intrinsic) {
+      supported = false;
+    }
+    for (const Var& result : op->results) {
+      if (!isDeclared(result)) {
+        supported = false;
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const FieldWrite* op) {
+    supported = false;
+  }
+
+  void visit(const TensorWrite* op) {
+    supported = false;
+  }
+
+  void visit(const Print* op) {
+    supported = false;
+  }
+};
+
+/// Redirects the scatter-adds of an edge loop body to the accumulators of the
+/// vertex whose incident edge it is evaluated for.
+class PullRewriter : public IRRewriter {
+public:
+  PullRewriter(const EdgeLoop* loop, Var vertex,
+               const map<pair<Buffer,int>, Var>* accumulators)
+      : loop(loop), vertex(vertex), accumulators(accumulators) {}
+
+private:
+  const EdgeLoop* loop;
+  Var vertex;
+  const map<pair<Buffer,int>, Var>* accumulators;
+
+  using IRRewriter::visit;
+
+  void visit(const Store* op) {
+    Buffer buffer;
+    Slot slot;
+    if (op->cop == CompoundOperator::Add &&
+        loop->matchBuffer(op->buffer, &buffer) &&
+        loop->matchSlot(op->buffer, op->index, &slot)) {
+      Var accumulator = accumulators->at({buffer, slot.second});
+      stmt = IfThenElse::make(Eq::make(loop->endpoint(slot.first), vertex),
+                              AssignStmt::make(accumulator, rewrite(op->value),
+                                               CompoundOperator::Add));
+      return;
+    }
+    IRRewriter::visit(op);
+  }
+};
+
+class LowerPullMaps : public IRRewriter {
+public:
+  LowerPullMaps(Environment* environment) : environment(environment) {}
+
+private:
+  Environment* environment;
+
+  /// Path expression sets are compared by identity, so each set variable gets
+  /// one for all the indices of the function.
+  map<Var, pe::Set> pathExpressionSets;
+
+  using IRRewriter::visit;
+
+  const pe::Set& getPathExpressionSet(const Var& set) {
+    if (!util::contains(pathExpressionSets, set)) {
+      pathExpressionSets.insert({set, pe::Set(set.getName())});
+    }
+    return pathExpressionSets.at(set);
+  }
+
+  /// The vertex to edge index of `edgeSet`'s endpoints in `vertexSet`.
+  const TensorIndex& getIncidenceIndex(const Var& vertexSet,
+                                       const Var& edgeSet) {
+    pe::Var v("v", getPathExpressionSet(vertexSet));
+    pe::Var e("e", getPathExpressionSet(edgeSet));
+    pe::PathExpression ve = pe::Link::make(v, e, pe::Link::ve);
+    if (!environment->hasTensorIndex(ve)) {
+      environment->addTensorIndex(ve, Var(vertexSet.getName() + "_" +
+                                          edgeSet.getName(), Int));
+    }
+    return environment->getTensorIndex(ve);
+  }
+
+  void visit(const For* op) {
+    IRRewriter::visit(op);
+    const ForDomain& domain = op->domain;
+    if (domain.kind != ForDomain::IndexSet ||
+        domain.indexSet.getKind() != IndexSet::Set ||
+        !isa<VarExpr>(domain.indexSet.getSet()) ||
+        !domain.indexSet.getSet().type().isUnstructuredSet()) {
+      return;
+    }
+    Expr edgeSet = domain.indexSet.getSet();
+    const vector<Expr*>& endpointSets =
+        edgeSet.type().toUnstructuredSet()->endpointSets;
+    if (endpointSets.size() == 0) {
+      return;
+    }
+
+    Stmt body = to<For>(stmt)->body;
+    EdgeLoop loop(op->var, to<VarExpr>(edgeSet)->var, endpointSets.size());
+    PullLoopAnalysis analysis(&loop);
+    analysis.analyze(body);
+    if (!analysis.supported || analysis.scatters.empty()) {
+      return;
+    }
+
+    // Every scattered endpoint must be in the same vertex set
+    Expr vertexSet;
+    for (auto& buffer : analysis.scatters) {
+      for (const Slot& slot : buffer.second) {
+        Expr endpointSet = *endpointSets[slot.first];
+        if (!isa<VarExpr>(endpointSet) || (vertexSet.defined() &&
+            to<VarExpr>(endpointSet)->var != to<VarExpr>(vertexSet)->var)) {
+          return;
+        }
+        vertexSet = endpointSet;
+      }
+    }
+    const TensorIndex& index =
+        getIncidenceIndex(to<VarExpr>(vertexSet)->var, loop.edgeSet);
+
+    Var vertex(to<VarExpr>(vertexSet)->var.getName() + "_vertex", Int);
+    Var previous(op->var.getName() + "_previous", Int);
+    Var coord(op->var.getName() + "_coord", Int);
+
+    // Accumulate the components each vertex receives in local variables
+    vector<Stmt> vertexStmts;
+    vector<Stmt> resultStmts;
+    map<pair<Buffer,int>, Var> accumulators;
+    for (auto& buffer : analysis.scatters) {
+      string name = buffer.first.first.getName() +
+          (buffer.first.second.empty() ? "" : "_" + buffer.first.second);
+      int width = EdgeLoop::bufferWidth(buffer.first);
+      ScalarType componentType = EdgeLoop::bufferExpr(buffer.first).type()
+                                     .toTensor()->getComponentType();
+      for (int c = 0; c < width; ++c) {
+        Var accumulator(name + "_sum" + to_string(c),
+                        TensorType::make(componentType));
+        Expr zero = componentType.isFloat() ? Literal::make(0.0)
+                                            : Literal::make(0);
+        vertexStmts.push_back(VarDecl::make(accumulator));
+        vertexStmts.push_back(AssignStmt::make(accumulator, zero));
+        accumulators.insert({{buffer.first, c}, accumulator});
+
+        Expr location = (width == 1)
+            ? Expr(vertex) : Add::make(Mul::make(vertex, width), c);
+        resultStmts.push_back(Store::make(EdgeLoop::bufferExpr(buffer.first),
+                                          location, accumulator,
+                                          CompoundOperator::Add));
+      }
+    }
+
+    // Loop over the incident edges, visiting edges incident at several
+    // endpoints once, since the body adds to every endpoint of the vertex
+    PullRewriter rewriter(&loop, vertex, &accumulators);
+    Stmt edgeBody = Block::make({
+        AssignStmt::make(op->var, Load::make(index.getColidxArray(), coord)),
+        IfThenElse::make(Ne::make(op->var, previous), rewriter.rewrite(body)),
+        AssignStmt::make(previous, op->var)});
+    vertexStmts.push_back(VarDecl::make(op->var));
+    vertexStmts.push_back(VarDecl::make(previous));
+    vertexStmts.push_back(AssignStmt::make(previous, -1));
+    vertexStmts.push_back(
+        ForRange::make(coord,
+                       Load::make(index.getRowptrArray(), vertex),
+                       Load::make(index.getRowptrArray(),
+                                  Add::make(vertex, 1)),
+                       edgeBody));
+    vertexStmts.insert(vertexStmts.end(),
+                       resultStmts.begin(), resultStmts.end());
+
+    stmt = For::make(vertex, ForDomain(IndexSet(vertexSet)),
+                     Block::make(vertexStmts));
+  }
+};
+
+Func lowerPullMaps(Func func) {
+  LowerPullMaps rewriter(&func.getEnvironment());
+  Stmt body = rewriter.rewrite(func.getBody());
+  return Func(func, body);
+}
+
+}}
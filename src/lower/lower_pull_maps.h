@@ -0,0 +1,22 @@
+#ifndef SIMIT_LOWER_PULL_MAPS_H
+#define SIMIT_LOWER_PULL_MAPS_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Lower loops over edge sets whose only effects are scatter-adds into
+/// endpoint tensors of one vertex set to loops over the vertices that pull
+/// from their incident edges. The incident edges are found through a vertex to
+/// edge index (the path expression `ve`), which is pre-assembled with the
+/// function's other tensor indices. Each vertex accumulates its results in
+/// local variables and adds them to its own tensor entries only, so vertex
+/// iterations are independent. The edge body is evaluated once per incident
+/// endpoint instead of once per edge. Must run on fully lowered (flattened and
+/// unrolled) functions.
+Func lowerPullMaps(Func func);
+
+}}
+
+#endif
@@ -0,0 +1,251 @@
+#include "pass_manager.h"
+
+#include <chrono>
+#include <iomanip>
+
+#include "lower.h"
+#include "ir_printer.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+#ifdef GPU
+#include "backend/gpu/gpu_ir.h"
+#endif
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+// class PassManager
+void PassManager::add(const std::string& name, const std::string& title,
+                      const std::function<Func(Func)>& rewrite) {
+  std::function<void(Func,std::ostream&)> print;
+  if (title != "") {
+    print = [title](Func func, std::ostream& os) {
+      printCallGraph(title, func, os);
+    };
+  }
+  add(name, rewrite, print);
+}
+
+void PassManager::add(const std::string& name,
+                      const std::function<Func(Func)>& rewrite,
+                      const std::function<void(Func,std::ostream&)>& print) {
+  simit_iassert(!util::contains(getPassNames(), name))
+      << "duplicate lowering pass " << util::quote(name);
+  passes.push_back({name, rewrite, print});
+}
+
+std::vector<std::string> PassManager::getPassNames() const {
+  vector<string> names;
+  for (const LowerPass& pass : passes) {
+    names.push_back(pass.name);
+  }
+  return names;
+}
+
+Func PassManager::run(Func func, const PassOptions& options, std::ostream* os,
+                      LowerCache* cache) const {
+  // Select the passes to run
+  map<string, const LowerPass*> passesByName;
+  for (const LowerPass& pass : passes) {
+    passesByName.insert({pass.name, &pass});
+  }
+  for (const string& name : options.skip) {
+    simit_uassert(util::contains(passesByName, name))
+        << "cannot skip unknown lowering pass " << util::quote(name)
+        << ", the passes are: " << util::join(getPassNames(), ", ");
+  }
+  vector<const LowerPass*> pipeline;
+  if (options.order.empty()) {
+    for (const LowerPass& pass : passes) {
+      pipeline.push_back(&pass);
+    }
+  }
+  else {
+    for (const string& name : options.order) {
+      simit_uassert(util::contains(passesByName, name))
+          << "cannot run unknown lowering pass " << util::quote(name)
+          << ", the passes are: " << util::join(getPassNames(), ", ");
+      pipeline.push_back(passesByName.at(name));
+    }
+  }
+
+  unsigned passNumber = 0;
+  for (const LowerPass* pass : pipeline) {
+    if (util::contains(options.skip, pass->name)) {
+      continue;
+    }
+
+    if (options.timings != nullptr) {
+      size_t nodesBefore = countNodes(func);
+      auto start = std::chrono::steady_clock::now();
+      func = rewriteCallGraph(func, pass->rewrite, cache, passNumber++);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      options.timings->push_back({pass->name, elapsed.count(), nodesBefore,
+                                  countNodes(func)});
+    }
+    else {
+      func = rewriteCallGraph(func, pass->rewrite, cache, passNumber++);
+    }
+
+    if (os && pass->print) {
+      pass->print(func, *os);
+    }
+  }
+  return func;
+}
+
+Func rewriteCallGraph(const Func& func, const function<Func(Func)>& rewriter,
+                      LowerCache* cache, unsigned pass) {
+  class Rewriter : public simit::ir::IRRewriterCallGraph {
+  public:
+    Rewriter(const function<Func(Func)>& rewriter, LowerCache* cache,
+             unsigned pass) : rewriter(rewriter), cache(cache), pass(pass) {}
+    const function<Func(Func)>& rewriter;
+    LowerCache* cache;
+    unsigned pass;
+
+    using IRRewriter::visit;
+    void visit(const simit::ir::Func *op) {
+      if (op->getKind() != simit::ir::Func::Internal) {
+        func = *op;
+        return;
+      }
+      auto rewriteFunc = [this,op]() {
+        return rewriter(simit::ir::Func(*op, rewrite(op->getBody())));
+      };
+      func = (cache != nullptr) ? cache->get(pass, *op, rewriteFunc)
+                                : rewriteFunc();
+    }
+  };
+  return Rewriter(rewriter, cache, pass).rewrite(func);
+}
+
+void visitCallGraph(Func func, const function<void(Func)>& visitRule) {
+  class Visitor : public simit::ir::IRVisitorCallGraph {
+  public:
+    Visitor(const function<void(Func)>& visitRule) : visitRule(visitRule) {}
+    const function<void(Func)>& visitRule;
+
+    using simit::ir::IRVisitor::visit;
+    void visit(const simit::ir::Func *op) {
+      if (op->getKind() != simit::ir::Func::Internal) {
+        return;
+      }
+      simit::ir::IRVisitorCallGraph::visit(op);
+      visitRule(*op);
+    }
+  };
+  Visitor visitor(visitRule);
+  func.accept(&visitor);
+}
+
+void printCallGraph(const std::string& headerText, Func func,
+                    std::ostream& os) {
+  os << "%% " << headerText << endl;
+  simit::ir::IRPrinterCallGraph(os).print(func);
+  os << endl;
+}
+
+size_t countNodes(Func func) {
+  class NodeCounter : public IRVisitorCallGraph {
+  public:
+    size_t count = 0;
+
+    using IRVisitorCallGraph::visit;
+
+#define SIMIT_COUNT_NODE(Node)      \
+    void visit(const Node* op) {    \
+      ++count;                      \
+      IRVisitorCallGraph::visit(op);\
+    }
+    SIMIT_COUNT_NODE(Literal)
+    SIMIT_COUNT_NODE(VarExpr)
+    SIMIT_COUNT_NODE(Load)
+    SIMIT_COUNT_NODE(FieldRead)
+    SIMIT_COUNT_NODE(Length)
+    SIMIT_COUNT_NODE(IndexRead)
+    SIMIT_COUNT_NODE(Neg)
+    SIMIT_COUNT_NODE(Add)
+    SIMIT_COUNT_NODE(Sub)
+    SIMIT_COUNT_NODE(Mul)
+    SIMIT_COUNT_NODE(Div)
+    SIMIT_COUNT_NODE(Rem)
+    SIMIT_COUNT_NODE(Not)
+    SIMIT_COUNT_NODE(Eq)
+    SIMIT_COUNT_NODE(Ne)
+    SIMIT_COUNT_NODE(Gt)
+    SIMIT_COUNT_NODE(Lt)
+    SIMIT_COUNT_NODE(Ge)
+    SIMIT_COUNT_NODE(Le)
+    SIMIT_COUNT_NODE(And)
+    SIMIT_COUNT_NODE(Or)
+    SIMIT_COUNT_NODE(Xor)
+    SIMIT_COUNT_NODE(VarDecl)
+    SIMIT_COUNT_NODE(AssignStmt)
+    SIMIT_COUNT_NODE(CallStmt)
+    SIMIT_COUNT_NODE(Store)
+    SIMIT_COUNT_NODE(FieldWrite)
+    SIMIT_COUNT_NODE(Scope)
+    SIMIT_COUNT_NODE(IfThenElse)
+    SIMIT_COUNT_NODE(ForRange)
+    SIMIT_COUNT_NODE(For)
+    SIMIT_COUNT_NODE(While)
+    SIMIT_COUNT_NODE(Kernel)
+    SIMIT_COUNT_NODE(Block)
+    SIMIT_COUNT_NODE(Print)
+    SIMIT_COUNT_NODE(Comment)
+    SIMIT_COUNT_NODE(Pass)
+    SIMIT_COUNT_NODE(UnnamedTupleRead)
+    SIMIT_COUNT_NODE(NamedTupleRead)
+    SIMIT_COUNT_NODE(SetRead)
+    SIMIT_COUNT_NODE(TensorRead)
+    SIMIT_COUNT_NODE(TensorWrite)
+    SIMIT_COUNT_NODE(IndexedTensor)
+    SIMIT_COUNT_NODE(IndexExpr)
+    SIMIT_COUNT_NODE(Map)
+#ifdef GPU
+    SIMIT_COUNT_NODE(GPUKernel)
+#endif
+#undef SIMIT_COUNT_NODE
+  };
+  NodeCounter counter;
+  func.accept(&counter);
+  return counter.count;
+}
+
+void printPassTimings(const std::vector<PassTiming>& timings,
+                      std::ostream& os) {
+  double totalSeconds = 0.0;
+  for (const PassTiming& timing : timings) {
+    totalSeconds += timing.seconds;
+  }
+
+  std::ios_base::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  os << "=== Lowering pass timings ===" << endl;
+  os << setw(12) << "Time (s)" << setw(8) << "%"
+     << setw(12) << "Nodes in" << setw(12) << "Nodes out" << "  Pass" << endl;
+  os << fixed;
+  for (const PassTiming& timing : timings) {
+    double percent = (totalSeconds > 0.0)
+                     ? 100.0 * timing.seconds / totalSeconds : 0.0;
+    os << setw(12) << setprecision(6) << timing.seconds
+       << setw(8) << setprecision(1) << percent
+       << setw(12) << timing.nodesBefore
+       << setw(12) << timing.nodesAfter
+       << "  " << timing.name << endl;
+  }
+  os << setw(12) << setprecision(6) << totalSeconds
+     << setw(8) << setprecision(1) << 100.0 << setw(24) << "" << "  Total"
+     << endl;
+  os.flags(flags);
+  os.precision(precision);
+}
+
+}}
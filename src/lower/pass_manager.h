@@ -0,0 +1,99 @@
+#ifndef SIMIT_PASS_MANAGER_H
+#define SIMIT_PASS_MANAGER_H
+
+#include <functional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+class LowerCache;
+
+/// A pass of the lowering pipeline, which rewrites every internal function of
+/// a call graph.
+struct LowerPass {
+  /// The name that selects the pass in PassOptions, e.g. "lower-maps".
+  std::string name;
+
+  std::function<Func(Func)> rewrite;
+
+  /// Prints the IR after the pass, or does nothing if undefined.
+  std::function<void(Func,std::ostream&)> print;
+};
+
+/// The time a lowering pass took and the number of IR nodes in the call graph
+/// before and after it.
+struct PassTiming {
+  std::string name;
+  double seconds;
+  size_t nodesBefore;
+  size_t nodesAfter;
+};
+
+/// Options for experimenting with the lowering pipeline.
+struct PassOptions {
+  /// The names of passes to skip.
+  std::set<std::string> skip;
+
+  /// The names of the passes to run in order, which replaces the pipeline's
+  /// own order if not empty. A name may be repeated to run a pass again.
+  std::vector<std::string> order;
+
+  /// If not null, the passes append their timings here.
+  std::vector<PassTiming>* timings = nullptr;
+};
+
+/// A pipeline of lowering passes.
+class PassManager {
+public:
+  /// Append a pass that prints the call graph under `title` afterwards, or
+  /// nothing if `title` is empty.
+  void add(const std::string& name, const std::string& title,
+           const std::function<Func(Func)>& rewrite);
+
+  /// Append a pass that prints the IR after it with `print`.
+  void add(const std::string& name, const std::function<Func(Func)>& rewrite,
+           const std::function<void(Func,std::ostream&)>& print);
+
+  /// The names of the passes in pipeline order.
+  std::vector<std::string> getPassNames() const;
+
+  /// Run the passes selected by `options` over the call graph of `func`,
+  /// printing the IR after each to `os` if given. Passes are numbered in the
+  /// order they run, so that functions lowered with the same `cache` share the
+  /// result of each pass.
+  Func run(Func func, const PassOptions& options=PassOptions(),
+           std::ostream* os=nullptr, LowerCache* cache=nullptr) const;
+
+private:
+  std::vector<LowerPass> passes;
+};
+
+/// Rewrite every internal function of the call graph of `func` with
+/// `rewriter`, sharing the rewritten functions through `cache` under `pass`.
+Func rewriteCallGraph(const Func& func,
+                      const std::function<Func(Func)>& rewriter,
+                      LowerCache* cache=nullptr, unsigned pass=0);
+
+/// Call `visitRule` on every internal function of the call graph of `func`,
+/// callees first.
+void visitCallGraph(Func func, const std::function<void(Func)>& visitRule);
+
+/// Print the call graph of `func` under the heading `headerText`.
+void printCallGraph(const std::string& headerText, Func func,
+                    std::ostream& os);
+
+/// The number of Expr and Stmt nodes in the call graph of `func`.
+size_t countNodes(Func func);
+
+/// Print a table of pass timings, with each pass's share of the total time.
+void printPassTimings(const std::vector<PassTiming>& timings,
+                      std::ostream& os);
+
+}}
+
+#endif
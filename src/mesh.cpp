@@ -1,9 +1,15 @@
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
 #include <map>
 #include "mesh.h"
+#include "util/parallel.h"
 
 using namespace simit;
 using namespace std;
@@ -16,7 +22,6 @@ int openOfstream(ofstream & out, const char * filename);
 
 //helper function used by saveHexObj
 int findFace(const IntMap & m, int ei, const MeshVol & vol);
-int findTetFace(const IntMap & m, int ei, const MeshVol & vol);
 
 int HexFaces[6][4]={
     {0,1,3,2},{4,5,7,6},
@@ -47,75 +52,390 @@ int openOfstream(ofstream & out, const char * filename)
   return 0;
 }
 
-int Mesh::load(const char * filename)
+//helpers used by the parallel text parsers
+typedef pair<const char*, const char*> LineRange;
+
+//chunks smaller than this are not worth a thread
+const size_t MinChunkBytes = 1<<16;
+
+//calls body(begin, end) on blocks of [0,n) in parallel.
+static void parallelBlocks(size_t n,
+                           const function<void(size_t,size_t)> & body)
 {
-  ifstream in;
-  int status = openIfstream(in,filename);
-  if(status<0){
-    return status;
-  }
-  status = load(in);
-  in.close();
-  return status;
+  const size_t blockSize = 4096;
+  util::parallelFor((n+blockSize-1)/blockSize, [&](size_t b){
+    body(b*blockSize, std::min(n, (b+1)*blockSize));
+  });
 }
 
-int Mesh::load(std::string filename) {
-  return load(filename.c_str());
+static string readStream(istream & in)
+{
+  ostringstream ss;
+  ss<<in.rdbuf();
+  return ss.str();
 }
 
-int Mesh::load(istream & in)
+//split [begin,end) into chunks of whole lines.
+static vector<LineRange> splitLines(const char * begin, const char * end)
 {
-  string line;
-  string vTok("v");
-  string fTok("f");
-  char bslash='/',space=' ';
-  string tok;
-  while(1) {
-    getline(in,line);
-    if(in.eof()) {
-      break;
+  size_t numChunks = std::min<size_t>(util::numWorkerThreads()*4,
+                                      (end-begin)/MinChunkBytes + 1);
+  vector<LineRange> chunks;
+  const char * chunkBegin = begin;
+  for(size_t ii = 1; ii<=numChunks && chunkBegin<end; ii++){
+    const char * chunkEnd = end;
+    if(ii<numChunks){
+      chunkEnd = std::max(chunkBegin, begin + (end-begin)*ii/numChunks);
+      chunkEnd = std::find(chunkEnd, end, '\n');
+      if(chunkEnd!=end){
+        chunkEnd++;
+      }
     }
-    if(line == "#end"){
-      break;
+    chunks.push_back(LineRange(chunkBegin, chunkEnd));
+    chunkBegin = chunkEnd;
+  }
+  return chunks;
+}
+
+static bool isBlank(char c)
+{
+  return c==' ' || c=='\t' || c=='\r';
+}
+
+//the next line of [p,end) with leading blanks removed, advancing p past it.
+static LineRange nextLine(const char * & p, const char * end)
+{
+  const char * lineEnd = std::find(p, end, '\n');
+  LineRange line(p, lineEnd);
+  while(line.first<line.second && isBlank(*line.first)){
+    line.first++;
+  }
+  p = (lineEnd==end) ? end : lineEnd+1;
+  return line;
+}
+
+//parse a number at the start of [p,end), skipping leading blanks, and
+//advance p past it.
+static bool parseNumber(const char * & p, const char * end, int * value)
+{
+  while(p<end && isBlank(*p)){
+    p++;
+  }
+  bool negative = false;
+  if(p<end && (*p=='-' || *p=='+')){
+    negative = (*p=='-');
+    p++;
+  }
+  if(p==end || *p<'0' || *p>'9'){
+    return false;
+  }
+  long long result = 0;
+  while(p<end && *p>='0' && *p<='9'){
+    result = result*10 + (*p-'0');
+    if(result>INT_MAX){
+      return false;
     }
-    if(line.size()<3) {
+    p++;
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+static bool parseNumber(const char * & p, const char * end, double * value)
+{
+  while(p<end && isBlank(*p)){
+    p++;
+  }
+  if(p==end || *p=='#'){
+    return false;
+  }
+  //strtod stops at the line break, or the terminating null of the buffer
+  char * numEnd;
+  *value = strtod(p, &numEnd);
+  if(numEnd==p || numEnd>end){
+    return false;
+  }
+  p = numEnd;
+  return true;
+}
+
+//parse the first line of a TetGen file that is not blank or a comment into
+//header, and set body to the lines after it.
+static bool parseTetGenHeader(const string & text, int numValues,
+                              vector<int> & header, LineRange & body)
+{
+  const char * p = text.data();
+  const char * end = p + text.size();
+  while(p<end){
+    LineRange line = nextLine(p, end);
+    if(line.first==line.second || *line.first=='#'){
       continue;
     }
-    if(line.at(0)=='#') {
+    header.resize(numValues);
+    for(int ii = 0; ii<numValues; ii++){
+      if(!parseNumber(line.first, line.second, &header[ii])){
+        return false;
+      }
+    }
+    body = LineRange(p, end);
+    return header[0]>=0;
+  }
+  return false;
+}
+
+//parse the first count records of a TetGen file body, that each have an
+//index followed by width values, ignoring any attributes and boundary
+//markers after them.
+template <typename T>
+static int parseTetGenRecords(LineRange body, size_t count, int width,
+                              vector<T> & values, const char * what)
+{
+  vector<LineRange> chunks = splitLines(body.first, body.second);
+  vector<vector<T> > chunkValues(chunks.size());
+  vector<char> malformed(chunks.size(), false);
+  util::parallelFor(chunks.size(), [&](size_t ci){
+    const char * p = chunks[ci].first;
+    const char * end = chunks[ci].second;
+    vector<T> & out = chunkValues[ci];
+    while(p<end){
+      LineRange line = nextLine(p, end);
+      if(line.first==line.second || *line.first=='#'){
+        continue;
+      }
+      int index;
+      if(!parseNumber(line.first, line.second, &index)){
+        malformed[ci] = true;
+        return;
+      }
+      for(int ii = 0; ii<width; ii++){
+        T value;
+        if(!parseNumber(line.first, line.second, &value)){
+          malformed[ci] = true;
+          return;
+        }
+        out.push_back(value);
+      }
+    }
+  });
+
+  //records after the first count are ignored, so malformed lines only
+  //matter in the chunks that contribute
+  vector<size_t> offsets(chunks.size()+1, 0);
+  for(size_t ci = 0; ci<chunks.size(); ci++){
+    if(offsets[ci]<count*width && malformed[ci]){
+      std::cerr << "Malformed " << what << " record" << std::endl;
+      return -1;
+    }
+    offsets[ci+1] = offsets[ci] + chunkValues[ci].size();
+  }
+  if(offsets.back()<count*width){
+    std::cerr << "Expected " << count << " " << what << " records but found "
+              << offsets.back()/width << std::endl;
+    return -1;
+  }
+  values.resize(count*width);
+  util::parallelFor(chunks.size(), [&](size_t ci){
+    size_t begin = std::min(offsets[ci], values.size());
+    size_t n = std::min(offsets[ci+1], values.size()) - begin;
+    std::copy(chunkValues[ci].begin(), chunkValues[ci].begin()+n,
+              values.begin()+begin);
+  });
+  return 0;
+}
+
+int MeshArrays::loadTet(std::string nodeFile, std::string eleFile)
+{
+  ifstream nodeIn, eleIn;
+  int status = openIfstream(nodeIn, nodeFile.c_str());
+  if(status<0){
+    return status;
+  }
+  status = openIfstream(eleIn, eleFile.c_str());
+  if(status<0){
+    return status;
+  }
+  return loadTet(nodeIn, eleIn);
+}
+
+int MeshArrays::loadTet(istream & nodeIn, istream & eleIn)
+{
+  //load vertices
+  string text = readStream(nodeIn);
+  vector<int> header;
+  LineRange body;
+  if(!parseTetGenHeader(text, 1, header, body)){
+    std::cerr << "Malformed node header" << std::endl;
+    return -1;
+  }
+  if(parseTetGenRecords(body, header[0], 3, v, "node")<0){
+    return -1;
+  }
+
+  //load elements
+  text = readStream(eleIn);
+  if(!parseTetGenHeader(text, 2, header, body) || header[1]<=0){
+    std::cerr << "Malformed element header" << std::endl;
+    return -1;
+  }
+  elementSize = header[1];
+  return parseTetGenRecords(body, header[0], elementSize, e, "element");
+}
+
+int MeshArrays::loadTetEdge(std::string edgeFile)
+{
+  ifstream edgeIn;
+  int status = openIfstream(edgeIn, edgeFile.c_str());
+  if(status<0){
+    return status;
+  }
+  return loadTetEdge(edgeIn);
+}
+
+int MeshArrays::loadTetEdge(istream & edgeIn)
+{
+  string text = readStream(edgeIn);
+  vector<int> header;
+  LineRange body;
+  if(!parseTetGenHeader(text, 1, header, body)){
+    std::cerr << "Malformed edge header" << std::endl;
+    return -1;
+  }
+  elementSize = 2;
+  return parseTetGenRecords(body, header[0], elementSize, e, "edge");
+}
+
+int MeshArrays::loadObj(std::string filename)
+{
+  ifstream in;
+  int status = openIfstream(in, filename.c_str());
+  if(status<0){
+    return status;
+  }
+  return loadObj(in);
+}
+
+//the vertices and triangles of a chunk of an obj file. Face indices are
+//absolute, so chunks are parsed independently.
+struct ObjChunk{
+  ObjChunk():ended(false),malformed(false){}
+  vector<double> v;
+  vector<int> t;
+  //the chunk has an #end line, after which the file is ignored
+  bool ended;
+  bool malformed;
+};
+
+static void parseObjChunk(const char * p, const char * end, ObjChunk & out)
+{
+  vector<int> vidx;
+  while(p<end){
+    LineRange line = nextLine(p, end);
+    const char * tokEnd = line.first;
+    while(tokEnd<line.second && !isBlank(*tokEnd)){
+      tokEnd++;
+    }
+    size_t tokSize = tokEnd-line.first;
+    if(tokSize==4 && strncmp(line.first, "#end", 4)==0){
+      out.ended = true;
+      return;
+    }
+    if(tokSize!=1){
       continue;
     }
-    stringstream ss(line);
-    ss>>tok;
-    if(tok==vTok) {
-      Vector3d vec;
-      ss>>vec[0]>>vec[1]>>vec[2];
-      v.push_back(vec);
-    } else if(tok==fTok) {
-      bool hasTexture = false;
-      if (line.find(bslash) != string::npos) {
-        replace(line.begin(), line.end(), bslash, space);
-        hasTexture = true;
+    if(*line.first=='v'){
+      for(int ii = 0; ii<3; ii++){
+        double x;
+        if(!parseNumber(tokEnd, line.second, &x)){
+          out.malformed = true;
+          return;
+        }
+        out.v.push_back(x);
       }
-      stringstream facess(line);
-      facess>>tok;
-      vector<int> vidx;
+    }else if(*line.first=='f'){
+      //vertex indices, skipping texture coordinate and normal indices
+      vidx.clear();
       int x;
-      while(facess>>x){
-        vidx.push_back(x);
-        if(hasTexture){
-          facess>>x;
+      while(parseNumber(tokEnd, line.second, &x)){
+        //relative indices are not supported
+        if(x<=0){
+          out.malformed = true;
+          return;
+        }
+        vidx.push_back(x-1);
+        while(tokEnd<line.second && !isBlank(*tokEnd)){
+          tokEnd++;
         }
       }
+      if(vidx.size()<3){
+        out.malformed = true;
+        return;
+      }
       for(unsigned ii = 0;ii<vidx.size()-2;ii++){
-        Vector3i trig;
-        trig[0] = vidx[0]-1;
-        for (int jj = 1; jj < 3; jj++) {
-          trig[jj] = vidx[ii+jj]-1;
-        }
-        t.push_back(trig);
+        out.t.push_back(vidx[0]);
+        out.t.push_back(vidx[ii+1]);
+        out.t.push_back(vidx[ii+2]);
       }
     }
   }
+}
+
+int MeshArrays::loadObj(istream & in)
+{
+  string text = readStream(in);
+  vector<LineRange> chunks = splitLines(text.data(),
+                                        text.data()+text.size());
+  vector<ObjChunk> objChunks(chunks.size());
+  util::parallelFor(chunks.size(), [&](size_t ci){
+    parseObjChunk(chunks[ci].first, chunks[ci].second, objChunks[ci]);
+  });
+
+  elementSize = 3;
+  for(size_t ci = 0; ci<objChunks.size(); ci++){
+    if(objChunks[ci].malformed){
+      std::cerr << "Malformed obj vertex or face" << std::endl;
+      return -1;
+    }
+    v.insert(v.end(), objChunks[ci].v.begin(), objChunks[ci].v.end());
+    e.insert(e.end(), objChunks[ci].t.begin(), objChunks[ci].t.end());
+    if(objChunks[ci].ended){
+      break;
+    }
+  }
+  return 0;
+}
+
+int Mesh::load(const char * filename)
+{
+  ifstream in;
+  int status = openIfstream(in,filename);
+  if(status<0){
+    return status;
+  }
+  status = load(in);
+  in.close();
+  return status;
+}
+
+int Mesh::load(std::string filename) {
+  return load(filename.c_str());
+}
+
+int Mesh::load(istream & in)
+{
+  MeshArrays arrays;
+  int status = arrays.loadObj(in);
+  if(status<0){
+    return status;
+  }
+  size_t vStart = v.size(), tStart = t.size();
+  v.resize(vStart + arrays.numVertices());
+  t.resize(tStart + arrays.numElements());
+  for(size_t ii = 0; ii<arrays.numVertices(); ii++){
+    std::copy(&arrays.v[3*ii], &arrays.v[3*ii]+3, v[vStart+ii].begin());
+  }
+  for(size_t ii = 0; ii<arrays.numElements(); ii++){
+    std::copy(&arrays.e[3*ii], &arrays.e[3*ii]+3, t[tStart+ii].begin());
+  }
   return 0;
 }
 
@@ -251,72 +571,24 @@ int MeshVol::loadTet(std::string nodeFile, std::string eleFile) {
 
 int MeshVol::loadTet(istream & nodeIn, istream & eleIn)
 {
-  
-  //load vertices
-  int intVal;
-  nodeIn>>intVal;
-  v.resize(intVal);
-  string line;
-  unsigned int cnt = 0;
-  //discard rest of the first line.
-  getline(nodeIn,line);
-  while(1) {
-    getline(nodeIn,line);
-    if(nodeIn.eof()) {
-      break;
-    }
-    //skip empty lines
-    if(line.size()<3) {
-      continue;
-    }
-    //skip comments
-    if(line.at(0)=='#') {
-      continue;
-    }
-    stringstream ss(line);
-    
-    ss>>intVal;
-    for(int ii = 0;ii<3;ii++){
-      ss>>v[cnt][ii];
-    }
-    cnt ++ ;
-    if(cnt>=v.size()){
-      break;
-    }
+  MeshArrays arrays;
+  int status = arrays.loadTet(nodeIn, eleIn);
+  if(status<0){
+    return status;
   }
-  
-  //load elements
-  eleIn>>intVal;
-  e.resize(intVal);
-  
-  int nV=0;
-  eleIn>>nV;
-  cnt = 0;
-  getline(eleIn,line);
-  while(1) {
-    getline(eleIn,line);
-    if(eleIn.eof()) {
-      break;
-    }
-    if(line.size()<3) {
-      continue;
-    }
-    if(line.at(0)=='#') {
-      continue;
+  v.resize(arrays.numVertices());
+  e.resize(arrays.numElements());
+  int nV = arrays.elementSize;
+  parallelBlocks(v.size(), [&](size_t begin, size_t end){
+    for(size_t ii = begin; ii<end; ii++){
+      std::copy(&arrays.v[3*ii], &arrays.v[3*ii]+3, v[ii].begin());
     }
-    stringstream ss(line);
-    ss>>intVal;
-    
-    e[cnt].resize(nV);
-    for(int ii = 0;ii<nV;ii++){
-      ss>>e[cnt][ii];
+  });
+  parallelBlocks(e.size(), [&](size_t begin, size_t end){
+    for(size_t ii = begin; ii<end; ii++){
+      e[ii].assign(&arrays.e[ii*nV], &arrays.e[ii*nV]+nV);
     }
-    
-    cnt ++ ;
-    if(cnt>=e.size()){
-      break;
-    }
-  }
+  });
   return 0;
 }
 
@@ -338,49 +610,53 @@ int MeshVol::loadTetEdge(std::string edgeFile) {
 
 int MeshVol::loadTetEdge(istream & edgeIn)
 {
-  //load vertices
-  int intVal;
-  edgeIn>>intVal;
-  edges.resize(intVal);
-  string line;
-  unsigned int cnt = 0;
-  //discard rest of the first line.
-  getline(edgeIn,line);
-  while(1) {
-    getline(edgeIn,line);
-    if(edgeIn.eof()) {
-      break;
-    }
-    //skip empty lines
-    if(line.size()<3) {
-      continue;
-    }
-    //skip comments
-    if(line.at(0)=='#') {
-      continue;
-    }
-    stringstream ss(line);
-    
-    ss>>intVal;
-    for(int ii = 0;ii<2;ii++){
-      ss>>edges[cnt][ii];
-    }
-    cnt ++ ;
-    if(cnt>=edges.size()){
-      break;
-    }
+  MeshArrays arrays;
+  int status = arrays.loadTetEdge(edgeIn);
+  if(status<0){
+    return status;
+  }
+  edges.resize(arrays.numElements());
+  for(size_t ii = 0; ii<edges.size(); ii++){
+    edges[ii][0] = arrays.e[2*ii];
+    edges[ii][1] = arrays.e[2*ii+1];
   }
   return 0;
 }
 
 void MeshVol::elementNeighbors(vector<vector<int> > & eleNeighbor)
 {
+  //count the elements of each vertex, size the lists, then fill them through
+  //atomic cursors. Filling is unordered, so the new entries are sorted.
   eleNeighbor.resize(v.size());
-  for(unsigned int ii = 0;ii<e.size();ii++){
-    for(unsigned int jj = 0;jj<e[ii].size();jj++){
-      eleNeighbor[e[ii][jj]].push_back(ii);
+  vector<atomic<int> > cursor(v.size());
+  parallelBlocks(e.size(), [&](size_t begin, size_t end){
+    for(size_t ii = begin; ii<end; ii++){
+      for(unsigned int jj = 0;jj<e[ii].size();jj++){
+        cursor[e[ii][jj]]++;
+      }
     }
-  }
+  });
+  vector<size_t> start(v.size());
+  parallelBlocks(v.size(), [&](size_t begin, size_t end){
+    for(size_t vi = begin; vi<end; vi++){
+      start[vi] = eleNeighbor[vi].size();
+      eleNeighbor[vi].resize(start[vi] + cursor[vi]);
+      cursor[vi] = 0;
+    }
+  });
+  parallelBlocks(e.size(), [&](size_t begin, size_t end){
+    for(size_t ii = begin; ii<end; ii++){
+      for(unsigned int jj = 0;jj<e[ii].size();jj++){
+        int vi = e[ii][jj];
+        eleNeighbor[vi][start[vi] + cursor[vi]++] = ii;
+      }
+    }
+  });
+  parallelBlocks(v.size(), [&](size_t begin, size_t end){
+    for(size_t vi = begin; vi<end; vi++){
+      std::sort(eleNeighbor[vi].begin()+start[vi], eleNeighbor[vi].end());
+    }
+  });
 }
 
 int findFace(const IntMap & m, int ei, const MeshVol & vol){
@@ -499,22 +775,6 @@ void MeshVol::makeHexSurf()
   }
 }
 
-int findTetFace(const IntMap & m, int ei, const MeshVol & vol)
-{
-  for(int fi = 0;fi<4;fi++){
-    int cnt = 0;
-    for(int fv = 0;fv<3;fv++){
-      if(m.at(vol.e[ei][TetFaces[fi][fv]])==2){
-        cnt++;
-      }
-    }
-    if(cnt==3){
-      return fi;
-    }
-  }
-  return 0;
-}
-
 int MeshVol::saveTetObj(const char * filename)
 {
   if(surf.v.size()==0){
@@ -531,42 +791,30 @@ int MeshVol::saveTetObj(std::string filename) {
 void MeshVol::makeTetSurf()
 {
   exterior.resize(e.size());
-  for(unsigned int ii = 0;ii<exterior.size();ii++){
-    unsigned int nV = e[ii].size();
-    exterior[ii].resize(nV, true);
-  }
   
-  //mark exterior faces
+  //mark exterior faces, which no other element shares. Each element only
+  //writes its own flags, so elements are processed in parallel.
   vector<vector<int > > eleNeighbor;
   elementNeighbors(eleNeighbor);
-  for(unsigned int ii =0 ;ii<v.size();ii++){
-    for(unsigned int nj = 0; nj<eleNeighbor[ii].size()-1;nj++){
-      int jj = eleNeighbor[ii][nj];
-      for(unsigned int nk = nj+1; nk<eleNeighbor[ii].size();nk++){
-        int kk = eleNeighbor[ii][nk];
-        IntMap im;
-        for(unsigned int vv = 0;vv<e[jj].size();vv++){
-          im[e[jj][vv]] = 1;
-        }
-        for(unsigned int vv = 0;vv<e[kk].size();vv++){
-          int key = e[kk][vv];
-          auto entry = im.find(key);
-          if(entry!=im.end()){
-            im[key] = 2;
-          }else{
-            im[key] = 1;
+  parallelBlocks(e.size(), [&](size_t begin, size_t end){
+    for(size_t ii = begin; ii<end; ii++){
+      exterior[ii].assign(e[ii].size(), true);
+      for(int fi = 0;fi<4;fi++){
+        int v0 = e[ii][TetFaces[fi][0]];
+        int v1 = e[ii][TetFaces[fi][1]];
+        int v2 = e[ii][TetFaces[fi][2]];
+        for(int kk : eleNeighbor[v0]){
+          const vector<int> & other = e[kk];
+          if((size_t)kk!=ii &&
+             std::find(other.begin(), other.end(), v1)!=other.end() &&
+             std::find(other.begin(), other.end(), v2)!=other.end()){
+            exterior[ii][fi] = false;
+            break;
           }
         }
-        if(im.size()==5){
-          //share a face
-          int fi = findTetFace(im, jj, *this);
-          exterior[jj][fi] = false;
-          fi = findTetFace(im, kk, *this);
-          exterior[kk][fi] = false;
-        }
       }
     }
-  }
+  });
   //save exterior vertices and exterior faces
   vidx.resize(v.size(),-1);
   int vCnt = 0;
@@ -7,6 +7,35 @@
 #include <string>
 namespace simit{
 
+///vertices and fixed-size elements in flat arrays, which can be added to
+///sets in bulk (see Set::addElements).
+///Text files are split into chunks of lines that are parsed on separate
+///threads.
+struct MeshArrays{
+  MeshArrays():elementSize(0){}
+  ///3 coordinates per vertex
+  std::vector<double> v;
+  ///elementSize vertex indices per element
+  std::vector<int> e;
+  int elementSize;
+
+  size_t numVertices() const {return v.size()/3;}
+  size_t numElements() const {return elementSize==0 ? 0 : e.size()/elementSize;}
+
+  ///load a TetGen .node and .ele file.
+  ///return -1 if failed to load or a file is malformed
+  int loadTet(std::string nodeFile, std::string eleFile);
+  int loadTet(std::istream & nodeIn, std::istream & eleIn);
+  ///load the edges of a TetGen .edge file as elements. Does not touch v.
+  ///return -1 if failed to load or the file is malformed
+  int loadTetEdge(std::string edgeFile);
+  int loadTetEdge(std::istream & edgeIn);
+  ///load the vertices and faces of an obj file, split into triangles.
+  ///return -1 if failed to load or the file is malformed
+  int loadObj(std::string filename);
+  int loadObj(std::istream & in);
+};
+
 ///a triagular mesh data structure for loading
 ///plain text obj files. Does not work with quad mesh.
 ///Assumes one object per file.
@@ -76,7 +105,8 @@ struct MeshVol{
   int saveTetObj(const char * filename);
   int saveTetObj(std::string filename);
 
-  ///for each vertex, what elements contain the vertex.
+  ///for each vertex, what elements contain the vertex, in ascending order.
+  ///Computed in parallel.
   void elementNeighbors(std::vector<std::vector<int> > & eleNeighbor);
   
   //is a face exterior
@@ -89,7 +119,7 @@ struct MeshVol{
   void updateSurfVert();
   //construct surface mesh for hexahedral finite elements.
   void makeHexSurf();
-  //construct surface for tetrahedral.
+  //construct surface for tetrahedral. Exterior faces are found in parallel.
   void makeTetSurf();
 };
 
@@ -0,0 +1,241 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#include "allocator.h"
+#include "error.h"
+#include "graph.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+#ifdef __linux__
+// From linux/mempolicy.h, which is not always installed
+const int kMpolPreferred = 1;
+const int kMpolInterleave = 3;
+const unsigned kMpolMfMove = 1 << 1;
+#endif
+
+std::atomic<int> fieldPlacement((int)FieldPlacement::Local);
+
+/// Parse a kernel CPU or node list such as "0-3,8,10-11".
+vector<int> parseList(const string& list) {
+  vector<int> values;
+  stringstream ss(list);
+  string range;
+  while (getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    size_t dash = range.find('-');
+    int first = atoi(range.substr(0, dash).c_str());
+    int last = (dash == string::npos) ? first
+                                      : atoi(range.substr(dash+1).c_str());
+    for (int value = first; value <= last; ++value) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+string readLine(const string& path) {
+  ifstream file(path);
+  string line;
+  getline(file, line);
+  return line;
+}
+
+size_t pageSize() {
+  static const size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+/// Apply the current placement to the whole pages of `bytes` bytes at `data`,
+/// of which the first `usedBytes` hold elements. Pages that have been written
+/// are only moved if `move` is set.
+void place(void* data, size_t bytes, size_t usedBytes, bool move) {
+#ifdef __linux__
+  const int numNodes = getNumNumaNodes();
+  FieldPlacement current = getFieldPlacement();
+  if (data == nullptr || numNodes <= 1 || current == FieldPlacement::Local) {
+    return;
+  }
+
+  const uintptr_t page = pageSize();
+  const uintptr_t start = (uintptr_t)data;
+  const uintptr_t begin = (start + page-1) / page * page;
+  const uintptr_t end = (start + bytes) / page * page;
+  if (begin >= end) {
+    return;
+  }
+
+  const unsigned flags = move ? kMpolMfMove : 0;
+  const size_t maskWords = (numNodes + 63) / 64;
+  vector<unsigned long> mask(maskWords, 0);
+  if (current == FieldPlacement::Interleave) {
+    for (int node = 0; node < numNodes; ++node) {
+      mask[node/64] |= 1ul << (node%64);
+    }
+    syscall(SYS_mbind, (void*)begin, end-begin, kMpolInterleave, mask.data(),
+            numNodes+1, flags);
+    return;
+  }
+
+  // Partitioned: a page goes to the node of the block its first byte is in,
+  // and the unused capacity to the last node
+  if (usedBytes == 0) {
+    usedBytes = bytes;
+  }
+  uintptr_t blockBegin = begin;
+  for (int node = 0; node < numNodes; ++node) {
+    uintptr_t blockEnd = end;
+    if (node < numNodes-1) {
+      blockEnd = start + usedBytes * (node+1) / numNodes;
+      blockEnd = std::max(begin, std::min(end, (blockEnd+page-1)/page*page));
+    }
+    if (blockBegin < blockEnd) {
+      std::fill(mask.begin(), mask.end(), 0);
+      mask[node/64] |= 1ul << (node%64);
+      syscall(SYS_mbind, (void*)blockBegin, blockEnd-blockBegin,
+              kMpolPreferred, mask.data(), numNodes+1, flags);
+    }
+    blockBegin = std::max(blockBegin, blockEnd);
+  }
+#endif
+}
+
+}
+
+void setFieldPlacement(FieldPlacement placement) {
+  fieldPlacement = (int)placement;
+}
+
+FieldPlacement getFieldPlacement() {
+  return (FieldPlacement)fieldPlacement.load();
+}
+
+int getNumNumaNodes() {
+  static const int numNodes = []() {
+    vector<int> nodes = parseList(readLine("/sys/devices/system/node/online"));
+    int maxNode = 0;
+    for (int node : nodes) {
+      maxNode = std::max(maxNode, node);
+    }
+    return maxNode + 1;
+  }();
+  return numNodes;
+}
+
+int getWorkerNode(unsigned worker, unsigned numWorkers) {
+  simit_iassert(worker < numWorkers);
+  return (int)((size_t)worker * getNumNumaNodes() / numWorkers);
+}
+
+std::vector<int> getNodeCPUs(int node) {
+  simit_uassert(node >= 0 && node < getNumNumaNodes())
+      << "no NUMA node " << node;
+  return parseList(readLine("/sys/devices/system/node/node" +
+                            to_string(node) + "/cpulist"));
+}
+
+bool bindThreadToNode(int node) {
+#ifdef __linux__
+  vector<int> cpus = getNodeCPUs(node);
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return node == 0;
+#endif
+}
+
+void placeFields(Set* set) {
+  for (const Set::FieldData* field : set->getFields()) {
+    size_t bytes = (size_t)set->getSize() * field->sizeOfType;
+    place(field->data, bytes, bytes, true);
+  }
+}
+
+std::vector<size_t> getPagesPerNode(const void* data, size_t bytes) {
+  const int numNodes = getNumNumaNodes();
+  vector<size_t> pages(numNodes+1, 0);
+  const uintptr_t page = pageSize();
+  const uintptr_t begin = (uintptr_t)data / page * page;
+  const uintptr_t end = ((uintptr_t)data + bytes + page-1) / page * page;
+  if (data == nullptr || begin >= end) {
+    return pages;
+  }
+  const size_t count = (end - begin) / page;
+
+#ifdef __linux__
+  vector<void*> addresses(count);
+  for (size_t i = 0; i < count; ++i) {
+    addresses[i] = (void*)(begin + i*page);
+  }
+  vector<int> status(count, -1);
+  if (syscall(SYS_move_pages, 0, count, addresses.data(), nullptr,
+              status.data(), 0) == 0) {
+    for (int node : status) {
+      pages[(node >= 0 && node < numNodes) ? node : numNodes] += 1;
+    }
+    return pages;
+  }
+#endif
+  pages[0] = count;
+  return pages;
+}
+
+void printFieldPlacement(std::ostream& os, Set* set) {
+  const int numNodes = getNumNumaNodes();
+  for (const Set::FieldData* field : set->getFields()) {
+    vector<size_t> pages = getPagesPerNode(field->data,
+                                           set->getSize()*field->sizeOfType);
+    os << field->name << ":";
+    for (int node = 0; node < numNodes; ++node) {
+      os << " node" << node << "=" << pages[node];
+    }
+    os << " unwritten=" << pages[numNodes] << std::endl;
+  }
+}
+
+namespace internal {
+
+void* allocateFieldData(Allocator* allocator, size_t capacity,
+                        size_t numElements, size_t elementBytes) {
+  void* data = allocator->allocate(capacity*elementBytes);
+  place(data, capacity*elementBytes, numElements*elementBytes, false);
+  return data;
+}
+
+void* reallocateFieldData(Allocator* allocator, void* data,
+                          size_t oldCapacity, size_t newCapacity,
+                          size_t numElements, size_t elementBytes) {
+  data = allocator->reallocate(data, oldCapacity*elementBytes,
+                               newCapacity*elementBytes);
+  place(data, newCapacity*elementBytes, numElements*elementBytes, false);
+  return data;
+}
+
+}}
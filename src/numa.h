@@ -0,0 +1,85 @@
+#ifndef SIMIT_NUMA_H
+#define SIMIT_NUMA_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+/// \file
+/// Placement of set fields on the NUMA nodes (sockets) of the machine. By
+/// default a page lands on the node of the thread that first writes it, and
+/// since fields are allocated and grown by one thread, all of a set's fields
+/// end up behind one memory controller. Interleaved and partitioned
+/// placement spread them across nodes. Placement is a hint: it has no effect
+/// on machines with one node or where the kernel refuses it.
+
+namespace simit {
+class Allocator;
+class Set;
+
+/// How the pages of set fields are placed on NUMA nodes.
+enum class FieldPlacement {
+  /// Pages go to the node of the thread that first writes them.
+  Local,
+
+  /// Pages are interleaved across the nodes, so loops running on all nodes
+  /// share all the memory controllers.
+  Interleave,
+
+  /// The elements of a set are split into one contiguous block per node, in
+  /// the same static partition parallel loops use when worker `w` of `n`
+  /// processes the w'th of n equal blocks on node `getWorkerNode(w, n)`. Each
+  /// block's pages go to its node, so such loops read local memory.
+  Partitioned
+};
+
+/// Set the placement of fields that are allocated or grown from now on. Use
+/// placeFields to move the pages of existing fields.
+void setFieldPlacement(FieldPlacement placement);
+FieldPlacement getFieldPlacement();
+
+/// The number of NUMA nodes of the machine (1 if it has no NUMA support).
+int getNumNumaNodes();
+
+/// The node that worker `worker` of `numWorkers` runs on in parallel loops
+/// over partitioned fields, where workers are spread evenly over the nodes.
+int getWorkerNode(unsigned worker, unsigned numWorkers);
+
+/// The CPUs of `node`, or none if they are not known.
+std::vector<int> getNodeCPUs(int node);
+
+/// Restrict the calling thread to the CPUs of `node`.
+/// Returns false if the thread could not be bound.
+bool bindThreadToNode(int node);
+
+/// Move the pages of the fields of `set` to where the current placement puts
+/// them, e.g. after the set has been built.
+void placeFields(Set* set);
+
+/// The number of pages of `bytes` bytes at `data` on each node, followed by
+/// the number of pages that have not been written yet.
+std::vector<size_t> getPagesPerNode(const void* data, size_t bytes);
+
+/// Print the number of pages of each field of `set` on each node.
+void printFieldPlacement(std::ostream& os, Set* set);
+
+namespace internal {
+
+/// Allocate zeroed data from `allocator` for `capacity` elements of a field
+/// with `numElements` elements, placed by the current field placement. The
+/// pages are bound to their nodes before they are first written, which places
+/// them like a first touch by the workers of each node would, without a
+/// parallel pass to zero them. Pages the allocator has already written, such
+/// as those of the DefaultAllocator's small allocations from the C heap, are
+/// not moved; placeFields moves them.
+void* allocateFieldData(Allocator* allocator, size_t capacity,
+                        size_t numElements, size_t elementBytes);
+
+/// Grow field data from `oldCapacity` to `newCapacity` elements, zeroing the
+/// new elements and placing them by the current field placement.
+void* reallocateFieldData(Allocator* allocator, void* data,
+                          size_t oldCapacity, size_t newCapacity,
+                          size_t numElements, size_t elementBytes);
+
+}}
+#endif
@@ -0,0 +1,299 @@
+#include "partition.h"
+
+#include <algorithm>
+#include <deque>
+#include <set>
+
+#include "error.h"
+#include "graph.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+/// The vertex adjacency of a graph in CSR form, where `nbrs[coords[v]:
+/// coords[v+1]]` are the neighbors of `v` (with repeats for parallel edges).
+struct Adjacency {
+  vector<int> coords;
+  vector<int> nbrs;
+};
+
+Adjacency buildAdjacency(const Set& vertices,
+                         const vector<const Set*>& edgeSets) {
+  const int numVertices = vertices.getSize();
+  vector<pair<int,int>> pairs;
+  for (const Set* edges : edgeSets) {
+    const int cardinality = edges->getCardinality();
+    for (int i = 0; i < cardinality; ++i) {
+      simit_uassert(edges->getEndpointSet(i) == &vertices)
+          << "can only partition edge sets whose endpoints are the vertices";
+    }
+    for (ElementRef edge : *edges) {
+      for (int i = 0; i < cardinality; ++i) {
+        int u = edges->getEndpoint(edge, i).getIdent();
+        for (int j = i+1; j < cardinality; ++j) {
+          int v = edges->getEndpoint(edge, j).getIdent();
+          if (u != v) {
+            pairs.push_back({u,v});
+            pairs.push_back({v,u});
+          }
+        }
+      }
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  Adjacency adjacency;
+  adjacency.coords.assign(numVertices+1, 0);
+  adjacency.nbrs.reserve(pairs.size());
+  for (const pair<int,int>& p : pairs) {
+    ++adjacency.coords[p.first+1];
+    adjacency.nbrs.push_back(p.second);
+  }
+  for (int v = 0; v < numVertices; ++v) {
+    adjacency.coords[v+1] += adjacency.coords[v];
+  }
+  return adjacency;
+}
+
+/// Breadth-first order of the vertices `subset` of the graph, where `inSubset`
+/// is `stamp` for exactly the subset's vertices. Each component is started
+/// from a pseudo-peripheral vertex: the last vertex reached from its first
+/// vertex.
+vector<int> breadthFirstOrder(const Adjacency& graph, const vector<int>& subset,
+                              vector<int>* inSubset, int stamp) {
+  vector<int> order;
+  order.reserve(subset.size());
+  vector<int>& mark = *inSubset;
+  deque<int> queue;
+
+  // Visit the vertices reached from `root`, marking them `visited`
+  auto visit = [&](int root, int visited, vector<int>* reached) {
+    mark[root] = visited;
+    queue.push_back(root);
+    while (!queue.empty()) {
+      int v = queue.front();
+      queue.pop_front();
+      reached->push_back(v);
+      for (int i = graph.coords[v]; i < graph.coords[v+1]; ++i) {
+        int u = graph.nbrs[i];
+        if (mark[u] == stamp) {
+          mark[u] = visited;
+          queue.push_back(u);
+        }
+      }
+    }
+  };
+
+  for (int start : subset) {
+    if (mark[start] != stamp) {
+      continue;
+    }
+    vector<int> component;
+    visit(start, -stamp-1, &component);
+    for (int v : component) {
+      mark[v] = stamp;
+    }
+    visit(component.back(), -stamp-2, &order);
+  }
+  return order;
+}
+
+/// Improve the bisection of a subset into the vertices with `side` 0 and 1
+/// with Fiduccia-Mattheyses passes: move the vertex that cuts the most fewer
+/// edges (or the fewest more) to the other side, lock it, and repeat, then
+/// keep the moves up to the smallest cut. Sides stay within `slack` vertices
+/// of their initial sizes.
+void refineBisection(const Adjacency& graph, const vector<int>& subset,
+                     vector<int>* side) {
+  const int slack = std::max((int)subset.size()/64, 1);
+  int targets[2] = {0, 0};
+  for (int v : subset) {
+    ++targets[(*side)[v]];
+  }
+
+  // The number of edges the move of `v` would remove from the cut
+  auto gainOf = [&](int v) {
+    int gain = 0;
+    for (int i = graph.coords[v]; i < graph.coords[v+1]; ++i) {
+      int u = graph.nbrs[i];
+      if ((*side)[u] >= 0) {
+        gain += ((*side)[u] != (*side)[v]) ? 1 : -1;
+      }
+    }
+    return gain;
+  };
+
+  const int maxPasses = 8;
+  const size_t maxFruitlessMoves = 64;
+  vector<int> gains(graph.coords.size()-1, 0);
+  vector<bool> locked(graph.coords.size()-1, false);
+  for (int pass = 0; pass < maxPasses; ++pass) {
+    set<pair<int,int>> queues[2];    // (-gain, vertex) of each side
+    int sizes[2] = {targets[0], targets[1]};
+    for (int v : subset) {
+      gains[v] = gainOf(v);
+      locked[v] = false;
+      queues[(*side)[v]].insert({-gains[v], v});
+    }
+
+    vector<int> moves;
+    int gain = 0;
+    int bestGain = 0;
+    size_t numBestMoves = 0;
+    while (moves.size() - numBestMoves < maxFruitlessMoves) {
+      int from = -1;
+      for (int s = 0; s < 2; ++s) {
+        bool feasible = !queues[s].empty() &&
+                        sizes[1-s]+1 <= targets[1-s]+slack &&
+                        sizes[s]-1 >= targets[s]-slack;
+        if (feasible && (from == -1 ||
+                         *queues[s].begin() < *queues[from].begin())) {
+          from = s;
+        }
+      }
+      if (from == -1) {
+        break;
+      }
+      int v = queues[from].begin()->second;
+      queues[from].erase(queues[from].begin());
+      (*side)[v] = 1-from;
+      locked[v] = true;
+      --sizes[from];
+      ++sizes[1-from];
+      gain += gains[v];
+      moves.push_back(v);
+      if (gain > bestGain) {
+        bestGain = gain;
+        numBestMoves = moves.size();
+      }
+      for (int i = graph.coords[v]; i < graph.coords[v+1]; ++i) {
+        int u = graph.nbrs[i];
+        if ((*side)[u] < 0 || locked[u]) {
+          continue;
+        }
+        queues[(*side)[u]].erase({-gains[u], u});
+        gains[u] += ((*side)[u] == 1-from) ? -2 : 2;
+        queues[(*side)[u]].insert({-gains[u], u});
+      }
+    }
+
+    for (size_t i = numBestMoves; i < moves.size(); ++i) {
+      (*side)[moves[i]] = 1 - (*side)[moves[i]];
+    }
+    if (bestGain <= 0) {
+      break;
+    }
+  }
+}
+
+/// Split `subset` into parts `firstPart` to `firstPart+numParts-1`.
+void bisect(const Adjacency& graph, const vector<int>& subset, int firstPart,
+            int numParts, vector<int>* parts, vector<int>* inSubset,
+            int* stamp) {
+  if (numParts == 1) {
+    for (int v : subset) {
+      (*parts)[v] = firstPart;
+    }
+    return;
+  }
+
+  // Stamps are positive and visited marks negative, so they never collide
+  int subsetStamp = (*stamp += 2);
+  for (int v : subset) {
+    (*inSubset)[v] = subsetStamp;
+  }
+  vector<int> order = breadthFirstOrder(graph, subset, inSubset, subsetStamp);
+
+  int leftParts = numParts / 2;
+  size_t split = order.size() * leftParts / numParts;
+  vector<int> side(graph.coords.size()-1, -1);
+  for (size_t i = 0; i < order.size(); ++i) {
+    side[order[i]] = (i < split) ? 0 : 1;
+  }
+  refineBisection(graph, order, &side);
+  vector<int> left, right;
+  for (int v : order) {
+    (side[v] == 0 ? left : right).push_back(v);
+  }
+  bisect(graph, left, firstPart, leftParts, parts, inSubset, stamp);
+  bisect(graph, right, firstPart+leftParts, numParts-leftParts, parts,
+         inSubset, stamp);
+}
+
+/// Move boundary vertices to the part most of their neighbors are in, if that
+/// cuts fewer edges and keeps the part sizes within [minSize,maxSize].
+void refine(const Adjacency& graph, int numParts, vector<int>* parts) {
+  const int numVertices = parts->size();
+  const double average = (double)numVertices / numParts;
+  const int maxSize = (int)(1.03*average) + 1;
+  const int minSize = std::max((int)(0.97*average), 1);
+
+  vector<int> sizes(numParts, 0);
+  for (int part : *parts) {
+    ++sizes[part];
+  }
+
+  const int maxPasses = 4;
+  vector<int> tally(numParts, 0);
+  vector<int> touched;
+  for (int pass = 0; pass < maxPasses; ++pass) {
+    int numMoved = 0;
+    for (int v = 0; v < numVertices; ++v) {
+      int own = (*parts)[v];
+      touched.clear();
+      for (int i = graph.coords[v]; i < graph.coords[v+1]; ++i) {
+        int part = (*parts)[graph.nbrs[i]];
+        if (tally[part]++ == 0) {
+          touched.push_back(part);
+        }
+      }
+      int best = own;
+      for (int part : touched) {
+        if (tally[part] > tally[best] && sizes[part] < maxSize) {
+          best = part;
+        }
+      }
+      if (best != own && sizes[own] > minSize) {
+        (*parts)[v] = best;
+        --sizes[own];
+        ++sizes[best];
+        ++numMoved;
+      }
+      for (int part : touched) {
+        tally[part] = 0;
+      }
+    }
+    if (numMoved == 0) {
+      break;
+    }
+  }
+}
+
+}
+
+std::vector<int> partitionGraph(const Set& vertices,
+                                const std::vector<const Set*>& edgeSets,
+                                int numParts) {
+  simit_uassert(numParts > 0) << "must partition into at least one part";
+  const int numVertices = vertices.getSize();
+  vector<int> parts(numVertices, 0);
+  if (numParts == 1 || numVertices == 0) {
+    return parts;
+  }
+
+  Adjacency graph = buildAdjacency(vertices, edgeSets);
+  vector<int> all(numVertices);
+  for (int v = 0; v < numVertices; ++v) {
+    all[v] = v;
+  }
+  vector<int> inSubset(numVertices, 0);
+  int stamp = 0;
+  bisect(graph, all, 0, numParts, &parts, &inSubset, &stamp);
+  refine(graph, numParts, &parts);
+  return parts;
+}
+
+}
@@ -0,0 +1,25 @@
+#ifndef SIMIT_PARTITION_H
+#define SIMIT_PARTITION_H
+
+#include <vector>
+
+namespace simit {
+class Set;
+
+/// Partition `vertices` into `numParts` parts of nearly equal size, with few
+/// of the edges of `edgeSets` between parts, and return the part of each
+/// vertex. The edge sets' endpoints must all be in `vertices`, and an edge
+/// connects each pair of its endpoints.
+///
+/// The vertices are split by recursive bisection of breadth-first orderings
+/// from pseudo-peripheral vertices, each bisection improved with
+/// Fiduccia-Mattheyses passes, and boundary vertices are then moved to the
+/// part most of their neighbors are in while the parts stay within 3% of the
+/// average size. The result only depends on the topology, so every process
+/// that holds the graph computes the same partition.
+std::vector<int> partitionGraph(const Set& vertices,
+                                const std::vector<const Set*>& edgeSets,
+                                int numParts);
+
+}
+#endif
@@ -1,6 +1,8 @@
 #include "path_indices.h"
 
+#include <algorithm>
 #include <iostream>
+#include <set>
 #include <stack>
 #include <map>
 #include <vector>
@@ -41,8 +43,8 @@ unsigned SetEndpointPathIndex::numNeighbors(unsigned elemID) const {
   return edgeSet.getCardinality();
 }
 
-unsigned SetEndpointPathIndex::numNeighbors() const {
-  return numElements() * edgeSet.getCardinality();
+size_t SetEndpointPathIndex::numNeighbors() const {
+  return (size_t)numElements() * edgeSet.getCardinality();
 }
 
 SetEndpointPathIndex::Neighbors
@@ -96,12 +98,12 @@ SegmentedPathIndex::neighbors(unsigned elemID) const {
   class SegmentNeighbors : public PathIndexImpl::Neighbors::Base {
     class Iterator : public PathIndexImpl::Neighbors::Iterator::Base {
     public:
-      /// nbrs points to the neighbor segment of the current element.
-      Iterator(unsigned currNbr, const unsigned *nbrs)
-          : currNbr(currNbr), nbrs(nbrs) {}
+      /// currNbr is the location of the current neighbor in the sinks.
+      Iterator(size_t currNbr, const SegmentedPathIndex *index)
+          : currNbr(currNbr), index(index) {}
 
       void operator++() {++currNbr;}
-      unsigned operator*() const {return nbrs[currNbr];}
+      unsigned operator*() const {return index->sink(currNbr);}
       Base* clone() const {return new Iterator(*this);}
 
     protected:
@@ -111,38 +113,127 @@ SegmentedPathIndex::neighbors(unsigned elemID) const {
       }
 
     private:
-      unsigned currNbr;
-      const unsigned *nbrs;
+      size_t currNbr;
+      const SegmentedPathIndex *index;
     };
 
   public:
-    SegmentNeighbors(unsigned numNbrs, const unsigned *nbrs)
-        : numNbrs(numNbrs), nbrs(nbrs) {}
+    SegmentNeighbors(size_t start, size_t end, const SegmentedPathIndex *index)
+        : start(start), end_(end), index(index) {}
 
-    Neighbors::Iterator begin() const {return new Iterator(0, nbrs);}
-    Neighbors::Iterator end() const {return new Iterator(numNbrs, nbrs);}
+    Neighbors::Iterator begin() const {return new Iterator(start, index);}
+    Neighbors::Iterator end() const {return new Iterator(end_, index);}
 
   private:
-    unsigned numNbrs;
-    const unsigned *nbrs;
+    size_t start;
+    size_t end_;
+    const SegmentedPathIndex *index;
   };
 
-  return new SegmentNeighbors(numNeighbors(elemID),
-                              &sinksData[coordsData[elemID]]);
+  simit_iassert(numElems > elemID);
+  return new SegmentNeighbors(coord(elemID), coord(elemID+1), this);
 }
 
 void SegmentedPathIndex::print(std::ostream &os) const {
   os << "SegmentedPathIndex:";
   os << "\n  ";
   for (size_t i=0; i < numElements()+1; ++i) {
-    os << coordsData[i] << " ";
+    os << coord(i) << " ";
   }
   os << "\n  ";
   for (size_t i=0; i < numNeighbors(); ++i) {
-    os << sinksData[i] << " ";
+    os << sink(i) << " ";
   }
 }
 
+/// Allocate an array of `n` unsigned integers that are `bytes` wide.
+static void* allocateIndex(Allocator* allocator, size_t n, unsigned bytes) {
+  return allocator->allocate(n*bytes);
+}
+
+/// Store `val` at location `i` of an array of `bytes` wide unsigned integers.
+static inline void setIndex(void* index, size_t i, size_t val, unsigned bytes){
+  if (bytes == sizeof(uint64_t)) {
+    ((uint64_t*)index)[i] = val;
+  }
+  else {
+    simit_uassert(val <= UINT32_MAX)
+        << "index value " << val << " does not fit in 32 bits, "
+        << "use 8-byte indices (Settings::indexSize)";
+    ((uint32_t*)index)[i] = val;
+  }
+}
+
+// class SlicedPathIndex
+SlicedPathIndex::SlicedPathIndex(const SegmentedPathIndex* index,
+                                 unsigned sliceHeight, unsigned sortWindow)
+    : numElems(index->numElements()), sliceHeight(sliceHeight),
+      indexBytes(index->getIndexBytes()), allocator(getAllocator()) {
+  simit_iassert(sliceHeight > 0 && sortWindow > 0);
+  numSlcs = (numElems + sliceHeight - 1) / sliceHeight;
+  size_t numPositions = (size_t)numSlcs * sliceHeight;
+
+  // Sort the elements by decreasing neighbor count within each window, and
+  // keep the order of elements with the same count
+  vector<unsigned> permutation(numElems);
+  for (unsigned i = 0; i < numElems; ++i) {
+    permutation[i] = i;
+  }
+  for (size_t start = 0; start < numElems; start += sortWindow) {
+    auto end = permutation.begin() + std::min<size_t>(start+sortWindow,
+                                                      numElems);
+    std::stable_sort(permutation.begin()+start, end,
+                     [index](unsigned a, unsigned b) {
+                       return index->numNeighbors(a) > index->numNeighbors(b);
+                     });
+  }
+
+  sliceptrData = allocateIndex(allocator, numSlcs+1, indexBytes);
+  permutationData = allocateIndex(allocator, numPositions, indexBytes);
+  lengthData = allocateIndex(allocator, numPositions, indexBytes);
+  size_t numLocs = 0;
+  setIndex(sliceptrData, 0, 0, indexBytes);
+  for (unsigned s = 0; s < numSlcs; ++s) {
+    size_t width = 0;
+    for (size_t i = s*sliceHeight; i < (s+1)*sliceHeight; ++i) {
+      size_t elem   = (i < numElems) ? permutation[i] : 0;
+      size_t length = (i < numElems) ? index->numNeighbors(elem) : 0;
+      setIndex(permutationData, i, elem, indexBytes);
+      setIndex(lengthData, i, length, indexBytes);
+      width = std::max(width, length);
+    }
+    numLocs += width * sliceHeight;
+    setIndex(sliceptrData, s+1, numLocs, indexBytes);
+  }
+
+  sinksData = allocateIndex(allocator, numLocs, indexBytes);
+  locsData = allocateIndex(allocator, numLocs, indexBytes);
+  for (unsigned s = 0; s < numSlcs; ++s) {
+    size_t width = (sliceptr(s+1) - sliceptr(s)) / sliceHeight;
+    for (unsigned r = 0; r < sliceHeight; ++r) {
+      size_t i = (size_t)s*sliceHeight + r;
+      size_t start = (i < numElems) ? index->coord(permutation[i]) : 0;
+      for (size_t k = 0; k < width; ++k) {
+        size_t location = sliceptr(s) + k*sliceHeight + r;
+        bool padded = k >= length(i);
+        setIndex(sinksData, location,
+                 padded ? 0 : index->sink(start+k), indexBytes);
+        setIndex(locsData, location, padded ? 0 : start+k, indexBytes);
+      }
+    }
+  }
+}
+
+SlicedPathIndex::~SlicedPathIndex() {
+  size_t numPositions = (size_t)numSlcs * sliceHeight;
+  size_t numLocs = numLocations();
+  allocator->deallocate(sliceptrData, (numSlcs+1)*indexBytes);
+  allocator->deallocate(permutationData, numPositions*indexBytes);
+  allocator->deallocate(lengthData, numPositions*indexBytes);
+  allocator->deallocate(sinksData, numLocs*indexBytes);
+  allocator->deallocate(locsData, numLocs*indexBytes);
+}
+
 
 // class PathIndexBuilder
 PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
@@ -171,35 +262,46 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
     /// Pack neighbor vectors into a segmented vector (contiguous array).
     PathIndex pack(const map<unsigned, vector<unsigned>> &pathNeighbors,
                    bool sorted=true) {
-      unsigned numNeighbors = 0;
+      const unsigned indexBytes = builder->indexBytes;
+      Allocator* allocator = getAllocator();
+
+      size_t numNeighbors = 0;
       for (auto &p : pathNeighbors) {
         numNeighbors += p.second.size();
       }
 
       size_t numElements = pathNeighbors.size();
-      uint32_t* coordsData= (uint32_t*)malloc((numElements+1)*sizeof(uint32_t));
-      uint32_t* sinksData = (uint32_t*)malloc(numNeighbors*sizeof(uint32_t));
+      void* coordsData = allocateIndex(allocator, numElements+1, indexBytes);
+      void* sinksData  = allocateIndex(allocator, numNeighbors, indexBytes);
 
-      int currNbrsStart = 0;
+      size_t currNbrsStart = 0;
       for (auto& p : pathNeighbors) {
         unsigned elem = p.first;
-        coordsData[elem] = currNbrsStart;
+        setIndex(coordsData, elem, currNbrsStart, indexBytes);
 
-        unsigned pNeighborSize = p.second.size();
+        size_t pNeighborSize = p.second.size();
         if (pNeighborSize > 0) {
           vector<unsigned> pNeighbors(p.second.begin(), p.second.end());
           if (sorted) {
             sort(pNeighbors.begin(), pNeighbors.end());
           }
 
-          memcpy(&sinksData[currNbrsStart], pNeighbors.data(),
-                 pNeighbors.size() * sizeof(uint32_t));
+          if (indexBytes == sizeof(uint32_t)) {
+            memcpy(&((uint32_t*)sinksData)[currNbrsStart], pNeighbors.data(),
+                   pNeighbors.size() * sizeof(uint32_t));
+          }
+          else {
+            for (size_t i=0; i < pNeighborSize; ++i) {
+              setIndex(sinksData, currNbrsStart+i, pNeighbors[i], indexBytes);
+            }
+          }
 
           currNbrsStart += pNeighborSize;
         }
       }
-      coordsData[numElements] = currNbrsStart;
-      return new SegmentedPathIndex(numElements, coordsData, sinksData);;
+      setIndex(coordsData, numElements, currNbrsStart, indexBytes);
+      return new SegmentedPathIndex(allocator, numElements, indexBytes,
+                                    coordsData, sinksData);
     }
 
     void visit(const Link *link) {
@@ -226,23 +328,26 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
           size_t n   = edgeSet.getSize();
           size_t nnz = edgeSet.getSize() * nnzPerRow;
 
-          uint32_t* ptr = (uint32_t*)malloc((n+1)*sizeof(uint32_t));
-          uint32_t* idx = (uint32_t*)malloc(nnz*sizeof(uint32_t));
+          const unsigned indexBytes = builder->indexBytes;
+          Allocator* allocator = getAllocator();
+          void* ptr = allocateIndex(allocator, n+1, indexBytes);
+          void* idx = allocateIndex(allocator, nnz, indexBytes);
 
           for (size_t i=0; i<=n; ++i) {
-            ptr[i] = i*nnzPerRow;
+            setIndex(ptr, i, i*nnzPerRow, indexBytes);
           }
 
           for (auto e : edgeSet) {
             for (int i=0, j=0; i<cardinality; ++i) {
               if (&vertexSet == edgeSet.getEndpointSet(i)) {
                 int ep = edgeSet.getEndpoint(e,i).getIdent();
-                idx[e.getIdent()*nnzPerRow + (j++)] = ep;
+                setIndex(idx, (size_t)e.getIdent()*nnzPerRow + (j++), ep,
+                         indexBytes);
               }
             }
           }
 
-          pi = new SegmentedPathIndex(n, ptr, idx);;
+          pi = new SegmentedPathIndex(allocator, n, indexBytes, ptr, idx);
           break;
         }
         case Link::ve: {
@@ -519,6 +624,9 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
   // TODO: Possible optimization is to detect symmetric path expressions, and
   //       return the same path index when they are evaluated in both directions
 
+  // Bring memoized path indices up to date with changes to the sets' topology
+  update();
+
   // Check if we have memoized the path index for this path expression, starting
   // at this sourceEndpoint, bound to these sets.
   if (util::contains(pathIndices, {pe,sourceEndpoint})) {
@@ -530,8 +638,55 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
   return pi;
 }
 
+PathIndex PathIndexBuilder::buildUpperTriangular(const PathExpression &pe,
+                                                 unsigned sourceEndpoint) {
+  PathIndex pi = buildSegmented(pe, sourceEndpoint);
+  auto memo = upperTriangularIndices.find({pe,sourceEndpoint});
+  if (memo != upperTriangularIndices.end() && memo->second.first == pi) {
+    return memo->second.second;
+  }
+
+  simit_iassert(isa<SegmentedPathIndex>(pi));
+  const SegmentedPathIndex* index = to<SegmentedPathIndex>(pi);
+  Allocator* allocator = getAllocator();
+  size_t numElements = index->numElements();
+
+  size_t numNeighbors = 0;
+  for (size_t elem=0; elem < numElements; ++elem) {
+    for (size_t i=index->coord(elem); i < index->coord(elem+1); ++i) {
+      numNeighbors += (index->sink(i) >= elem);
+    }
+  }
+
+  void* coordsData = allocateIndex(allocator, numElements+1, indexBytes);
+  void* sinksData  = allocateIndex(allocator, numNeighbors, indexBytes);
+  size_t currNbrsStart = 0;
+  for (size_t elem=0; elem < numElements; ++elem) {
+    setIndex(coordsData, elem, currNbrsStart, indexBytes);
+    for (size_t i=index->coord(elem); i < index->coord(elem+1); ++i) {
+      if (index->sink(i) >= elem) {
+        setIndex(sinksData, currNbrsStart++, index->sink(i), indexBytes);
+      }
+    }
+  }
+  setIndex(coordsData, numElements, currNbrsStart, indexBytes);
+
+  PathIndex upper = new SegmentedPathIndex(allocator, numElements, indexBytes,
+                                           coordsData, sinksData);
+  upperTriangularIndices[{pe,sourceEndpoint}] = {pi, upper};
+  return upper;
+}
+
 void PathIndexBuilder::bind(std::string name, const simit::Set* set) {
-  bindings.insert({name,set});
+  auto binding = bindings.find(name);
+  if (binding != bindings.end() && binding->second != set) {
+    pathIndices.clear();
+    upperTriangularIndices.clear();
+  }
+  bindings[name] = set;
+  if (!util::contains(topologies, set)) {
+    topologies.insert({set, {set->getTopologyVersion(), set->getSize()}});
+  }
 }
 
 const simit::Set* PathIndexBuilder::getBinding(pe::Set pset) const {
@@ -544,4 +699,224 @@ const simit::Set* PathIndexBuilder::getBinding(ir::Var var) const {
   return bindings.at(var.getName());
 }
 
+/// Collects the sets that the links of a path expression range over.
+class LinkSets : public PathExpressionVisitor {
+public:
+  std::set<pe::Set> sets;
+  std::set<ir::Var> gridSets;
+
+  using PathExpressionVisitor::visit;
+  void visit(const Link* link) {
+    sets.insert(link->getLhsSet());
+    sets.insert(link->getRhsSet());
+    if (link->hasStencil()) {
+      gridSets.insert(link->getStencil().getGridSet());
+    }
+  }
+};
+
+void PathIndexBuilder::update() {
+  // Find the remaps of the sets that changed since the last update
+  map<const simit::Set*, vector<int>> remaps;
+  set<const simit::Set*> unrecorded;
+  bool changed = false;
+  for (auto& topology : topologies) {
+    const simit::Set* set = topology.first;
+    uint64_t version = topology.second.first;
+    int size = topology.second.second;
+    if (version == set->getTopologyVersion()) {
+      continue;
+    }
+    changed = true;
+    if (!set->getTopologyRemap(version, size, &remaps[set])) {
+      remaps.erase(set);
+      unrecorded.insert(set);
+    }
+    topology.second = {set->getTopologyVersion(), set->getSize()};
+  }
+  if (!changed) {
+    return;
+  }
+
+  // Update the edge-vertex link indices. Other indices that range over a
+  // changed set are dropped, and are rebuilt from the updated links when
+  // requested.
+  auto isChanged = [&](const simit::Set* set) {
+    return util::contains(remaps, set) || util::contains(unrecorded, set);
+  };
+  map<pair<PathExpression,unsigned>, PathIndex> updated;
+  for (auto& memo : pathIndices) {
+    const PathExpression& pexpr = memo.first.first;
+    if (!isa<Link>(pexpr) || !isa<SegmentedPathIndex>(memo.second) ||
+        to<Link>(pexpr)->getType() == Link::vv) {
+      LinkSets linkSets;
+      pexpr.accept(&linkSets);
+      bool keep = true;
+      for (const pe::Set& pset : linkSets.sets) {
+        keep &= util::contains(bindings, pset.getName()) &&
+                !isChanged(getBinding(pset));
+      }
+      for (const ir::Var& gridSet : linkSets.gridSets) {
+        keep &= util::contains(bindings, gridSet.getName()) &&
+                !isChanged(getBinding(gridSet));
+      }
+      if (keep) {
+        updated.insert(memo);
+      }
+      continue;
+    }
+    const Link* link = to<Link>(pexpr);
+    const simit::Set* edgeSet = getBinding(link->getEdgeSet());
+    const simit::Set* vertexSet = getBinding(link->getVertexSet());
+    if (util::contains(unrecorded, edgeSet) ||
+        util::contains(unrecorded, vertexSet)) {
+      continue;
+    }
+    const vector<int>* edgeRemap = util::contains(remaps, edgeSet)
+                                   ? &remaps.at(edgeSet) : nullptr;
+    const vector<int>* vertexRemap = util::contains(remaps, vertexSet)
+                                     ? &remaps.at(vertexSet) : nullptr;
+    if (edgeRemap == nullptr && vertexRemap == nullptr) {
+      updated.insert(memo);
+    }
+    else {
+      updated.insert({memo.first,
+                      updateLink(link, to<SegmentedPathIndex>(memo.second),
+                                 edgeRemap, vertexRemap)});
+    }
+  }
+  pathIndices = updated;
+}
+
+PathIndex PathIndexBuilder::updateLink(const Link* link,
+                                       const SegmentedPathIndex* index,
+                                       const vector<int>* edgeRemap,
+                                       const vector<int>* vertexRemap) const {
+  const simit::Set& edgeSet = *getBinding(link->getEdgeSet());
+  const simit::Set& vertexSet = *getBinding(link->getVertexSet());
+  const int cardinality = edgeSet.getCardinality();
+  Allocator* allocator = getAllocator();
+
+  auto remapEdge = [edgeRemap](size_t e) -> int {
+    return (edgeRemap != nullptr) ? (*edgeRemap)[e] : (int)e;
+  };
+  auto remapVertex = [vertexRemap](size_t v) -> int {
+    return (vertexRemap != nullptr) ? (*vertexRemap)[v] : (int)v;
+  };
+
+  // Edges that survived keep their relative order, and added edges follow them
+  size_t firstNewEdge = 0;
+  if (edgeRemap != nullptr) {
+    for (int e : *edgeRemap) {
+      firstNewEdge += (e >= 0);
+    }
+  }
+  else {
+    firstNewEdge = edgeSet.getSize();
+  }
+
+  switch (link->getType()) {
+    case Link::ev: {
+      // Each edge has the same number of endpoints in the vertex set
+      int nnzPerRow = 0;
+      for (int i=0; i < cardinality; ++i) {
+        nnzPerRow += (&vertexSet == edgeSet.getEndpointSet(i));
+      }
+
+      size_t n = edgeSet.getSize();
+      void* ptr = allocateIndex(allocator, n+1, indexBytes);
+      void* idx = allocateIndex(allocator, n*nnzPerRow, indexBytes);
+      for (size_t i=0; i <= n; ++i) {
+        setIndex(ptr, i, i*nnzPerRow, indexBytes);
+      }
+
+      size_t e = 0;
+      for (size_t old=0; old < index->numElements(); ++old) {
+        if (remapEdge(old) < 0) {
+          continue;
+        }
+        for (int j=0; j < nnzPerRow; ++j) {
+          int v = remapVertex(index->sink(old*nnzPerRow + j));
+          simit_uassert(v >= 0)
+              << "Edge " << e << " of set (" << edgeSet.getName() << ") has "
+              << "an endpoint that was removed from (" << vertexSet.getName()
+              << ")";
+          setIndex(idx, e*nnzPerRow + j, v, indexBytes);
+        }
+        ++e;
+      }
+      simit_iassert(e == firstNewEdge);
+      for (; e < n; ++e) {
+        for (int i=0, j=0; i < cardinality; ++i) {
+          if (&vertexSet == edgeSet.getEndpointSet(i)) {
+            int ep = edgeSet.getEndpoint(ElementRef(e),i).getIdent();
+            setIndex(idx, e*nnzPerRow + (j++), ep, indexBytes);
+          }
+        }
+      }
+      return new SegmentedPathIndex(allocator, n, indexBytes, ptr, idx);
+    }
+    case Link::ve: {
+      size_t numVertices = vertexSet.getSize();
+      size_t numEdges = edgeSet.getSize();
+
+      // Count the remaining and added edges of each vertex
+      vector<size_t> coords(numVertices+1, 0);
+      for (size_t old=0; old < index->numElements(); ++old) {
+        int v = remapVertex(old);
+        for (size_t i=index->coord(old); i < index->coord(old+1); ++i) {
+          if (remapEdge(index->sink(i)) >= 0) {
+            simit_uassert(v >= 0)
+                << "Vertex " << old << " was removed from ("
+                << vertexSet.getName() << ") but has edges in ("
+                << edgeSet.getName() << ")";
+            coords[v+1]++;
+          }
+        }
+      }
+      for (size_t e=firstNewEdge; e < numEdges; ++e) {
+        for (int i=0; i < cardinality; ++i) {
+          if (&vertexSet == edgeSet.getEndpointSet(i)) {
+            coords[edgeSet.getEndpoint(ElementRef(e),i).getIdent()+1]++;
+          }
+        }
+      }
+      for (size_t v=0; v < numVertices; ++v) {
+        coords[v+1] += coords[v];
+      }
+
+      // Remaining edges keep their order, and added edges have larger ids, so
+      // the neighbors of each vertex remain sorted
+      vector<size_t> next(coords.begin(), coords.end()-1);
+      void* ptr = allocateIndex(allocator, numVertices+1, indexBytes);
+      void* idx = allocateIndex(allocator, coords[numVertices], indexBytes);
+      for (size_t old=0; old < index->numElements(); ++old) {
+        int v = remapVertex(old);
+        for (size_t i=index->coord(old); i < index->coord(old+1); ++i) {
+          int e = remapEdge(index->sink(i));
+          if (e >= 0) {
+            setIndex(idx, next[v]++, e, indexBytes);
+          }
+        }
+      }
+      for (size_t e=firstNewEdge; e < numEdges; ++e) {
+        for (int i=0; i < cardinality; ++i) {
+          if (&vertexSet == edgeSet.getEndpointSet(i)) {
+            int v = edgeSet.getEndpoint(ElementRef(e),i).getIdent();
+            setIndex(idx, next[v]++, e, indexBytes);
+          }
+        }
+      }
+      for (size_t v=0; v <= numVertices; ++v) {
+        setIndex(ptr, v, coords[v], indexBytes);
+      }
+      return new SegmentedPathIndex(allocator, numVertices, indexBytes, ptr,
+                                    idx);
+    }
+    case Link::vv:
+      simit_unreachable;
+  }
+  return PathIndex();
+}
+
 }}
@@ -1,11 +1,13 @@
 #ifndef SIMIT_PATH_INDICES_H
 #define SIMIT_PATH_INDICES_H
 
+#include <cstdint>
 #include <ostream>
 #include <map>
 #include <memory>
 #include <typeinfo>
 
+#include "allocator.h"
 #include "graph.h"
 #include "path_expressions.h"
 #include "interfaces/printable.h"
@@ -99,7 +101,7 @@ public:
 
   virtual unsigned numElements() const = 0;
   virtual unsigned numNeighbors(unsigned elemID) const = 0;
-  virtual unsigned numNeighbors() const = 0;
+  virtual size_t numNeighbors() const = 0;
 
   ElementIterator begin() const {return ElementIterator(0);}
   ElementIterator end() const {return ElementIterator(numElements());}
@@ -107,7 +109,7 @@ public:
   virtual Neighbors neighbors(unsigned elemID) const = 0;
 
 private:
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
   friend inline void aquire(PathIndexImpl *p) {++p->ref;}
   friend inline void release(PathIndexImpl *p) {if (--p->ref==0) delete p;}
 };
@@ -126,7 +128,7 @@ public:
   unsigned numElements() const {return ptr->numElements();}
 
   /// The sum of number of neighbors of each element covered by this path index.
-  unsigned numNeighbors() const {return ptr->numNeighbors();}
+  size_t numNeighbors() const {return ptr->numNeighbors();}
 
   /// The number of path neighbors of `elem`.
   unsigned numNeighbors(unsigned elemID) const {
@@ -156,7 +158,7 @@ class SetEndpointPathIndex : public PathIndexImpl {
 public:
   unsigned numElements() const;
   unsigned numNeighbors(unsigned elemID) const;
-  unsigned numNeighbors() const;
+  size_t numNeighbors() const;
 
   Neighbors neighbors(unsigned elemID) const;
 
@@ -171,23 +173,40 @@ private:
 
 
 /// In a SegmentedPathIndex the path neighbors are packed into a segmented
-/// vector with no holes. This is equivalent to CSR indices.
+/// vector with no holes. This is equivalent to CSR indices. The coords and
+/// sinks are stored as 4-byte or 8-byte unsigned integers, depending on the
+/// index size the index was built for.
 class SegmentedPathIndex : public PathIndexImpl {
 public:
   ~SegmentedPathIndex() {
-    free(coordsData);
-    free(sinksData);
+    allocator->deallocate(sinksData, numNeighbors()*indexBytes);
+    allocator->deallocate(coordsData, (numElems+1)*indexBytes);
   }
 
   unsigned numElements() const {return numElems;}
-  unsigned numNeighbors() const {return coordsData[numElems];}
+  size_t numNeighbors() const {return coord(numElems);}
 
-  const unsigned* getCoordData() const {return coordsData;}
-  const unsigned* getSinkData() const {return sinksData;}
+  const void* getCoordData() const {return coordsData;}
+  const void* getSinkData() const {return sinksData;}
+
+  /// The number of bytes of each coord and sink.
+  unsigned getIndexBytes() const {return indexBytes;}
 
   unsigned numNeighbors(unsigned elemID) const {
     simit_iassert(numElems > elemID);
-    return coordsData[elemID+1]-coordsData[elemID];
+    return coord(elemID+1)-coord(elemID);
+  }
+
+  /// The location of the first neighbor of element `i` in the sinks.
+  size_t coord(size_t i) const {
+    return (indexBytes == sizeof(uint64_t)) ? ((uint64_t*)coordsData)[i]
+                                            : ((uint32_t*)coordsData)[i];
+  }
+
+  /// The neighbor at location `i` in the sinks.
+  unsigned sink(size_t i) const {
+    return (indexBytes == sizeof(uint64_t)) ? ((uint64_t*)sinksData)[i]
+                                            : ((uint32_t*)sinksData)[i];
   }
 
   Neighbors neighbors(unsigned elemID) const;
@@ -196,20 +215,19 @@ private:
   /// Segmented vector, where `coordsData[i]:coordsData[i+1]` is the range of
   /// locations of neighbors of `i` in `sinksData`.
   size_t numElems;
-  uint32_t* coordsData;
-  uint32_t* sinksData;
+  unsigned indexBytes;
+  void* coordsData;
+  void* sinksData;
+  Allocator* allocator;
 
   void print(std::ostream &os) const;
 
   friend PathIndexBuilder;
 
-  SegmentedPathIndex(size_t numElements, uint32_t *nbrsStart, uint32_t *nbrs)
-      : numElems(numElements), coordsData(nbrsStart), sinksData(nbrs) {}
-
-  SegmentedPathIndex() : numElems(0), coordsData(nullptr), sinksData(nullptr) {
-    coordsData = new uint32_t[1];
-    coordsData[0] = 0;
-  }
+  SegmentedPathIndex(Allocator* allocator, size_t numElements,
+                     unsigned indexBytes, void *nbrsStart, void *nbrs)
+      : numElems(numElements), indexBytes(indexBytes),
+        coordsData(nbrsStart), sinksData(nbrs), allocator(allocator) {}
 };
 
 template <typename PI>
@@ -224,27 +242,134 @@ inline const PI* to(PathIndex pi) {
 }
 
 
+/// A sliced ELLPACK (SELL-C-sigma) view of a segmented path index. Elements
+/// are sorted by decreasing neighbor count within windows of `sortWindow`
+/// elements, and the sorted elements are grouped into slices of `sliceHeight`
+/// elements. Each slice is padded to its longest element and stored column
+/// major, so the k'th neighbor of the r'th element of slice s is at location
+/// `sliceptr[s] + k*sliceHeight + r`. A matrix stored with the segmented index
+/// can therefore be multiplied one neighbor column of a slice at a time, in
+/// lockstep across the slice's rows.
+///
+/// The view does not move the values of matrices stored with the segmented
+/// index. Instead it stores each neighbor's location in the segmented sinks,
+/// which is the location of the neighbor's value. Padded locations have
+/// neighbor and location 0, and must be masked using the element lengths.
+class SlicedPathIndex {
+public:
+  SlicedPathIndex(const SegmentedPathIndex* index, unsigned sliceHeight,
+                  unsigned sortWindow);
+  ~SlicedPathIndex();
+
+  unsigned numElements() const {return numElems;}
+  unsigned numSlices() const {return numSlcs;}
+  unsigned getSliceHeight() const {return sliceHeight;}
+
+  /// The number of locations of all slices, including padding.
+  size_t numLocations() const {return sliceptr(numSlcs);}
+
+  /// `numSlices()+1` slice starts.
+  const void* getSliceptrData() const {return sliceptrData;}
+
+  /// The element at each of the `numSlices()*sliceHeight` sorted positions,
+  /// where positions past the last element are 0.
+  const void* getPermutationData() const {return permutationData;}
+
+  /// The neighbor count of the element at each sorted position.
+  const void* getLengthData() const {return lengthData;}
+
+  /// The neighbor at each location.
+  const void* getSinkData() const {return sinksData;}
+
+  /// The segmented sink location of the neighbor at each location.
+  const void* getLocData() const {return locsData;}
+
+  size_t sliceptr(size_t s) const {return get(sliceptrData, s);}
+  size_t permutation(size_t i) const {return get(permutationData, i);}
+  size_t length(size_t i) const {return get(lengthData, i);}
+  size_t sink(size_t i) const {return get(sinksData, i);}
+  size_t loc(size_t i) const {return get(locsData, i);}
+
+private:
+  unsigned numElems;
+  unsigned numSlcs;
+  unsigned sliceHeight;
+  unsigned indexBytes;
+  void* sliceptrData;
+  void* permutationData;
+  void* lengthData;
+  void* sinksData;
+  void* locsData;
+  Allocator* allocator;
+
+  size_t get(const void* data, size_t i) const {
+    return (indexBytes == sizeof(uint64_t)) ? ((uint64_t*)data)[i]
+                                            : ((uint32_t*)data)[i];
+  }
+
+  SlicedPathIndex(const SlicedPathIndex&) = delete;
+  SlicedPathIndex& operator=(const SlicedPathIndex&) = delete;
+};
+
+
 /// A builder that builds path indices by evaluating path expressions on graphs.
 /// The builder memoizes previously computed path indices, and uses these to
 /// accelerate subsequent path index construction (since path expressions can be
 /// recursively constructed from path expressions).
+///
+/// When elements are added to or removed from the bound sets, the memoized
+/// edge-vertex link indices are updated from the sets' remaps. Other indices
+/// that range over a changed set are rebuilt from the updated links, while
+/// indices over unchanged sets are kept.
 class PathIndexBuilder {
 public:
-  PathIndexBuilder() {}
-  PathIndexBuilder(std::map<std::string, const simit::Set*> bindings)
-      : bindings(bindings) {}
+  /// Create a builder whose segmented indices store `indexBytes` wide coords
+  /// and sinks (4 or 8).
+  PathIndexBuilder(unsigned indexBytes=sizeof(uint32_t))
+      : indexBytes(indexBytes) {}
+  PathIndexBuilder(std::map<std::string, const simit::Set*> bindings,
+                   unsigned indexBytes=sizeof(uint32_t))
+      : indexBytes(indexBytes), bindings(bindings) {}
 
   // Build a Segmented path index by evaluating the `pe` over the given graph.
   PathIndex buildSegmented(const PathExpression &pe, unsigned sourceEndpoint);
 
+  /// Build the upper triangle of the segmented path index of `pe`, which
+  /// keeps the neighbors of each element that are not before the element.
+  /// The path expression's ends must be the same set. Symmetric matrices are
+  /// stored with such indices (see ir::TensorStorage::Symmetric).
+  PathIndex buildUpperTriangular(const PathExpression &pe,
+                                 unsigned sourceEndpoint);
+
+  /// Bind a set. Rebinding a name to a different set drops the memoized
+  /// indices.
   void bind(std::string name, const simit::Set* set);
 
   const simit::Set* getBinding(pe::Set pset) const;
   const simit::Set* getBinding(ir::Var var) const;
 
 private:
+  unsigned indexBytes;
   std::map<std::pair<PathExpression,unsigned>, PathIndex> pathIndices;
   std::map<std::string, const simit::Set*> bindings;
+
+  /// The memoized upper triangular indices, and the segmented indices they
+  /// were built from.
+  std::map<std::pair<PathExpression,unsigned>,
+           std::pair<PathIndex,PathIndex>> upperTriangularIndices;
+
+  /// The topology version and size of each bound set when the memoized indices
+  /// were last brought up to date.
+  std::map<const simit::Set*, std::pair<uint64_t,int>> topologies;
+
+  /// Update the memoized indices to the current topology of the bound sets.
+  void update();
+
+  /// Update an edge-vertex link index with the remaps of its edge and vertex
+  /// sets, which are nullptr if the set is unchanged.
+  PathIndex updateLink(const Link* link, const SegmentedPathIndex* index,
+                       const std::vector<int>* edgeRemap,
+                       const std::vector<int>* vertexRemap) const;
 };
 
 }}
@@ -0,0 +1,272 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+static const uint64_t CACHE_LINE_BYTES = 64;
+
+static string escapeJSON(const string& str) {
+  string escaped;
+  for (char c : str) {
+    switch (c) {
+      case '"':  escaped += "\\\""; break;
+      case '\\': escaped += "\\\\"; break;
+      case '\n': escaped += "\\n";  break;
+      case '\t': escaped += "\\t";  break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          escaped += buf;
+        }
+        else {
+          escaped += c;
+        }
+    }
+  }
+  return escaped;
+}
+
+// class Profile
+void Profile::writeJSON(std::ostream& os) const {
+  std::streamsize precision = os.precision();
+  os << "{" << endl;
+  os << "  \"hardwareCounters\": " << (hardwareCounters ? "true" : "false")
+     << "," << endl;
+  os << "  \"regions\": [";
+  for (size_t i = 0; i < regions.size(); ++i) {
+    const ProfileRegion& region = regions[i];
+    os << (i == 0 ? "" : ",") << endl;
+    os << "    {\"id\": " << i
+       << ", \"kind\": \"" << region.kind << "\""
+       << ", \"function\": \"" << escapeJSON(region.function) << "\""
+       << ", \"description\": \"" << escapeJSON(region.description) << "\""
+       << ", \"count\": " << region.count
+       << ", \"seconds\": " << std::setprecision(9) << region.seconds;
+    if (hardwareCounters) {
+      os << ", \"cycles\": " << region.cycles
+         << ", \"instructions\": " << region.instructions
+         << ", \"llcMisses\": " << region.llcMisses
+         << ", \"bytes\": " << region.bytes;
+    }
+    os << "}";
+  }
+  os << endl << "  ]" << endl;
+  os << "}" << endl;
+  os.precision(precision);
+}
+
+std::ostream& operator<<(std::ostream& os, ProfileRegion::Kind kind) {
+  switch (kind) {
+    case ProfileRegion::Map:
+      return os << "map";
+    case ProfileRegion::Loop:
+      return os << "loop";
+    case ProfileRegion::Call:
+      return os << "call";
+  }
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Profile& profile) {
+  for (size_t i = 0; i < profile.getRegions().size(); ++i) {
+    const ProfileRegion& region = profile.getRegions()[i];
+    os << std::setw(3) << i << " " << std::left << std::setw(4) << region.kind
+       << " " << std::setw(16) << region.function << std::right
+       << std::setw(10) << region.count << " "
+       << std::fixed << std::setprecision(6) << std::setw(12) << region.seconds
+       << "s";
+    if (profile.hasHardwareCounters()) {
+      os << std::setw(16) << region.cycles << " cyc"
+         << std::setw(16) << region.llcMisses << " llc";
+    }
+    os << std::defaultfloat << "  " << region.description << endl;
+  }
+  return os;
+}
+
+namespace internal {
+
+static thread_local Profiler* currentProfiler = nullptr;
+
+static uint64_t nanos() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(
+      steady_clock::now().time_since_epoch()).count();
+}
+
+// class Profiler
+Profiler::Profiler(const ProfilerOptions& options)
+    : hardwareCounters(options.hardwareCounters),
+      hardwareCountersAvailable(false) {
+  for (int i = 0; i < NumCounters; ++i) {
+    perfFds[i] = -1;
+  }
+}
+
+Profiler::~Profiler() {
+  closeCounters();
+}
+
+int Profiler::addRegion(ProfileRegion::Kind kind, const std::string& function,
+                        const std::string& description) {
+  std::lock_guard<std::mutex> lock(regionsMutex);
+  RegionCounters counters;
+  counters.region.kind = kind;
+  counters.region.function = function;
+  counters.region.description = description;
+  counters.startNanos = 0;
+  regions.push_back(counters);
+  return regions.size()-1;
+}
+
+void Profiler::begin(int region) {
+  simit_iassert(region >= 0 && (size_t)region < regions.size());
+  RegionCounters& counters = regions[region];
+  if (hardwareCounters) {
+    readCounters(counters.startCounters);
+  }
+  counters.startNanos = nanos();
+}
+
+void Profiler::end(int region) {
+  uint64_t endNanos = nanos();
+  simit_iassert(region >= 0 && (size_t)region < regions.size());
+  RegionCounters& counters = regions[region];
+  ProfileRegion& r = counters.region;
+  r.count += 1;
+  r.seconds += (endNanos - counters.startNanos) * 1e-9;
+
+  uint64_t endCounters[NumCounters];
+  if (hardwareCounters && readCounters(endCounters)) {
+    r.cycles       += endCounters[0] - counters.startCounters[0];
+    r.instructions += endCounters[1] - counters.startCounters[1];
+    r.llcMisses    += endCounters[2] - counters.startCounters[2];
+    r.bytes         = r.llcMisses * CACHE_LINE_BYTES;
+  }
+}
+
+void Profiler::addTime(int region, double seconds) {
+  if (region < 0 || (size_t)region >= regions.size()) {
+    return;
+  }
+  regions[region].region.count += 1;
+  regions[region].region.seconds += seconds;
+}
+
+Profile Profiler::getProfile() const {
+  std::lock_guard<std::mutex> lock(regionsMutex);
+  vector<ProfileRegion> result;
+  for (const RegionCounters& counters : regions) {
+    result.push_back(counters.region);
+  }
+  return Profile(result, hardwareCountersAvailable);
+}
+
+void Profiler::reset() {
+  std::lock_guard<std::mutex> lock(regionsMutex);
+  for (RegionCounters& counters : regions) {
+    ProfileRegion& r = counters.region;
+    r.count = 0;
+    r.seconds = 0.0;
+    r.cycles = r.instructions = r.llcMisses = r.bytes = 0;
+  }
+}
+
+Profiler* Profiler::current() {
+  return currentProfiler;
+}
+
+bool Profiler::readCounters(uint64_t counters[NumCounters]) {
+  // perf events count the thread that opened them, so reopen them if the
+  // function has moved to another thread.
+  if (perfThread != std::this_thread::get_id()) {
+    openCounters();
+  }
+  if (!hardwareCountersAvailable) {
+    return false;
+  }
+#ifdef __linux__
+  // PERF_FORMAT_GROUP layout: {nr, values[nr]}
+  uint64_t buf[1 + NumCounters];
+  if (read(perfFds[0], buf, sizeof(buf)) != sizeof(buf)) {
+    return false;
+  }
+  for (int i = 0; i < NumCounters; ++i) {
+    counters[i] = buf[1+i];
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Profiler::openCounters() {
+  closeCounters();
+  perfThread = std::this_thread::get_id();
+#ifdef __linux__
+  const uint64_t configs[NumCounters] = {PERF_COUNT_HW_CPU_CYCLES,
+                                         PERF_COUNT_HW_INSTRUCTIONS,
+                                         PERF_COUNT_HW_CACHE_MISSES};
+  for (int i = 0; i < NumCounters; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = (i == 0) ? 1 : 0;
+    int groupFd = (i == 0) ? -1 : perfFds[0];
+    perfFds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+    if (perfFds[i] < 0) {
+      closeCounters();
+      return;
+    }
+  }
+  ioctl(perfFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(perfFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  hardwareCountersAvailable = true;
+#endif
+}
+
+void Profiler::closeCounters() {
+#ifdef __linux__
+  for (int i = NumCounters-1; i >= 0; --i) {
+    if (perfFds[i] >= 0) {
+      close(perfFds[i]);
+    }
+  }
+#endif
+  for (int i = 0; i < NumCounters; ++i) {
+    perfFds[i] = -1;
+  }
+  hardwareCountersAvailable = false;
+}
+
+// class Profiler::Scope
+Profiler::Scope::Scope(Profiler* profiler) : previous(currentProfiler) {
+  currentProfiler = profiler;
+}
+
+Profiler::Scope::~Scope() {
+  currentProfiler = previous;
+}
+
+}}
@@ -0,0 +1,147 @@
+#ifndef SIMIT_PROFILER_H
+#define SIMIT_PROFILER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace simit {
+
+/// Profiling options (see Program::compileWithProfiler).
+struct ProfilerOptions {
+  /// Also collect hardware counters (cycles, instructions and last-level cache
+  /// misses) with perf_event_open. Silently unavailable if the platform or the
+  /// perf_event_paranoid level does not permit it, see
+  /// Profile::hasHardwareCounters. Counters are read on every region entry and
+  /// exit, which costs a system call each.
+  bool hardwareCounters = false;
+};
+
+/// The counters of one profiled region of a function: a map, an outermost loop
+/// or a call to an external kernel (e.g. a solver).
+struct ProfileRegion {
+  enum Kind {Map, Loop, Call};
+
+  Kind kind;
+
+  /// The Simit function the region is in.
+  std::string function;
+
+  /// The first line of the region's IR.
+  std::string description;
+
+  /// Number of times the region was executed.
+  uint64_t count = 0;
+
+  /// Wall-clock time spent in the region.
+  double seconds = 0.0;
+
+  /// Hardware counters, only set if Profile::hasHardwareCounters.
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t llcMisses = 0;
+
+  /// Estimated memory traffic: last-level cache misses times the cache line
+  /// size.
+  uint64_t bytes = 0;
+};
+
+/// A snapshot of the counters of a profiled function. Map regions contain the
+/// loops they lower to, so region times may overlap and need not add up.
+class Profile {
+public:
+  Profile() : hardwareCounters(false) {}
+  Profile(std::vector<ProfileRegion> regions, bool hardwareCounters)
+      : regions(regions), hardwareCounters(hardwareCounters) {}
+
+  /// The profiled regions, indexed by region id.
+  const std::vector<ProfileRegion>& getRegions() const {return regions;}
+
+  /// True if the regions' hardware counters were collected.
+  bool hasHardwareCounters() const {return hardwareCounters;}
+
+  /// Write the profile as a JSON object.
+  void writeJSON(std::ostream& os) const;
+
+private:
+  std::vector<ProfileRegion> regions;
+  bool hardwareCounters;
+};
+
+std::ostream& operator<<(std::ostream& os, ProfileRegion::Kind kind);
+
+/// Write the profile as a human-readable table.
+std::ostream& operator<<(std::ostream& os, const Profile& profile);
+
+namespace internal {
+
+/// Collects the counters of a profiled function. Regions are registered while
+/// the function is lowered and are identified by dense integer ids, which the
+/// generated code passes to simit_profile_begin and simit_profile_end. Those
+/// update the profiler that is current on the calling thread (see Scope).
+class Profiler {
+public:
+  Profiler(const ProfilerOptions& options);
+  ~Profiler();
+
+  /// Register a region and return its id.
+  int addRegion(ProfileRegion::Kind kind, const std::string& function,
+                const std::string& description);
+
+  void begin(int region);
+  void end(int region);
+
+  /// Add time measured by the program itself (the storeTime intrinsic).
+  void addTime(int region, double seconds);
+
+  Profile getProfile() const;
+  void reset();
+
+  /// The profiler that is current on the calling thread, or nullptr.
+  static Profiler* current();
+
+  /// Makes a profiler current on the calling thread for the lifetime of the
+  /// scope. Profiled functions run in such a scope.
+  class Scope {
+  public:
+    Scope(Profiler* profiler);
+    ~Scope();
+  private:
+    Profiler* previous;
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+private:
+  enum {NumCounters = 3};
+
+  struct RegionCounters {
+    ProfileRegion region;
+    uint64_t startNanos;
+    uint64_t startCounters[NumCounters];
+  };
+
+  mutable std::mutex regionsMutex;
+  std::vector<RegionCounters> regions;
+
+  /// perf_event group (cycles, instructions, LLC misses) of the thread that
+  /// last ran the function. The fds are -1 if the counters are unavailable.
+  bool hardwareCounters;
+  bool hardwareCountersAvailable;
+  int perfFds[NumCounters];
+  std::thread::id perfThread;
+
+  bool readCounters(uint64_t counters[NumCounters]);
+  void openCounters();
+  void closeCounters();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+};
+
+}}
+#endif
@@ -6,11 +6,14 @@
 #include "ir.h"
 #include "frontend/frontend.h"
 #include "util/util.h"
+#include "util/parallel.h"
 #include "error.h"
 #include "program_context.h"
 #include "storage.h"
 #include "lower/lower.h"
-#include "timers.h"
+#include "halo_analysis.h"
+#include "profiler.h"
+#include "settings.h"
 
 #include "backend/backend.h"
 
@@ -24,34 +27,44 @@ const std::vector<std::string> VALID_BACKENDS = {
   "gpu",
 #endif
 };
-std::string kBackend;
-
-static
-Function compile(ir::Func func, backend::Backend *backend, bool addTimers) {
+thread_local std::string kBackend = internal::getDefaultSettings().backend;
+
+/// Lowers and compiles func with the given settings. Each compilation gets its
+/// own backend, so functions can be compiled concurrently. If `profiler` is
+/// given the function is instrumented and collects its counters.
+static Function compile(ir::Func func, const Settings& settings,
+                        std::shared_ptr<internal::Profiler> profiler,
+                        ir::LowerCache* cache=nullptr) {
+  internal::SettingsScope scope(settings);
+  backend::Backend backend(settings.backend);
   ir::Storage storage;
   // Fill in storage path expressions, etc.
   /// map<Var,pe::PathExpressions> pes = assignPathExpressions(func);
   /// storage.addPathExpressions(pes);
-  func = lower(func, nullptr, addTimers);
-  return Function(backend->compile(func, storage));
+  std::string haloHazard = ir::findHaloHazard(func);
+  func = lower(func, nullptr, profiler.get(), cache);
+  backend::Function* compiled = backend.compile(func, storage);
+  compiled->setProfiler(profiler);
+  compiled->setHaloHazard(haloHazard);
+  return Function(compiled);
 }
 
-static Function compile(ir::Func func, backend::Backend *backend) {
-  return simit::compile(func, backend, false);
+static Function compile(ir::Func func, const Settings& settings) {
+  return simit::compile(func, settings, nullptr);
 }
 
 // class ProgramContent
 struct Program::ProgramContent {
   internal::ProgramContext ctx;
   internal::Frontend *frontend;
-  backend::Backend   *backend;
+  Settings settings;
   Diagnostics diags;
 };
 
 // class Program
 Program::Program() : content(new ProgramContent) {
   content->frontend = new internal::Frontend();
-  content->backend =  new backend::Backend(kBackend);
+  content->settings = internal::getThreadSettings();
 }
 
 Program::~Program() {
@@ -60,7 +73,6 @@ Program::~Program() {
 
 void Program::clear() {
   delete content->frontend;
-  delete content->backend;
   delete content;
   content = nullptr;
 }
@@ -98,20 +110,61 @@ std::vector<std::string> Program::getFunctionNames() const {
   return functionNames;
 }
 
+std::vector<std::string> Program::getExportedFunctionNames() const {
+  const set<string> &exported = content->ctx.getExportedFunctions();
+  return vector<string>(exported.begin(), exported.end());
+}
+
 Function Program::compile(const std::string &function) {
   ir::Func simitFunc = content->ctx.getFunction(function);
   simit_uassert(simitFunc.defined())
       << "Attempting to compile an unknown function "
       << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend);
+  return simit::compile(simitFunc, content->settings);
 }
 
-Function Program::compileWithTimers(const std::string &function) {
+Function Program::compileWithProfiler(const std::string &function,
+                                      const ProfilerOptions &options) {
   ir::Func simitFunc = content->ctx.getFunction(function);
   simit_uassert(simitFunc.defined())
       << "Attempting to compile an unknown function "
       << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend, true);
+  return simit::compile(simitFunc, content->settings,
+                        make_shared<internal::Profiler>(options));
+}
+
+Function Program::compileWithTimers(const std::string &function) {
+  return compileWithProfiler(function);
+}
+
+std::map<std::string,Function>
+Program::compileAll(const std::vector<std::string> &functions,
+                    unsigned numThreads) {
+  vector<ir::Func> simitFuncs;
+  for (const string &function : functions) {
+    ir::Func simitFunc = content->ctx.getFunction(function);
+    simit_uassert(simitFunc.defined())
+        << "Attempting to compile an unknown function "
+        << "(" << function << ")";
+    simitFuncs.push_back(simitFunc);
+  }
+
+  ir::LowerCache cache;
+  vector<Function> compiled(simitFuncs.size());
+  util::parallelFor(simitFuncs.size(), [&](size_t i) {
+    compiled[i] = simit::compile(simitFuncs[i], content->settings, nullptr,
+                                 &cache);
+  }, numThreads);
+
+  std::map<std::string,Function> result;
+  for (size_t i = 0; i < functions.size(); ++i) {
+    result[functions[i]] = compiled[i];
+  }
+  return result;
+}
+
+std::map<std::string,Function> Program::compileAll(unsigned numThreads) {
+  return compileAll(getExportedFunctionNames(), numThreads);
 }
 
 int Program::verify() {
@@ -128,7 +181,7 @@ int Program::verify() {
       return 1;
     }
     ir::Func func = functions.at(test->getCallee());
-    Function compiledFunc = simit::compile(func, content->backend);
+    Function compiledFunc = simit::compile(func, content->settings);
 
     bool evaluates = test->evaluate(func, compiledFunc, &content->diags);
     if (!evaluates) {
@@ -4,6 +4,7 @@
 #include <string>
 #include <ostream>
 #include <vector>
+#include <map>
 #include <memory>
 
 #include "function.h"
@@ -13,12 +14,16 @@
 namespace simit {
 
 extern const std::vector<std::string> VALID_BACKENDS;
-extern std::string kBackend;
+extern thread_local std::string kBackend;
 
 class Diagnostics;
 
 /// A Simit program. You can load Simit source code using the \ref loadString
 /// and \ref loadFile and compile the program using the \ref compile method.
+///
+/// A program compiles with the settings (see \ref init) that were in effect on
+/// the thread that created it. Once loaded, functions may be compiled from
+/// several threads concurrently, but loading must not overlap compilation.
 class Program : private interfaces::Uncopyable {
 public:
   /// Create a new Simit program.
@@ -43,11 +48,30 @@ public:
   /// Returns the names of all the functions in the program.
   std::vector<std::string> getFunctionNames() const;
 
+  /// Returns the names of the exported functions in the program.
+  std::vector<std::string> getExportedFunctionNames() const;
+
   /// Compile and return a runnable function, or an undefined function if an
-  /// error occured.
+  /// error occured. Thread-safe: each call compiles in its own context.
   Function compile(const std::string &function);
+
+  /// Compile a function that profiles its maps, outermost loops and kernel
+  /// calls. The counters are retrieved with Function::getProfile.
+  Function compileWithProfiler(const std::string &function,
+                               const ProfilerOptions &options=ProfilerOptions());
+
+  /// Same as compileWithProfiler with default options.
   Function compileWithTimers(const std::string &function);
 
+  /// Compile the given functions concurrently on up to `numThreads` threads (0
+  /// uses one per hardware thread), and return them by name. Internal functions
+  /// and intrinsics that several of them call are lowered once and shared.
+  std::map<std::string,Function>
+  compileAll(const std::vector<std::string> &functions, unsigned numThreads=0);
+
+  /// Compile all exported functions concurrently (see above).
+  std::map<std::string,Function> compileAll(unsigned numThreads=0);
+
   /// Verify the program by executing in-code comment tests.
   int verify();
 
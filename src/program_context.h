@@ -6,6 +6,7 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <set>
 #include <utility>
 
 #include "types.h"
@@ -140,6 +141,16 @@ public:
     return functions;
   }
 
+  /// Mark a function as exported, i.e. callable from the host program.
+  void exportFunction(const std::string &name) {
+    simit_iassert(containsFunction(name)) << "Could not find function " << name;
+    exportedFunctions.insert(name);
+  }
+
+  const std::set<std::string> &getExportedFunctions() const {
+    return exportedFunctions;
+  }
+
   void addElementType(ir::Type elemType) {
     elementTypes[elemType.toElement()->name] = elemType;
   }
@@ -200,6 +211,7 @@ private:
   std::map<std::string, ir::Var>   externs;
   std::map<ir::Var,ir::Expr>       constants;
   std::map<std::string, ir::Func>  functions;
+  std::set<std::string>            exportedFunctions;
   std::list<std::vector<ir::Stmt>> statements;
   std::vector<Test*>               tests;
 
@@ -5,10 +5,18 @@ namespace simit {
 namespace ir {
 
 // class ReductionOperator
-std::string ReductionOperator::getName() {
+std::string ReductionOperator::getName() const {
   switch (kind) {
     case Sum:
       return "sum";
+    case Product:
+      return "product";
+    case Max:
+      return "max";
+    case Min:
+      return "min";
+    case User:
+      return reducer.getName();
     case Undefined:
       return "";
   }
@@ -17,7 +25,8 @@ std::string ReductionOperator::getName() {
 }
 
 bool operator==(const ReductionOperator &l, const ReductionOperator &r) {
-  return l.getKind() == r.getKind();
+  return l.getKind() == r.getKind() && l.getReducer() == r.getReducer() &&
+         l.getIdentity() == r.getIdentity();
 }
 
 bool operator!=(const ReductionOperator &l, const ReductionOperator &r) {
@@ -29,6 +38,18 @@ std::ostream &operator<<(std::ostream &os, const ReductionOperator &rop) {
     case ReductionOperator::Sum:
       os << "+";
       break;
+    case ReductionOperator::Product:
+      os << "*";
+      break;
+    case ReductionOperator::Max:
+      os << "max";
+      break;
+    case ReductionOperator::Min:
+      os << "min";
+      break;
+    case ReductionOperator::User:
+      os << rop.getReducer().getName();
+      break;
     case ReductionOperator::Undefined:
       break;
   }
@@ -4,6 +4,9 @@
 #include <string>
 #include <ostream>
 
+#include "func.h"
+#include "complex_types.h"
+
 namespace simit {
 namespace ir {
 
@@ -11,24 +14,42 @@ namespace ir {
 /// Since reductions happen over unordered sets, the reduction operators must
 /// be both associative and commutative. Supported reduction operators are:
 /// - Sum
+/// - Product
+/// - Max
+/// - Min
+/// - User-defined functions `(T,T) -> T`, with an identity `e` for which
+///   `f(e,x) = x`
 class ReductionOperator {
 public:
-  // TODO: Add Poduct, Max, Min, and user-defined functions
-  enum Kind { Sum, Undefined };
+  enum Kind { Sum, Product, Max, Min, User, Undefined };
 
   // Construct an undefiend reduction operator.
   ReductionOperator() : kind(Undefined) {}
 
   // Construct a reduction operator.
   ReductionOperator(Kind kind) : kind(kind) {}
-  
+
+  // Construct a user-defined reduction operator that combines two values
+  // using `reducer`, starting from `identity`.
+  ReductionOperator(Func reducer, double_complex identity)
+      : kind(User), reducer(reducer), identity(identity) {}
+
   Kind getKind() const {return kind;}
 
+  /// Returns the function of a user-defined reduction operator.
+  const Func& getReducer() const {return reducer;}
+
+  /// Returns the identity of a user-defined reduction operator, which is
+  /// converted to the component type of the reduced values.
+  const double_complex& getIdentity() const {return identity;}
+
   /// Returns the name of the reduction variable (e.g. sum).
-  std::string getName();
+  std::string getName() const;
 
 private:
   Kind kind;
+  Func reducer;
+  double_complex identity;
 };
 
 bool operator==(const ReductionOperator &, const ReductionOperator &);
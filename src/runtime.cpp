@@ -1,11 +1,15 @@
 #include "runtime.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <time.h>
 #include <chrono>
 #include <vector>
 
-#include "timers.h"
+#include "error.h"
+#include "profiler.h"
+#include "util/thread_pool.h"
 #include "stdio.h"
 
 #ifdef EIGEN
@@ -22,6 +26,13 @@ int loc(int v0, int v1, int *neighbors_start, int *neighbors) {
   return l;
 }
 
+int64_t loc_i64(int64_t v0, int64_t v1, int64_t *neighbors_start,
+                int64_t *neighbors) {
+  int64_t l = neighbors_start[v0];
+  while(neighbors[l] != v1) l++;
+  return l;
+}
+
 double atan2_f64(double y, double x) {
   return atan2(y, x);
 }
@@ -60,23 +71,23 @@ float acos_f32(float x) {
 }
 
 double max_f64(double a,double b) {
-  return max(a,b);
+  return std::max(a,b);
 }
 
 float max_f32(float a, float b) {
   double d_a = a;
   double d_b = b;
-  return (float)max(d_a,d_b);
+  return (float)std::max(d_a,d_b);
 }
 
 double min_f64(double a,double b) {
-  return min(a,b);
+  return std::min(a,b);
 }
 
 float min_f32(float a, float b) {
   double d_a = a;
   double d_b = b;
-  return (float)min(d_a,d_b);
+  return (float)std::min(d_a,d_b);
 }
 
 double cbrt_f64(double x) {
@@ -295,7 +306,26 @@ float complexNorm_f32(float r, float i) {
 }
 
 void storeTime(int i, double value) {
-  simit::ir::TimerStorage::getInstance().storeTime(i, value);
+  // value is in microseconds (see simitClock)
+  simit::internal::Profiler* profiler = simit::internal::Profiler::current();
+  if (profiler) {
+    profiler->addTime(i, value * 1e-6);
+  }
+}
+
+// Profiled functions that run without a current profiler are not recorded
+void simit_profile_begin(int region) {
+  simit::internal::Profiler* profiler = simit::internal::Profiler::current();
+  if (profiler) {
+    profiler->begin(region);
+  }
+}
+
+void simit_profile_end(int region) {
+  simit::internal::Profiler* profiler = simit::internal::Profiler::current();
+  if (profiler) {
+    profiler->end(region);
+  }
 }
 
 double simitClock() {
@@ -653,3 +683,20 @@ extern "C" int dtriangularSolve(int An,  int Am,  int* Arowptr, int* Acolidx,
 }
 
 
+
+namespace simit {
+extern thread_local int kNumThreads;
+extern thread_local bool kPinThreads;
+}
+
+extern "C" void simit_parallel_for(int64_t begin, int64_t end, int64_t grain,
+                                   void (*body)(void*, int64_t, int64_t),
+                                   void* closure) {
+  if (end <= begin) {
+    return;
+  }
+  simit::util::ThreadPool::getGlobal().parallelFor(end - begin, grain,
+      [=](size_t first, size_t last) {
+        body(closure, begin + first, begin + last);
+      }, simit::kNumThreads, simit::kPinThreads);
+}
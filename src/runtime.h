@@ -2,8 +2,20 @@
 #define SIMIT_RUNTIME_H
 
 #include "ffi.h"
+#include <cstdint>
 #include <iostream>
 
+/// Runs `body(closure, first, last)` for disjoint ranges of at most `grain`
+/// iterations that cover [begin,end), on the runtime's thread pool with the
+/// calling thread's Settings::numThreads and Settings::pinThreads. Generated
+/// code runs a parallel loop by outlining its body into a function of a
+/// closure holding the values the body uses and a range of iterations.
+/// Iterations must be independent. Calls from inside a parallel loop run
+/// serially on the calling thread.
+extern "C" void simit_parallel_for(int64_t begin, int64_t end, int64_t grain,
+                                   void (*body)(void*, int64_t, int64_t),
+                                   void* closure);
+
 template <typename Float>
 void mallocMatrix(int n,  int m,  int** rowptr, int** colidx,
                   int nn, int mm, Float** vals,
@@ -0,0 +1,86 @@
+#include "settings.h"
+
+#include <mutex>
+
+#include "types.h"
+
+namespace simit {
+
+extern thread_local std::string kBackend;
+extern thread_local bool kIndexlessStencils;
+extern thread_local int kSliceHeight;
+extern thread_local int kSliceSortWindow;
+extern thread_local bool kSymmetricMatrices;
+extern thread_local int kEdgeBlockSize;
+extern thread_local bool kPullMaps;
+extern thread_local int kNumThreads;
+extern thread_local bool kPinThreads;
+extern thread_local bool kVectorizationReport;
+
+namespace internal {
+
+static std::mutex defaultSettingsMutex;
+
+static Settings& defaultSettings() {
+  static Settings settings = []() {
+    Settings settings;
+    // Compiling without calling simit::init is an error
+    settings.backend = "";
+    return settings;
+  }();
+  return settings;
+}
+
+Settings getDefaultSettings() {
+  std::lock_guard<std::mutex> lock(defaultSettingsMutex);
+  return defaultSettings();
+}
+
+void setDefaultSettings(const Settings& settings) {
+  std::lock_guard<std::mutex> lock(defaultSettingsMutex);
+  defaultSettings() = settings;
+}
+
+Settings getThreadSettings() {
+  Settings settings;
+  settings.backend = kBackend;
+  settings.floatSize = ir::ScalarType::floatBytes;
+  settings.indexlessStencils = kIndexlessStencils;
+  settings.indexSize = ir::ScalarType::indexBytes;
+  settings.sliceHeight = kSliceHeight;
+  settings.sliceSortWindow = kSliceSortWindow;
+  settings.symmetricMatrices = kSymmetricMatrices;
+  settings.edgeBlockSize = kEdgeBlockSize;
+  settings.pullMaps = kPullMaps;
+  settings.numThreads = kNumThreads;
+  settings.pinThreads = kPinThreads;
+  settings.vectorizationReport = kVectorizationReport;
+  return settings;
+}
+
+void setThreadSettings(const Settings& settings) {
+  kBackend = settings.backend;
+  ir::ScalarType::floatBytes = settings.floatSize;
+  kIndexlessStencils = settings.indexlessStencils;
+  ir::ScalarType::indexBytes = settings.indexSize;
+  kSliceHeight = settings.sliceHeight;
+  kSliceSortWindow = settings.sliceSortWindow;
+  kSymmetricMatrices = settings.symmetricMatrices;
+  kEdgeBlockSize = settings.edgeBlockSize;
+  kPullMaps = settings.pullMaps;
+  kNumThreads = settings.numThreads;
+  kPinThreads = settings.pinThreads;
+  kVectorizationReport = settings.vectorizationReport;
+}
+
+// class SettingsScope
+SettingsScope::SettingsScope(const Settings& settings)
+    : previous(getThreadSettings()) {
+  setThreadSettings(settings);
+}
+
+SettingsScope::~SettingsScope() {
+  setThreadSettings(previous);
+}
+
+}}
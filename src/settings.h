@@ -0,0 +1,98 @@
+#ifndef SIMIT_SETTINGS_H
+#define SIMIT_SETTINGS_H
+
+#include <string>
+
+namespace simit {
+
+// Settings struct with default values
+struct Settings {
+  std::string backend="cpu";
+  int floatSize = 8;
+  bool indexlessStencils = false;
+
+  /// Bytes per index (4 or 8). 8-byte indices are needed for sparse systems
+  /// with more than 2^31 nonzeros, at the cost of twice the index bandwidth.
+  int indexSize = 4;
+
+  /// Rows per slice of the sliced ELLPACK (SELL-C-sigma) view built for
+  /// scalar system matrices that are multiplied with vectors, or 0 to
+  /// multiply them in CSR form. The rows of a slice are multiplied in
+  /// lockstep, which vectorizes better than CSR when row lengths vary, e.g.
+  /// on irregular meshes. A multiple of the SIMD width, such as 8, is best.
+  int sliceHeight = 0;
+
+  /// Rows are sorted by length within windows of this many rows before they
+  /// are sliced, to reduce padding. Larger windows pad less but scatter the
+  /// results further from the rows' original order.
+  int sliceSortWindow = 256;
+
+  /// Store assembled system matrices whose rows and columns are the same set
+  /// as symmetric matrices: only their upper block triangle is assembled and
+  /// stored, and products with vectors apply it and its transpose in one pass.
+  /// Assembly drops the contributions to the lower triangle, so this is only
+  /// correct if all such matrices are symmetric, like stiffness matrices.
+  bool symmetricMatrices = false;
+
+  /// Edges per block of the blocked loops over edge sets, or 0 to loop over
+  /// edges one at a time. A blocked loop gathers the endpoint fields a map
+  /// reads into contiguous buffers before computing the block, and
+  /// scatter-adds the results to the endpoints after, so the computation
+  /// itself makes no indirect accesses. Blocks should fit in the L1 cache.
+  int edgeBlockSize = 0;
+
+  /// Lower maps over edge sets that scatter-add into vertex tensors to loops
+  /// over the vertices that pull from their incident edges, through a vertex
+  /// to edge index. Vertices then sum their results without reductions into
+  /// shared entries, at the cost of evaluating each edge once per endpoint.
+  bool pullMaps = false;
+
+  /// Threads that run the parallel loops of compiled functions, counting the
+  /// thread that calls the function, or 0 for one per hardware thread. The
+  /// threads come from a pool shared by all functions.
+  int numThreads = 0;
+
+  /// Pin the pool's threads to one CPU each, which keeps their caches warm
+  /// between loops but competes badly with other busy processes.
+  bool pinThreads = false;
+
+  /// Print which loops of each compiled function LLVM vectorized to stderr,
+  /// and why it did not vectorize the others.
+  bool vectorizationReport = false;
+};
+
+namespace internal {
+
+/// Returns the settings given to the last call to simit::init (the backend is
+/// empty if init has not been called). Threads start out with these settings.
+Settings getDefaultSettings();
+
+/// Sets the settings that threads start out with.
+void setDefaultSettings(const Settings& settings);
+
+/// Returns the settings in effect on the calling thread.
+Settings getThreadSettings();
+
+/// Sets the settings in effect on the calling thread. Compilation reads the
+/// settings from thread-local state, so programs compiled on different threads
+/// do not interfere with each other.
+void setThreadSettings(const Settings& settings);
+
+/// Applies settings to the calling thread for the lifetime of the scope, and
+/// restores the previous settings afterwards. Programs and functions use this
+/// to compile and initialize with the settings they were created with,
+/// regardless of which thread they are used from.
+class SettingsScope {
+public:
+  SettingsScope(const Settings& settings);
+  ~SettingsScope();
+
+private:
+  Settings previous;
+
+  SettingsScope(const SettingsScope&) = delete;
+  SettingsScope& operator=(const SettingsScope&) = delete;
+};
+
+}}
+#endif
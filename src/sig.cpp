@@ -99,7 +99,8 @@ SIG merge(SIG &sig1, SIG &sig2, SIG::MergeOp mop, Storage& storage) {
       // edge: the one that is a sysreduced tensor
       auto storageKind = storage.getStorage(e->tensor).getKind();
   
-      if (storageKind == TensorStorage::Kind::Indexed) {
+      if (storageKind == TensorStorage::Kind::Indexed ||
+          storageKind == TensorStorage::Kind::Symmetric) {
         exists->get()->tensor = e->tensor;
         exists->get()->set = e->set;
       }
@@ -415,7 +416,8 @@ LoopVars LoopVars::create(const SIG &sig, const Storage &storage) {
           
           ForDomain::Kind domainKind = ForDomain::Neighbors;
           
-          if (storageKind == TensorStorage::Kind::Indexed) {
+          if (storageKind == TensorStorage::Kind::Indexed ||
+              storageKind == TensorStorage::Kind::Symmetric) {
             // if we have a fixed index var, then we need
             // a NeigborsOf domain
             if (indexVar.isFixed()) {
@@ -449,6 +451,7 @@ LoopVars LoopVars::create(const SIG &sig, const Storage &storage) {
           addVertexLoopVar(indexVar, LoopVar(var, domain, rop));
 
           if (storageKind == TensorStorage::Kind::Indexed ||
+              storageKind == TensorStorage::Kind::Symmetric ||
               storageKind == TensorStorage::Kind::Stencil) {
             // The ij var links i to j through the neighbors indices. E.g.
             // for i in points:
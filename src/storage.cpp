@@ -4,6 +4,7 @@
 
 #include "init.h"
 #include "ir.h"
+#include "ir_queries.h"
 #include "ir_visitor.h"
 #include "path_expressions.h"
 #include "tensor_index.h"
@@ -44,7 +45,8 @@ bool TensorStorage::hasTensorIndex() const {
 
 const TensorIndex& TensorStorage::getTensorIndex() const {
   simit_iassert((content->index.getKind() == TensorIndex::PExpr &&
-           getKind() == TensorStorage::Indexed) ||
+           (getKind() == TensorStorage::Indexed ||
+            getKind() == TensorStorage::Symmetric)) ||
           (content->index.getKind() == TensorIndex::Sten &&
            getKind() == TensorStorage::Stencil))
       << "Expected Indexed tensor, but was " << *this;
@@ -54,7 +56,8 @@ const TensorIndex& TensorStorage::getTensorIndex() const {
 
 TensorIndex& TensorStorage::getTensorIndex() {
   simit_iassert((content->index.getKind() == TensorIndex::PExpr &&
-           getKind() == TensorStorage::Indexed) ||
+           (getKind() == TensorStorage::Indexed ||
+            getKind() == TensorStorage::Symmetric)) ||
           (content->index.getKind() == TensorIndex::Sten &&
            getKind() == TensorStorage::Stencil))
       << "Expected Indexed tensor, but was " << *this;
@@ -80,6 +83,9 @@ std::ostream &operator<<(std::ostream &os, const TensorStorage &ts) {
         os << " (" << ts.getTensorIndex().getPathExpression() << ")";
       }
       break;
+    case TensorStorage::Symmetric:
+      os << "Symmetric (" << ts.getTensorIndex().getPathExpression() << ")";
+      break;
     case TensorStorage::Stencil:
       os << "Stencil";
       break;
@@ -272,6 +278,60 @@ private:
         inferStorage(var, op->value);
       }
     }
+    sliceMatrixVectorIndex(op->value);
+  }
+
+  void visit(const FieldWrite *op) {
+    IRVisitor::visit(op);
+    sliceMatrixVectorIndex(op->value);
+  }
+
+  /// Add a sliced view to the index of a scalar system matrix that is
+  /// multiplied with a vector in `value`, if enabled (Settings::sliceHeight).
+  /// The view is built with the CSR index, so slicing does not change how the
+  /// matrix is assembled or used elsewhere.
+  void sliceMatrixVectorIndex(Expr value) {
+    if (kSliceHeight <= 0 || kBackend != "cpu" || !isa<IndexExpr>(value)) {
+      return;
+    }
+    const IndexedTensor* matrix;
+    const IndexedTensor* vector;
+    if (!isMatrixVectorProduct(to<IndexExpr>(value), false, &matrix, &vector)
+        || !isa<VarExpr>(matrix->tensor)) {
+      return;
+    }
+    const Var& var = to<VarExpr>(matrix->tensor)->var;
+    if (!storage->hasStorage(var) ||
+        storage->getStorage(var).getKind() != TensorStorage::Indexed ||
+        !isScalar(var.getType().toTensor()->getBlockType())) {
+      return;
+    }
+    TensorIndex& index = storage->getStorage(var).getTensorIndex();
+    if (index.getPathExpression().defined() && !index.isSliced()) {
+      index.setSliced(kSliceHeight, kSliceSortWindow);
+    }
+  }
+
+  /// True if the system matrix `var` should be stored as a symmetric matrix
+  /// (see Settings::symmetricMatrices), which requires its rows and columns
+  /// to be the same set.
+  bool isSymmetric(const Var& var) {
+    const TensorType* type = var.getType().toTensor();
+    if (!kSymmetricMatrices || kBackend != "cpu" || type->order() != 2) {
+      return false;
+    }
+    vector<IndexSet> dimensions = type->getOuterDimensions();
+    if (dimensions[0] != dimensions[1]) {
+      return false;
+    }
+    Type blockType = type->getBlockType();
+    simit_uassert(isScalar(blockType) ||
+                  (blockType.toTensor()->order() == 2 &&
+                   blockType.toTensor()->getOuterDimensions()[0] ==
+                   blockType.toTensor()->getOuterDimensions()[1]))
+        << util::quote(var) << " cannot be stored as a symmetric matrix, "
+        << "because its blocks are not square";
+    return true;
   }
 
   void visit(const TensorWrite *op) {
@@ -358,6 +418,11 @@ private:
             if (isDiagonal(tensorType, op->target)) {
               tensorStorage = TensorStorage(TensorStorage::Diagonal);
             }
+            else if (isSymmetric(var)) {
+              auto index = getTensorIndex(var);
+              index.setUpperTriangular();
+              tensorStorage = TensorStorage(TensorStorage::Symmetric, index);
+            }
             else {
               auto index = getTensorIndex(var);
               tensorStorage = TensorStorage(TensorStorage::Indexed, index);
@@ -418,6 +483,7 @@ private:
       static map<TensorStorage::Kind, unsigned> priorities = {
         {TensorStorage::Dense,     3},
         {TensorStorage::Indexed,   2},
+        {TensorStorage::Symmetric, 2},
         {TensorStorage::Diagonal,  1},
         {TensorStorage::Undefined, 0}
       };
@@ -442,10 +508,12 @@ private:
             case TensorStorage::Dense:
               tensorStorage = TensorStorage(TensorStorage::Dense);
               break;
-            case TensorStorage::Indexed: {
+            case TensorStorage::Indexed:
+            case TensorStorage::Symmetric: {
               auto operandIndex = operandStorage.getTensorIndex();
               TensorIndex index;
-              if (tensorStorage.getKind() != TensorStorage::Indexed) {
+              if (tensorStorage.getKind() != TensorStorage::Indexed &&
+                  tensorStorage.getKind() != TensorStorage::Symmetric) {
                 index = operandIndex.getPathExpression().defined()
                     ? getTensorIndex(var)
                     : TensorIndex(var.getName()+"_index", pe::PathExpression());
@@ -454,7 +522,11 @@ private:
                 index=TensorIndex(var.getName()+"_index", pe::PathExpression());
               }
               if (index.defined()) {
-                tensorStorage = TensorStorage(TensorStorage::Indexed, index);
+                // Matrices that share the index of a symmetric matrix are
+                // also symmetric
+                tensorStorage = TensorStorage(index.isUpperTriangular()
+                                              ? TensorStorage::Symmetric
+                                              : TensorStorage::Indexed, index);
               }
               break;
             }
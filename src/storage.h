@@ -40,6 +40,12 @@ public:
     /// tensor index.
     Indexed,
 
+    /// A symmetric sparse matrix, whose non-zero components in the upper
+    /// block triangle are accessible through an upper triangular tensor
+    /// index. The lower block triangle is the transpose of the upper one and
+    /// is not stored (see Settings::symmetricMatrices).
+    Symmetric,
+
     /// A sparse matrix, whose non-zeros components are accessible through a
     /// *computable* tensor index (i.e. no memory-based structures).
     /// Stencil-assembled matrices can be stored this way, since all
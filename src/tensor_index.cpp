@@ -19,6 +19,15 @@ struct TensorIndex::Content {
   StencilLayout stencil;
   Var coordArray;
   Var sinkArray;
+  bool upperTriangular = false;
+
+  unsigned sliceHeight = 0;
+  unsigned sortWindow = 0;
+  Var sliceptrArray;
+  Var permutationArray;
+  Var lengthArray;
+  Var slicedSinkArray;
+  Var slicedLocArray;
 };
 
 TensorIndex::TensorIndex(std::string name, pe::PathExpression pexpr)
@@ -82,6 +91,71 @@ const Var& TensorIndex::getColidxArray() const {
   return content->sinkArray;
 }
 
+void TensorIndex::setSliced(unsigned sliceHeight, unsigned sortWindow) {
+  simit_iassert(content->kind == PExpr && content->pexpr.defined());
+  simit_iassert(sliceHeight > 0 && sortWindow > 0);
+  content->sliceHeight = sliceHeight;
+  content->sortWindow = sortWindow;
+
+  string prefix = content->name + ".sliced.";
+  content->sliceptrArray    = Var(prefix + "slices",
+                                  ArrayType::make(ScalarType::Int));
+  content->permutationArray = Var(prefix + "rows",
+                                  ArrayType::make(ScalarType::Int));
+  content->lengthArray      = Var(prefix + "lengths",
+                                  ArrayType::make(ScalarType::Int));
+  content->slicedSinkArray  = Var(prefix + "sinks",
+                                  ArrayType::make(ScalarType::Int));
+  content->slicedLocArray   = Var(prefix + "locs",
+                                  ArrayType::make(ScalarType::Int));
+}
+
+bool TensorIndex::isSliced() const {
+  return content->sliceHeight > 0;
+}
+
+unsigned TensorIndex::getSliceHeight() const {
+  return content->sliceHeight;
+}
+
+unsigned TensorIndex::getSortWindow() const {
+  return content->sortWindow;
+}
+
+const Var& TensorIndex::getSliceptrArray() const {
+  simit_iassert(isSliced());
+  return content->sliceptrArray;
+}
+
+const Var& TensorIndex::getPermutationArray() const {
+  simit_iassert(isSliced());
+  return content->permutationArray;
+}
+
+const Var& TensorIndex::getLengthArray() const {
+  simit_iassert(isSliced());
+  return content->lengthArray;
+}
+
+const Var& TensorIndex::getSlicedColidxArray() const {
+  simit_iassert(isSliced());
+  return content->slicedSinkArray;
+}
+
+const Var& TensorIndex::getSlicedLocArray() const {
+  simit_iassert(isSliced());
+  return content->slicedLocArray;
+}
+
+void TensorIndex::setUpperTriangular() {
+  simit_iassert(content->kind == PExpr && content->pexpr.defined());
+  content->upperTriangular = true;
+}
+
+bool TensorIndex::isUpperTriangular() const {
+  return content->upperTriangular;
+}
+
 const Expr TensorIndex::computeRowptr(Expr source) const {
   simit_iassert(isComputed());
   if (getKind() == Sten) {
@@ -109,10 +183,19 @@ ostream &operator<<(ostream& os, const TensorIndex& ti) {
   if (ti.getKind() == TensorIndex::PExpr) {
     auto rowptr = ti.getRowptrArray();
     auto colidx = ti.getColidxArray();
-    os << "tensor-index " << ti.getName() << ": " << ti.getPathExpression()
-       << endl;
+    os << "tensor-index " << ti.getName() << ": " << ti.getPathExpression();
+    if (ti.isUpperTriangular()) {
+      os << " (upper triangle)";
+    }
+    os << endl;
     os << "  " << rowptr << " : " << rowptr.getType() << endl;
     os << "  " << colidx << " : " << colidx.getType();
+    if (ti.isSliced()) {
+      os << endl << "  sliced " << ti.getSliceHeight() << "-"
+         << ti.getSortWindow() << ": " << ti.getSliceptrArray() << ", "
+         << ti.getPermutationArray() << ", " << ti.getLengthArray() << ", "
+         << ti.getSlicedColidxArray() << ", " << ti.getSlicedLocArray();
+    }
   }
   else if (ti.getKind() == TensorIndex::Sten) {
     os << "tensor-index " << ti.getName() << ": " << ti.getStencilLayout()
@@ -69,6 +69,49 @@ public:
   /// Note: only sparse matrix CSR indices are supported for now.
   const Var& getColidxArray() const;
 
+  /// Add a sliced ELLPACK (SELL-C-sigma) view to the tensor index, which is
+  /// built alongside its CSR arrays and used to multiply its matrices with
+  /// vectors (see pe::SlicedPathIndex). Rows are sorted by decreasing length
+  /// within windows of `sortWindow` rows and sliced into `sliceHeight` rows.
+  /// Only tensor indices with path expressions can be sliced.
+  void setSliced(unsigned sliceHeight, unsigned sortWindow);
+
+  /// True if the tensor index has a sliced view, false otherwise.
+  bool isSliced() const;
+
+  unsigned getSliceHeight() const;
+  unsigned getSortWindow() const;
+
+  /// Return the sliced view's slice array, with the start of each slice in
+  /// the sliced colidx and loc arrays.
+  const Var& getSliceptrArray() const;
+
+  /// Return the sliced view's row permutation array, with the row stored at
+  /// each sorted position.
+  const Var& getPermutationArray() const;
+
+  /// Return the sliced view's row length array, with the number of non-zeros
+  /// of the row at each sorted position.
+  const Var& getLengthArray() const;
+
+  /// Return the sliced view's colidx array, with the column index of every
+  /// (padded) sliced non-zero.
+  const Var& getSlicedColidxArray() const;
+
+  /// Return the sliced view's loc array, with the location of every (padded)
+  /// sliced non-zero in the CSR colidx array, and thus in the tensor values.
+  const Var& getSlicedLocArray() const;
+
+  /// Restrict the tensor index to its upper triangle, that is to the
+  /// neighbors of each row that are not before the row (see
+  /// pe::PathIndexBuilder::buildUpperTriangular). Symmetric matrices are
+  /// stored with such indices. Only tensor indices with path expressions
+  /// whose ends are the same set can be restricted.
+  void setUpperTriangular();
+
+  /// True if the tensor index is restricted to its upper triangle.
+  bool isUpperTriangular() const;
+
   /// Compute the tensor index's rowptr value for a given source.
   const Expr computeRowptr(Expr base) const;
 
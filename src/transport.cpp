@@ -0,0 +1,190 @@
+#include "transport.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "util/thread_pool.h"
+
+using namespace std;
+
+namespace simit {
+
+// class Transport
+void Transport::exchange(int rank, const void* sendData, size_t sendBytes,
+                         void* recvData, size_t recvBytes) {
+  // The lower rank sends first, so that neither waits on a full buffer
+  if (getRank() < rank) {
+    send(rank, sendData, sendBytes);
+    recv(rank, recvData, recvBytes);
+  }
+  else {
+    recv(rank, recvData, recvBytes);
+    send(rank, sendData, sendBytes);
+  }
+}
+
+void Transport::allreduce(double* values, size_t n) {
+  const size_t bytes = n*sizeof(double);
+  if (getRank() == 0) {
+    vector<double> contribution(n);
+    for (int r = 1; r < getNumRanks(); ++r) {
+      recv(r, contribution.data(), bytes);
+      for (size_t i = 0; i < n; ++i) {
+        values[i] += contribution[i];
+      }
+    }
+    for (int r = 1; r < getNumRanks(); ++r) {
+      send(r, values, bytes);
+    }
+  }
+  else {
+    send(0, values, bytes);
+    recv(0, values, bytes);
+  }
+}
+
+void Transport::barrier() {
+  double none = 0.0;
+  allreduce(&none, 1);
+}
+
+
+// class LocalTransport
+LocalTransport::LocalTransport(int rank, const std::vector<int>& sockets)
+    : rank(rank), sockets(sockets) {
+  simit_iassert(rank >= 0 && rank < (int)sockets.size());
+}
+
+LocalTransport::~LocalTransport() {
+  for (int socket : sockets) {
+    if (socket >= 0) {
+      close(socket);
+    }
+  }
+}
+
+void LocalTransport::send(int rank, const void* data, size_t bytes) {
+  simit_uassert(rank >= 0 && rank < getNumRanks() && rank != this->rank)
+      << "cannot send to rank " << rank;
+  const char* next = (const char*)data;
+  while (bytes > 0) {
+    ssize_t sent = ::send(sockets[rank], next, bytes, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    simit_uassert(sent > 0)
+        << "rank " << this->rank << " cannot send to rank " << rank << ": "
+        << strerror(errno);
+    next += sent;
+    bytes -= sent;
+  }
+}
+
+void LocalTransport::recv(int rank, void* data, size_t bytes) {
+  simit_uassert(rank >= 0 && rank < getNumRanks() && rank != this->rank)
+      << "cannot receive from rank " << rank;
+  char* next = (char*)data;
+  while (bytes > 0) {
+    ssize_t received = ::recv(sockets[rank], next, bytes, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    simit_uassert(received != 0)
+        << "rank " << rank << " disconnected from rank " << this->rank;
+    simit_uassert(received > 0)
+        << "rank " << this->rank << " cannot receive from rank " << rank
+        << ": " << strerror(errno);
+    next += received;
+    bytes -= received;
+  }
+}
+
+
+int runLocalRanks(int numRanks,
+                  const std::function<int(Transport& transport)>& rank) {
+  simit_uassert(numRanks > 0) << "must run at least one rank";
+
+  // sockets[r][s] is rank r's end of the connection between r and s
+  vector<vector<int>> sockets(numRanks, vector<int>(numRanks, -1));
+  for (int r = 0; r < numRanks; ++r) {
+    for (int s = r+1; s < numRanks; ++s) {
+      int pair[2];
+      simit_uassert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0)
+          << "cannot connect ranks: " << strerror(errno);
+      sockets[r][s] = pair[0];
+      sockets[s][r] = pair[1];
+    }
+  }
+
+  auto closeAllBut = [&](int keep) {
+    for (int r = 0; r < numRanks; ++r) {
+      if (r == keep) {
+        continue;
+      }
+      for (int socket : sockets[r]) {
+        if (socket >= 0) {
+          close(socket);
+        }
+      }
+    }
+  };
+
+  // Forked ranks only have the forking thread, so stop the global pool's
+  // workers first. Every rank starts its own when it runs a parallel loop.
+  util::ThreadPool::getGlobal().stop();
+  std::cout.flush();
+  std::cerr.flush();
+  vector<pid_t> children;
+  for (int r = 1; r < numRanks; ++r) {
+    pid_t pid = fork();
+    simit_uassert(pid >= 0) << "cannot fork rank " << r;
+    if (pid == 0) {
+      closeAllBut(r);
+      int status = 1;
+      try {
+        LocalTransport transport(r, sockets[r]);
+        status = rank(transport);
+      }
+      catch (std::exception& e) {
+        std::cerr << "rank " << r << ": " << e.what() << std::endl;
+      }
+      std::cout.flush();
+      std::cerr.flush();
+      _exit(status == 0 ? 0 : 1);
+    }
+    children.push_back(pid);
+  }
+  closeAllBut(0);
+
+  int result = 0;
+  std::exception_ptr error;
+  try {
+    // Closing rank 0's sockets when it is done wakes ranks that wait on it
+    LocalTransport transport(0, sockets[0]);
+    result = rank(transport);
+  }
+  catch (...) {
+    error = std::current_exception();
+  }
+  for (pid_t child : children) {
+    int status;
+    pid_t waited;
+    while ((waited = waitpid(child, &status, 0)) < 0 && errno == EINTR) {}
+    if (waited < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      result = 1;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return result == 0 ? 0 : 1;
+}
+
+}
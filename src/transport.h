@@ -0,0 +1,74 @@
+#ifndef SIMIT_TRANSPORT_H
+#define SIMIT_TRANSPORT_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace simit {
+
+/// Point-to-point messaging between the ranks (processes) of a distributed
+/// run. Messages between two ranks arrive in the order they were sent.
+class Transport {
+public:
+  virtual ~Transport() {}
+
+  virtual int getRank() const = 0;
+  virtual int getNumRanks() const = 0;
+
+  /// Send `bytes` bytes to `rank`. May block until `rank` receives them.
+  virtual void send(int rank, const void* data, size_t bytes) = 0;
+
+  /// Receive `bytes` bytes sent by `rank`.
+  virtual void recv(int rank, void* data, size_t bytes) = 0;
+
+  /// Send `sendBytes` bytes to `rank` and receive `recvBytes` bytes from it,
+  /// while `rank` makes the matching exchange with this rank. A rank that
+  /// exchanges with several others must do so in increasing rank order, so
+  /// that exchanges cannot wait on each other in a cycle.
+  void exchange(int rank, const void* sendData, size_t sendBytes,
+                void* recvData, size_t recvBytes);
+
+  /// Replace `values` on every rank with their sum over all ranks.
+  void allreduce(double* values, size_t n);
+
+  /// Wait for all ranks to reach the barrier.
+  void barrier();
+};
+
+/// A transport between processes on one machine, over a pair of connected
+/// sockets per pair of ranks. Created by runLocalRanks.
+class LocalTransport : public Transport {
+public:
+  /// `sockets[r]` is the socket connected to rank `r`, or -1 for this rank.
+  LocalTransport(int rank, const std::vector<int>& sockets);
+
+  /// Closes the sockets.
+  ~LocalTransport();
+
+  int getRank() const {return rank;}
+  int getNumRanks() const {return sockets.size();}
+
+  void send(int rank, const void* data, size_t bytes);
+  void recv(int rank, void* data, size_t bytes);
+
+private:
+  int rank;
+  std::vector<int> sockets;
+
+  LocalTransport(const LocalTransport&) = delete;
+  LocalTransport& operator=(const LocalTransport&) = delete;
+};
+
+/// Run `rank` on `numRanks` processes on this machine, connected by a
+/// LocalTransport. The calling process runs rank 0 and forks the others,
+/// which exit when their rank returns (or throws, which counts as 1), so
+/// they must not expect to return to the caller. The workers of the global
+/// thread pool are stopped before forking, so the ranks may run parallel
+/// loops. Use it to test distributed programs on one machine.
+///return 0 if every rank returned 0
+int runLocalRanks(int numRanks,
+                  const std::function<int(Transport& transport)>& rank);
+
+}
+#endif
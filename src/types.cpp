@@ -1,9 +1,11 @@
 #include "types.h"
 
+#include <cstdint>
 #include <ostream>
 
 #include "ir.h"
 #include "macros.h"
+#include "settings.h"
 #include "util/util.h"
 #include "util/collections.h"
 
@@ -33,8 +35,9 @@ const GridSetType* Type::toGridSet() const {
   return dynamic_cast<GridSetType*>(set);
 }
 
-// Default to double size
-unsigned ScalarType::floatBytes = sizeof(double);
+// Threads start out with the float size given to simit::init (default double)
+thread_local unsigned ScalarType::floatBytes =
+    internal::getDefaultSettings().floatSize;
 
 bool ScalarType::singleFloat() {
   simit_iassert(floatBytes == sizeof(float) || floatBytes == sizeof(double))
@@ -42,6 +45,16 @@ bool ScalarType::singleFloat() {
   return floatBytes == sizeof(float);
 }
 
+// Threads start out with the index size given to simit::init (default 32-bit)
+thread_local unsigned ScalarType::indexBytes =
+    internal::getDefaultSettings().indexSize;
+
+bool ScalarType::longIndices() {
+  simit_iassert(indexBytes == sizeof(int32_t) || indexBytes == sizeof(int64_t))
+      << "Invalid index size: " << indexBytes;
+  return indexBytes == sizeof(int64_t);
+}
+
 // struct TensorType
 // TODO: Define below functions in terms of block types instead of in terms of
 //       the dimensions
@@ -108,11 +108,20 @@ struct ScalarType {
   ScalarType() : kind(Int) {}
   ScalarType(Kind kind) : kind(kind) {}
 
-  static unsigned floatBytes;
+  /// Float width in bytes. Per-thread, so that programs with different
+  /// settings can be compiled concurrently (see simit::Settings).
+  static thread_local unsigned floatBytes;
+
+  /// Width of Int values in generated code and of the index structures the
+  /// runtime builds for it (set sizes and path index coords/sinks). Int data
+  /// stored in fields and tensors keeps its 4-byte layout. Per-thread like
+  /// floatBytes.
+  static thread_local unsigned indexBytes;
 
   Kind kind;
 
   static bool singleFloat();
+  static bool longIndices();
 
   unsigned bytes() const {
     if (isInt()) {
@@ -224,10 +233,16 @@ private:
 };
 
 struct Field {
-  Field(std::string name, Type type) : name(name), type(type) {}
+  Field(std::string name, Type type, unsigned floatBytes=0)
+      : name(name), type(type), floatBytes(floatBytes) {}
 
   std::string name;
   Type type;
+
+  /// Storage width of the components of a float element field (4 or 8 bytes),
+  /// or 0 to store them at the program's float precision (floatBytes). Fields
+  /// are converted to the program precision when loaded and back when stored.
+  unsigned floatBytes;
 };
 
 struct ElementType : TypeNode {
@@ -0,0 +1,29 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace simit {
+namespace util {
+
+unsigned numWorkerThreads(unsigned numThreads) {
+  if (numThreads == 0) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+  return std::max(numThreads, 1u);
+}
+
+void parallelFor(size_t n, const std::function<void(size_t)>& body,
+                 unsigned numThreads) {
+  ThreadPool::getGlobal().parallelFor(n, 1, [&body](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      body(i);
+    }
+  }, numThreads);
+}
+
+}}
@@ -0,0 +1,24 @@
+#ifndef SIMIT_PARALLEL_H
+#define SIMIT_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace simit {
+namespace util {
+
+/// Returns the number of threads to use when `numThreads` are requested, where
+/// 0 requests one thread per hardware thread.
+unsigned numWorkerThreads(unsigned numThreads=0);
+
+/// Calls `body(i)` for every i in [0,n) on up to `numThreads` threads (0 uses
+/// one per hardware thread) of the global thread pool (see ThreadPool). Idle
+/// threads steal iterations, so they may be unevenly sized. The calling thread
+/// takes part in the work, and calls from inside a parallel loop run
+/// serially. If any iteration throws, the remaining iterations are skipped and
+/// the first exception is rethrown once all threads are done.
+void parallelFor(size_t n, const std::function<void(size_t)>& body,
+                 unsigned numThreads=0);
+
+}}
+#endif
@@ -0,0 +1,311 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "numa.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace simit {
+namespace util {
+
+/// True on threads that are running part of a loop.
+static thread_local bool inParallelFor = false;
+
+/// The CPUs the calling thread may run on.
+static vector<int> getThreadCPUs() {
+  vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+/// The CPU to pin thread `t` of `n` to: one of the `allowed` CPUs of node
+/// getWorkerNode(t, n), which the threads on the node take in turn. Falls
+/// back to all `allowed` CPUs if none of the node's are allowed.
+static int getThreadCPU(unsigned t, unsigned n, const vector<int>& allowed) {
+  const int node = getWorkerNode(t, n);
+  vector<int> cpus;
+  for (int cpu : getNodeCPUs(node)) {
+    if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    cpus = allowed;
+  }
+  unsigned rank = 0;
+  for (unsigned other = 0; other < t; ++other) {
+    if (getWorkerNode(other, n) == node) {
+      ++rank;
+    }
+  }
+  return cpus[rank % cpus.size()];
+}
+
+/// Restrict `thread` to `cpus`.
+static void pinThread(std::thread& thread, const vector<int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+/// A loop run by the pool. Each taking-part thread owns a range of the
+/// iterations, which it runs from the front in grain-sized chunks and others
+/// steal from the back.
+struct ThreadPool::Loop {
+  struct Range {
+    std::mutex mutex;
+    size_t begin;
+    size_t end;
+    char padding[64];
+  };
+
+  size_t grain;
+  const std::function<void(size_t,size_t)>* body;
+  unsigned numThreads;
+  std::unique_ptr<Range[]> ranges;
+
+  /// The number of threads that took part and are not done, guarded by the
+  /// pool's `doneMutex`.
+  unsigned running;
+
+  std::atomic<bool> failed;
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  Loop(size_t n, size_t grain, const std::function<void(size_t,size_t)>* body,
+       unsigned numThreads)
+      : grain(grain), body(body), numThreads(numThreads),
+        ranges(new Range[numThreads]), running(1), failed(false) {
+    for (unsigned t = 0; t < numThreads; ++t) {
+      ranges[t].begin = n * t / numThreads;
+      ranges[t].end   = n * (t+1) / numThreads;
+    }
+  }
+
+  /// Take the next chunk of thread `t`'s range.
+  bool take(unsigned t, size_t* begin, size_t* end) {
+    Range& range = ranges[t];
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin == range.end) {
+      return false;
+    }
+    *begin = range.begin;
+    *end = std::min(range.begin + grain, range.end);
+    range.begin = *end;
+    return true;
+  }
+
+  /// Steal half of the iterations left to another thread into thread `t`'s
+  /// (empty) range.
+  bool steal(unsigned t) {
+    for (unsigned i = 1; i < numThreads; ++i) {
+      Range& victim = ranges[(t + i) % numThreads];
+      size_t begin, end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        size_t remaining = victim.end - victim.begin;
+        if (remaining == 0) {
+          continue;
+        }
+        end = victim.end;
+        begin = end - (remaining+1)/2;
+        victim.end = begin;
+      }
+      std::lock_guard<std::mutex> lock(ranges[t].mutex);
+      ranges[t].begin = begin;
+      ranges[t].end = end;
+      return true;
+    }
+    return false;
+  }
+
+  void run(unsigned t) {
+    size_t begin, end;
+    while (!failed && (take(t, &begin, &end) ||
+                       (steal(t) && take(t, &begin, &end)))) {
+      try {
+        (*body)(begin, end);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!failed) {
+          error = std::current_exception();
+          failed = true;
+        }
+      }
+    }
+  }
+};
+
+// class ThreadPool
+ThreadPool::ThreadPool()
+    : pinnedThreads(0), allowedCPUs(getThreadCPUs()), loop(nullptr),
+      generation(0), stopping(false) {
+}
+
+ThreadPool::~ThreadPool() {
+  stop();
+}
+
+void ThreadPool::parallelFor(size_t n, size_t grain,
+                             const std::function<void(size_t,size_t)>& body,
+                             unsigned numThreads, bool pinThreads) {
+  grain = std::max<size_t>(grain, 1);
+  size_t numChunks = (n + grain-1) / grain;
+  const unsigned poolThreads = numWorkerThreads(numThreads);
+  numThreads = std::min<size_t>(poolThreads, numChunks);
+  if (numThreads <= 1 || inParallelFor || !loopMutex.try_lock()) {
+    for (size_t begin = 0; begin < n; begin += grain) {
+      body(begin, std::min(begin + grain, n));
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> loopLock(loopMutex, std::adopt_lock);
+  // Pin for the full thread count, which loops over partitioned fields use,
+  // so that loops with fewer chunks do not move the workers
+  configure(numThreads-1, poolThreads, pinThreads);
+
+  Loop current(n, grain, &body, numThreads);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    loop = &current;
+    ++generation;
+  }
+  wakeup.notify_all();
+
+  inParallelFor = true;
+  current.run(0);
+  inParallelFor = false;
+
+  // Workers that have not joined by now will find no work, so stop them from
+  // joining and wait for those that did
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    loop = nullptr;
+  }
+  {
+    std::unique_lock<std::mutex> lock(doneMutex);
+    --current.running;
+    done.wait(lock, [&current]() {return current.running == 0;});
+  }
+
+  if (current.error) {
+    std::rethrow_exception(current.error);
+  }
+}
+
+unsigned ThreadPool::getNumWorkers() const {
+  return workers.size();
+}
+
+void ThreadPool::stop() {
+  std::lock_guard<std::mutex> loopLock(loopMutex);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  pinnedThreads = 0;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  stopping = false;
+}
+
+ThreadPool& ThreadPool::getGlobal() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::configure(unsigned numWorkers, unsigned numThreads,
+                           bool pinThreads) {
+  unsigned long currentGeneration;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentGeneration = generation;
+  }
+  const unsigned started = workers.size();
+  while (workers.size() < numWorkers) {
+    unsigned worker = workers.size();
+    workers.emplace_back(&ThreadPool::work, this, worker, currentGeneration);
+  }
+  if (allowedCPUs.empty()) {
+    return;
+  }
+
+  // New workers inherit the affinity of the calling thread, so they are
+  // (un)pinned even if the other workers are not moved
+  const unsigned layout = pinThreads
+      ? std::max<unsigned>(numThreads, workers.size()+1) : 0;
+  for (unsigned worker = 0; worker < workers.size(); ++worker) {
+    if (layout == pinnedThreads && worker < started) {
+      continue;
+    }
+    if (layout == 0) {
+      pinThread(workers[worker], allowedCPUs);
+    }
+    else {
+      pinThread(workers[worker],
+                {getThreadCPU(worker+1, layout, allowedCPUs)});
+    }
+  }
+  pinnedThreads = layout;
+}
+
+void ThreadPool::work(unsigned worker, unsigned long seen) {
+  inParallelFor = true;
+  while (true) {
+    Loop* current;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wakeup.wait(lock, [&]() {return stopping || generation != seen;});
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+      current = loop;
+      if (current == nullptr || worker+1 >= current->numThreads) {
+        continue;
+      }
+      std::lock_guard<std::mutex> doneLock(doneMutex);
+      ++current->running;
+    }
+
+    current->run(worker+1);
+
+    std::lock_guard<std::mutex> lock(doneMutex);
+    if (--current->running == 0) {
+      done.notify_all();
+    }
+  }
+}
+
+}}
@@ -0,0 +1,92 @@
+#ifndef SIMIT_THREAD_POOL_H
+#define SIMIT_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simit {
+namespace util {
+
+/// A pool of persistent worker threads that run parallel loops with work
+/// stealing. The iterations of a loop are split evenly between the threads
+/// that take part, and a thread that runs out of iterations steals half of
+/// the remaining iterations of another thread. Workers sleep while no loop
+/// runs, so an idle pool costs nothing.
+///
+/// The pool runs one loop at a time. Loops started from inside a loop, or
+/// while the pool runs a loop for another thread, run serially on the calling
+/// thread, so nested parallelism never oversubscribes the machine or blocks.
+class ThreadPool {
+public:
+  ThreadPool();
+  ~ThreadPool();
+
+  /// Calls `body(begin,end)` for disjoint ranges of at most `grain`
+  /// iterations that together cover [0,n), on up to `numThreads` threads
+  /// including the calling thread (0 uses one per hardware thread). If
+  /// `pinThreads` is true the workers are pinned to one CPU each, among the
+  /// CPUs the process may run on. Thread `t` of `n`, where the calling thread
+  /// is thread 0, runs on NUMA node `getWorkerNode(t, n)`, next to the block
+  /// of partitioned fields it starts on (see numa.h). If any call
+  /// throws, the remaining ranges are skipped and the first exception is
+  /// rethrown once all threads are done.
+  void parallelFor(size_t n, size_t grain,
+                   const std::function<void(size_t,size_t)>& body,
+                   unsigned numThreads=0, bool pinThreads=false);
+
+  /// The number of worker threads started so far, not counting the threads
+  /// that call parallelFor.
+  unsigned getNumWorkers() const;
+
+  /// Stop and join the workers, waiting for a running loop to finish first.
+  /// Later loops start new workers. Processes that fork stop the pool first,
+  /// since the child would not have the parent's workers.
+  void stop();
+
+  /// The pool shared by the runtime and generated code.
+  static ThreadPool& getGlobal();
+
+private:
+  struct Loop;
+
+  std::vector<std::thread> workers;
+
+  /// The number of threads the workers are pinned for, or 0 if they are not
+  /// pinned.
+  unsigned pinnedThreads;
+
+  /// The CPUs the process could run on when the pool was created. Workers are
+  /// pinned to these and unpinned workers may run on all of them.
+  std::vector<int> allowedCPUs;
+
+  /// Held by the thread that runs a loop on the pool.
+  std::mutex loopMutex;
+
+  /// Guards `loop`, `generation` and `stopping`, and signals new loops.
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  Loop* loop;
+  unsigned long generation;
+  bool stopping;
+
+  /// Signals the end of the threads' parts of a loop.
+  std::mutex doneMutex;
+  std::condition_variable done;
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// Start workers until there are `numWorkers` of them and (un)pin them for
+  /// loops on `numThreads` threads.
+  void configure(unsigned numWorkers, unsigned numThreads, bool pinThreads);
+
+  /// Run the loops of the pool started after `generation` as worker `worker`.
+  void work(unsigned worker, unsigned long generation);
+};
+
+}}
+#endif
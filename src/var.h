@@ -15,7 +15,7 @@ struct VarContent {
   std::string name;
   Type type;
 
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
   friend inline void aquire(VarContent *c) {++c->ref;}
   friend inline void release(VarContent *c) {if (--c->ref==0) delete c;}
 };
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <map>
+
+#include "allocator.h"
+#include "graph.h"
+
+using namespace std;
+using namespace simit;
+
+/// Counts the bytes allocated and not yet freed.
+class CountingAllocator : public Allocator {
+public:
+  void* allocate(size_t bytes) {
+    void* data = allocator.allocate(bytes);
+    if (data != nullptr) {
+      sizes[data] = bytes;
+      allocatedBytes += bytes;
+    }
+    return data;
+  }
+
+  void deallocate(void* data, size_t bytes) {
+    if (data != nullptr) {
+      EXPECT_EQ(sizes[data], bytes);
+      sizes.erase(data);
+      allocatedBytes -= bytes;
+    }
+    allocator.deallocate(data, bytes);
+  }
+
+  DefaultAllocator allocator;
+  map<void*, size_t> sizes;
+  size_t allocatedBytes = 0;
+};
+
+static bool isZero(const void* data, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    if (((const char*)data)[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(allocator, default) {
+  for (HugePages hugePages : {HugePages::None, HugePages::Transparent,
+                              HugePages::Explicit}) {
+    DefaultAllocator allocator(hugePages);
+    ASSERT_EQ(nullptr, allocator.allocate(0));
+
+    // Small, mapped and huge page allocations
+    for (size_t bytes : {(size_t)24, (size_t)300 << 10,
+                         getHugePageSize()*2 + 24}) {
+      char* data = (char*)allocator.allocate(bytes);
+      ASSERT_NE(nullptr, data);
+      ASSERT_EQ(0u, (uintptr_t)data % kAllocationAlignment);
+      ASSERT_TRUE(isZero(data, bytes));
+      if (hugePages == HugePages::Transparent && bytes > getHugePageSize()) {
+        ASSERT_EQ(0u, (uintptr_t)data % getHugePageSize());
+      }
+      for (size_t i = 0; i < bytes; ++i) {
+        data[i] = (char)(i+1);
+      }
+
+      // Growing keeps the data and zeroes the rest, across all the kinds
+      size_t newBytes = bytes*3 + 1000;
+      data = (char*)allocator.reallocate(data, bytes, newBytes);
+      ASSERT_EQ(0u, (uintptr_t)data % kAllocationAlignment);
+      for (size_t i = 0; i < bytes; ++i) {
+        ASSERT_EQ((char)(i+1), data[i]);
+      }
+      ASSERT_TRUE(isZero(data+bytes, newBytes-bytes));
+
+      // Shrinking and regrowing zeroes the dropped bytes
+      data = (char*)allocator.reallocate(data, newBytes, bytes/2);
+      data = (char*)allocator.reallocate(data, bytes/2, bytes);
+      ASSERT_EQ((char)1, data[0]);
+      ASSERT_TRUE(isZero(data+bytes/2, bytes-bytes/2));
+      allocator.deallocate(data, bytes);
+    }
+    allocator.deallocate(nullptr, 0);
+  }
+}
+
+TEST(allocator, sets) {
+  CountingAllocator allocator;
+  Allocator* defaultAllocator = getAllocator();
+  setAllocator(&allocator);
+  {
+    Set V;
+    Set E(V,V);
+    FieldRef<double,3> x = V.addField<double,3>("x");
+    FieldRef<int> a = E.addField<int>("a");
+    createBox(&V, &E, 20, 20, 20);
+    setAllocator(defaultAllocator);
+
+    ASSERT_GT(allocator.allocatedBytes, V.getSize()*3*sizeof(double));
+    ASSERT_EQ(0u, (uintptr_t)x.getData() % kAllocationAlignment);
+    ASSERT_EQ(0u, (uintptr_t)a.getData() % kAllocationAlignment);
+    ASSERT_EQ(0u, (uintptr_t)E.getEndpointsPtr() % kAllocationAlignment);
+
+    // Sets keep using the allocator they were created with
+    size_t allocatedBytes = allocator.allocatedBytes;
+    ElementRef first = V.addElements(5000);
+    ASSERT_GT(allocator.allocatedBytes, allocatedBytes);
+    ASSERT_EQ(0.0, x.get(first)(2));
+    x.set(first, {1.0, 2.0, 3.0});
+    ASSERT_EQ(3.0, x.get(first)(2));
+  }
+  ASSERT_EQ(0u, allocator.allocatedBytes);
+  ASSERT_TRUE(allocator.sizes.empty());
+}
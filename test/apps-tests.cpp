@@ -2,8 +2,13 @@
 
 #include <iostream>
 
+#include "init.h"
 #include "graph.h"
 #include "program.h"
+#include "program_context.h"
+#include "frontend/frontend.h"
+#include "lower/lower.h"
+#include "util/util.h"
 #include "error.h"
 
 using namespace std;
@@ -20,8 +25,8 @@ TEST(apps, esprings) {
   auto fixed = points.addField<bool>("fixed");
 
   Set springs(points,points);
-  auto  k = springs.addField<float>("k");
-  auto l0 = springs.addField<float>("l0");
+  auto  k = springs.addField<simit_float>("k");
+  auto l0 = springs.addField<simit_float>("l0");
 
   ElementRef p0 = points.add();
   ElementRef p1 = points.add();
@@ -72,3 +77,141 @@ TEST(apps, esprings) {
   SIMIT_ASSERT_FLOAT_EQ(-0.0000195219,            v(p2)(1));
   SIMIT_ASSERT_FLOAT_EQ( 0.0,                     v(p2)(2));
 }
+
+/// Run the springs twice on a chain with more springs than fit in one edge
+/// block, lowered with the given settings, and return the positions and
+/// velocities of the points.
+static vector<simit_float> runSpringsChain(int edgeBlockSize, bool pullMaps) {
+  const int numPoints = 7;
+
+  Set points;
+  auto     x = points.addField<simit_float,3>("x");
+  auto     v = points.addField<simit_float,3>("v");
+  auto     m = points.addField<simit_float>("m");
+  auto fixed = points.addField<bool>("fixed");
+
+  Set springs(points,points);
+  auto  k = springs.addField<simit_float>("k");
+  auto l0 = springs.addField<simit_float>("l0");
+
+  vector<ElementRef> p;
+  for (int i = 0; i < numPoints; ++i) {
+    p.push_back(points.add());
+    x(p[i]) = {(simit_float)i, 0.1*(i%2), 0.0};
+    v(p[i]) = {0.0, 0.0, 0.0};
+    m(p[i]) = 1.0 + i;
+  }
+  fixed(p[0]) = true;
+  for (int i = 0; i < numPoints-1; ++i) {
+    ElementRef s = springs.add(p[i],p[i+1]);
+    k(s)  = 1.0 + i;
+    l0(s) = 0.9;
+  }
+
+  // HACK: Set kEdgeBlockSize and kPullMaps to change how the spring map is
+  // lowered
+  kEdgeBlockSize = edgeBlockSize;
+  kPullMaps = pullMaps;
+  Function func = loadFunction(std::string(APPS_DIR) +
+                               "/springs/esprings.sim", "timestep");
+  kEdgeBlockSize = 0;
+  kPullMaps = false;
+  if (!func.defined()) {
+    return {};
+  }
+  func.bind("points",  &points);
+  func.bind("springs", &springs);
+  func.runSafe();
+  func.runSafe();
+
+  vector<simit_float> result;
+  for (int i = 0; i < numPoints; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      result.push_back(x(p[i])(j));
+      result.push_back(v(p[i])(j));
+    }
+  }
+  return result;
+}
+
+/// The springs timestep lowered with the given edge block size and pull maps.
+static string lowerSprings(int edgeBlockSize, bool pullMaps) {
+  internal::ProgramContext ctx;
+  vector<ParseError> errors;
+  internal::Frontend().parseFile(std::string(APPS_DIR) +
+                                 "/springs/esprings.sim", &ctx, &errors);
+  if (errors.size() > 0) {
+    return errors[0].toString();
+  }
+
+  // HACK: Set kEdgeBlockSize and kPullMaps to change how the spring map is
+  // lowered
+  kEdgeBlockSize = edgeBlockSize;
+  kPullMaps = pullMaps;
+  ir::Func lowered = ir::lower(ctx.getFunction("timestep"));
+  kEdgeBlockSize = 0;
+  kPullMaps = false;
+  return util::toString(lowered);
+}
+
+TEST(apps, esprings_blocked) {
+  // The spring loop gathers its endpoints' fields into block buffers
+  if (kBackend == "cpu") {
+    EXPECT_EQ(string::npos, lowerSprings(0, false).find("points_x_block"));
+    EXPECT_NE(string::npos, lowerSprings(4, false).find("points_x_block"));
+  }
+
+  vector<simit_float> expected = runSpringsChain(0, false);
+  vector<simit_float> actual = runSpringsChain(4, false);
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(expected[i], actual[i]);
+  }
+}
+
+TEST(apps, esprings_pull) {
+  // The spring loop becomes a loop over the points that pull from their springs
+  if (kBackend == "cpu") {
+    EXPECT_EQ(string::npos,
+              lowerSprings(0, false).find("for points_vertex in points"));
+    EXPECT_NE(string::npos,
+              lowerSprings(0, true).find("for points_vertex in points"));
+  }
+
+  vector<simit_float> expected = runSpringsChain(0, false);
+  vector<simit_float> actual = runSpringsChain(0, true);
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(expected[i], actual[i]);
+  }
+}
+
+TEST(apps, esprings_vectorization_report) {
+  vector<simit_float> expected = runSpringsChain(0, false);
+
+  // HACK: Set kVectorizationReport to report on the compiled springs
+  kVectorizationReport = true;
+  testing::internal::CaptureStderr();
+  vector<simit_float> actual = runSpringsChain(0, false);
+  string report = testing::internal::GetCapturedStderr();
+  kVectorizationReport = false;
+
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(expected[i], actual[i]);
+  }
+#ifndef SIMIT_DEBUG
+  EXPECT_NE(string::npos, report.find("Loop vectorization report"));
+
+  // The report ends with "<vectorized> of <considered> loops vectorized", and
+  // at least one of the springs loops must vectorize
+  size_t summary = report.find(" loops vectorized");
+  ASSERT_NE(string::npos, summary);
+  size_t line = report.rfind('\n', summary);
+  line = (line == string::npos) ? 0 : line + 1;
+  EXPECT_GT(std::stoi(report.substr(line, summary - line)), 0) << report;
+#endif
+}
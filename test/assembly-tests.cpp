@@ -1,5 +1,7 @@
 #include "simit-test.h"
 
+#include <limits>
+
 #include "init.h"
 #include "graph.h"
 #include "tensor.h"
@@ -215,6 +217,82 @@ TEST(assembly, edges_two_results) {
   ASSERT_EQ(168, (int)b(v2));
 }
 
+TEST(assembly, vertices_reduce_min) {
+  Set V;
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  FieldRef<int> a = V.addField<int>("a");
+  FieldRef<int> b = V.addField<int>("b");
+  a(v0) = 3;
+  a(v1) = -1;
+  a(v2) = 2;
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.runSafe();
+
+  ASSERT_EQ(4, (int)b(v0));
+  ASSERT_EQ(0, (int)b(v1));
+  ASSERT_EQ(3, (int)b(v2));
+}
+
+TEST(assembly, edges_reduce_max) {
+  Set V;
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  ElementRef v3 = V.add();
+  FieldRef<int> b = V.addField<int>("b");
+
+  Set E(V,V);
+  ElementRef e0 = E.add(v0,v1);
+  ElementRef e1 = E.add(v1,v2);
+  FieldRef<int> a = E.addField<int>("a");
+  a(e0) = 5;
+  a(e1) = -2;
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+
+  ASSERT_EQ(5,  (int)b(v0));
+  ASSERT_EQ(5,  (int)b(v1));
+  ASSERT_EQ(-2, (int)b(v2));
+  ASSERT_EQ(std::numeric_limits<int>::min(), (int)b(v3));
+}
+
+TEST(assembly, edges_reduce_user) {
+  Set V;
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  ElementRef v3 = V.add();
+  FieldRef<int> b = V.addField<int>("b");
+
+  Set E(V,V);
+  ElementRef e0 = E.add(v0,v1);
+  ElementRef e1 = E.add(v1,v2);
+  FieldRef<int> a = E.addField<int>("a");
+  a(e0) = 5;
+  a(e1) = -2;
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+
+  // Vertices without edges keep the reducer's identity
+  ASSERT_EQ(5,   (int)b(v0));
+  ASSERT_EQ(-10, (int)b(v1));
+  ASSERT_EQ(-2,  (int)b(v2));
+  ASSERT_EQ(1,   (int)b(v3));
+}
+
 TEST(assembly, matrix_ve) {
   Set V;
   ElementRef v0 = V.add();
@@ -0,0 +1,239 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "binary_mesh.h"
+#include "graph.h"
+
+using namespace std;
+using namespace simit;
+
+static void saveAndLoad(MeshCompression compression) {
+  const string filename = "binary_mesh_test.smsh";
+
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<double,3> v = points.addField<double,3>("v");
+  for (int i=0; i < 100; ++i) {
+    ElementRef p = points.add();
+    x.set(p, {1.0*i, 2.0*i, 3.0*i});
+    id.set(p, i+7);
+  }
+  Set springs(points,points);
+  FieldRef<float> k = springs.addField<float>("k");
+  vector<int> endpoints;
+  for (int i=0; i < 99; ++i) {
+    endpoints.push_back(i);
+    endpoints.push_back(i+1);
+  }
+  springs.addElements(99, endpoints.data());
+  for (ElementRef s : springs) {
+    if (s.getIdent() == 5) {
+      k.set(s, 0.5f);
+    }
+  }
+
+  BinaryMeshWriter writer(compression);
+  writer.addSet("points", &points);
+  writer.addSet("springs", &springs);
+  ASSERT_EQ(0, writer.save(filename));
+
+  BinaryMesh mesh;
+  ASSERT_EQ(0, mesh.open(filename));
+  ASSERT_EQ(vector<string>({"points", "springs"}), mesh.getSetNames());
+
+  Set loadedPoints;
+  FieldRef<int> loadedId = loadedPoints.addField<int>("id");
+  Set loadedSprings(loadedPoints, loadedPoints);
+  ASSERT_EQ(0, mesh.load("points", &loadedPoints));
+  ASSERT_EQ(0, mesh.load("springs", &loadedSprings));
+  mesh.close();
+  remove(filename.c_str());
+
+  ASSERT_EQ(100, loadedPoints.getSize());
+  ASSERT_EQ(99, loadedSprings.getSize());
+  FieldRef<double,3> loadedX = loadedPoints.getField<double,3>("x");
+  FieldRef<double,3> loadedV = loadedPoints.getField<double,3>("v");
+  for (ElementRef p : loadedPoints) {
+    int i = p.getIdent();
+    ASSERT_EQ(1.0*i, loadedX.get(p)(0));
+    ASSERT_EQ(3.0*i, loadedX.get(p)(2));
+    ASSERT_EQ(0.0,   loadedV.get(p)(1));
+    ASSERT_EQ(i+7,   loadedId.get(p));
+  }
+  FieldRef<float> loadedK = loadedSprings.getField<float>("k");
+  for (ElementRef s : loadedSprings) {
+    int i = s.getIdent();
+    ASSERT_EQ(i,   loadedSprings.getEndpoint(s, 0).getIdent());
+    ASSERT_EQ(i+1, loadedSprings.getEndpoint(s, 1).getIdent());
+    ASSERT_EQ(i == 5 ? 0.5f : 0.0f, loadedK.get(s));
+  }
+}
+
+TEST(BinaryMesh, saveAndLoad) {
+  saveAndLoad(MeshCompression::None);
+}
+
+TEST(BinaryMesh, saveAndLoadZeroRuns) {
+  saveAndLoad(MeshCompression::ZeroRuns);
+}
+
+TEST(BinaryMesh, rejectMismatch) {
+  const string filename = "binary_mesh_test_mismatch.smsh";
+  Set points;
+  points.addField<double>("a");
+  points.add();
+  BinaryMeshWriter writer;
+  writer.addSet("points", &points);
+  ASSERT_EQ(0, writer.save(filename));
+
+  BinaryMesh mesh;
+  ASSERT_EQ(0, mesh.open(filename));
+  Set wrongType;
+  wrongType.addField<int>("a");
+  ASSERT_EQ(-1, mesh.load("points", &wrongType));
+  Set edges(points, points);
+  ASSERT_EQ(-1, mesh.load("points", &edges));
+  ASSERT_EQ(-1, mesh.load("lines", &points));
+  mesh.close();
+  remove(filename.c_str());
+
+  ASSERT_EQ(-1, mesh.open(filename));
+}
+
+TEST(BinaryMesh, snapshotAndTensors) {
+  const string filename = "binary_mesh_test_snapshot.smsh";
+  Set points;
+  FieldRef<double> a = points.addField<double>("a");
+  ElementRef p = points.add();
+  a.set(p, 1.0);
+  double tensor[3] = {1.0, 2.0, 3.0};
+
+  BinaryMeshWriter writer;
+  ASSERT_EQ(0, writer.addSet("points", &points));
+  ASSERT_EQ(0, writer.addTensor("tensor", tensor, sizeof(tensor)));
+  writer.snapshot();
+
+  // Changes after the snapshot are not saved
+  a.set(p, 2.0);
+  tensor[1] = 0.0;
+  points.add();
+  ASSERT_EQ(0, writer.save(filename));
+
+  BinaryMesh mesh;
+  ASSERT_EQ(0, mesh.open(filename));
+  Set loaded;
+  ASSERT_EQ(0, mesh.load("points", &loaded));
+  ASSERT_EQ(1, loaded.getSize());
+  ASSERT_EQ(1.0, loaded.getField<double>("a").get(*loaded.begin()));
+
+  double loadedTensor[3];
+  ASSERT_EQ(0, mesh.loadTensor("tensor", loadedTensor, sizeof(loadedTensor)));
+  ASSERT_EQ(2.0, loadedTensor[1]);
+  ASSERT_EQ(-1, mesh.loadTensor("tensor", loadedTensor, sizeof(double)));
+  mesh.close();
+  remove(filename.c_str());
+}
+
+TEST(BinaryMesh, setSaveAndLoad) {
+  const string filename = "binary_mesh_test_set.smsh";
+  Set points;
+  points.addElements(3);
+  Set edges(points, points);
+  FieldRef<int> w = edges.addField<int>("w");
+  int endpoints[] = {0, 1, 1, 2};
+  edges.addElements(2, endpoints);
+  for (ElementRef e : edges) {
+    w.set(e, 10 + e.getIdent());
+  }
+  ASSERT_EQ(0, edges.save(filename));
+
+  // Loading replaces the elements of the set
+  int otherEndpoints[] = {2, 0};
+  edges.addElements(1, otherEndpoints);
+  ASSERT_EQ(0, edges.load(filename));
+  remove(filename.c_str());
+  ASSERT_EQ(2, edges.getSize());
+  for (ElementRef e : edges) {
+    ASSERT_EQ(e.getIdent(),   edges.getEndpoint(e, 0).getIdent());
+    ASSERT_EQ(e.getIdent()+1, edges.getEndpoint(e, 1).getIdent());
+    ASSERT_EQ(10 + e.getIdent(), w.get(e));
+  }
+}
+
+TEST(BinaryMesh, appendToNonEmptySets) {
+  const string filename = "binary_mesh_test_append.smsh";
+  Set points;
+  points.addElements(3);
+  Set edges(points, points);
+  int endpoints[] = {0, 1, 1, 2};
+  edges.addElements(2, endpoints);
+  BinaryMeshWriter writer;
+  ASSERT_EQ(0, writer.addSet("points", &points));
+  ASSERT_EQ(0, writer.addSet("edges", &edges));
+  ASSERT_EQ(0, writer.save(filename));
+
+  // The second copy's endpoints are the second copy's points
+  BinaryMesh mesh;
+  ASSERT_EQ(0, mesh.open(filename));
+  ASSERT_EQ(0, mesh.load("points", &points));
+  ASSERT_EQ(0, mesh.load("edges", &edges));
+  mesh.close();
+  remove(filename.c_str());
+
+  ASSERT_EQ(6, points.getSize());
+  ASSERT_EQ(4, edges.getSize());
+  for (ElementRef e : edges) {
+    int first = (e.getIdent() < 2) ? 0 : 3;
+    int i = e.getIdent() % 2;
+    ASSERT_EQ(first+i,   edges.getEndpoint(e, 0).getIdent());
+    ASSERT_EQ(first+i+1, edges.getEndpoint(e, 1).getIdent());
+  }
+}
+
+TEST(BinaryMesh, rejectTruncatedAndCorrupt) {
+  const string filename = "binary_mesh_test_truncated.smsh";
+  Set points;
+  FieldRef<double> a = points.addField<double>("a");
+  for (int i=0; i < 10; ++i) {
+    a.set(points.add(), i);
+  }
+  BinaryMeshWriter writer;
+  ASSERT_EQ(0, writer.addSet("points", &points));
+  ASSERT_EQ(0, writer.save(filename));
+
+  std::ifstream in(filename, std::ios::binary);
+  string bytes((std::istreambuf_iterator<char>(in)),
+               std::istreambuf_iterator<char>());
+  in.close();
+  auto rewrite = [&](const string& contents) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+  };
+
+  // Every truncation is rejected, including ones inside a chunk header
+  BinaryMesh mesh;
+  for (size_t size = 0; size < bytes.size(); ++size) {
+    rewrite(bytes.substr(0, size));
+    ASSERT_EQ(-1, mesh.open(filename)) << size;
+  }
+
+  // A chunk name without a terminating NUL in its 64 bytes is rejected
+  size_t name = bytes.find("points");
+  ASSERT_NE(string::npos, name);
+  string corrupt = bytes;
+  std::fill(corrupt.begin()+name, corrupt.begin()+name+64, 'x');
+  rewrite(corrupt);
+  ASSERT_EQ(-1, mesh.open(filename));
+
+  rewrite(bytes);
+  ASSERT_EQ(0, mesh.open(filename));
+  mesh.close();
+  remove(filename.c_str());
+}
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "distributed.h"
+#include "frontend/frontend.h"
+#include "graph.h"
+#include "halo_analysis.h"
+#include "partition.h"
+#include "program_context.h"
+#include "transport.h"
+#include "util/thread_pool.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(distributed, partition) {
+  Set V;
+  Set E(V,V);
+  createBox(&V, &E, 12, 12, 1);
+
+  vector<int> parts = partitionGraph(V, {&E}, 4);
+  ASSERT_EQ(144u, parts.size());
+  vector<int> sizes(4, 0);
+  for (int part : parts) {
+    ASSERT_TRUE(part >= 0 && part < 4);
+    ++sizes[part];
+  }
+  for (int size : sizes) {
+    ASSERT_GE(size, 34);
+    ASSERT_LE(size, 38);
+  }
+
+  // Four 6x6 quadrants cut 24 edges
+  int cut = 0;
+  for (ElementRef e : E) {
+    if (parts[E.getEndpoint(e,0).getIdent()] !=
+        parts[E.getEndpoint(e,1).getIdent()]) {
+      ++cut;
+    }
+  }
+  ASSERT_LT(cut, 40);
+
+  // The partition only depends on the topology
+  ASSERT_EQ(parts, partitionGraph(V, {&E}, 4));
+}
+
+TEST(distributed, allreduce) {
+  int status = runLocalRanks(3, [](Transport& transport) {
+    double values[2] = {(double)transport.getRank(), 1.0};
+    transport.allreduce(values, 2);
+    transport.barrier();
+    return (values[0] == 3.0 && values[1] == 3.0) ? 0 : 1;
+  });
+  ASSERT_EQ(0, status);
+}
+
+TEST(distributed, parallel_ranks) {
+  // Ranks forked after the global pool started its workers run parallel loops
+  auto sum = [](size_t n) {
+    std::atomic<size_t> total(0);
+    util::ThreadPool::getGlobal().parallelFor(n, 1, [&](size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        total += i;
+      }
+    }, 4);
+    return total.load();
+  };
+  ASSERT_EQ(4950u, sum(100));
+  int status = runLocalRanks(3, [&](Transport&) {
+    // The ranks do not inherit workers, which do not run in forked processes
+    if (util::ThreadPool::getGlobal().getNumWorkers() != 0) {
+      return 1;
+    }
+    return (sum(100) == 4950u) ? 0 : 1;
+  });
+  ASSERT_EQ(0, status);
+}
+
+TEST(distributed, halo) {
+  Set V;
+  Set E(V,V);
+  FieldRef<int> id = V.addField<int>("id");
+  FieldRef<int> sum = V.addField<int>("sum");
+  FieldRef<int> a = E.addField<int>("a");
+  createBox(&V, &E, 8, 8, 1);
+  vector<int> expected(V.getSize(), 0);
+  for (ElementRef v : V) {
+    id.set(v, v.getIdent());
+  }
+  for (ElementRef e : E) {
+    a.set(e, e.getIdent()+1);
+    expected[E.getEndpoint(e,0).getIdent()] += e.getIdent()+1;
+    expected[E.getEndpoint(e,1).getIdent()] += e.getIdent()+1;
+  }
+
+  int status = runLocalRanks(3, [&](Transport& transport) {
+    DistributedSets distributed(&transport, &V, {&E});
+    Set localV;
+    Set localE(localV, localV);
+    distributed.distribute(&localV, {&localE});
+    FieldRef<int> localId = localV.getField<int>("id");
+    FieldRef<int> localSum = localV.getField<int>("sum");
+    FieldRef<int> localA = localE.getField<int>("a");
+
+    // Halo vertices are refreshed from their owners
+    int numOwned = distributed.getNumOwned(&localV);
+    for (ElementRef v : localV) {
+      if (v.getIdent() >= numOwned) {
+        localId.set(v, -1);
+      }
+    }
+    distributed.update();
+    for (ElementRef v : localV) {
+      if (localId.get(v) != distributed.getGlobal(&localV, v).getIdent()) {
+        return 1;
+      }
+    }
+
+    // Reductions over the local edges are complete on the owned vertices
+    for (ElementRef e : localE) {
+      localSum.set(localE.getEndpoint(e,0),
+                   localSum.get(localE.getEndpoint(e,0)) + localA.get(e));
+      localSum.set(localE.getEndpoint(e,1),
+                   localSum.get(localE.getEndpoint(e,1)) + localA.get(e));
+    }
+    distributed.gather(&localV, "sum");
+    if (transport.getRank() == 0) {
+      for (ElementRef v : V) {
+        if (sum.get(v) != expected[v.getIdent()]) {
+          return 1;
+        }
+      }
+    }
+    return 0;
+  });
+  ASSERT_EQ(0, status);
+}
+
+/// The halo hazard of `body` as the main function of a spring program.
+static string getHaloHazard(const string& body) {
+  string program =
+      "element Point\n"
+      "  b : float;\n"
+      "  c : float;\n"
+      "end\n"
+      "element Spring\n"
+      "  a : float;\n"
+      "end\n"
+      "extern points  : set{Point};\n"
+      "extern springs : set{Spring}(points,points);\n"
+      "func stiffness(s : Spring, p : (Point*2)) -> "
+      "(A : tensor[points,points](float))\n"
+      "  A(p(0),p(0)) =  s.a;\n"
+      "  A(p(0),p(1)) = -s.a;\n"
+      "  A(p(1),p(0)) = -s.a;\n"
+      "  A(p(1),p(1)) =  s.a;\n"
+      "end\n"
+      "func force(s : Spring, p : (Point*2)) -> (f : tensor[points](float))\n"
+      "  f(p(0)) = s.a * (p(1).c - p(0).c);\n"
+      "  f(p(1)) = s.a * (p(0).c - p(1).c);\n"
+      "end\n"
+      "export func main()\n" + body + "end\n";
+  internal::ProgramContext ctx;
+  vector<ParseError> errors;
+  internal::Frontend().parseString(program, &ctx, &errors);
+  if (errors.size() > 0) {
+    return errors[0].toString();
+  }
+  return ir::findHaloHazard(ctx.getFunction("main"));
+}
+
+TEST(distributed, halo_hazards) {
+  // Reading complete values at neighbors, and computing partial ones
+  ASSERT_EQ("", getHaloHazard("  A = map stiffness to springs reduce +;\n"
+                              "  points.c = A * points.b;\n"));
+  ASSERT_EQ("", getHaloHazard("  f = map force to springs reduce +;\n"
+                              "  points.b = points.b + f;\n"));
+
+  // Reading partial values at neighbors
+  string hazard = getHaloHazard("  A = map stiffness to springs reduce +;\n"
+                                "  x = A * points.b;\n"
+                                "  points.c = A * x;\n");
+  ASSERT_EQ(0u, hazard.find("reads 'x' at the neighbors")) << hazard;
+  hazard = getHaloHazard("  A = map stiffness to springs reduce +;\n"
+                         "  points.c = A * points.b;\n"
+                         "  f = map force to springs reduce +;\n");
+  ASSERT_EQ(0u, hazard.find("reads 'points.c' at the neighbors")) << hazard;
+
+  // Values that become partial in one iteration are read in the next
+  hazard = getHaloHazard("  A = map stiffness to springs reduce +;\n"
+                         "  var x = points.b;\n"
+                         "  var i = 0;\n"
+                         "  while i < 2\n"
+                         "    y = A * x;\n"
+                         "    x = y;\n"
+                         "    i = i + 1;\n"
+                         "  end\n"
+                         "  points.c = x;\n");
+  ASSERT_EQ(0u, hazard.find("reads 'x' at the neighbors")) << hazard;
+
+  // Reducing a set into a global
+  hazard = getHaloHazard("  r = norm(points.b);\n"
+                         "  points.c = r * points.b;\n");
+  ASSERT_EQ(0u, hazard.find("reduces a set into a global")) << hazard;
+  hazard = getHaloHazard("  r = points.b' * points.b;\n"
+                         "  points.c = r * points.b;\n");
+  ASSERT_EQ(0u, hazard.find("reduces a set into a global")) << hazard;
+}
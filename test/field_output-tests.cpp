@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "binary_mesh.h"
+#include "field_output.h"
+#include "graph.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(FieldOutput, span) {
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  for (int i=0; i < 10; ++i) {
+    ElementRef p = points.add();
+    x.set(p, {1.0*i, 2.0*i, 3.0*i});
+  }
+
+  FieldSpan<double> span = x.span();
+  ASSERT_EQ(10u, span.getNumElements());
+  ASSERT_EQ(3u, span.getComponentsPerElement());
+  ASSERT_EQ(30u, span.size());
+  double sum = 0.0;
+  for (double value : span) {
+    sum += value;
+  }
+  ASSERT_EQ(6.0*45, sum);
+  for (ElementRef p : points) {
+    ASSERT_EQ(x.get(p)(1), span.element(p)[1]);
+  }
+}
+
+TEST(FieldOutput, binary) {
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  FieldRef<int> id = points.addField<int>("id");
+  for (int i=0; i < 50; ++i) {
+    ElementRef p = points.add();
+    x.set(p, {1.0*i, 2.0*i, 3.0*i});
+    id.set(p, i);
+  }
+
+  FieldOutput output("field_output_test-", OutputFormat::Binary, 2);
+  output.addField(&points, "id", "ids");
+  for (int step=0; step < 3; ++step) {
+    for (ElementRef p : points) {
+      id.set(p, p.getIdent() + step + 1);
+    }
+    while (!output.write(step)) {
+      output.flush();
+    }
+    // The write copied the fields, so changing them before the files are
+    // written does not change the files
+    for (ElementRef p : points) {
+      id.set(p, -1);
+    }
+  }
+  ASSERT_EQ(0, output.flush());
+
+  for (int step=0; step < 3; ++step) {
+    string filename = "field_output_test-" + to_string(step) + ".smsh";
+    BinaryMesh mesh;
+    ASSERT_EQ(0, mesh.open(filename));
+    vector<int> ids(50);
+    ASSERT_EQ(0, mesh.loadTensor("ids", ids.data(), ids.size()*sizeof(int)));
+    mesh.close();
+    remove(filename.c_str());
+    for (int i=0; i < 50; ++i) {
+      ASSERT_EQ(i+step+1, ids[i]);
+    }
+  }
+}
+
+TEST(FieldOutput, vtk) {
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  FieldRef<float> t = points.addField<float>("t");
+  for (int i=0; i < 4; ++i) {
+    ElementRef p = points.add();
+    x.set(p, {1.0*i, 0.0, 0.0});
+    t.set(p, 0.5f*i);
+  }
+  Set springs(points,points);
+  FieldRef<double> k = springs.addField<double>("k");
+  vector<int> endpoints = {0,1, 1,2, 2,3};
+  springs.addElements(3, endpoints.data());
+
+  FieldOutput output("field_output_test-", OutputFormat::VTK);
+  output.setMesh(&points, "x", &springs);
+  output.addField(&points, "x", "position");
+  output.addField(&points, "t");
+  output.addField(&springs, "k");
+  ASSERT_TRUE(output.write(7));
+  ASSERT_EQ(0, output.flush());
+  ASSERT_EQ(0u, output.getNumDropped());
+
+  string filename = "field_output_test-7.vtk";
+  ifstream in(filename, ios::binary);
+  ASSERT_TRUE(in.good());
+  stringstream contents;
+  contents << in.rdbuf();
+  in.close();
+  remove(filename.c_str());
+
+  string vtk = contents.str();
+  ASSERT_EQ(0u, vtk.find("# vtk DataFile Version 3.0\n"));
+  ASSERT_NE(string::npos, vtk.find("DATASET UNSTRUCTURED_GRID\n"));
+  ASSERT_NE(string::npos, vtk.find("POINTS 4 double\n"));
+  ASSERT_NE(string::npos, vtk.find("CELLS 3 9\n"));
+  ASSERT_NE(string::npos, vtk.find("POINT_DATA 4\nVECTORS position double\n"));
+  ASSERT_NE(string::npos, vtk.find("SCALARS t float 1\n"));
+  ASSERT_NE(string::npos, vtk.find("CELL_DATA 3\nSCALARS k double 1\n"));
+
+  // Values are big-endian
+  size_t cellTypes = vtk.find("CELL_TYPES 3\n");
+  ASSERT_NE(string::npos, cellTypes);
+  const char* type = vtk.data() + cellTypes + string("CELL_TYPES 3\n").size();
+  ASSERT_EQ(0, type[0]);
+  ASSERT_EQ(0, type[2]);
+  ASSERT_EQ(3, type[3]);
+}
@@ -1,5 +1,10 @@
 #include "simit-test.h"
 
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "program.h"
 #include "tensor.h"
 #include "tensor_data.h"
 #include "graph.h"
@@ -41,6 +46,103 @@ TEST(Function, bindSet) {
   SIMIT_ASSERT_FLOAT_EQ(-44, field(p2));
 }
 
+TEST(Function, resizeBoundSet) {
+  Type vertexType = ElementType::make("Vertex", {Field("field", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var i("i", Int);
+  Stmt neg =
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "field"), i,
+                                 -Load::make(FieldRead::make(V, "field"), i)));
+
+  Environment env;
+  env.addExtern(V);
+  simit::Function function = getTestBackend()->compile(neg, env);
+
+  simit::Set VArg;
+  auto field = VArg.addField<int>("field");
+  simit::ElementRef p0 = VArg.add();
+  field(p0) = 42;
+  function.bind("V", &VArg);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-42, field(p0));
+
+  // Growing the set (and moving its fields) must not require init
+  VArg.addElements(100);
+  int k = 0;
+  for (simit::ElementRef p : VArg) {
+    if (p != p0) field(p) = k++;
+  }
+  function.runSafe();
+  k = 0;
+  for (simit::ElementRef p : VArg) {
+    SIMIT_ASSERT_FLOAT_EQ((p == p0) ? 42 : -(k++), field(p));
+  }
+
+  // Neither must shrinking it
+  VArg.removeElements({p0});
+  ASSERT_EQ(100, VArg.getSize());
+  function.runSafe();
+  k = 0;
+  for (simit::ElementRef p : VArg) {
+    SIMIT_ASSERT_FLOAT_EQ(k++, field(p));
+  }
+}
+
+TEST(Function, checkpoint) {
+  Type vertexType = ElementType::make("Vertex", {Field("field", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var a("a", Int);
+  Var i("i", Int);
+  Stmt neg = Block::make(
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "field"), i,
+                                 -Load::make(FieldRead::make(V, "field"), i))),
+      AssignStmt::make(a, -a));
+
+  Environment env;
+  env.addExtern(V);
+  env.addExtern(a);
+  simit::Function function = getTestBackend()->compile(neg, env);
+
+  simit::Set VArg;
+  auto field = VArg.addField<int>("field");
+  for (int k=0; k < 10; ++k) {
+    field(VArg.add()) = k;
+  }
+  simit::Tensor<int> aArg = 42;
+  function.bind("V", &VArg);
+  function.bind("a", &aArg);
+
+  // The first checkpoint is written while the function runs
+  const std::string filename = "function_checkpoint_test.smsh";
+  function.checkpoint(filename);
+  function.runSafe();
+  function.runSafe();
+  function.runSafe();
+  ASSERT_EQ(-42, aArg);
+  VArg.addElements(5);
+  ASSERT_EQ(0, function.waitForCheckpoints());
+
+  ASSERT_EQ(0, function.restore(filename));
+  remove(filename.c_str());
+  ASSERT_EQ(10, VArg.getSize());
+  ASSERT_EQ(42, aArg);
+  int k = 0;
+  for (simit::ElementRef p : VArg) {
+    ASSERT_EQ(k++, (int)field(p));
+  }
+
+  // The restored set is run without initializing the function again
+  function.runSafe();
+  k = 0;
+  for (simit::ElementRef p : VArg) {
+    ASSERT_EQ(-(k++), (int)field(p));
+  }
+}
+
 TEST(Function, bindScalar) {
   Var a("a", Int);
   Var b("b", Int);
@@ -137,3 +239,197 @@ TEST(Function, bindSparseTensor) {
   ASSERT_EQ(-3, A_vals[2]);
   ASSERT_EQ(-4, A_vals[3]);
 }
+
+TEST(Function, compileAndRunConcurrently) {
+  simit::Program program;
+  int errorCode = program.loadString(
+      "element Vertex\n"
+      "  a : int;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func neg(inout v : Vertex)\n"
+      "  v.a = -v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply neg to V;\n"
+      "end\n");
+  ASSERT_EQ(0, errorCode);
+
+  const int numThreads = 4;
+  const int numElements = 100;
+  std::vector<std::unique_ptr<simit::Set>> sets;
+  for (int t = 0; t < numThreads; ++t) {
+    sets.emplace_back(new simit::Set());
+    auto a = sets.back()->addField<int>("a");
+    for (int i = 0; i < numElements; ++i) {
+      a.set(sets.back()->add(), t*numElements + i);
+    }
+  }
+
+  // Compile, bind and run a separate function on each thread
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&program, &sets, t]() {
+      simit::Function function = program.compile("main");
+      function.bind("V", sets[t].get());
+      function.runSafe();
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; t < numThreads; ++t) {
+    simit::FieldRef<int> a = sets[t]->getField<int>("a");
+    int i = 0;
+    for (simit::ElementRef v : *sets[t]) {
+      ASSERT_EQ(-(t*numElements + i), a.get(v));
+      ++i;
+    }
+  }
+}
+
+TEST(Program, compileAll) {
+  simit::Program program;
+  int errorCode = program.loadString(
+      "element Vertex\n"
+      "  a : int;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func inc(inout v : Vertex)\n"
+      "  v.a = v.a + 1;\n"
+      "end\n"
+      "func dbl(inout v : Vertex)\n"
+      "  v.a = 2 * v.a;\n"
+      "end\n"
+      "export func incAll()\n"
+      "  apply inc to V;\n"
+      "end\n"
+      "export func incDblAll()\n"
+      "  apply inc to V;\n"
+      "  apply dbl to V;\n"
+      "end\n"
+      "export func dblAll()\n"
+      "  apply dbl to V;\n"
+      "end\n");
+  ASSERT_EQ(0, errorCode);
+
+  std::vector<std::string> exported = program.getExportedFunctionNames();
+  ASSERT_EQ(3u, exported.size());
+
+  std::map<std::string,simit::Function> functions = program.compileAll(2);
+  ASSERT_EQ(3u, functions.size());
+
+  simit::Set V;
+  auto a = V.addField<int>("a");
+  simit::ElementRef v0 = V.add();
+  simit::ElementRef v1 = V.add();
+  a.set(v0, 1);
+  a.set(v1, 5);
+
+  for (const std::string& name : exported) {
+    ASSERT_TRUE(functions[name].defined()) << name;
+    functions[name].bind("V", &V);
+  }
+  functions["incAll"].runSafe();
+  functions["incDblAll"].runSafe();
+  functions["dblAll"].runSafe();
+
+  ASSERT_EQ(((1+1)+1)*2*2, a.get(v0));
+  ASSERT_EQ(((5+1)+1)*2*2, a.get(v1));
+}
+
+TEST(Program, compileWithProfiler) {
+  simit::Program program;
+  int errorCode = program.loadString(
+      "element Vertex\n"
+      "  a : int;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func inc(inout v : Vertex)\n"
+      "  v.a = v.a + 1;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply inc to V;\n"
+      "end\n");
+  ASSERT_EQ(0, errorCode);
+
+  simit::Function f = program.compileWithProfiler("main");
+  ASSERT_TRUE(f.defined());
+  ASSERT_TRUE(f.isProfiled());
+
+  simit::Set V;
+  auto a = V.addField<int>("a");
+  simit::ElementRef v0 = V.add();
+  a.set(v0, 1);
+
+  f.bind("V", &V);
+  f.runSafe();
+  f.runSafe();
+  ASSERT_EQ(3, a.get(v0));
+
+  simit::Profile profile = f.getProfile();
+  size_t maps = 0;
+  for (const simit::ProfileRegion& region : profile.getRegions()) {
+    if (region.kind == simit::ProfileRegion::Map) {
+      ASSERT_EQ(2u, region.count);
+      ASSERT_LE(0.0, region.seconds);
+      ++maps;
+    }
+  }
+  ASSERT_EQ(1u, maps);
+
+  std::stringstream json;
+  json.precision(3);
+  profile.writeJSON(json);
+  ASSERT_NE(std::string::npos, json.str().find("\"regions\""));
+  ASSERT_EQ(3, json.precision());
+
+  f.resetProfile();
+  for (const simit::ProfileRegion& region : f.getProfile().getRegions()) {
+    ASSERT_EQ(0u, region.count);
+  }
+}
+
+TEST(Program, mixedPrecisionFields) {
+  simit::Program program;
+  int errorCode = program.loadString(
+      "element Point\n"
+      "  x : vector[2](float32);\n"
+      "  m : float64;\n"
+      "  y : vector[2](float);\n"
+      "end\n"
+      "extern P : set{Point};\n"
+      "func scale(inout p : Point)\n"
+      "  p.x = p.m * p.x;\n"
+      "  p.y = p.x + [0.5, 0.5]';\n"
+      "end\n"
+      "export func main()\n"
+      "  apply scale to P;\n"
+      "end\n");
+  ASSERT_EQ(0, errorCode);
+
+  simit::Set P;
+  auto x = P.addField<float,2>("x");
+  auto m = P.addField<double>("m");
+  auto y = P.addField<simit_float,2>("y");
+  simit::ElementRef p0 = P.add();
+  simit::ElementRef p1 = P.add();
+  x.set(p0, {1.0f, 2.0f});
+  x.set(p1, {-3.0f, 0.25f});
+  m.set(p0, 2.0);
+  m.set(p1, 0.5);
+
+  simit::Function function = program.compile("main");
+  function.bind("P", &P);
+  function.runSafe();
+
+  ASSERT_EQ(2.0f, x.get(p0)(0));
+  ASSERT_EQ(4.0f, x.get(p0)(1));
+  ASSERT_EQ(-1.5f, x.get(p1)(0));
+  ASSERT_EQ(0.125f, x.get(p1)(1));
+  SIMIT_ASSERT_FLOAT_EQ(2.5, y.get(p0)(0));
+  SIMIT_ASSERT_FLOAT_EQ(4.5, y.get(p0)(1));
+  SIMIT_ASSERT_FLOAT_EQ(-1.0, y.get(p1)(0));
+  SIMIT_ASSERT_FLOAT_EQ(0.625, y.get(p1)(1));
+}
@@ -1,5 +1,7 @@
 #include "simit-test.h"
 
+#include <array>
+#include <set>
 #include <vector>
 
 #include "graph.h"
@@ -61,6 +63,85 @@ TEST(Set, IncreaseCapacity) {
   ASSERT_EQ(count, 1029);
 }
 
+TEST(Set, RemoveElements) {
+  Set points;
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+
+  vector<ElementRef> elems;
+  for (int i=0; i < 6; ++i) {
+    ElementRef p = points.add();
+    id.set(p, i);
+    x.set(p, {i+0.1, i+0.2, i+0.3});
+    elems.push_back(p);
+  }
+
+  vector<int> remap = points.removeElements({elems[1], elems[4]});
+  ASSERT_EQ(vector<int>({0, -1, 1, 2, -1, 3}), remap);
+  ASSERT_EQ(4, points.getSize());
+
+  // The remaining elements keep their order and all their components
+  vector<int> expected = {0, 2, 3, 5};
+  int i = 0;
+  for (ElementRef p : points) {
+    ASSERT_EQ(expected[i], id.get(p));
+    TensorRef<simit_float,3> xp = x.get(p);
+    SIMIT_ASSERT_FLOAT_EQ(expected[i]+0.1, xp(0));
+    SIMIT_ASSERT_FLOAT_EQ(expected[i]+0.2, xp(1));
+    SIMIT_ASSERT_FLOAT_EQ(expected[i]+0.3, xp(2));
+    ++i;
+  }
+
+  // Added elements are zero
+  ElementRef first = points.addElements(2);
+  ASSERT_EQ(4, first.getIdent());
+  ASSERT_EQ(6, points.getSize());
+  for (ElementRef p : points) {
+    if (p.getIdent() >= 4) {
+      ASSERT_EQ(0, id.get(p));
+      SIMIT_ASSERT_FLOAT_EQ(0.0, x.get(p)(2));
+    }
+  }
+}
+
+TEST(Set, AddElementsIncreasesCapacity) {
+  Set points;
+  FieldRef<int> id = points.addField<int>("id");
+  points.add();
+  ElementRef first = points.addElements(3000);
+  ASSERT_EQ(1, first.getIdent());
+  ASSERT_EQ(3001, points.getSize());
+  int i = 0;
+  ElementRef last;
+  for (ElementRef p : points) {
+    id.set(p, i++);
+    last = p;
+  }
+  ASSERT_EQ(3000, id.get(last));
+}
+
+TEST(Set, TopologyRemap) {
+  Set points;
+  vector<ElementRef> elems;
+  for (int i=0; i < 4; ++i) {
+    elems.push_back(points.add());
+  }
+  uint64_t version = points.getTopologyVersion();
+
+  points.removeElements({elems[0]});
+  points.addElements(1);
+  vector<ElementRef> remaining;
+  for (ElementRef p : points) {
+    remaining.push_back(p);
+  }
+  points.removeElements({remaining[1]});
+
+  // 0 was removed, then 2 (which had become 1)
+  vector<int> remap;
+  ASSERT_TRUE(points.getTopologyRemap(version, 4, &remap));
+  ASSERT_EQ(vector<int>({-1, 0, -1, 1}), remap);
+}
+
 TEST(Set, FieldAccessByName) {
   Set myset;
   
@@ -228,6 +309,49 @@ TEST(Field, boolean) {
   ASSERT_TRUE(b(p1));
 }
 
+TEST(Field, bulk) {
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  FieldRef<int> id = points.addField<int>("id");
+  createElements(&points, 100000);
+
+  x.fill({1.0, 2.0, 3.0});
+  id.fill(7);
+  for (ElementRef p : points) {
+    ASSERT_EQ(2.0, x.get(p)(1));
+    ASSERT_EQ(7, (int)id.get(p));
+  }
+
+  vector<double> src(3*10);
+  for (size_t i=0; i < src.size(); ++i) {
+    src[i] = i;
+  }
+  x.assign(50000, 50010, src.data());
+  double (*xs)[3] = x.data();
+  ASSERT_EQ(1.0, xs[49999][0]);
+  ASSERT_EQ(5.0, xs[50001][2]);
+  ASSERT_EQ(1.0, xs[50010][0]);
+
+  vector<int> idents = {50001, 3, 99999};
+  vector<double> gathered = x.gather(idents);
+  ASSERT_EQ(vector<double>({3.0, 4.0, 5.0, 1.0, 2.0, 3.0, 1.0, 2.0, 3.0}),
+            gathered);
+  x.scatter({3, 99999}, {9.0, 9.0, 9.0, 8.0, 8.0, 8.0});
+  ASSERT_EQ(9.0, xs[3][2]);
+  ASSERT_EQ(8.0, xs[99999][0]);
+
+  EXPECT_THROW(x.gather({0, 100000}), simit::SimitException);
+  EXPECT_THROW(x.scatter({-1}, {0.0, 0.0, 0.0}), simit::SimitException);
+  EXPECT_THROW(x.scatter({3, 3}, {9.0, 9.0, 9.0, 8.0, 8.0, 8.0}),
+               simit::SimitException);
+  ASSERT_EQ(9.0, xs[3][2]);
+
+  // A failed check does not make later scatters of the same idents fail
+  x.scatter({3, 4}, {7.0, 7.0, 7.0, 6.0, 6.0, 6.0});
+  ASSERT_EQ(7.0, xs[3][2]);
+  ASSERT_EQ(6.0, xs[4][0]);
+}
+
 TEST(EdgeSet, CreateAndGetEdge) {
   Set points;
 
@@ -254,6 +378,41 @@ TEST(EdgeSet, CreateAndGetEdge) {
   ASSERT_EQ(y.get(e), 54);
 }
 
+TEST(EdgeSet, RemoveElements) {
+  Set points;
+  vector<ElementRef> p;
+  for (int i=0; i < 4; ++i) {
+    p.push_back(points.add());
+  }
+
+  Set edges(points, points);
+  FieldRef<int> y = edges.addField<int>("y");
+  vector<ElementRef> e;
+  for (int i=0; i < 3; ++i) {
+    e.push_back(edges.add(p[i], p[i+1]));
+    y.set(e[i], i);
+  }
+
+  // Remove point 1 and the edges that connect it
+  edges.removeElements({e[0], e[1]});
+  vector<int> remap = points.removeElements({p[1]});
+  edges.remapEndpoints(points, remap);
+
+  ASSERT_EQ(1, edges.getSize());
+  ElementRef edge = *edges.begin();
+  ASSERT_EQ(2, y.get(edge));
+  ASSERT_EQ(1, edges.getEndpoint(edge,0).getIdent());
+  ASSERT_EQ(2, edges.getEndpoint(edge,1).getIdent());
+
+  // Add two edges at once
+  int endpoints[] = {0, 1, 0, 2};
+  ElementRef first = edges.addElements(2, endpoints);
+  ASSERT_EQ(1, first.getIdent());
+  ASSERT_EQ(3, edges.getSize());
+  ASSERT_EQ(0, y.get(first));
+  ASSERT_EQ(1, edges.getEndpoint(first,1).getIdent());
+}
+
 TEST(EdgeSet, EdgeIteratorTest) {
   Set points;
   
@@ -322,3 +481,124 @@ TEST(GraphGenerator, createBox) {
 
   ASSERT_EQ(box.getEdges().size(), 54u);
 }
+
+TEST(GraphGenerator, createBoxLayout) {
+  Set points;
+  Set edges(points, points);
+  createElements(&points, 5);
+  Box box = createBox(&points, &edges, 4, 3, 2);
+  ASSERT_EQ(5+24, points.getSize());
+  ASSERT_EQ(3*3*2 + 4*2*2 + 4*3*1, edges.getSize());
+  ASSERT_EQ((size_t)edges.getSize(), box.getNumEdges());
+  ASSERT_EQ(5 + (2*3 + 1)*2 + 1, box(2,1,1).getIdent());
+
+  for (unsigned x=0; x < 4; ++x) {
+    for (unsigned y=0; y < 3; ++y) {
+      for (unsigned z=0; z < 2; ++z) {
+        ElementRef p = box(x,y,z);
+        ElementRef neighbors[3] = {
+          (x+1 < 4) ? box(x+1,y,z) : ElementRef(),
+          (y+1 < 3) ? box(x,y+1,z) : ElementRef(),
+          (z+1 < 2) ? box(x,y,z+1) : ElementRef()
+        };
+        for (ElementRef neighbor : neighbors) {
+          if (!neighbor.defined()) {
+            continue;
+          }
+          ElementRef edge = box.getEdge(p, neighbor);
+          ASSERT_TRUE(edge.defined());
+          ASSERT_EQ(p, edges.getEndpoint(edge, 0));
+          ASSERT_EQ(neighbor, edges.getEndpoint(edge, 1));
+          ASSERT_FALSE(box.getEdge(neighbor, p).defined());
+        }
+      }
+    }
+  }
+  ASSERT_FALSE(box.getEdge(box(3,0,0), box(3,0,0)).defined());
+  ASSERT_FALSE(box.getEdge(box(3,0,1), box(3,1,0)).defined());
+}
+
+TEST(GraphGenerator, createTetBox) {
+  Set points;
+  Set tets(points, points, points, points);
+  Box box = createTetBox(&points, &tets, 3, 4, 5);
+  ASSERT_EQ(60, points.getSize());
+  ASSERT_EQ(6*2*3*4, tets.getSize());
+  ASSERT_EQ(0u, box.getNumEdges());
+
+  // Every tetrahedron is positively oriented with volume 1/6
+  vector<array<int,3>> coords(60);
+  for (int x=0; x < 3; ++x) {
+    for (int y=0; y < 4; ++y) {
+      for (int z=0; z < 5; ++z) {
+        coords[box(x,y,z).getIdent()] = {{x, y, z}};
+      }
+    }
+  }
+  for (ElementRef tet : tets) {
+    array<int,3> v[4];
+    for (int i=0; i < 4; ++i) {
+      v[i] = coords[tets.getEndpoint(tet, i).getIdent()];
+    }
+    int a[3], b[3], c[3];
+    for (int d=0; d < 3; ++d) {
+      a[d] = v[1][d] - v[0][d];
+      b[d] = v[2][d] - v[0][d];
+      c[d] = v[3][d] - v[0][d];
+    }
+    int det = a[0]*(b[1]*c[2] - b[2]*c[1]) - a[1]*(b[0]*c[2] - b[2]*c[0]) +
+              a[2]*(b[0]*c[1] - b[1]*c[0]);
+    ASSERT_EQ(1, det);
+  }
+}
+
+TEST(GraphGenerator, createRandomGeometricGraph) {
+  Set points;
+  Set edges(points, points);
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  const double radius = 0.15;
+  createRandomGeometricGraph(&points, &edges, 1000, radius, "x", 7);
+  ASSERT_EQ(1000, points.getSize());
+
+  set<pair<int,int>> expected;
+  const double (*xs)[3] = x.data();
+  for (int i=0; i < 1000; ++i) {
+    for (int j=i+1; j < 1000; ++j) {
+      double dist2 = 0.0;
+      for (int d=0; d < 3; ++d) {
+        dist2 += (xs[i][d]-xs[j][d]) * (xs[i][d]-xs[j][d]);
+      }
+      if (dist2 < radius*radius) {
+        expected.insert({i,j});
+      }
+    }
+  }
+  set<pair<int,int>> actual;
+  for (ElementRef edge : edges) {
+    actual.insert({edges.getEndpoint(edge, 0).getIdent(),
+                   edges.getEndpoint(edge, 1).getIdent()});
+  }
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(expected, actual);
+}
+
+TEST(GraphGenerator, createPowerLawGraph) {
+  Set points;
+  Set edges(points, points);
+  createPowerLawGraph(&points, &edges, 10, 8, 3);
+  ASSERT_EQ(1024, points.getSize());
+  ASSERT_EQ(8*1024, edges.getSize());
+
+  Set points2;
+  Set edges2(points2, points2);
+  createPowerLawGraph(&points2, &edges2, 10, 8, 3);
+  vector<int> degree(1024, 0);
+  for (ElementRef edge : edges) {
+    ASSERT_EQ(edges.getEndpoint(edge, 0), edges2.getEndpoint(edge, 0));
+    ASSERT_EQ(edges.getEndpoint(edge, 1), edges2.getEndpoint(edge, 1));
+    ++degree[edges.getEndpoint(edge, 0).getIdent()];
+  }
+
+  // The degrees are skewed: vertex 0 is the most likely source
+  ASSERT_GT(degree[0], 10*8);
+}
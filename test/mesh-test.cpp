@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -309,3 +310,83 @@ const string inputEdge = R"(24  1
   
 }
 
+
+TEST(MeshArrays, ChunkedTetgenTest) {
+  //large enough to be split into several chunks
+  const int n = 20000;
+  stringstream nodeStream, eleStream;
+  nodeStream << "# comment before the header\n" << n << " 3 0 0\n";
+  for (int i = 0; i < n; i++) {
+    nodeStream << "  " << i << "  " << i << " " << 0.5*i << " -" << i
+               << "  # node " << i << "\n";
+  }
+  eleStream << n-3 << "  4  0\n";
+  for (int i = 0; i < n-3; i++) {
+    eleStream << i << "\t" << i << " " << i+1 << " " << i+2 << " " << i+3
+              << "\r\n";
+  }
+  eleStream << "# Generated by hand";
+
+  MeshArrays m;
+  ASSERT_EQ(0, m.loadTet(nodeStream, eleStream));
+  ASSERT_EQ((size_t)n,   m.numVertices());
+  ASSERT_EQ((size_t)n-3, m.numElements());
+  ASSERT_EQ(4, m.elementSize);
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(i,     m.v[3*i]);
+    ASSERT_EQ(0.5*i, m.v[3*i+1]);
+    ASSERT_EQ(-i,    m.v[3*i+2]);
+  }
+  for (int i = 0; i < n-3; i++) {
+    for (int j = 0; j < 4; j++) {
+      ASSERT_EQ(i+j, m.e[4*i+j]);
+    }
+  }
+}
+
+TEST(MeshArrays, MalformedTetgenTest) {
+  stringstream nodeStream, eleStream;
+  nodeStream << "3 3 0 0\n0 0 0 0\n1 1 1 1\n";
+  eleStream << "1 4 0\n0 0 1 2 2\n";
+  MeshArrays m;
+  ASSERT_EQ(-1, m.loadTet(nodeStream, eleStream));
+
+  stringstream nodeStream2, eleStream2;
+  nodeStream2 << "3 3 0 0\n0 0 0 0\n1 1 1 1\n2 x 1 1\n";
+  eleStream2 << "1 4 0\n0 0 1 2 2\n";
+  ASSERT_EQ(-1, m.loadTet(nodeStream2, eleStream2));
+}
+
+TEST(MeshArrays, ObjTest) {
+  stringstream input;
+  input << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+        << "vn 0 0 1\n"
+        << "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        << "f 1//1 3//1 4//1\n"
+        << "#end\n"
+        << "f 1 2 3\n";
+  MeshArrays m;
+  ASSERT_EQ(0, m.loadObj(input));
+  ASSERT_EQ(4u, m.numVertices());
+  ASSERT_EQ(3u, m.numElements());
+  ASSERT_EQ(vector<int>({0,1,2, 0,2,3, 0,2,3}), m.e);
+}
+
+TEST(MeshVol, TetSurfTest) {
+  //two tetrahedra that share the face (1,2,3)
+  MeshVol m;
+  m.v = {{{0,0,0}}, {{1,0,0}}, {{0,1,0}}, {{0,0,1}}, {{1,1,1}}};
+  m.e = {{0,1,2,3}, {4,1,3,2}};
+
+  vector<vector<int> > eleNeighbor;
+  m.elementNeighbors(eleNeighbor);
+  ASSERT_EQ(vector<int>({0}),   eleNeighbor[0]);
+  ASSERT_EQ(vector<int>({0,1}), eleNeighbor[2]);
+  ASSERT_EQ(vector<int>({1}),   eleNeighbor[4]);
+
+  m.makeTetSurf();
+  ASSERT_EQ(5u, m.surf.v.size());
+  ASSERT_EQ(6u, m.surf.t.size());
+  ASSERT_FALSE(m.exterior[0][3]);
+  ASSERT_EQ(1, count(m.exterior[1].begin(), m.exterior[1].end(), false));
+}
@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <vector>
+
+#include "graph.h"
+#include "numa.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(numa, nodes) {
+  int numNodes = getNumNumaNodes();
+  ASSERT_GE(numNodes, 1);
+  ASSERT_EQ(0, getWorkerNode(0, 8));
+  ASSERT_EQ(7*numNodes/8, getWorkerNode(7, 8));
+  for (unsigned w = 1; w < 8; ++w) {
+    ASSERT_LE(getWorkerNode(w-1, 8), getWorkerNode(w, 8));
+  }
+}
+
+TEST(numa, placement) {
+  int numNodes = getNumNumaNodes();
+  for (FieldPlacement placement : {FieldPlacement::Interleave,
+                                   FieldPlacement::Partitioned,
+                                   FieldPlacement::Local}) {
+    setFieldPlacement(placement);
+    ASSERT_EQ(placement, getFieldPlacement());
+
+    Set points;
+    FieldRef<double> x = points.addField<double>("x");
+    points.addElements(100000);
+    x.fill(1.0);
+    placeFields(&points);
+    for (ElementRef p : points) {
+      ASSERT_EQ(1.0, x.get(p));
+    }
+
+    // Every written page is on some node
+    vector<size_t> pages = getPagesPerNode(x.getData(),
+                                           points.getSize()*sizeof(double));
+    ASSERT_EQ((size_t)numNodes+1, pages.size());
+    size_t numPages = 0;
+    for (int node = 0; node < numNodes; ++node) {
+      numPages += pages[node];
+    }
+    ASSERT_GE(numPages, points.getSize()*sizeof(double) / 4096);
+    ASSERT_EQ(0u, pages[numNodes]);
+
+    stringstream placementReport;
+    printFieldPlacement(placementReport, &points);
+    ASSERT_EQ(0u, placementReport.str().find("x: node0="));
+  }
+}
@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "error.h"
+#include "ir.h"
+#include "lower/lower.h"
+#include "lower/pass_manager.h"
+
+using namespace std;
+using namespace simit;
+using namespace simit::ir;
+
+/// A pass that appends `name` as a comment to the function body.
+static Func appendComment(Func func, const string& name) {
+  return Func(func, Block::make(func.getBody(), Comment::make(name)));
+}
+
+/// The comments appended by `appendComment`, in order.
+static vector<string> getComments(Func func) {
+  vector<string> comments;
+  Stmt body = func.getBody();
+  while (isa<Block>(body)) {
+    const Block* block = to<Block>(body);
+    if (isa<Comment>(block->rest)) {
+      comments.insert(comments.begin(), to<Comment>(block->rest)->comment);
+    }
+    body = block->first;
+  }
+  return comments;
+}
+
+static PassManager makePasses() {
+  PassManager passes;
+  for (string name : {"a", "b", "c"}) {
+    passes.add(name, "Pass " + name, [name](Func func) -> Func {
+      return appendComment(func, name);
+    });
+  }
+  return passes;
+}
+
+TEST(pass_manager, run) {
+  PassManager passes = makePasses();
+  ASSERT_EQ(vector<string>({"a", "b", "c"}), passes.getPassNames());
+
+  Func func("f", {}, {}, Pass::make(), Func::Internal);
+  stringstream os;
+  Func lowered = passes.run(func, PassOptions(), &os);
+  EXPECT_EQ(vector<string>({"a", "b", "c"}), getComments(lowered));
+  EXPECT_NE(string::npos, os.str().find("%% Pass b"));
+}
+
+TEST(pass_manager, options) {
+  PassManager passes = makePasses();
+  Func func("f", {}, {}, Pass::make(), Func::Internal);
+
+  PassOptions skip;
+  skip.skip = {"b"};
+  EXPECT_EQ(vector<string>({"a", "c"}), getComments(passes.run(func, skip)));
+
+  PassOptions order;
+  order.order = {"c", "a", "c"};
+  EXPECT_EQ(vector<string>({"c", "a", "c"}),
+            getComments(passes.run(func, order)));
+
+  vector<PassTiming> timings;
+  PassOptions timed;
+  timed.timings = &timings;
+  passes.run(func, timed);
+  ASSERT_EQ(3u, timings.size());
+  EXPECT_EQ("b", timings[1].name);
+  EXPECT_GE(timings[1].seconds, 0.0);
+  EXPECT_EQ(timings[0].nodesAfter, timings[1].nodesBefore);
+  EXPECT_LT(timings[1].nodesBefore, timings[1].nodesAfter);
+
+  stringstream os;
+  printPassTimings(timings, os);
+  EXPECT_NE(string::npos, os.str().find("Total"));
+
+  PassOptions unknown;
+  unknown.skip = {"d"};
+  EXPECT_THROW(passes.run(func, unknown), SimitException);
+}
+
+TEST(pass_manager, lower) {
+  Func func("f", {}, {}, Pass::make(), Func::Internal);
+  vector<PassTiming> timings;
+  PassOptions options;
+  options.skip = {"unroll-1", "unroll-2", "unroll-3"};
+  options.timings = &timings;
+  lower(func, nullptr, nullptr, nullptr, &options);
+  ASSERT_FALSE(timings.empty());
+  EXPECT_EQ("inline-calls", timings.front().name);
+  for (const PassTiming& timing : timings) {
+    EXPECT_EQ(string::npos, timing.name.find("unroll"));
+  }
+}
@@ -75,6 +75,204 @@ TEST(pathindex, link) {
 }
 
 
+TEST(pathindex, link_long_indices) {
+  PathIndexBuilder builder(sizeof(uint64_t));
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 5, 1, 1);  // v-e-v-e-v-e-v-e-v
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  Var e("e", simit::pe::Set("E"));
+  Var v("v", simit::pe::Set("V"));
+  PathExpression ev = Link::make(e, v, Link::ev);
+  PathIndex evIndex = builder.buildSegmented(ev, 0);
+  VERIFY_INDEX(evIndex, nbrs({{0,1}, {1,2}, {2,3}, {3,4}}));
+
+  PathExpression ve = Link::make(v, e, Link::ve);
+  PathIndex veIndex = builder.buildSegmented(ve, 0);
+  VERIFY_INDEX(veIndex, nbrs({{0}, {0,1}, {1,2}, {2,3}, {3}}));
+
+  // The backend reads the coords and sinks directly as 8-byte integers
+  ASSERT_TRUE(isa<SegmentedPathIndex>(veIndex));
+  const SegmentedPathIndex* spidx = to<SegmentedPathIndex>(veIndex);
+  ASSERT_EQ(sizeof(uint64_t), spidx->getIndexBytes());
+  const uint64_t* coords = (const uint64_t*)spidx->getCoordData();
+  const uint64_t* sinks = (const uint64_t*)spidx->getSinkData();
+  ASSERT_EQ(8u, coords[5]);
+  ASSERT_EQ(1u, coords[1]);
+  ASSERT_EQ(2u, sinks[4]);
+}
+
+
+TEST(pathindex, link_update) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 5, 1, 1);  // v-e-v-e-v-e-v-e-v
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  Var e("e", simit::pe::Set("E"));
+  Var v("v", simit::pe::Set("V"));
+  PathExpression ev = Link::make(e, v, Link::ev);
+  PathExpression ve = Link::make(v, e, Link::ve);
+  PathIndex evIndex = builder.buildSegmented(ev, 0);
+  PathIndex veIndex = builder.buildSegmented(ve, 0);
+
+  // Remove the last vertex and its edge, and connect a new vertex to the first
+  vector<ElementRef> edges, vertices;
+  for (ElementRef edge : E) {
+    edges.push_back(edge);
+  }
+  for (ElementRef vertex : V) {
+    vertices.push_back(vertex);
+  }
+  E.removeElements({edges[3]});
+  E.remapEndpoints(V, V.removeElements({vertices[4]}));
+  ElementRef first = *V.begin();
+  ElementRef added = V.add();
+  E.add(first, added);
+
+  PathIndex evUpdated = builder.buildSegmented(ev, 0);
+  PathIndex veUpdated = builder.buildSegmented(ve, 0);
+  ASSERT_NE(evIndex, evUpdated);
+  ASSERT_NE(veIndex, veUpdated);
+  VERIFY_INDEX(evUpdated, nbrs({{0,1}, {1,2}, {2,3}, {0,4}}));
+  VERIFY_INDEX(veUpdated, nbrs({{0,3}, {0,1}, {1,2}, {2}, {3}}));
+
+  // The updated indices are memoized until the sets change again
+  ASSERT_EQ(evUpdated, builder.buildSegmented(ev, 0));
+  ASSERT_EQ(veUpdated, builder.buildSegmented(ve, 0));
+}
+
+
+TEST(pathindex, composite_update) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 3, 1, 1);  // v-e-v-e-v
+  simit::Set W;
+  simit::Set F(W,W);
+  createBox(&W, &F, 2, 1, 1);  // w-f-w
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+  builder.bind("W", &W);
+  builder.bind("F", &F);
+
+  Var vi("vi");
+  Var vj("vj");
+  Var e("e");
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+  PathIndex vevIndex = builder.buildSegmented(vev, 0);
+
+  // Indices over unchanged sets are kept when other sets change
+  W.add();
+  ASSERT_EQ(vevIndex, builder.buildSegmented(vev, 0));
+
+  // and rebuilt when their own sets change
+  ElementRef first = *V.begin();
+  ElementRef added = V.add();
+  E.add(first, added);
+  PathIndex vevUpdated = builder.buildSegmented(vev, 0);
+  ASSERT_NE(vevIndex, vevUpdated);
+  VERIFY_INDEX(vevUpdated, nbrs({{0,1,3}, {0,1,2}, {1,2}, {0,3}}));
+}
+
+
+TEST(pathindex, sliced) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 5, 1, 1);  // v-e-v-e-v-e-v-e-v
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  Var vi("vi");
+  Var vj("vj");
+  Var e("e");
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+  PathIndex vevIndex = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(vevIndex, nbrs({{0,1}, {0,1,2}, {1,2,3}, {2,3,4}, {3,4}}));
+  const SegmentedPathIndex* segmented = to<SegmentedPathIndex>(vevIndex);
+
+  // Slices of two elements, sorted by length within windows of four
+  SlicedPathIndex sliced(segmented, 2, 4);
+  ASSERT_EQ(5u, sliced.numElements());
+  ASSERT_EQ(3u, sliced.numSlices());
+  ASSERT_EQ(16u, sliced.numLocations());
+
+  vector<size_t> permutation = {1,2,3,0,4,0};
+  vector<size_t> lengths = {3,3,3,2,2,0};
+  for (size_t i = 0; i < permutation.size(); ++i) {
+    ASSERT_EQ(permutation[i], sliced.permutation(i)) << "position " << i;
+    ASSERT_EQ(lengths[i], sliced.length(i)) << "position " << i;
+  }
+  vector<size_t> sliceptr = {0,6,12,16};
+  for (size_t s = 0; s < sliceptr.size(); ++s) {
+    ASSERT_EQ(sliceptr[s], sliced.sliceptr(s));
+  }
+
+  // Slices are stored column major, and padding is 0
+  vector<size_t> sinks = {0,1, 1,2, 2,3,  2,0, 3,1, 4,0,  3,0, 4,0};
+  vector<size_t> locs  = {2,5, 3,6, 4,7,  8,0, 9,1, 10,0, 11,0, 12,0};
+  for (size_t l = 0; l < sinks.size(); ++l) {
+    ASSERT_EQ(sinks[l], sliced.sink(l)) << "location " << l;
+    ASSERT_EQ(locs[l], sliced.loc(l)) << "location " << l;
+    ASSERT_EQ(sliced.sink(l), segmented->sink(sliced.loc(l)));
+  }
+
+  // A window of one keeps the element order
+  SlicedPathIndex unsorted(segmented, 4, 1);
+  ASSERT_EQ(2u, unsorted.numSlices());
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_EQ(i, unsorted.permutation(i));
+  }
+  ASSERT_EQ(12u+8u, unsorted.numLocations());
+}
+
+TEST(pathindex, upper_triangular) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 5, 1, 1);  // v-e-v-e-v-e-v-e-v
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  Var vi("vi");
+  Var vj("vj");
+  Var e("e");
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+  PathIndex vevIndex = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(vevIndex, nbrs({{0,1}, {0,1,2}, {1,2,3}, {2,3,4}, {3,4}}));
+
+  PathIndex upperIndex = builder.buildUpperTriangular(vev, 0);
+  VERIFY_INDEX(upperIndex, nbrs({{0,1}, {1,2}, {2,3}, {3,4}, {4}}));
+  ASSERT_EQ(upperIndex, builder.buildUpperTriangular(vev, 0));
+
+  // Changing the sets rebuilds the index
+  ElementRef first = *V.begin();
+  ElementRef added = V.add();
+  E.add(first, added);
+  PathIndex upperUpdated = builder.buildUpperTriangular(vev, 0);
+  ASSERT_NE(upperIndex, upperUpdated);
+  VERIFY_INDEX(upperUpdated, nbrs({{0,1,5}, {1,2}, {2,3}, {3,4}, {4}, {5}}));
+}
+
 TEST(pathindex, and) {
   PathIndexBuilder builder;
 
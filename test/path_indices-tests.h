@@ -44,7 +44,7 @@ inline void createTestGraph0(Set* V, Set* E, Set* F) {
 /// v  v-e-v-e-v  v-f-v
 inline void createTestGraph1(Set* V, Set* E, Set* F) {
   V->add();
-  Box box = createBox(V, E, 2, 1, 1);
+  createBox(V, E, 2, 1, 1);
   ElementRef v3 = V->add();
   ElementRef v4 = V->add();
   F->add(v3, v4);
@@ -6,7 +6,6 @@
 #include "program.h"
 #include "error.h"
 #include "mesh.h"
-#include "timers.h"
 
 using namespace std;
 using namespace simit;
@@ -4,7 +4,6 @@
 #include <iostream>
 #include <vector>
 
-#include "timers.h"
 #include "program.h"
 #include "init.h"
 #include "ir.h"
@@ -30,6 +29,7 @@ void ParseEnvironmentOptions(const char *progName, const char *envvar,
 }}
 
 static bool PROFILE(false);
+static std::vector<simit::Function> profiledFunctions;
 
 #ifdef F32
 // F32 environment setup
@@ -120,13 +120,15 @@ int main(int argc, char **argv) {
   int returnValue = RUN_ALL_TESTS();
 
   if (PROFILE) {
-    simit::ir::printTimes();
+    for (const simit::Function& f : profiledFunctions) {
+      std::cout << f.getProfile();
+    }
   }
   return returnValue;
 }
 
 namespace simit {
-extern std::string kBackend;
+extern thread_local std::string kBackend;
 }
 
 std::unique_ptr<simit::backend::Backend> getTestBackend() {
@@ -144,7 +146,10 @@ simit::Function loadFunction(std::string fileName, std::string funcName="main"){
 
   simit::Function f;
   if (PROFILE) {
-    f = program.compileWithTimers(funcName);
+    f = program.compileWithProfiler(funcName);
+    if (f.defined()) {
+      profiledFunctions.push_back(f);
+    }
   } else {
     f = program.compile(funcName);
   }
@@ -164,7 +169,7 @@ simit::Function loadFunctionWithTimers(std::string fileName, std::string funcNam
     return simit::Function();
   }
 
-  simit::Function f = program.compileWithTimers(funcName);
+  simit::Function f = program.compileWithProfiler(funcName);
   
   if (!f.defined()) {
     std::cerr << program.getDiagnostics().getMessage();
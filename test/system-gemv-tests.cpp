@@ -57,6 +57,146 @@ TEST(system, gemv) {
   ASSERT_EQ(10.0, c.get(p2));
 }
 
+TEST(system, gemv_sliced) {
+  // HACK: Set kSliceHeight to multiply the matrix in sliced ELLPACK form
+  kSliceHeight = 2;
+
+  // Points
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+
+  vector<ElementRef> p;
+  for (int i = 0; i < 5; ++i) {
+    p.push_back(points.add());
+    b.set(p[i], i+1.0);
+    c.set(p[i], 42.0);
+  }
+
+  // Springs, with rows of different lengths and an odd number of rows
+  Set springs(points,points);
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  a.set(springs.add(p[0],p[1]), 1.0);
+  a.set(springs.add(p[1],p[2]), 2.0);
+  a.set(springs.add(p[1],p[3]), 3.0);
+  a.set(springs.add(p[3],p[4]), 4.0);
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  kSliceHeight = 0;
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check that outputs are correct
+  ASSERT_EQ(3.0,  c.get(p[0]));
+  ASSERT_EQ(31.0, c.get(p[1]));
+  ASSERT_EQ(10.0, c.get(p[2]));
+  ASSERT_EQ(54.0, c.get(p[3]));
+  ASSERT_EQ(36.0, c.get(p[4]));
+}
+
+TEST(system, gemv_symmetric) {
+  // HACK: Set kSymmetricMatrices to store and multiply the upper triangle
+  kSymmetricMatrices = true;
+
+  // Points
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+
+  vector<ElementRef> p;
+  for (int i = 0; i < 5; ++i) {
+    p.push_back(points.add());
+    b.set(p[i], i+1.0);
+    c.set(p[i], 42.0);
+  }
+
+  // Springs, where p1 and p3 have neighbors on both sides of the diagonal
+  Set springs(points,points);
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  a.set(springs.add(p[0],p[1]), 1.0);
+  a.set(springs.add(p[1],p[2]), 2.0);
+  a.set(springs.add(p[1],p[3]), 3.0);
+  a.set(springs.add(p[3],p[4]), 4.0);
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  kSymmetricMatrices = false;
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check that outputs are correct
+  ASSERT_EQ(3.0,  c.get(p[0]));
+  ASSERT_EQ(31.0, c.get(p[1]));
+  ASSERT_EQ(10.0, c.get(p[2]));
+  ASSERT_EQ(54.0, c.get(p[3]));
+  ASSERT_EQ(36.0, c.get(p[4]));
+}
+
+TEST(system, gemv_symmetric_blocked) {
+  // HACK: Set kSymmetricMatrices to store and multiply the upper triangle
+  kSymmetricMatrices = true;
+
+  // Points
+  Set points;
+  FieldRef<simit_float,2> b = points.addField<simit_float,2>("b");
+  FieldRef<simit_float,2> c = points.addField<simit_float,2>("c");
+
+  ElementRef p0 = points.add();
+  ElementRef p1 = points.add();
+  ElementRef p2 = points.add();
+
+  b.set(p0, {1.0, 2.0});
+  b.set(p1, {3.0, 4.0});
+  b.set(p2, {5.0, 6.0});
+
+  // Taint c
+  c.set(p0, {42.0, 42.0});
+  c.set(p2, {42.0, 42.0});
+
+  // Springs, in reverse order so that the upper triangle stores blocks that
+  // the map assembled at (p(1),p(0))
+  Set springs(points,points);
+  FieldRef<simit_float,2,2> a = springs.addField<simit_float,2,2>("a");
+
+  ElementRef s0 = springs.add(p1,p0);
+  ElementRef s1 = springs.add(p2,p1);
+
+  a.set(s0, {1.0, 2.0, 2.0, 4.0});
+  a.set(s1, {5.0, 6.0, 6.0, 8.0});
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  kSymmetricMatrices = false;
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check that outputs are correct
+  TensorRef<simit_float,2> c0 = c.get(p0);
+  ASSERT_EQ(16.0, c0(0));
+  ASSERT_EQ(32.0, c0(1));
+
+  TensorRef<simit_float,2> c1 = c.get(p1);
+  ASSERT_EQ(116.0, c1(0));
+  ASSERT_EQ(160.0, c1(1));
+
+  TensorRef<simit_float,2> c2 = c.get(p2);
+  ASSERT_EQ(100.0, c2(0));
+  ASSERT_EQ(128.0, c2(1));
+}
+
 TEST(system, gemv_stencil) {
   // Points
   Set points;
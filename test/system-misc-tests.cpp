@@ -202,6 +202,58 @@ TEST(system, transpose_gemm) {
   ASSERT_EQ(3.0, (double)b(v2));
 }
 
+TEST(system, transpose_vector_matrix) {
+  Set V;
+  FieldRef<int> b = V.addField<int>("b");
+  FieldRef<int> c = V.addField<int>("c");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  b(v0) = 1;
+  b(v1) = 2;
+  b(v2) = 3;
+
+  Set E(V,V);
+  E.add(v0,v1);
+  E.add(v1,v2);
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+
+  ASSERT_EQ(0, (int)c(v0));
+  ASSERT_EQ(6, (int)c(v1));
+  ASSERT_EQ(8, (int)c(v2));
+}
+
+TEST(system, transpose_gemv_add) {
+  Set V;
+  FieldRef<int> b = V.addField<int>("b");
+  FieldRef<int> c = V.addField<int>("c");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  b(v0) = 1;
+  b(v1) = 2;
+  b(v2) = 3;
+
+  Set E(V,V);
+  E.add(v0,v1);
+  E.add(v1,v2);
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+
+  ASSERT_EQ(1, (int)c(v0));
+  ASSERT_EQ(8, (int)c(v1));
+  ASSERT_EQ(11, (int)c(v2));
+}
+
 TEST(system, swap) {
   Set V;
   FieldRef<simit_float> val = V.addField<simit_float>("val");
@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "runtime.h"
+#include "util/parallel.h"
+#include "util/thread_pool.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(thread_pool, ranges) {
+  util::ThreadPool pool;
+  for (size_t grain : {1, 7, 64}) {
+    const size_t n = 10007;
+    vector<std::atomic<int>> counts(n);
+    for (auto& count : counts) {
+      count = 0;
+    }
+    pool.parallelFor(n, grain, [&](size_t begin, size_t end) {
+      ASSERT_LT(begin, end);
+      ASSERT_LE(end - begin, grain);
+      for (size_t i = begin; i < end; ++i) {
+        ++counts[i];
+      }
+    }, 4);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(1, counts[i]) << i;
+    }
+  }
+  EXPECT_LE(pool.getNumWorkers(), 3u);
+
+  // Loops reuse the pool's workers
+  for (int i = 0; i < 100; ++i) {
+    std::atomic<size_t> sum(0);
+    pool.parallelFor(1000, 10, [&](size_t begin, size_t end) {
+      for (size_t j = begin; j < end; ++j) {
+        sum += j;
+      }
+    }, 4, i % 2 == 0);
+    ASSERT_EQ(999u*1000/2, sum);
+  }
+  EXPECT_LE(pool.getNumWorkers(), 3u);
+}
+
+TEST(thread_pool, nested) {
+  util::ThreadPool pool;
+  std::atomic<int> count(0);
+  pool.parallelFor(8, 1, [&](size_t, size_t) {
+    // Nested loops run serially on the thread that starts them
+    std::thread::id id = std::this_thread::get_id();
+    pool.parallelFor(100, 1, [&](size_t begin, size_t end) {
+      EXPECT_EQ(id, std::this_thread::get_id());
+      count += end - begin;
+    }, 4);
+  }, 4);
+  EXPECT_EQ(800, count);
+}
+
+TEST(thread_pool, stop) {
+  util::ThreadPool pool;
+  std::atomic<int> count(0);
+  auto body = [&](size_t begin, size_t end) {
+    count += end - begin;
+  };
+  pool.parallelFor(100, 1, body, 4);
+  EXPECT_EQ(3u, pool.getNumWorkers());
+  pool.stop();
+  EXPECT_EQ(0u, pool.getNumWorkers());
+
+  // Loops after a stop start new workers
+  pool.parallelFor(100, 1, body, 4);
+  EXPECT_EQ(3u, pool.getNumWorkers());
+  EXPECT_EQ(200, count);
+}
+
+TEST(thread_pool, exceptions) {
+  util::ThreadPool pool;
+  EXPECT_THROW(pool.parallelFor(1000, 1, [](size_t begin, size_t) {
+    if (begin == 500) {
+      throw std::runtime_error("iteration failed");
+    }
+  }, 4), std::runtime_error);
+
+  // The pool still works after a loop failed
+  std::atomic<int> count(0);
+  pool.parallelFor(1000, 1, [&](size_t begin, size_t end) {
+    count += end - begin;
+  }, 4);
+  EXPECT_EQ(1000, count);
+
+  EXPECT_THROW(util::parallelFor(10, [](size_t i) {
+    if (i == 3) {
+      throw std::runtime_error("iteration failed");
+    }
+  }, 2), std::runtime_error);
+}
+
+#ifdef __linux__
+TEST(thread_pool, pinning) {
+  // Pinned workers stay within the CPUs the process may run on
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+
+  util::ThreadPool pool;
+  for (bool pinThreads : {true, false, true}) {
+    std::atomic<int> outside(0);
+    pool.parallelFor(64, 1, [&](size_t, size_t) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      sched_getaffinity(0, sizeof(cpus), &cpus);
+      CPU_AND(&cpus, &cpus, &allowed);
+      if (CPU_COUNT(&cpus) == 0 || !CPU_ISSET(sched_getcpu(), &allowed)) {
+        ++outside;
+      }
+    }, 4, pinThreads);
+    EXPECT_EQ(0, outside);
+  }
+}
+#endif
+
+static void addRange(void* closure, int64_t first, int64_t last) {
+  std::atomic<int64_t>* sum = static_cast<std::atomic<int64_t>*>(closure);
+  for (int64_t i = first; i < last; ++i) {
+    *sum += i;
+  }
+}
+
+TEST(thread_pool, simit_parallel_for) {
+  std::atomic<int64_t> sum(0);
+  simit_parallel_for(-100, 1000, 16, addRange, &sum);
+  EXPECT_EQ(999*1000/2 - 100*101/2, sum);
+
+  sum = 0;
+  simit_parallel_for(10, 10, 16, addRange, &sum);
+  EXPECT_EQ(0, sum);
+}
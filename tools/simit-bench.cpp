@@ -0,0 +1,862 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "init.h"
+#include "program.h"
+#include "function.h"
+#include "tensor.h"
+#include "util/parallel.h"
+#include "util/util.h"
+
+using namespace std;
+using namespace simit;
+
+// Benchmarks Simit programs on generated problems of a given size. Each
+// benchmark is timed in three phases: compiling its function, initializing it
+// (binding and building indices) and running it. Runs are compared against a
+// roofline estimate from the bytes and floating point operations that the
+// program must at least move and compute, and the results are written as JSON
+// so they can be compared across Simit versions.
+
+static void printUsage() {
+  cerr << "Usage: simit-bench [options]"   << endl << endl
+       << "Options:"                       << endl
+       << "-bench=<name>[,<name>...]"      << endl
+       << "-vertices=<approximate count>"  << endl
+       << "-runs=<count>"                  << endl
+       << "-bandwidth=<GB/s>"              << endl
+       << "-peak-gflops=<GFLOP/s>"         << endl
+       << "-profile"                       << endl
+       << "-o=<results.json>"              << endl << endl
+       << "Benchmarks: springs, fem, cg, pagerank, stencil, lulesh" << endl;
+}
+
+/// The least memory traffic and floating point operations of one run.
+struct Estimate {
+  double bytes = 0.0;
+  double flops = 0.0;
+};
+
+/// A benchmark's problem, bound to its compiled function.
+struct Problem {
+  vector<unique_ptr<Set>> sets;
+  vector<string> setNames;
+  Estimate estimate;
+  Function function;
+
+  /// Global float and int scalars, stored in the first component of a
+  /// vector[2] the way LULESH's externs are.
+  map<string, Tensor<double,2>> floats;
+  map<string, Tensor<int,2>> ints;
+
+  Set* add(const string& name, Set* set) {
+    sets.push_back(unique_ptr<Set>(set));
+    setNames.push_back(name);
+    return set;
+  }
+};
+
+struct Benchmark {
+  string name;
+
+  /// The program's source, or empty to load `file` from the apps directory.
+  string source;
+  string file;
+  string functionName;
+
+  /// Build the problem with about `vertices` vertices.
+  std::function<void(size_t vertices, Problem* problem)> build;
+
+  /// Bind the problem's sets to its function.
+  std::function<void(Problem* problem)> bind;
+};
+
+static const double DOUBLE = sizeof(double);
+static const double INDEX = sizeof(int);
+
+
+// Springs: explicit integration of a mass-spring box
+static const string springsSource = R"(
+element Point
+  x     : vector[3](float);
+  v     : vector[3](float);
+  m     : float;
+  fixed : bool;
+end
+
+element Spring
+  k  : float;
+  l0 : float;
+end
+
+extern points  : set{Point};
+extern springs : set{Spring}(points,points);
+
+const g    = [0.0, -9.81, 0.0]';
+const h    = 1e-6;
+const damp = 0.01;
+
+func acceleration(s : Spring, p : (Point*2))
+    -> a : vector[points](vector[3](float))
+  dx = p(1).x - p(0).x;
+  l = norm(dx);
+  U = dx/l;
+  f = s.k * (l-s.l0);
+  fe0 = f*U;
+
+  if not p(0).fixed
+    a(p(0)) =  (1.0/p(0).m) * fe0 + g;
+  end
+  if not p(1).fixed
+    a(p(1)) = -(1.0/p(1).m) * fe0 + g;
+  end
+end
+
+export func timestep()
+  a = map acceleration to springs reduce +;
+  points.v = (1.0 - damp) * points.v + h*a;
+  points.x = points.x + points.v;
+end
+)";
+
+static void buildSprings(size_t vertices, Problem* problem) {
+  unsigned n = std::max(2, (int)std::cbrt((double)vertices));
+  Set* points = problem->add("points", new Set());
+  Set* springs = problem->add("springs", new Set(*points, *points));
+  FieldRef<double,3> x = points->addField<double,3>("x");
+  points->addField<double,3>("v");
+  FieldRef<double> m = points->addField<double>("m");
+  FieldRef<bool> fixed = points->addField<bool>("fixed");
+  FieldRef<double> k = springs->addField<double>("k");
+  FieldRef<double> l0 = springs->addField<double>("l0");
+  Box box = createBox(points, springs, n, n, n);
+
+  for (unsigned i=0; i < n; ++i) {
+    for (unsigned j=0; j < n; ++j) {
+      for (unsigned l=0; l < n; ++l) {
+        ElementRef p = box(i,j,l);
+        x.set(p, {(double)i, (double)j, (double)l});
+        fixed.set(p, j == 0);
+      }
+    }
+  }
+  m.fill(1.0);
+  k.fill(1e4);
+  l0.fill(1.0);
+
+  // Per spring: read two positions, masses and fixed flags and the spring's
+  // fields, and reduce two accelerations. Per point: read v, a and x and
+  // write v and x.
+  double numSprings = springs->getSize(), numPoints = points->getSize();
+  problem->estimate.bytes = numSprings * (2*(3*DOUBLE + DOUBLE + 1) +
+                                          2*DOUBLE + 2*3*DOUBLE) +
+                            numPoints * 5*3*DOUBLE;
+  problem->estimate.flops = numSprings * 35 + numPoints * 12;
+}
+
+static void bindPointsAndSprings(Problem* problem) {
+  problem->function.bind("points", problem->sets[0].get());
+  problem->function.bind("springs", problem->sets[1].get());
+}
+
+
+// FEM: linear elastic forces of a tetrahedralized box
+static const string femSource = R"(
+element Vert
+  x : vector[3](float);
+  v : vector[3](float);
+end
+
+element Tet
+  W : float;
+  B : tensor[3,3](float);
+end
+
+extern verts : set{Vert};
+extern tets  : set{Tet}(verts, verts, verts, verts);
+
+const h = 1e-5;
+const mu = 1e3;
+
+func force(t : Tet, v : (Vert*4)) -> (f : vector[verts](vector[3](float)))
+  var Ds : tensor[3,3](float);
+  for ii in 0:3
+    for jj in 0:3
+      Ds(jj,ii) = v(ii).x(jj) - v(3).x(jj);
+    end
+  end
+  F = Ds*t.B;
+  I = [1.0, 0.0, 0.0; 0.0, 1.0, 0.0; 0.0, 0.0, 1.0];
+  P = mu*(F + F' - 2.0*I);
+  H = -t.W * P * t.B';
+  for ii in 0:3
+    f(v(ii)) = H(:,ii);
+    f(v(3)) = -H(:,ii);
+  end
+end
+
+export func timestep()
+  f = map force to tets reduce +;
+  verts.v = verts.v + h*f;
+  verts.x = verts.x + h*verts.v;
+end
+)";
+
+static void buildFEM(size_t vertices, Problem* problem) {
+  unsigned n = std::max(2, (int)std::cbrt((double)vertices));
+  Set* verts = problem->add("verts", new Set());
+  Set* tets = problem->add("tets", new Set(*verts, *verts, *verts, *verts));
+  FieldRef<double,3> x = verts->addField<double,3>("x");
+  verts->addField<double,3>("v");
+  FieldRef<double> W = tets->addField<double>("W");
+  FieldRef<double,3,3> B = tets->addField<double,3,3>("B");
+  Box box = createTetBox(verts, tets, n, n, n);
+
+  for (unsigned i=0; i < n; ++i) {
+    for (unsigned j=0; j < n; ++j) {
+      for (unsigned l=0; l < n; ++l) {
+        x.set(box(i,j,l), {(double)i, (double)j, (double)l});
+      }
+    }
+  }
+
+  // B is the inverse of the rest shape matrix, whose columns are the edges
+  // from the tet's last vertex
+  const double (*xs)[3] = x.data();
+  for (ElementRef tet : *tets) {
+    double D[3][3];
+    for (int i=0; i < 3; ++i) {
+      for (int j=0; j < 3; ++j) {
+        D[j][i] = xs[tets->getEndpoint(tet, i).getIdent()][j] -
+                  xs[tets->getEndpoint(tet, 3).getIdent()][j];
+      }
+    }
+    double det = D[0][0]*(D[1][1]*D[2][2] - D[1][2]*D[2][1]) -
+                 D[0][1]*(D[1][0]*D[2][2] - D[1][2]*D[2][0]) +
+                 D[0][2]*(D[1][0]*D[2][1] - D[1][1]*D[2][0]);
+    double Binv[9];
+    for (int i=0; i < 3; ++i) {
+      for (int j=0; j < 3; ++j) {
+        // The cofactor of D(j,i) over the determinant
+        int r0 = (j+1)%3, r1 = (j+2)%3, c0 = (i+1)%3, c1 = (i+2)%3;
+        Binv[i*3+j] = (D[r0][c0]*D[r1][c1] - D[r0][c1]*D[r1][c0]) / det;
+      }
+    }
+    B.set(tet, {Binv[0], Binv[1], Binv[2], Binv[3], Binv[4], Binv[5],
+                Binv[6], Binv[7], Binv[8]});
+    W.set(tet, std::abs(det) / 6.0);
+  }
+
+  // Per tet: read four positions, W and B, and reduce four forces. Per
+  // vertex: read v, f and x and write v and x.
+  double numTets = tets->getSize(), numVerts = verts->getSize();
+  problem->estimate.bytes = numTets * (4*3*DOUBLE + 10*DOUBLE + 4*3*DOUBLE) +
+                            numVerts * 5*3*DOUBLE;
+  problem->estimate.flops = numTets * 180 + numVerts * 12;
+}
+
+static void bindFEM(Problem* problem) {
+  problem->function.bind("verts", problem->sets[0].get());
+  problem->function.bind("tets", problem->sets[1].get());
+}
+
+
+// CG: a fixed number of conjugate gradient iterations on a spring laplacian
+static const int CG_ITERATIONS = 50;
+
+static const string cgSource = R"(
+element Point
+  b  : float;
+  c  : float;
+end
+
+element Spring
+  a : float;
+end
+
+extern points  : set{Point};
+extern springs : set{Spring}(points,points);
+
+func f(s : Spring, p : (Point*2)) -> (A : tensor[points,points](float))
+  A(p(0),p(0)) =  s.a;
+  A(p(0),p(1)) = -s.a;
+  A(p(1),p(0)) = -s.a;
+  A(p(1),p(1)) =  s.a;
+end
+
+func eye(p : Point) -> (I : tensor[points,points](float))
+  I(p,p) = 1.0;
+end
+
+export func main()
+  b = points.b;
+  I = map eye to points reduce +;
+  A = I + 0.01 * (map f to springs reduce +);
+
+  var x : vector[points](float) = 0.0;
+  var r = b - (A*x);
+  var p = r;
+  for i in 0:)" + to_string(CG_ITERATIONS) + R"(
+    Ap = A * p;
+    denom = dot(p, Ap);
+    oldrsqn = dot(r, r);
+    alpha = oldrsqn / denom;
+    x = x + alpha*p;
+    r = r - alpha * Ap;
+    newrsqn = dot(r, r);
+    beta = newrsqn / oldrsqn;
+    p = r + beta*p;
+  end
+  points.c = x;
+end
+)";
+
+static void buildCG(size_t vertices, Problem* problem) {
+  unsigned n = std::max(2, (int)std::cbrt((double)vertices));
+  Set* points = problem->add("points", new Set());
+  Set* springs = problem->add("springs", new Set(*points, *points));
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  FieldRef<double> a = springs->addField<double>("a");
+  createBox(points, springs, n, n, n);
+  b.fill(1.0);
+  a.fill(1.0);
+
+  // Assembly writes each spring's four matrix components. An iteration
+  // multiplies the matrix (a value and a column index per nonzero, and the
+  // vector's components) and makes five more passes over vectors.
+  double numSprings = springs->getSize(), numPoints = points->getSize();
+  double nonzeros = numPoints + 2*numSprings;
+  double assembly = numSprings * (DOUBLE + 4*DOUBLE) + numPoints * DOUBLE;
+  double iteration = nonzeros * (DOUBLE + INDEX) + numPoints * 2*DOUBLE +
+                     numPoints * 5*2*DOUBLE;
+  problem->estimate.bytes = assembly + CG_ITERATIONS * iteration;
+  problem->estimate.flops = numSprings * 4 +
+                            CG_ITERATIONS * (2*nonzeros + 10*numPoints);
+}
+
+
+// PageRank: power iterations on an R-MAT graph
+static const int PAGERANK_ITERATIONS = 20;
+
+static const string pagerankSource = R"(
+element Page
+  outlinks : float;
+  pr       : float;
+end
+
+element Link
+end
+
+extern pages : set{Page};
+extern links : set{Link}(pages,pages);
+
+func pagerank_matrix(link : Link, p : (Page*2))
+    -> (A : tensor[pages,pages](float))
+  A(p(1),p(0)) = 0.85 / p(0).outlinks;
+end
+
+export func main()
+  A = map pagerank_matrix to links reduce +;
+  pages.pr = 1.0;
+  for i in 0:)" + to_string(PAGERANK_ITERATIONS) + R"(
+    pages.pr = A * pages.pr + (1.0 - 0.85);
+  end
+end
+)";
+
+static void buildPageRank(size_t vertices, Problem* problem) {
+  unsigned scale = std::max(1, (int)std::log2((double)vertices));
+  Set* pages = problem->add("pages", new Set());
+  Set* links = problem->add("links", new Set(*pages, *pages));
+  FieldRef<double> outlinks = pages->addField<double>("outlinks");
+  pages->addField<double>("pr");
+  createPowerLawGraph(pages, links, scale, 16);
+
+  vector<double> degrees(pages->getSize(), 0.0);
+  for (ElementRef link : *links) {
+    degrees[links->getEndpoint(link, 0).getIdent()] += 1.0;
+  }
+  for (double& degree : degrees) {
+    degree = std::max(degree, 1.0);
+  }
+  outlinks.assign(0, degrees.size(), degrees.data());
+
+  // Assembly reads each link's source degree and writes its matrix value. An
+  // iteration multiplies the matrix and reads and writes the ranks.
+  double numLinks = links->getSize(), numPages = pages->getSize();
+  double iteration = numLinks * (DOUBLE + INDEX) + numPages * 3*DOUBLE;
+  problem->estimate.bytes = numLinks * (2*INDEX + 2*DOUBLE) +
+                            PAGERANK_ITERATIONS * iteration;
+  problem->estimate.flops = numLinks +
+                            PAGERANK_ITERATIONS * (2*numLinks + 2*numPages);
+}
+
+static void bindPageRank(Problem* problem) {
+  problem->function.bind("pages", problem->sets[0].get());
+  problem->function.bind("links", problem->sets[1].get());
+}
+
+
+// Stencil: repeated five-point stencil products on a periodic 2D grid
+static const int STENCIL_ITERATIONS = 10;
+
+static const string stencilSource = R"(
+element Point
+  b : float;
+  c : float;
+end
+
+element Link
+  a : float;
+end
+
+extern points : set{Point};
+extern springs : grid[2]{Link}(points);
+
+func vonNeumann(orig : Point,
+                l : grid[2]{Link}(points))
+    -> (vnMat : tensor[points,points](float))
+    vnMat(orig,orig) = l[0,0;0,1].a + l[0,0;0,-1].a +
+                     l[0,0;1,0].a + l[0,0;-1,0].a;
+    vnMat(orig,points[0,1]) = l[0,0;0,1].a;
+    vnMat(orig,points[0,-1]) = l[0,0;0,-1].a;
+    vnMat(orig,points[1,0]) = l[0,0;1,0].a;
+    vnMat(orig,points[-1,0]) = l[0,0;-1,0].a;
+end
+
+export func main()
+  B = map vonNeumann to points through springs;
+  for i in 0:)" + to_string(STENCIL_ITERATIONS) + R"(
+    points.c = B*points.b;
+    points.b = 0.125*points.c;
+  end
+end
+)";
+
+static void buildStencil(size_t vertices, Problem* problem) {
+  int n = std::max(2, (int)std::sqrt((double)vertices));
+  Set* points = problem->add("points", new Set());
+  Set* springs = problem->add("springs", new Set(*points, {n, n}));
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  FieldRef<double> a = springs->addField<double>("a");
+  b.fill(1.0);
+  a.fill(1.0);
+
+  // Assembly reads four link values per point and writes five stencil
+  // values. An iteration multiplies by the stencil and scales the result.
+  double numPoints = points->getSize();
+  double iteration = numPoints * (5*DOUBLE + 2*DOUBLE) + numPoints * 2*DOUBLE;
+  problem->estimate.bytes = numPoints * 9*DOUBLE +
+                            STENCIL_ITERATIONS * iteration;
+  problem->estimate.flops = numPoints * 3 +
+                            STENCIL_ITERATIONS * (10*numPoints);
+}
+
+
+// LULESH: cycles of the Sedov blast problem on a hexahedral box, with the
+// program from apps/lulesh
+static void buildLULESH(size_t vertices, Problem* problem) {
+  int nx = std::max(1, (int)std::cbrt((double)vertices) - 1);
+  int edgeNodes = nx + 1;
+  int numElems = nx*nx*nx;
+  Set* nodes = problem->add("nodes", new Set());
+  Set* elems = problem->add("elems", new Set(*nodes, *nodes, *nodes, *nodes,
+                                             *nodes, *nodes, *nodes, *nodes));
+  Set* connects = problem->add("connects",
+                               new Set(*elems, *elems, *elems, *elems,
+                                       *elems, *elems, *elems));
+  Set* symmX = problem->add("symmX", new Set(*nodes));
+  Set* symmY = problem->add("symmY", new Set(*nodes));
+  Set* symmZ = problem->add("symmZ", new Set(*nodes));
+
+  FieldRef<double,3> coord = nodes->addField<double,3>("coord");
+  nodes->addField<double,3>("coord_local");
+  nodes->addField<double,3>("vel");
+  nodes->addField<double,3>("a");
+  nodes->addField<double,3>("f");
+  FieldRef<double> nodalMass = nodes->addField<double>("nodalMass");
+  nodes->addField<int,3>("symm");
+
+  FieldRef<int,3,6> elemBC = elems->addField<int,3,6>("elemBC");
+  elems->addField<double,3>("dxyz");
+  elems->addField<double,3>("delvel");
+  elems->addField<double,3>("delx");
+  FieldRef<double> e = elems->addField<double>("e");
+  for (const char* name : {"p", "q", "ql", "qq", "delv", "vdov", "arealg",
+                           "ss"}) {
+    elems->addField<double>(name);
+  }
+  FieldRef<double> v = elems->addField<double>("v");
+  FieldRef<double> volo = elems->addField<double>("volo");
+  FieldRef<double> elemMass = elems->addField<double>("elemMass");
+
+  // A uniform box of side 1.125, with nodes numbered by plane, row and
+  // column as in LULESH's BuildMesh
+  vector<ElementRef> nodeRefs;
+  for (int plane=0; plane < edgeNodes; ++plane) {
+    for (int row=0; row < edgeNodes; ++row) {
+      for (int col=0; col < edgeNodes; ++col) {
+        ElementRef node = nodes->add();
+        coord.set(node, {1.125*col/nx, 1.125*row/nx, 1.125*plane/nx});
+        nodeRefs.push_back(node);
+      }
+    }
+  }
+
+  // Every element has the same volume. Faces on the minimum planes are
+  // symmetry planes and faces on the maximum planes are free surfaces. The
+  // rows of elemBC flag communication, symmetry and free faces, and the
+  // columns are the -xi, +xi, -eta, +eta, -zeta and +zeta faces.
+  double volume = std::pow(1.125/nx, 3);
+  vector<double> masses(nodes->getSize(), 0.0);
+  vector<ElementRef> elemRefs;
+  for (int plane=0; plane < nx; ++plane) {
+    for (int row=0; row < nx; ++row) {
+      for (int col=0; col < nx; ++col) {
+        int n = (plane*edgeNodes + row)*edgeNodes + col;
+        int corners[8] = {n, n+1, n+edgeNodes+1, n+edgeNodes};
+        for (int i=0; i < 4; ++i) {
+          corners[i+4] = corners[i] + edgeNodes*edgeNodes;
+        }
+        ElementRef elem = elems->add(
+            nodeRefs[corners[0]], nodeRefs[corners[1]], nodeRefs[corners[2]],
+            nodeRefs[corners[3]], nodeRefs[corners[4]], nodeRefs[corners[5]],
+            nodeRefs[corners[6]], nodeRefs[corners[7]]);
+        for (int corner : corners) {
+          masses[corner] += volume / 8.0;
+        }
+        v.set(elem, 1.0);
+        volo.set(elem, volume);
+        elemMass.set(elem, volume);
+        elemBC.set(elem, {0, 0, 0, 0, 0, 0,
+                          col == 0, 0, row == 0, 0, plane == 0, 0,
+                          0, col == nx-1, 0, row == nx-1, 0, plane == nx-1});
+        elemRefs.push_back(elem);
+      }
+    }
+  }
+  nodalMass.assign(0, masses.size(), masses.data());
+
+  // The neighbors of each element across its faces, where elements on the
+  // boundary are their own neighbors as in SetupElementConnectivities
+  int planeSize = nx*nx;
+  for (int i=0; i < numElems; ++i) {
+    connects->add(elemRefs[i],
+                  elemRefs[std::max(i-1, 0)],
+                  elemRefs[std::min(i+1, numElems-1)],
+                  elemRefs[i < nx ? i : i-nx],
+                  elemRefs[i >= numElems-nx ? i : i+nx],
+                  elemRefs[i < planeSize ? i : i-planeSize],
+                  elemRefs[i >= numElems-planeSize ? i : i+planeSize]);
+  }
+
+  for (int i=0; i < edgeNodes; ++i) {
+    for (int j=0; j < edgeNodes; ++j) {
+      symmX->add(nodeRefs[(i*edgeNodes + j)*edgeNodes]);
+      symmY->add(nodeRefs[i*edgeNodes*edgeNodes + j]);
+      symmZ->add(nodeRefs[i*edgeNodes + j]);
+    }
+  }
+
+  // Deposit the blast energy, scaled from 45 elements per side, in the
+  // element at the origin
+  double einit = 3.948746e+7 * std::pow(nx/45.0, 3);
+  e.set(elemRefs[0], einit);
+
+  // The stop time is never reached, and a frequency of one returns after
+  // every cycle, so each run is one cycle
+  map<string,double> floats = {
+    {"time", 0.0}, {"stoptime", 1.0e+20}, {"dtfixed", -1.0e-6},
+    {"deltatime", 0.5*std::cbrt(volume) / std::sqrt(2.0*einit)},
+    {"dtcourant", 1.0e+20}, {"dthydro", 1.0e+20}, {"dtmax", 1.0e-2},
+    {"deltatimemultlb", 1.1}, {"deltatimemultub", 1.2},
+    {"hgcoef", 3.0}, {"u_cut", 1.0e-7}, {"qstop", 1.0e+12},
+    {"monoq_limiter_mult", 2.0}, {"monoq_max_slope", 1.0},
+    {"qlc_monoq", 0.5}, {"qqc_monoq", 2.0/3.0}, {"qqc", 2.0},
+    {"eosvmin", 1.0e-9}, {"eosvmax", 1.0e+9}, {"v_cut", 1.0e-10},
+    {"dvovmax", 0.1}, {"rho0", 1.0}, {"ss4o3", 4.0/3.0},
+    {"e_cut", 1.0e-7}, {"p_cut", 1.0e-7}, {"q_cut", 1.0e-7},
+    {"emin", -1.0e+15}, {"pmin", 0.0}
+  };
+  for (auto& scalar : floats) {
+    problem->floats[scalar.first](0) = scalar.second;
+  }
+  map<string,int> ints = {
+    {"cycle", 0}, {"iterMax", INT_MAX}, {"showProg", 0}, {"frequency", 1}
+  };
+  for (auto& scalar : ints) {
+    problem->ints[scalar.first](0) = scalar.second;
+  }
+
+  // LULESH's kernels are too many to count exactly. Per cycle, every
+  // element reads its eight nodes and reads and writes its own state, and
+  // every node reads and writes its position, velocity, acceleration and
+  // force. The flops are a rough count of the element kernels, which
+  // dominate the run.
+  double numNodes = nodes->getSize();
+  problem->estimate.bytes = numElems * (8*INDEX + 8*2*3*DOUBLE +
+                                        2*21*DOUBLE + 18*INDEX) +
+                            numNodes * 2*(4*3*DOUBLE + DOUBLE);
+  problem->estimate.flops = numElems * 1500.0;
+}
+
+static void bindLULESH(Problem* problem) {
+  for (size_t i=0; i < problem->sets.size(); ++i) {
+    problem->function.bind(problem->setNames[i], problem->sets[i].get());
+  }
+  for (auto& scalar : problem->floats) {
+    problem->function.bind(scalar.first, &scalar.second);
+  }
+  for (auto& scalar : problem->ints) {
+    problem->function.bind(scalar.first, &scalar.second);
+  }
+}
+
+static const vector<Benchmark> benchmarks = {
+  {"springs",  springsSource,  "", "timestep", buildSprings,
+   bindPointsAndSprings},
+  {"fem",      femSource,      "", "timestep", buildFEM, bindFEM},
+  {"cg",       cgSource,       "", "main",     buildCG, bindPointsAndSprings},
+  {"pagerank", pagerankSource, "", "main",     buildPageRank, bindPageRank},
+  {"stencil",  stencilSource,  "", "main",     buildStencil,
+   bindPointsAndSprings},
+  {"lulesh",   "", "lulesh/lulesh.sim", "lulesh_sim", buildLULESH, bindLULESH}
+};
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/// Measure the memory bandwidth in GB/s with a STREAM triad on all threads.
+static double measureBandwidth() {
+  const size_t n = 1 << 24;
+  vector<double> a(n), b(n, 1.0), c(n, 2.0);
+  const size_t blockSize = 1 << 16;
+  auto triad = [&](size_t block) {
+    for (size_t i=block*blockSize; i < (block+1)*blockSize; ++i) {
+      a[i] = b[i] + 3.0*c[i];
+    }
+  };
+  util::parallelFor(n/blockSize, triad);
+  double best = 0.0;
+  for (int i=0; i < 5; ++i) {
+    auto start = chrono::steady_clock::now();
+    util::parallelFor(n/blockSize, triad);
+    best = std::max(best, 3*n*sizeof(double) / secondsSince(start) / 1e9);
+  }
+  return best;
+}
+
+struct Result {
+  string name;
+  size_t vertices;
+  vector<pair<string,int>> setSizes;
+  double compileSeconds;
+  double initSeconds;
+  vector<double> runSeconds;
+  Estimate estimate;
+  Profile profile;
+  bool profiled;
+};
+
+static int runBenchmark(const Benchmark& benchmark, size_t vertices, int runs,
+                        bool profile, Result* result) {
+  result->name = benchmark.name;
+  result->vertices = vertices;
+  result->profiled = profile;
+
+  Problem problem;
+  benchmark.build(vertices, &problem);
+  for (size_t i=0; i < problem.sets.size(); ++i) {
+    result->setSizes.push_back({problem.setNames[i],
+                                problem.sets[i]->getSize()});
+  }
+  result->estimate = problem.estimate;
+
+  auto start = chrono::steady_clock::now();
+  Program program;
+  int status = benchmark.source.empty()
+      ? program.loadFile(string(APPS_DIR) + "/" + benchmark.file)
+      : program.loadString(benchmark.source);
+  if (status != 0) {
+    cerr << "Error: " << benchmark.name << " does not parse: "
+         << program.getDiagnostics() << endl;
+    return 1;
+  }
+  problem.function = profile ? program.compileWithTimers(benchmark.functionName)
+                             : program.compile(benchmark.functionName);
+  if (!problem.function.defined()) {
+    cerr << "Error: " << benchmark.name << " does not compile" << endl;
+    return 1;
+  }
+  result->compileSeconds = secondsSince(start);
+
+  start = chrono::steady_clock::now();
+  benchmark.bind(&problem);
+  problem.function.init();
+  result->initSeconds = secondsSince(start);
+
+  // Unmap the arguments before each run and map them back after, as
+  // runSafe does, but only time the run
+  for (int i=0; i < runs; ++i) {
+    problem.function.unmapArgs();
+    start = chrono::steady_clock::now();
+    problem.function.run();
+    result->runSeconds.push_back(secondsSince(start));
+    problem.function.mapArgs();
+  }
+  if (profile) {
+    result->profile = problem.function.getProfile();
+  }
+  return 0;
+}
+
+static void writeJSON(ostream& os, const vector<Result>& results,
+                      double bandwidth, double peakGflops) {
+  os << std::setprecision(6);
+  os << "{" << endl;
+  os << "  \"threads\": " << util::numWorkerThreads() << "," << endl;
+  os << "  \"bandwidthGBs\": " << bandwidth << "," << endl;
+  os << "  \"peakGFLOPs\": " << peakGflops << "," << endl;
+  os << "  \"benchmarks\": [";
+  for (size_t i=0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    vector<double> sorted = result.runSeconds;
+    std::sort(sorted.begin(), sorted.end());
+    double best = sorted.front();
+    double median = sorted[sorted.size()/2];
+    double intensity = result.estimate.flops / result.estimate.bytes;
+    double roofline = intensity * bandwidth;
+    if (peakGflops > 0.0) {
+      roofline = std::min(roofline, peakGflops);
+    }
+    double gflops = result.estimate.flops / best / 1e9;
+
+    os << (i == 0 ? "" : ",") << endl;
+    os << "    {" << endl;
+    os << "      \"name\": \"" << result.name << "\"," << endl;
+    os << "      \"vertices\": " << result.vertices << "," << endl;
+    os << "      \"sets\": {";
+    for (size_t s=0; s < result.setSizes.size(); ++s) {
+      os << (s == 0 ? "" : ", ") << "\"" << result.setSizes[s].first
+         << "\": " << result.setSizes[s].second;
+    }
+    os << "}," << endl;
+    os << "      \"compileSeconds\": " << result.compileSeconds << "," << endl;
+    os << "      \"initSeconds\": " << result.initSeconds << "," << endl;
+    os << "      \"runSeconds\": {\"min\": " << best
+       << ", \"median\": " << median
+       << ", \"runs\": " << sorted.size() << "}," << endl;
+    os << "      \"bytes\": " << result.estimate.bytes << "," << endl;
+    os << "      \"flops\": " << result.estimate.flops << "," << endl;
+    os << "      \"arithmeticIntensity\": " << intensity << "," << endl;
+    os << "      \"GBs\": " << result.estimate.bytes / best / 1e9 << ","
+       << endl;
+    os << "      \"GFLOPs\": " << gflops << "," << endl;
+    os << "      \"rooflineGFLOPs\": " << roofline << "," << endl;
+    os << "      \"rooflineFraction\": " << gflops / roofline;
+    if (result.profiled) {
+      os << "," << endl << "      \"profile\": ";
+      result.profile.writeJSON(os);
+    }
+    os << endl << "    }";
+  }
+  os << endl << "  ]" << endl;
+  os << "}" << endl;
+}
+
+int main(int argc, const char* argv[]) {
+  vector<string> names;
+  size_t vertices = 1 << 20;
+  int runs = 10;
+  double bandwidth = 0.0;
+  double peakGflops = 0.0;
+  bool profile = false;
+  string outputFile;
+
+  for (int i=1; i < argc; ++i) {
+    string arg = argv[i];
+    std::vector<std::string> keyValPair = simit::util::split(arg, "=");
+    if (arg == "-profile") {
+      profile = true;
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-bench") {
+      names = simit::util::split(keyValPair[1], ",");
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-vertices") {
+      vertices = std::stoul(keyValPair[1]);
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-runs") {
+      runs = std::max(1, std::stoi(keyValPair[1]));
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-bandwidth") {
+      bandwidth = std::stod(keyValPair[1]);
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-peak-gflops") {
+      peakGflops = std::stod(keyValPair[1]);
+    }
+    else if (keyValPair.size() == 2 && keyValPair[0] == "-o") {
+      outputFile = keyValPair[1];
+    }
+    else {
+      printUsage();
+      return 3;
+    }
+  }
+  if (names.empty()) {
+    for (const Benchmark& benchmark : benchmarks) {
+      names.push_back(benchmark.name);
+    }
+  }
+
+  simit::init("cpu", sizeof(double));
+  if (bandwidth <= 0.0) {
+    bandwidth = measureBandwidth();
+  }
+
+  vector<Result> results;
+  for (const string& name : names) {
+    auto benchmark = std::find_if(benchmarks.begin(), benchmarks.end(),
+        [&](const Benchmark& b) {return b.name == name;});
+    if (benchmark == benchmarks.end()) {
+      cerr << "Error: no benchmark " << name << endl;
+      printUsage();
+      return 3;
+    }
+    Result result;
+    if (runBenchmark(*benchmark, vertices, runs, profile, &result) != 0) {
+      return 1;
+    }
+    cerr << name << ": compile " << result.compileSeconds << "s, init "
+         << result.initSeconds << "s, run "
+         << *std::min_element(result.runSeconds.begin(),
+                              result.runSeconds.end()) << "s" << endl;
+    results.push_back(result);
+  }
+
+  if (outputFile.empty()) {
+    writeJSON(cout, results, bandwidth, peakGflops);
+  }
+  else {
+    ofstream out(outputFile);
+    if (!out.good()) {
+      cerr << "Error: Could not open file " << outputFile << endl;
+      return 2;
+    }
+    writeJSON(out, results, bandwidth, peakGflops);
+  }
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include "ir_printer.h"
 #include "ir_rewriter.h"
 #include "lower/lower.h"
+#include "lower/pass_manager.h"
 #include "temps.h"
 #include "flatten.h"
 #include "frontend/frontend.h"
@@ -32,6 +33,10 @@ static void printUsage() {
        << "-single-float"       << endl
        << "-compile=<function>" << endl
        << "-section=<section>"  << endl
+       << "-time-passes"        << endl
+       << "-skip-passes=<pass>,<pass>,..." << endl
+       << "-passes=<pass>,<pass>,..."      << endl
+       << "-vectorization-report"          << endl
        << "-gpu";
 }
 const ios_base::openmode outputMode = ios_base::trunc;
@@ -51,6 +56,9 @@ int main(int argc, const char* argv[]) {
   bool compile = false;
   bool fileoutput = false;
   bool gpu = false;
+  bool timePasses = false;
+  bool vectorizationReport = false;
+  ir::PassOptions passOptions;
 
   ostream* simitos = nullptr;
   ostream* llvmos  = nullptr;
@@ -97,6 +105,12 @@ int main(int argc, const char* argv[]) {
           singleFloat = true;
           gpu = true;
         }
+        else if (arg == "-time-passes") {
+          timePasses = true;
+        }
+        else if (arg == "-vectorization-report") {
+          vectorizationReport = true;
+        }
         else {
           printUsage();
           return 3;
@@ -110,6 +124,14 @@ int main(int argc, const char* argv[]) {
           compile = true;
           function = keyValPair[1];
         }
+        else if (keyValPair[0] == "-skip-passes") {
+          for (const string& pass : simit::util::split(keyValPair[1], ",")) {
+            passOptions.skip.insert(pass);
+          }
+        }
+        else if (keyValPair[0] == "-passes") {
+          passOptions.order = simit::util::split(keyValPair[1], ",");
+        }
         else {
           printUsage();
           return 3;
@@ -150,9 +172,11 @@ int main(int argc, const char* argv[]) {
     }
   }
 
-  std::string backend = gpu ? "gpu" : "cpu";
-  size_t floatSize = singleFloat ? sizeof(float) : sizeof(double);
-  simit::init(backend, floatSize);
+  Settings settings;
+  settings.backend = gpu ? "gpu" : "cpu";
+  settings.floatSize = singleFloat ? sizeof(float) : sizeof(double);
+  settings.vectorizationReport = vectorizationReport;
+  simit::init(settings);
 
   std::string source;
   int status = simit::util::loadText(sourceFile, &source);
@@ -251,7 +275,14 @@ int main(int argc, const char* argv[]) {
       *simitos << "% Compile " << function << endl;
     }
 
-    func = lower(func, simitos);
+    std::vector<ir::PassTiming> timings;
+    if (timePasses) {
+      passOptions.timings = &timings;
+    }
+    func = lower(func, simitos, nullptr, nullptr, &passOptions);
+    if (timePasses) {
+      ir::printPassTimings(timings, cerr);
+    }
 
     // Emit and print llvm code
     // NB: The LLVM code gets further optimized at init time (OSR, etc.)
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "binary_mesh.h"
+#include "graph.h"
+#include "mesh.h"
+using namespace std;
+
+// Converts TetGen (.node and .ele) and obj meshes to binary meshes, with the
+// vertex set "verts" (field "x") and the element set "tets" or "tris".
+
+static void printUsage() {
+  cerr << "Usage: simit-mesh [-float] [-compress] <mesh.node mesh.ele | "
+       << "mesh.obj> <out.smsh>" << endl;
+}
+
+static bool endsWith(const string& str, const string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size()-suffix.size(), suffix.size(), suffix) == 0;
+}
+
+template <typename T>
+static void addVerts(simit::Set* verts, const vector<double>& coordinates) {
+  simit::FieldRef<T,3> x = verts->addField<T,3>("x");
+  verts->addElements(coordinates.size()/3);
+  for (simit::ElementRef vert : *verts) {
+    const double* v = &coordinates[3*vert.getIdent()];
+    x.set(vert, {(T)v[0], (T)v[1], (T)v[2]});
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  bool singlePrecision = false;
+  simit::MeshCompression compression = simit::MeshCompression::None;
+  vector<string> files;
+  for (int i=1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "-float") {
+      singlePrecision = true;
+    }
+    else if (arg == "-compress") {
+      compression = simit::MeshCompression::ZeroRuns;
+    }
+    else if (arg[0] == '-') {
+      printUsage();
+      return 3;
+    }
+    else {
+      files.push_back(arg);
+    }
+  }
+
+  simit::MeshArrays mesh;
+  if (files.size() == 3 && endsWith(files[0], ".node")) {
+    if (mesh.loadTet(files[0], files[1]) != 0) {
+      cerr << "Error loading " << files[0] << " and " << files[1] << endl;
+      return 2;
+    }
+    if (mesh.elementSize != 4) {
+      cerr << "Only linear tetrahedra are supported" << endl;
+      return 1;
+    }
+  }
+  else if (files.size() == 2 && endsWith(files[0], ".obj")) {
+    if (mesh.loadObj(files[0]) != 0) {
+      cerr << "Error loading " << files[0] << endl;
+      return 2;
+    }
+  }
+  else {
+    printUsage();
+    return 3;
+  }
+
+  simit::Set verts;
+  if (singlePrecision) {
+    addVerts<float>(&verts, mesh.v);
+  }
+  else {
+    addVerts<double>(&verts, mesh.v);
+  }
+
+  // The flat element arrays are the sets' endpoints
+  simit::Set tets(verts, verts, verts, verts);
+  simit::Set tris(verts, verts, verts);
+  simit::Set& elems = (mesh.elementSize == 4) ? tets : tris;
+  elems.addElements(mesh.numElements(), mesh.e.data());
+
+  simit::BinaryMeshWriter writer(compression);
+  writer.addSet("verts", &verts);
+  writer.addSet(mesh.elementSize == 4 ? "tets" : "tris", &elems);
+  if (writer.save(files.back()) != 0) {
+    return 1;
+  }
+  cout << "Wrote " << mesh.numVertices() << " vertices and "
+       << mesh.numElements() << " elements to " << files.back() << endl;
+  return 0;
+}